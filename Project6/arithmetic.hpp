@@ -0,0 +1,96 @@
+#ifndef ARITHMETIC_HPP
+#define ARITHMETIC_HPP
+
+// Integer operations both engines and the bytecode passes need to agree on.
+// Results wrap around at 32 bits like the rest of the arithmetic.
+
+// +, -, * and unary - on the two's complement bits, as signed overflow is
+// undefined in C++
+inline int wrappingAdd(int lhs, int rhs) {
+    return static_cast<int>(static_cast<unsigned>(lhs) + static_cast<unsigned>(rhs));
+}
+
+inline int wrappingSubtract(int lhs, int rhs) {
+    return static_cast<int>(static_cast<unsigned>(lhs) - static_cast<unsigned>(rhs));
+}
+
+inline int wrappingMultiply(int lhs, int rhs) {
+    return static_cast<int>(static_cast<unsigned>(lhs) * static_cast<unsigned>(rhs));
+}
+
+inline int wrappingNegate(int value) {
+    return static_cast<int>(0u - static_cast<unsigned>(value));
+}
+
+// lhs / rhs and lhs % rhs rounded toward zero, for any rhs but 0, which the
+// callers report. The one quotient that does not fit, INT_MIN / -1, wraps
+// around to INT_MIN and leaves 0, where the hardware would trap.
+inline int wrappingDivide(int lhs, int rhs) {
+    return rhs == -1 ? wrappingNegate(lhs) : lhs / rhs;
+}
+
+inline int wrappingModulo(int lhs, int rhs) {
+    return rhs == -1 ? 0 : lhs % rhs;
+}
+
+// base ^ exponent has no value: 0 to a negative power
+inline bool powerDividesByZero(int base, int exponent) {
+    return base == 0 && exponent < 0;
+}
+
+// base ^ exponent by squaring. A negative exponent is 1 / base ^ -exponent
+// rounded toward zero, so only 1 and -1 give anything but 0.
+inline int integerPower(int base, int exponent) {
+    if (exponent < 0) {
+        if (base == 1) {
+            return 1;
+        }
+        if (base == -1) {
+            return exponent % 2 ? -1 : 1;
+        }
+        return 0;
+    }
+
+    unsigned result = 1;
+    unsigned factor = static_cast<unsigned>(base);
+    while (exponent) {
+        if (exponent & 1) {
+            result *= factor;
+        }
+        factor *= factor;
+        exponent >>= 1;
+    }
+    return static_cast<int>(result);
+}
+
+// log2 of value when it is a power of two from 2 to 2^30, else -1
+inline int powerOfTwo(int value) {
+    if (value < 2 || (value & (value - 1))) {
+        return -1;
+    }
+    int shift = 0;
+    while (value >>= 1) {
+        shift++;
+    }
+    return shift;
+}
+
+// value * 2^shift
+inline int multiplyByPowerOfTwo(int value, int shift) {
+    return static_cast<int>(static_cast<unsigned>(value) << shift);
+}
+
+// value / 2^shift, rounded toward zero like /. An arithmetic shift rounds
+// down, so negative values are biased by 2^shift - 1 first.
+inline int divideByPowerOfTwo(int value, int shift) {
+    int bias = static_cast<int>(static_cast<unsigned>(value >> 31) >> (32 - shift));
+    return (value + bias) >> shift;
+}
+
+// value % 2^shift, negative like the value as with %
+inline int moduloPowerOfTwo(int value, int shift) {
+    int bias = static_cast<int>(static_cast<unsigned>(value >> 31) >> (32 - shift));
+    return value - ((value + bias) & -(1 << shift));
+}
+
+#endif  // ARITHMETIC_HPP
@@ -0,0 +1,52 @@
+#include "array.hpp"
+
+#include <algorithm>
+
+ElementType elementTypeOf(TokenType datatype) {
+    switch (datatype) {
+        case TokenType::INT:
+            return ElementType::Int;
+        case TokenType::BOOL:
+            return ElementType::Bool;
+        default:
+            return ElementType::Char;
+    }
+}
+
+std::string outOfRange(int index, size_t size) {
+    return "index " + std::to_string(index) + " is out of range for an array of " + std::to_string(size) +
+           " elements.";
+}
+
+std::string doesNotFit(size_t size, size_t capacity) {
+    return std::to_string(size) + " elements do not fit in an array of " + std::to_string(capacity) +
+           " elements.";
+}
+
+Array::Array(ElementType type, size_t size) : _type(type) {
+    if (type == ElementType::Int) {
+        _ints.assign(size, 0);
+    } else {
+        _bytes.assign(size, '\0');
+    }
+}
+
+Array::Array(const std::string& text) : _type(ElementType::Char), _bytes(text) {}
+
+std::string Array::assign(const Array& source) {
+    if ((source._type == ElementType::Int) != (_type == ElementType::Int)) {
+        return "arrays of different types.";
+    }
+    if (source.size() > size()) {
+        return doesNotFit(source.size(), size());
+    }
+
+    if (_type == ElementType::Int) {
+        std::copy(source._ints.begin(), source._ints.end(), _ints.begin());
+        std::fill(_ints.begin() + source._ints.size(), _ints.end(), 0);
+    } else {
+        std::copy(source._bytes.begin(), source._bytes.end(), _bytes.begin());
+        std::fill(_bytes.begin() + source._bytes.size(), _bytes.end(), '\0');
+    }
+    return "";
+}
@@ -0,0 +1,73 @@
+#ifndef ARRAY_HPP
+#define ARRAY_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "token_enum.hpp"
+
+// What the elements of an array hold, from the datatype of its declaration
+enum class ElementType {
+    Char,
+    Bool,
+    Int,
+};
+
+ElementType elementTypeOf(TokenType datatype);
+
+// error of an index outside an array of size elements, the same in both engines
+std::string outOfRange(int index, size_t size);
+
+// error of assigning an array of size elements to one of capacity elements
+std::string doesNotFit(size_t size, size_t capacity);
+
+// Storage of one array variable, allocated with the size of its declaration.
+// Elements sit back to back, an int each in int arrays and a byte each in
+// char and bool arrays, and are read and written in place. Both engines
+// keep every array in one of these, string constants as char arrays.
+class Array {
+   public:
+    Array() = default;
+    Array(ElementType type, size_t size);
+    // char array holding a string constant, as written in the source
+    explicit Array(const std::string& text);
+
+    ElementType type() const { return _type; }
+    size_t size() const { return _type == ElementType::Int ? _ints.size() : _bytes.size(); }
+
+    bool contains(int index) const { return index >= 0 && static_cast<size_t>(index) < size(); }
+
+    int get(size_t index) const { return _type == ElementType::Int ? _ints[index] : _bytes[index]; }
+
+    // bool elements only ever hold 0 or 1, char elements the low byte
+    void set(size_t index, int value) {
+        switch (_type) {
+            case ElementType::Int:
+                _ints[index] = value;
+                break;
+            case ElementType::Bool:
+                _bytes[index] = value != 0;
+                break;
+            case ElementType::Char:
+                _bytes[index] = static_cast<char>(value);
+                break;
+        }
+    }
+
+    // Copies the elements of source and zeroes the rest, the size stays the
+    // declared one. Returns the runtime error when only one of them is an
+    // int array or source is longer, else an empty string.
+    std::string assign(const Array& source);
+
+    // the elements of a char array, what %s prints
+    std::string_view chars() const { return _bytes; }
+
+   private:
+    ElementType _type{ElementType::Char};
+    std::vector<int> _ints;  // Int arrays
+    std::string _bytes;      // Char and Bool arrays
+};
+
+#endif  // ARRAY_HPP
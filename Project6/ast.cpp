@@ -1,4 +1,5 @@
 #include "ast.hpp"
+#include "expression_parser.hpp"
 #include "symbol_table_list_node.hpp"
 #include "token_enum.hpp"
 
@@ -128,7 +129,8 @@ void ASTree::advance() {
 
 ASTListNode *ASTree::parseDeclaration() {
   ASTListNode *node = new ASTListNode(ASTNodeType::DECLARATION);
-  bool _function = _currCNode->type == TokenType::FUNCTION;
+  bool _function = _currCNode->type == TokenType::FUNCTION ||
+                   _currCNode->type == TokenType::PROCEDURE;
 
   // reach identifer, should only be max twice (function + type + [name])
   while (_currCNode->type != TokenType::IDENTIFIER &&
@@ -161,10 +163,8 @@ ASTListNode *ASTree::parseBooleanExp() {
   node->token = _currCNode;
   advance();
 
-  // convert exp
-  ASTListNode *sibList = nullptr;
-  _currCNode = boolPostfixConverter(_currCNode, sibList);
-  node->sibling = sibList;
+  // convert exp, ( exp )
+  _currCNode = convertExpression(_currCNode, node);
 
   return node;
 }
@@ -174,68 +174,40 @@ ASTListNode *ASTree::parseFor() {
   node->token = _currCNode;
   _currCNode = _currCNode->sibling->sibling; // skip paren
 
-  // convert num exp
-  ASTListNode *sibList = nullptr;
-  _currCNode = numPostfixConverter(_currCNode, sibList);
-  node->sibling = sibList;
+  // convert assignment
+  _currCNode = convertExpression(_currCNode, node);
 
   // add FOR1
   addNext(node);
 
   node = new ASTListNode(ASTNodeType::FOR2);
   _currCNode = _currCNode->sibling; // skip semicolon
-  sibList = nullptr;
-  _currCNode = boolPostfixConverter(_currCNode, sibList);
-  node->sibling = sibList;
+  _currCNode = convertExpression(_currCNode, node);
 
   // add FOR2
   addNext(node);
 
   node = new ASTListNode(ASTNodeType::FOR3);
   _currCNode = _currCNode->sibling; // skip semicolon
+  _currCNode = convertExpression(_currCNode, node);
 
-  sibList = nullptr;
-  _currCNode = numPostfixConverter(_currCNode, sibList);
-  _currCNode = _currCNode->child;
-  node->sibling = sibList;
-
-  // return FOR3
+  // return FOR3, the caller advances past ) onto the body's {
   return node;
 }
 
 ASTListNode *ASTree::parseCall() {
   ASTListNode *node = new ASTListNode(ASTNodeType::CALL);
   node->token = _currCNode;
-  _currCNode = _currCNode->sibling->sibling; // skip paren
-
-  ASTListNode *sibList = nullptr;
-  ASTListNode *lastSibling = nullptr;
-
-  // need to actually parse parameters
-  // could be: identifiers, nums, chars, strings, functions, arrays, etc.
-  while (_currCNode->type != TokenType::R_PAREN) {
-    if (_currCNode->type == TokenType::COMMA) {
-      advance();
-      continue;
-    }
-    ASTListNode *param = new ASTListNode(ASTNodeType::SIBLING);
-    param->token = _currCNode;
-    if (param->token->type == TokenType::IDENTIFIER) {
-      param->symbol = getNodeSymbol(param->token);
-    }
-    if (sibList == nullptr) {
-      sibList = param;
-    } else {
-      lastSibling->sibling = param;
-    }
 
-    lastSibling = param;
-    advance();
-  }
+  // arguments are converted like a function call inside an expression,
+  // ( arg , arg ), the leading name is already held by the CALL node
+  _currCNode = convertExpression(_currCNode, node);
+  ASTListNode *name = node->sibling;
+  node->sibling = name->sibling;
+  delete name;
 
-  // skip );
-  _currCNode = _currCNode->sibling->child;
-  node->sibling = sibList;
+  // skip ;
+  advance();
 
   // return CALL
   return node;
@@ -245,10 +217,8 @@ ASTListNode *ASTree::parseAssignment() {
   ASTListNode *node = new ASTListNode(ASTNodeType::ASSIGNMENT);
   node->token = _currCNode;
 
-  // convert exp
-  ASTListNode *sibList = nullptr;
-  _currCNode = numPostfixConverter(_currCNode, sibList);
-  node->sibling = sibList;
+  // convert exp, target = exp
+  _currCNode = convertExpression(_currCNode, node);
 
   // return ASSIGNMENT
   return node;
@@ -258,10 +228,8 @@ ASTListNode *ASTree::parseReturn() {
   ASTListNode *node = new ASTListNode(ASTNodeType::RETURN);
   node->token = _currCNode;
 
-  // convert exp, doesnt work if assignment
-  ASTListNode *sibList = nullptr;
-  _currCNode = boolPostfixConverter(_currCNode, sibList);
-  node->sibling = sibList;
+  // convert exp, none for a bare return;
+  _currCNode = convertExpression(_currCNode->sibling, node);
 
   // return RETURN
   return node;
@@ -271,32 +239,19 @@ ASTListNode *ASTree::parsePrintf() {
   ASTListNode *node = new ASTListNode(ASTNodeType::PRINTF);
   node->token = _currCNode;
 
-  // skip ("
-  _currCNode = _currCNode->sibling->sibling->sibling;
-
-  // get string
-  ASTListNode *str = new ASTListNode(ASTNodeType::SIBLING);
-  str->token = _currCNode;
-  node->sibling = str;
-
-  // skip "
-  _currCNode = _currCNode->sibling->sibling;
-
-  ASTListNode *lastSibling = str;
-
-  // need to actually parse parameters
-  // could be: identifiers, nums, chars, strings, functions, arrays, etc.
-  while (_currCNode->type != TokenType::R_PAREN) {
-    if (_currCNode->type == TokenType::COMMA) {
-      advance();
-      continue;
-    }
-    ASTListNode *param = new ASTListNode(ASTNodeType::SIBLING);
-    param->token = _currCNode;
-    lastSibling->sibling = param;
-    lastSibling = param;
-    advance();
+  // printf ( "format" , arg , ... ) parses like a call, its tree is kept
+  // as one. The row holds the format string then each argument's postfix,
+  // with no delimiters.
+  ExpressionParser parser(_currCNode);
+  node->expression = parser.parse();
+
+  ASTListNode *_tail = node;
+  std::vector<ExpressionNode *> &arguments = node->expression->operands;
+  appendToken(arguments.at(0)->token, _tail);
+  for (size_t i = 1; i < arguments.size(); i++) {
+    appendPostfix(arguments[i], _tail);
   }
+  _currCNode = parser.last();
 
   // skip );
   _currCNode = _currCNode->sibling->child;
@@ -311,21 +266,9 @@ bool ASTree::isDelimiter(TokenType type) {
           type == TokenType::SEMICOLON);
 }
 
-void ASTree::displayToken(TokenNode *currToken) {
-  std::cout << currToken->lexeme << " ";
-}
-
-void ASTree::displayToken(TokenNode *currToken, ASTListNode *&_tokenStr,
-                          ASTListNode *&_tail) {
-  // std::cout << "t: " << currToken->lexeme << "\n";
-
-  if (!_tail) {
-    _tokenStr = new ASTListNode(ASTNodeType::SIBLING);
-    _tail = _tokenStr;
-  } else {
-    _tail->sibling = new ASTListNode(ASTNodeType::SIBLING);
-    _tail = _tail->sibling;
-  }
+void ASTree::appendToken(TokenNode *currToken, ASTListNode *&_tail) {
+  _tail->sibling = new ASTListNode(ASTNodeType::SIBLING);
+  _tail = _tail->sibling;
   _tail->token = currToken;
 
   if (currToken->type == TokenType::IDENTIFIER) {
@@ -343,383 +286,84 @@ SymbolTableListNode *ASTree::getNodeSymbol(TokenNode *tokenNode) {
   return nullptr;
 }
 
-TokenNode *ASTree::numPostfixConverter(TokenNode *&currToken,
-                                       ASTListNode *&_tokenStr) {
-  std::stack<TokenNode *> _holdStack;
-  bool _finished = false; // looping flag
-  bool _function = false;
-  TokenNode *topToken = nullptr;
-  ASTListNode *_tail = nullptr;
-  TokenNode *_retPosition = nullptr;
-
-  // 'display' token meaning add to ASTree
-  // function could return a pointer to a chain of AST nodes, handled upon
-  // return to caller currently: printing to std::cout
-
-  // movement loop
-  // endNode must be a sibling, and have be set before function call
-  for (; (currToken && currToken->type != TokenType::SEMICOLON);
-       currToken = currToken->sibling) {
-    if (!currToken->sibling) {
-      _retPosition = currToken; // for handling returns once row is done
-      if (currToken->type == TokenType::R_PAREN) { // end of for exp
-        break;
-      }
-    }
-    switch (currToken->type) {
-    case TokenType::INTEGER:
-    case TokenType::TRUE:
-    case TokenType::FALSE:
-    case TokenType::SINGLE_QUOTE:
-    case TokenType::DOUBLE_QUOTE:
-    case TokenType::CHAR_LITERAL:
-    case TokenType::STRING:
-    case TokenType::L_BRACKET:
-    case TokenType::R_BRACKET: {
-      displayToken(currToken, _tokenStr, _tail);
-      break;
-    }
-    case TokenType::IDENTIFIER: {
-      auto *sym = getNodeSymbol(currToken);
-      if (sym && sym->identifierType == TokenType::FUNCTION) {
-        _function = true;
-      }
-      displayToken(currToken, _tokenStr, _tail);
-      break;
-    }
-    case TokenType::L_PAREN: {
-      (_function) ? displayToken(currToken, _tokenStr, _tail)
-                  : _holdStack.push(currToken);
-      break;
-    }
-    case TokenType::R_PAREN: {
-      if (_function) {
-        displayToken(currToken, _tokenStr, _tail);
-        _function = false;
-      } else {
-        topToken = _holdStack.top();
-        while (topToken->type != TokenType::L_PAREN) {
-          displayToken(topToken, _tokenStr, _tail);
-          _holdStack.pop();
-          if (!_holdStack.empty()) {
-            topToken = _holdStack.top();
-          }
-        }
-        _holdStack.pop();
-      }
-      break;
-    }
-    case TokenType::PLUS:
-    case TokenType::MINUS:
-    case TokenType::ASTERISK:
-    case TokenType::DIVIDE:
-    case TokenType::MODULO:
-    case TokenType::ASSIGNMENT_OPERATOR: {
-      if (_holdStack.empty()) {
-        _holdStack.push(currToken);
-      } else {
-        switch (currToken->type) {
-        case TokenType::PLUS:
-        case TokenType::MINUS: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if (isNumericOperator(topToken->type)) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        case TokenType::ASTERISK:
-        case TokenType::DIVIDE:
-        case TokenType::MODULO: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if ((topToken->type == TokenType::ASTERISK) ||
-                  (topToken->type == TokenType::DIVIDE) ||
-                  (topToken->type == TokenType::MODULO)) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        case TokenType::ASSIGNMENT_OPERATOR: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if (isNumericOperator(topToken->type)) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-                topToken = _holdStack.top();
-
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        default: {
-          // error
-        }
-        }
-      }
-      break;
-    }
-    default: {
-      // error out?
-      // should never reach this point, all cst rows should be correct
-    }
-    }
-  }
-  while (!_holdStack.empty()) {
-    // display token at top of stack
-    // pop stack
-    topToken = _holdStack.top();
-    displayToken(topToken, _tokenStr, _tail);
-    _holdStack.pop();
+// parse the expression starting at currToken into row->expression and add
+// its postfix form as the siblings of row. Returns the token the expression
+// stops at, or its last token when it ends the row.
+TokenNode *ASTree::convertExpression(TokenNode *currToken, ASTListNode *row) {
+  ExpressionParser parser(currToken);
+  row->expression = parser.parse();
+
+  ASTListNode *_tail = row;
+  if (row->expression) {
+    appendPostfix(row->expression, _tail);
   }
-  // std::cout << std::endl;
 
-  return (_retPosition ? _retPosition : currToken);
+  if (parser.current()) {
+    return parser.current();
+  }
+  return parser.last() ? parser.last() : currToken;
 }
 
-TokenNode *ASTree::boolPostfixConverter(TokenNode *&currToken,
-                                        ASTListNode *&_tokenStr) {
-  std::stack<TokenNode *> _holdStack;
-  bool _finished = false; // looping flag
-  bool _function = false;
-  TokenNode *topToken = nullptr;
-  ASTListNode *_tail = nullptr;
-  TokenNode *_retPosition = nullptr;
-
-  // 'display' token meaning add to ASTree
-  // function could return a pointer to a chain of AST nodes, handled upon
-  // return to caller currently: printing to std::cout
-
-  // movement loop
-  // ends upon encountering SEMICOLON or L_BRACE (ie, row end)
-
-  for (; (currToken && currToken->type != TokenType::SEMICOLON);
-       currToken = currToken->sibling) {
-    if (!currToken->sibling) {
-      _retPosition = currToken; // for handling returns once row is done
-    }
-    switch (currToken->type) {
-    case TokenType::INTEGER:
-    case TokenType::IDENTIFIER: {
-      auto *sym = getNodeSymbol(currToken);
-      if (sym && sym->identifierType == TokenType::FUNCTION) {
-        _function = true;
-      }
-      displayToken(currToken, _tokenStr, _tail);
-    } break;
-    case TokenType::TRUE:
-    case TokenType::FALSE:
-    case TokenType::SINGLE_QUOTE:
-    case TokenType::DOUBLE_QUOTE:
-    case TokenType::STRING:
-    case TokenType::CHAR_LITERAL:
-    case TokenType::L_BRACKET:
-    case TokenType::R_BRACKET: {
-      displayToken(currToken, _tokenStr, _tail);
-      break;
-    }
-    case TokenType::L_PAREN: {
-      (_function) ? displayToken(currToken, _tokenStr, _tail)
-                  : _holdStack.push(currToken);
-      break;
-    }
-    case TokenType::R_PAREN: {
-      if (_function) {
-        displayToken(currToken, _tokenStr, _tail);
-        _function = false;
-      } else {
-        _finished = false;
-        while (!_finished) {
-          topToken = _holdStack.top();
-          if (topToken->type == TokenType::L_PAREN) {
-            _holdStack.pop();
-            _finished = true;
-          } else {
-            displayToken(topToken, _tokenStr, _tail);
-            _holdStack.pop();
-          }
-        }
-      }
-      break;
+// operands before their operator, the legacy row form every later pass reads:
+//   name [ index ]    name ( argument , argument )    ' c '    " text "
+// there is no negate, - x becomes 0 x -
+void ASTree::appendPostfix(ExpressionNode *expression, ASTListNode *&_tail) {
+  std::vector<TokenNode *> &delimiters = expression->delimiters;
+  std::vector<ExpressionNode *> &operands = expression->operands;
+
+  switch (expression->type) {
+  case ExpressionType::LITERAL: {
+    if (delimiters.empty()) {
+      appendToken(expression->token, _tail);
+    } else {
+      appendToken(delimiters[0], _tail);
+      appendToken(expression->token, _tail);
+      appendToken(delimiters[1], _tail);
     }
-    case TokenType::BOOLEAN_NOT:
-    case TokenType::BOOLEAN_NOT_EQUAL:
-    case TokenType::BOOLEAN_EQUAL:
-    case TokenType::BOOLEAN_AND:
-    case TokenType::BOOLEAN_OR:
-    case TokenType::LT:
-    case TokenType::LT_EQUAL:
-    case TokenType::GT:
-    case TokenType::GT_EQUAL:
-    case TokenType::PLUS:
-    case TokenType::MINUS:
-    case TokenType::ASTERISK:
-    case TokenType::DIVIDE:
-    case TokenType::MODULO: {
-      if (_holdStack.empty()) {
-        _holdStack.push(currToken);
-      } else {
-        switch (currToken->type) {
-        case TokenType::BOOLEAN_NOT: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if (topToken->type == TokenType::BOOLEAN_NOT) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        case TokenType::ASTERISK:
-        case TokenType::DIVIDE:
-        case TokenType::MODULO: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if (topToken->type == TokenType::BOOLEAN_NOT ||
-                  topToken->type == TokenType::ASTERISK ||
-                  topToken->type == TokenType::DIVIDE ||
-                  topToken->type == TokenType::MODULO) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _finished = true;
-                _holdStack.push(currToken);
-              }
-            } else {
-              _finished = true;
-              _holdStack.push(currToken);
-            }
-          }
-          break;
-        }
-        case TokenType::PLUS:
-        case TokenType::MINUS: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if ((topToken->type == TokenType::BOOLEAN_NOT) ||
-                  isNumericOperator(topToken->type)) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        case TokenType::BOOLEAN_NOT_EQUAL:
-        case TokenType::BOOLEAN_EQUAL:
-        case TokenType::LT:
-        case TokenType::LT_EQUAL:
-        case TokenType::GT:
-        case TokenType::GT_EQUAL: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if (isOperator(topToken->type) &&
-                  topToken->type != TokenType::BOOLEAN_AND &&
-                  topToken->type != TokenType::BOOLEAN_OR) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        case TokenType::BOOLEAN_AND:
-        case TokenType::BOOLEAN_OR: {
-          _finished = false;
-          while (!_finished) {
-            if (!_holdStack.empty()) {
-              topToken = _holdStack.top();
-              if (isOperator(topToken->type)) {
-                displayToken(topToken, _tokenStr, _tail);
-                _holdStack.pop();
-              } else {
-                _holdStack.push(currToken);
-                _finished = true;
-              }
-            } else {
-              _holdStack.push(currToken);
-              _finished = true;
-            }
-          }
-          break;
-        }
-        default: {
-          // error
-        }
-        }
-      }
-      break;
+    break;
+  }
+  case ExpressionType::VARIABLE: {
+    appendToken(expression->token, _tail);
+    expression->symbol = _tail->symbol;
+    break;
+  }
+  case ExpressionType::INDEX: {
+    appendToken(expression->token, _tail);
+    expression->symbol = _tail->symbol;
+    appendToken(delimiters[0], _tail);
+    appendPostfix(operands[0], _tail);
+    appendToken(delimiters[1], _tail);
+    break;
+  }
+  case ExpressionType::CALL: {
+    appendToken(expression->token, _tail);
+    expression->symbol = _tail->symbol;
+    // ( then a , or the ) after each argument
+    appendToken(delimiters[0], _tail);
+    for (size_t i = 0; i < operands.size(); i++) {
+      appendPostfix(operands[i], _tail);
+      appendToken(delimiters[i + 1], _tail);
     }
-    default: {
-      // error
+    if (operands.empty()) {
+      appendToken(delimiters[1], _tail);
     }
+    break;
+  }
+  case ExpressionType::UNARY: {
+    if (expression->token->type == TokenType::MINUS) {
+      appendToken(new TokenNode(Token(TokenType::INTEGER, "0",
+                                      expression->token->lineNumber)),
+                  _tail);
     }
+    appendPostfix(operands[0], _tail);
+    appendToken(expression->token, _tail);
+    break;
+  }
+  case ExpressionType::BINARY: {
+    appendPostfix(operands[0], _tail);
+    appendPostfix(operands[1], _tail);
+    appendToken(expression->token, _tail);
+    break;
   }
-
-  while (!_holdStack.empty()) {
-    // display token at top of stack
-    // pop stack
-    topToken = _holdStack.top();
-    displayToken(topToken, _tokenStr, _tail);
-    _holdStack.pop();
   }
-  return (_retPosition ? _retPosition : currToken);
 }
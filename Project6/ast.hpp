@@ -3,6 +3,7 @@
 
 #include "ast_list_node.hpp"
 #include "cst.hpp"
+#include "expression_node.hpp"
 #include "symbol_table.hpp"
 #include "symbol_table_list_node.hpp"
 #include "token.hpp"
@@ -32,13 +33,9 @@ private:
   void advance();
   bool isDelimiter(TokenType type);
 
-  TokenNode *numPostfixConverter(TokenNode *&currToken,
-                                 ASTListNode *&_tokenStr);
-  TokenNode *boolPostfixConverter(TokenNode *&currToken,
-                                  ASTListNode *&_tokenStr);
-  void displayToken(TokenNode *currToken);
-  void displayToken(TokenNode *currToken, ASTListNode *&_tokenStr,
-                    ASTListNode *&_tail);
+  TokenNode *convertExpression(TokenNode *currToken, ASTListNode *row);
+  void appendPostfix(ExpressionNode *expression, ASTListNode *&_tail);
+  void appendToken(TokenNode *currToken, ASTListNode *&_tail);
 
   ASTListNode *parseDeclaration();
   ASTListNode *parseBooleanExp();
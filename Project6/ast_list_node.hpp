@@ -3,6 +3,7 @@
 
 #include <string>
 
+#include "expression_node.hpp"
 #include "symbol_table_list_node.hpp"
 #include "token_enum.hpp"
 #include "token_node.hpp"
@@ -101,6 +102,16 @@ static const ASTNodeType tokenTypeToASType(TokenType type) {
     }
 }
 
+// Static type of an expression, worked out from the datatypes in the symbol
+// table by the TypeChecker. Int, Char and Bool values are all held as int.
+enum class ValueType {
+    Unknown,
+    Int,
+    Char,
+    Bool,
+    String,
+};
+
 // class ASTSiblingNode;
 
 class ASTListNode {
@@ -115,8 +126,63 @@ class ASTListNode {
 
     ASTListNode* sibling;
     ASTListNode* child;
+
+    // tree the ExpressionParser built for the row, its siblings are the
+    // postfix form of it. Passes that rewrite the siblings leave it as parsed.
+    ExpressionNode* expression{nullptr};
+
+    // jump targets of IF/WHILE/FOR1, filled in by the Interpreter
+    ASTListNode* body{nullptr};      // first node inside the block
+    ASTListNode* elseBody{nullptr};  // first node inside the else block of an IF
+    ASTListNode* end{nullptr};       // END_BLOCK closing the whole statement
+
+    // DECLARATION of the function/procedure a call site invokes, linked once
+    // by the Interpreter so calls never look their target up by name
+    ASTListNode* callee{nullptr};
+
+    // type of the value this node leaves on the operand stack
+    ValueType valueType{ValueType::Unknown};
+    // set on the first node of an expression that only ever produces ints,
+    // so it can be evaluated without looking at the Value's type
+    bool scalarExpression{false};
+    // set on the first node of the right operand of && or ||, the operator
+    // it belongs to, so evaluation can skip to it once the left one decides
+    ASTListNode* shortCircuit{nullptr};
+
+    // PRINTF rows, the Executor's parsed form of the statement once it ran
+    int printfIndex{-1};
+
+    // set by the RangeAnalysis on the array of an element access whose index
+    // a counted loop keeps in range, it is then used without a bounds check
+    bool inBounds{false};
+
+    // set by the RangeAnalysis on the FOR1 row of a counted loop whose
+    // condition is only its bound: what FOR3 adds to the variable, and the
+    // last value the body runs with
+    int countedStep{0};
+    int countedHigh{0};
+
+    // set by the PurityAnalysis on the DECLARATION of a function whose
+    // result depends on its arguments alone
+    bool pure{false};
+
+    // set by the TailCallAnalysis on a call of the running function that is
+    // the last thing it does
+    bool tailCall{false};
 };
 
+// rows of the AST are linked through the child of their last sibling
+inline ASTListNode* lastSibling(ASTListNode* node) {
+    while (node->sibling) {
+        node = node->sibling;
+    }
+    return node;
+}
+
+inline ASTListNode* nextRow(ASTListNode* node) {
+    return lastSibling(node)->child;
+}
+
 // class ASTSiblingNode : public ASTListNode {
 //    public:
 //     ASTSiblingNode(TokenNode* token) : ASTListNode(ASTNodeType::SIBLING), token(token) {};
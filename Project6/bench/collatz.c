@@ -0,0 +1,34 @@
+// ***************************************************
+// * Dispatch benchmark: branchy loop body           *
+// ***************************************************
+procedure main (void)
+{
+  int n;
+  int x;
+  int steps;
+  int longest;
+
+  longest = 0;
+  for (n = 1; n < 100000; n = n + 1)
+  {
+    x = n;
+    steps = 0;
+    while (x != 1)
+    {
+      if (x % 2 == 0)
+      {
+        x = x / 2;
+      }
+      else
+      {
+        x = 3 * x + 1;
+      }
+      steps = steps + 1;
+    }
+    if (steps > longest)
+    {
+      longest = steps;
+    }
+  }
+  printf ("longest = %d\n", longest);
+}
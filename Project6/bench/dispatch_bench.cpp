@@ -0,0 +1,93 @@
+// dispatch_bench.cpp
+//
+// Runs every program given on the command line on the VirtualMachine with
+// switch and threaded dispatch and reports the time per executed
+// instruction. Program output goes to /dev/null, the report to stderr.
+//
+// Usage: dispatch_bench.exe [--runs=N] <input_file>...
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "load_program.hpp"
+#include "strength_reduction.hpp"
+#include "superinstructions.hpp"
+#include "vm.hpp"
+
+// best of runs, in nanoseconds
+static double timeRuns(VirtualMachine &vm, OutputBuffer &output, Dispatch dispatch, int runs) {
+    double best = 0;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        vm.run(dispatch);
+        output.flush();
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+static void bench(const std::string &filename, int runs) {
+    Program program = loadProgram(filename);
+    fuseSuperinstructions(program);
+    reduceStrength(program);
+
+    OutputBuffer output;
+    VirtualMachine vm(program, output);
+    vm.run(Dispatch::Switch, true);
+    uint64_t ops = vm.executed();
+
+    double switchNs = timeRuns(vm, output, Dispatch::Switch, runs);
+    std::cerr << std::left << std::setw(28) << filename << std::right << std::setw(12) << ops << " ops"
+              << std::fixed << std::setprecision(2) << "   switch " << std::setw(6) << switchNs / ops << " ns/op";
+
+    if (VirtualMachine::threadedAvailable()) {
+        double threadedNs = timeRuns(vm, output, Dispatch::Threaded, runs);
+        std::cerr << "   threaded " << std::setw(6) << threadedNs / ops << " ns/op"
+                  << "   speedup " << switchNs / threadedNs << "x";
+    } else {
+        std::cerr << "   threaded dispatch not built in";
+    }
+    std::cerr << "\n";
+}
+
+int main(int argc, char *argv[]) {
+    int runs = 5;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--runs=", 0) == 0) {
+            runs = std::stoi(arg.substr(7));
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        std::cerr << "Usage: dispatch_bench.exe [--runs=N] <input_file>...\n";
+        return 1;
+    }
+
+    if (!std::freopen("/dev/null", "w", stdout)) {
+        std::cerr << "Error: could not redirect stdout\n";
+        return 1;
+    }
+
+    int failed = 0;
+    for (const std::string &file : files) {
+        try {
+            bench(file, runs);
+        } catch (const std::exception &ex) {
+            std::cerr << file << ": " << ex.what() << "\n";
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+// ***************************************************
+// * Dispatch benchmark: recursive calls             *
+// ***************************************************
+function int fib (int n)
+{
+  if (n < 2)
+  {
+    return n;
+  }
+  return fib (n - 1) + fib (n - 2);
+}
+
+procedure main (void)
+{
+  int result;
+
+  result = fib (27);
+  printf ("fib(27) = %d\n", result);
+}
@@ -0,0 +1,37 @@
+// ***************************************************
+// * Call benchmark: a small leaf function turning   *
+// * hex digits into values, ten million calls       *
+// ***************************************************
+function int hexdigit2int (char hex_digit)
+{
+  int digit;
+
+  digit = -1;
+  if ((hex_digit >= '0') && (hex_digit <= '9'))
+  {
+    digit = hex_digit - '0';
+  }
+  else
+  {
+    if ((hex_digit >= 'a') && (hex_digit <= 'f'))
+    {
+      digit = hex_digit - 'a' + 10;
+    }
+  }
+  return digit;
+}
+
+procedure main (void)
+{
+  char digits[17];
+  int i;
+  int sum;
+
+  digits = "0123456789abcdef";
+  sum = 0;
+  for (i = 0; i < 10000000; i = i + 1)
+  {
+    sum = (sum * 16 + hexdigit2int (digits[i % 16])) % 1000003;
+  }
+  printf ("sum = %d\n", sum);
+}
@@ -0,0 +1,30 @@
+// ***************************************************
+// * Array benchmark: histogram of ten million       *
+// * pseudo-random numbers in an int array           *
+// ***************************************************
+procedure main (void)
+{
+  int counts[256];
+  int x;
+  int i;
+  int largest;
+  int sum;
+
+  x = 1;
+  for (i = 0; i < 10000000; i = i + 1)
+  {
+    x = (x * 75 + 74) % 65537;
+    counts[x % 256] = counts[x % 256] + 1;
+  }
+  largest = 0;
+  sum = 0;
+  for (i = 0; i < 256; i = i + 1)
+  {
+    sum = sum + counts[i];
+    if (counts[i] > counts[largest])
+    {
+      largest = i;
+    }
+  }
+  printf ("sum = %d, largest bucket = %d with %d\n", sum, largest, counts[largest]);
+}
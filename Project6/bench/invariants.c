@@ -0,0 +1,48 @@
+// ***************************************************
+// * Loop-invariant benchmark: nested loops over a   *
+// * grid whose inner body recomputes what only the  *
+// * outer loop changes, a pure call included        *
+// ***************************************************
+int width;
+
+function int weight (int row, int salt)
+{
+  int h;
+
+  h = row * 31 + salt;
+  h = (h * 17 + 5) % 65536;
+  h = (h * 13 + row) % 65536;
+  h = (h * 11 + salt) % 65536;
+  h = (h * 7 + row * row) % 65536;
+  if (h < 0)
+  {
+    h = 0 - h;
+  }
+  if (h > 32768)
+  {
+    h = h - 32768;
+  }
+  return h % 100 + 1;
+}
+
+procedure main (void)
+{
+  int row;
+  int column;
+  int sum;
+  int base;
+  int scale;
+
+  width = 2000;
+  scale = 3;
+  sum = 0;
+  for (row = 0; row < 3000; row = row + 1)
+  {
+    base = row * 7;
+    for (column = 0; column < width; column = column + 1)
+    {
+      sum = (sum + (row * width + column) * scale + base * scale + weight (row, 12345)) % 1000003;
+    }
+  }
+  printf ("sum = %d\n", sum);
+}
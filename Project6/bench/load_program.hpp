@@ -0,0 +1,32 @@
+#ifndef BENCH_LOAD_PROGRAM_HPP
+#define BENCH_LOAD_PROGRAM_HPP
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "compiler.hpp"
+#include "cst.hpp"
+#include "interpreter.hpp"
+#include "symbol_table.hpp"
+#include "tokenizer.hpp"
+
+// Runs the front end on filename and compiles the result, without the
+// output files main writes along the way
+inline Program loadProgram(const std::string &filename) {
+    Tokenizer tokenizer(filename);
+    std::vector<Token> tokens = tokenizer.tokenize();
+    if (!tokenizer.errorMessage.empty()) {
+        throw std::runtime_error(tokenizer.errorMessage);
+    }
+
+    CSTree tree(tokens);
+    SymbolTable symbolTable(tree);
+    ASTree aTree(&tree, &symbolTable);
+    Interpreter interpreter(&aTree, &symbolTable);
+    return Compiler(&aTree, interpreter).compile();
+}
+
+#endif  // BENCH_LOAD_PROGRAM_HPP
@@ -0,0 +1,21 @@
+// ***************************************************
+// * Dispatch benchmark: nested counting loops       *
+// ***************************************************
+procedure main (void)
+{
+  int i;
+  int j;
+  int sum;
+
+  sum = 0;
+  for (i = 0; i < 3000; i = i + 1)
+  {
+    j = 0;
+    while (j < 1000)
+    {
+      sum = (sum + i * j) % 1000003;
+      j = j + 1;
+    }
+  }
+  printf ("sum = %d\n", sum);
+}
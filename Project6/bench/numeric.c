@@ -0,0 +1,24 @@
+// ***************************************************
+// * Arithmetic benchmark: *, / and % by powers of   *
+// * two and squares over ten million signed values  *
+// ***************************************************
+procedure main (void)
+{
+  int x;
+  int d;
+  int i;
+  int sum;
+  int hash;
+
+  x = 1;
+  sum = 0;
+  hash = 0;
+  for (i = 0; i < 10000000; i = i + 1)
+  {
+    x = (x * 75 + 74) % 65537;
+    d = x - 32768;
+    sum = (sum + d / 16 + d % 8 + (d % 256) ^ 2 / 1024) % 1048576;
+    hash = (hash * 32 + d) % 1048576;
+  }
+  printf ("sum = %d, hash = %d\n", sum, hash);
+}
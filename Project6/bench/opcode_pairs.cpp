@@ -0,0 +1,113 @@
+// opcode_pairs.cpp
+//
+// Dynamic opcode-pair histogram over a corpus. Every program given on the
+// command line is run once with instruction counting and the number of times
+// each opcode directly followed another is summed over all of them. Pairs at
+// the top of the list are the ones worth fusing into a superinstruction.
+// Also reports how many executed instructions the current fusions save.
+//
+// Usage: opcode_pairs.exe [--fused] [--top=N] <input_file>...
+//   --fused   histogram of the programs after fuseSuperinstructions, showing
+//             what is left to fuse
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "load_program.hpp"
+#include "superinstructions.hpp"
+#include "vm.hpp"
+
+struct Pair {
+    OpCode first;
+    OpCode second;
+    uint64_t count;
+};
+
+int main(int argc, char *argv[]) {
+    bool fused = false;
+    size_t top = 20;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--fused") {
+            fused = true;
+        } else if (arg.rfind("--top=", 0) == 0) {
+            top = std::stoul(arg.substr(6));
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        std::cerr << "Usage: opcode_pairs.exe [--fused] [--top=N] <input_file>...\n";
+        return 1;
+    }
+
+    // program output is not part of the report
+    if (!std::freopen("/dev/null", "w", stdout)) {
+        std::cerr << "Error: could not redirect stdout\n";
+        return 1;
+    }
+
+    std::vector<uint64_t> counts(opcodeCount * opcodeCount, 0);
+    uint64_t plainOps = 0;
+    uint64_t fusedOps = 0;
+
+    for (const std::string &file : files) {
+        try {
+            Program plain = loadProgram(file);
+            Program withFusion = plain;
+            fuseSuperinstructions(withFusion);
+
+            OutputBuffer output;
+            VirtualMachine plainVm(plain, output);
+            plainVm.run(Dispatch::Switch, true);
+            VirtualMachine fusedVm(withFusion, output);
+            fusedVm.run(Dispatch::Switch, true);
+            plainOps += plainVm.executed();
+            fusedOps += fusedVm.executed();
+
+            const VirtualMachine &vm = fused ? fusedVm : plainVm;
+            for (size_t first = 0; first < opcodeCount; first++) {
+                for (size_t second = 0; second < opcodeCount; second++) {
+                    counts[first * opcodeCount + second] +=
+                        vm.pairCount(static_cast<OpCode>(first), static_cast<OpCode>(second));
+                }
+            }
+        } catch (const std::exception &ex) {
+            // broken programs are part of the corpus, they just add nothing
+            std::cerr << file << ": " << ex.what() << "\n";
+        }
+    }
+
+    std::vector<Pair> pairs;
+    uint64_t total = 0;
+    for (size_t first = 0; first < opcodeCount; first++) {
+        for (size_t second = 0; second < opcodeCount; second++) {
+            uint64_t count = counts[first * opcodeCount + second];
+            if (count) {
+                pairs.push_back({static_cast<OpCode>(first), static_cast<OpCode>(second), count});
+                total += count;
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair &lhs, const Pair &rhs) { return lhs.count > rhs.count; });
+
+    std::cerr << "executed instructions: " << plainOps << " plain, " << fusedOps << " fused";
+    if (plainOps) {
+        std::cerr << std::fixed << std::setprecision(1) << " (" << 100.0 * (plainOps - fusedOps) / plainOps
+                  << "% fewer)";
+    }
+    std::cerr << "\n\n";
+
+    std::cerr << (fused ? "pairs after fusion" : "pairs before fusion") << ":\n";
+    for (size_t i = 0; i < pairs.size() && i < top; i++) {
+        std::cerr << std::setw(14) << pairs[i].count << std::fixed << std::setprecision(1) << std::setw(7)
+                  << 100.0 * pairs[i].count / total << "%  " << opcodeName(pairs[i].first) << " -> "
+                  << opcodeName(pairs[i].second) << "\n";
+    }
+    return 0;
+}
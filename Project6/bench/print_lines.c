@@ -0,0 +1,12 @@
+// ***************************************************
+// * Output benchmark: a million lines of printf,    *
+// * time it with stdout going to a file or a pipe   *
+// ***************************************************
+procedure main (void)
+{
+  int i;
+  for (i = 0; i < 1000000; i = i + 1)
+  {
+    printf ("line %d of the output benchmark\n", i);
+  }
+}
@@ -0,0 +1,43 @@
+// ***************************************************
+// * Array benchmark: sieve of Eratosthenes over a   *
+// * million bools, run ten times                    *
+// ***************************************************
+procedure main (void)
+{
+  bool composite[1000000];
+  int n;
+  int i;
+  int j;
+  int count;
+  int round;
+
+  n = 1000000;
+  for (round = 0; round < 10; round = round + 1)
+  {
+    for (i = 0; i < 1000000; i = i + 1)
+    {
+      composite[i] = FALSE;
+    }
+    i = 2;
+    while (i * i < n)
+    {
+      if (!composite[i])
+      {
+        for (j = i * i; j < n; j = j + i)
+        {
+          composite[j] = TRUE;
+        }
+      }
+      i = i + 1;
+    }
+    count = 0;
+    for (i = 2; i < 1000000; i = i + 1)
+    {
+      if (!composite[i])
+      {
+        count = count + 1;
+      }
+    }
+  }
+  printf ("primes below %d = %d\n", n, count);
+}
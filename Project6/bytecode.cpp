@@ -0,0 +1,134 @@
+#include "bytecode.hpp"
+
+#include <iomanip>
+#include <ostream>
+
+const char* opcodeName(OpCode op) {
+    switch (op) {
+#define CS460_OPCODE_NAME(name) \
+    case OpCode::name:          \
+        return #name;
+        CS460_OPCODES(CS460_OPCODE_NAME)
+#undef CS460_OPCODE_NAME
+    }
+    return "UNKNOWN";
+}
+
+int stackEffect(const Instruction& instruction) {
+    switch (instruction.op) {
+        case OpCode::PUSH:
+        case OpCode::PUSH_STRING:
+        case OpCode::LOAD_LOCAL:
+        case OpCode::LOAD_GLOBAL:
+        case OpCode::DUP:
+            return 1;
+        case OpCode::STORE_LOCAL:
+        case OpCode::STORE_GLOBAL:
+        case OpCode::COPY_ARRAY_LOCAL:
+        case OpCode::COPY_ARRAY_GLOBAL:
+        case OpCode::LOAD_ELEMENT:
+        case OpCode::LOAD_ELEMENT_UNCHECKED:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::JUMP_IF_TRUE:
+        case OpCode::RETURN:
+        case OpCode::POP:
+            return -1;
+        case OpCode::STORE_ELEMENT:
+        case OpCode::STORE_ELEMENT_UNCHECKED:
+            return -3;
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+        case OpCode::MOD:
+        case OpCode::POW:
+        case OpCode::LT:
+        case OpCode::LE:
+        case OpCode::GT:
+        case OpCode::GE:
+        case OpCode::EQ:
+        case OpCode::NE:
+            return -1;
+        case OpCode::JUMP_IF_FALSE_OR_POP:
+        case OpCode::JUMP_IF_TRUE_OR_POP:
+            return -1;  // when falling through, a jump keeps the value
+        case OpCode::MUL_ADD_LOCAL:
+            return -1;
+        case OpCode::CALL:
+        case OpCode::CALL_MEMOIZED:
+            return 1 - instruction.b;
+        case OpCode::PRINTF:
+        case OpCode::TAIL_CALL:
+            return -instruction.b;
+        default:
+            return 0;
+    }
+}
+
+int* jumpTarget(Instruction& instruction) {
+    switch (instruction.op) {
+        case OpCode::JUMP:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::JUMP_IF_TRUE:
+        case OpCode::JUMP_IF_FALSE_OR_POP:
+        case OpCode::JUMP_IF_TRUE_OR_POP:
+            return &instruction.a;
+        case OpCode::JUMP_UNLESS_LOCAL_LT:
+        case OpCode::JUMP_UNLESS_LOCAL_LE:
+        case OpCode::JUMP_UNLESS_LOCAL_GT:
+        case OpCode::JUMP_UNLESS_LOCAL_GE:
+        case OpCode::JUMP_UNLESS_LOCAL_EQ:
+        case OpCode::JUMP_UNLESS_LOCAL_NE:
+        case OpCode::LOOP_LT_LOCAL:
+        case OpCode::LOOP_LE_LOCAL:
+            return &instruction.c;
+        default:
+            return nullptr;
+    }
+}
+
+std::vector<bool> jumpTargets(const Program& program) {
+    std::vector<bool> isTarget(program.code.size() + 1, false);
+    for (Instruction instruction : program.code) {
+        if (int* target = jumpTarget(instruction)) {
+            isTarget[*target] = true;
+        }
+    }
+    for (const FunctionInfo& function : program.functions) {
+        isTarget[function.entry] = true;
+    }
+    return isTarget;
+}
+
+void relocate(Program& program, std::vector<Instruction> code, std::vector<int> lines,
+              const std::vector<size_t>& remap) {
+    for (Instruction& instruction : code) {
+        if (int* target = jumpTarget(instruction)) {
+            *target = remap[*target];
+        }
+    }
+    for (FunctionInfo& function : program.functions) {
+        function.entry = remap[function.entry];
+    }
+
+    program.code = std::move(code);
+    program.lines = std::move(lines);
+}
+
+void Program::dump(std::ostream& out) const {
+    for (size_t pc = 0; pc < code.size(); pc++) {
+        for (const FunctionInfo& function : functions) {
+            if (function.entry == pc) {
+                out << function.name << ":\n";
+            }
+        }
+        Instruction instruction = code[pc];
+        out << std::setw(6) << pc << "  " << std::left << std::setw(22) << opcodeName(instruction.op)
+            << std::right << instruction.a << " " << instruction.b;
+        if (jumpTarget(instruction) == &instruction.c || instruction.op == OpCode::NEW_ARRAY_LOCAL ||
+            instruction.op == OpCode::NEW_ARRAY_GLOBAL) {
+            out << " " << instruction.c;
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "printf_format.hpp"
+
+// Every opcode of the virtual machine, in the order of the OpCode enum.
+// Operands are noted as a and b of the Instruction.
+#define CS460_OPCODES(X)                                                     \
+    X(PUSH)              /* push constant a */                               \
+    X(PUSH_STRING)       /* push the array holding string constant a */      \
+    X(LOAD_LOCAL)        /* push frame slot a */                             \
+    X(STORE_LOCAL)       /* pop into frame slot a */                         \
+    X(LOAD_GLOBAL)       /* push global slot a */                            \
+    X(STORE_GLOBAL)      /* pop into global slot a */                        \
+    X(NEW_ARRAY_LOCAL)   /* frame slot a = new array of b elements of type c */ \
+    X(NEW_ARRAY_GLOBAL)  /* global slot a = new array of b elements of type c */ \
+    X(COPY_ARRAY_LOCAL)  /* pop an array, copy it into frame slot a */       \
+    X(COPY_ARRAY_GLOBAL) /* pop an array, copy it into global slot a */      \
+    X(LOAD_ELEMENT)      /* pop index and array, push the element */         \
+    X(STORE_ELEMENT)     /* pop value, index and array, store the element */ \
+    X(LOAD_ELEMENT_UNCHECKED)  /* LOAD_ELEMENT of an index proven in range */ \
+    X(STORE_ELEMENT_UNCHECKED) /* STORE_ELEMENT of an index proven in range */ \
+    X(ADD)                                                                   \
+    X(SUB)                                                                   \
+    X(MUL)                                                                   \
+    X(DIV)                                                                   \
+    X(MOD)                                                                   \
+    X(POW)               /* lhs ^ rhs, see integerPower */                   \
+    X(LT)                                                                    \
+    X(LE)                                                                    \
+    X(GT)                                                                    \
+    X(GE)                                                                    \
+    X(EQ)                                                                    \
+    X(NE)                                                                    \
+    X(NOT)                                                                   \
+    X(JUMP)              /* continue at a */                                 \
+    X(JUMP_IF_FALSE)     /* pop, continue at a when zero */                  \
+    X(JUMP_IF_TRUE)      /* pop, continue at a when not zero */              \
+    X(JUMP_IF_FALSE_OR_POP) /* continue at a when the top is zero, else pop */ \
+    X(JUMP_IF_TRUE_OR_POP)  /* top != 0: make it 1, continue at a; else pop */ \
+    X(CALL)              /* call function a with the top b values */         \
+    X(RETURN)            /* pop the result and return it to the caller */    \
+    X(POP)                                                                   \
+    X(DUP)               /* push the top again */                            \
+    X(PRINTF)            /* print format a with the top b values */          \
+    X(HALT)                                                                  \
+    /* superinstructions, only produced by fuseSuperinstructions */         \
+    X(INC_LOCAL)         /* frame slot a += b */                             \
+    X(INC_GLOBAL)        /* global slot a += b */                            \
+    X(JUMP_UNLESS_LOCAL_LT) /* continue at c unless frame slot a < b */      \
+    X(JUMP_UNLESS_LOCAL_LE)                                                  \
+    X(JUMP_UNLESS_LOCAL_GT)                                                  \
+    X(JUMP_UNLESS_LOCAL_GE)                                                  \
+    X(JUMP_UNLESS_LOCAL_EQ)                                                  \
+    X(JUMP_UNLESS_LOCAL_NE)                                                  \
+    X(MUL_ADD_LOCAL)     /* pop y, frame slot a = slot a * b + y */       \
+    X(LOOP_LT_LOCAL)     /* frame slot a += 1, continue at c while a < b */  \
+    X(LOOP_LE_LOCAL)     /* frame slot a += 1, continue at c while a <= b */ \
+    /* only produced by eliminateTailCalls, a is the running function */     \
+    X(TAIL_CALL)         /* the b args become slot 0.., others 0, run a */   \
+    /* only produced with --memoize, for the calls of pure functions */      \
+    X(CALL_MEMOIZED)     /* CALL, answered from a's MemoTable when it can */ \
+    /* only produced by reduceStrength, a is the power of two */            \
+    X(MUL_POW2)          /* top = top * 2^a, a shift */                      \
+    X(DIV_POW2)          /* top = top / 2^a, a biased shift */               \
+    X(MOD_POW2)          /* top = top % 2^a, a biased mask */
+
+enum class OpCode {
+#define CS460_OPCODE_ENUM(name) name,
+    CS460_OPCODES(CS460_OPCODE_ENUM)
+#undef CS460_OPCODE_ENUM
+};
+
+#define CS460_OPCODE_COUNT(name) +1
+constexpr size_t opcodeCount = 0 CS460_OPCODES(CS460_OPCODE_COUNT);
+#undef CS460_OPCODE_COUNT
+
+const char* opcodeName(OpCode op);
+
+struct Instruction {
+    OpCode op;
+    int a;
+    int b;
+    int c;  // ElementType of NEW_ARRAY_*, target of the compare-and-branch and loop superinstructions
+};
+
+// A compiled function or procedure, its arguments are the first `parameterCount`
+// slots of the frame
+struct FunctionInfo {
+    std::string name;
+    size_t entry{0};
+    size_t frameSize{0};
+    size_t parameterCount{0};
+    size_t maxStack{0};  // deepest the operand stack gets inside the body
+    bool procedure{false};  // its callers drop the result
+};
+
+// Linear instruction stream of a whole program, execution starts at 0
+struct Program {
+    std::vector<Instruction> code;
+    std::vector<int> lines;  // source line of each instruction
+    std::vector<FunctionInfo> functions;
+    std::vector<std::string> strings;
+    std::vector<PrintfFormat> formats;  // of every printf, parsed once
+    size_t globalCount{0};
+
+    void dump(std::ostream& out) const;
+};
+
+// change of the operand stack height caused by executing instruction
+int stackEffect(const Instruction& instruction);
+
+// the operand holding the destination of a jump, nullptr for other opcodes
+int* jumpTarget(Instruction& instruction);
+
+// Whether a jump or a function entry lands on each instruction, with one
+// more entry for the end of the code
+std::vector<bool> jumpTargets(const Program& program);
+
+// Replaces the code of program with code, given where each old instruction
+// (and the end) moved to. Jumps and function entries are moved with it.
+void relocate(Program& program, std::vector<Instruction> code, std::vector<int> lines,
+              const std::vector<size_t>& remap);
+
+#endif  // BYTECODE_HPP
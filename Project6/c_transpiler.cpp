@@ -0,0 +1,1059 @@
+#include "c_transpiler.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <map>
+
+#include "array.hpp"
+#include "printf_format.hpp"
+#include "token_error.hpp"
+
+// Everything the translated functions call, in front of them in every file
+static const char* runtime = R"(#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#if defined(__GNUC__)
+#define RT_NORETURN __attribute__((noreturn))
+#else
+#define RT_NORETURN
+#endif
+
+/* what the elements of an array hold */
+enum { RT_CHAR, RT_BOOL, RT_INT };
+
+typedef struct {
+    int type;
+    size_t size;
+    int *ints;   /* RT_INT arrays */
+    char *bytes; /* RT_CHAR and RT_BOOL arrays */
+} rt_array;
+
+/* every array, handles are indexes; the string constants come first */
+static rt_array *rt_arrays;
+static size_t rt_count, rt_capacity;
+/* calls fail once the C stack is below this */
+static uintptr_t rt_stack_limit;
+
+static RT_NORETURN void rt_error(int line, const char *message) {
+    fflush(stdout);
+    fprintf(stderr, "Error on line %d: %s\n", line, message);
+    exit(1);
+}
+
+static void rt_start(void) {
+    char marker;
+    size_t budget = (size_t)1 << 20;
+#if defined(__unix__) || defined(__APPLE__)
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0) {
+        budget = limit.rlim_cur == RLIM_INFINITY ? (size_t)64 << 20 : (size_t)limit.rlim_cur;
+    }
+#endif
+    /* an eighth is left for the error of the deepest call */
+    budget -= budget / 8;
+    rt_stack_limit = (uintptr_t)&marker > budget ? (uintptr_t)&marker - budget : 0;
+}
+
+static inline void rt_check_stack(int line) {
+    char marker;
+    if ((uintptr_t)&marker < rt_stack_limit) {
+        rt_error(line, "stack overflow.");
+    }
+}
+
+static inline rt_array *rt_push(int type, size_t size) {
+    rt_array *array;
+    if (rt_count == rt_capacity) {
+        rt_capacity = rt_capacity ? 2 * rt_capacity : 64;
+        rt_arrays = (rt_array *)realloc(rt_arrays, rt_capacity * sizeof *rt_arrays);
+        if (!rt_arrays) {
+            rt_error(0, "out of memory.");
+        }
+    }
+    array = &rt_arrays[rt_count++];
+    array->type = type;
+    array->size = size;
+    array->ints = type == RT_INT ? (int *)calloc(size + 1, sizeof(int)) : NULL;
+    array->bytes = type == RT_INT ? NULL : (char *)calloc(size + 1, 1);
+    return array;
+}
+
+static inline int rt_new_array(int type, size_t size) {
+    rt_push(type, size);
+    return (int)(rt_count - 1);
+}
+
+static inline void rt_string(const char *text, size_t length) {
+    memcpy(rt_push(RT_CHAR, length)->bytes, text, length);
+}
+
+/* the arrays allocated from here on are dropped by rt_release */
+static inline int rt_mark(void) {
+    return (int)rt_count;
+}
+
+static inline void rt_release(int base) {
+    while (rt_count > (size_t)base) {
+        rt_count--;
+        free(rt_arrays[rt_count].ints);
+        free(rt_arrays[rt_count].bytes);
+    }
+}
+
+static inline rt_array *rt_array_at(int handle, int line) {
+    if (handle < 0 || (size_t)handle >= rt_count) {
+        rt_error(line, "value is not an array.");
+    }
+    return &rt_arrays[handle];
+}
+
+static inline rt_array *rt_array_with_index(int handle, int index, int line) {
+    rt_array *array = rt_array_at(handle, line);
+    if (index < 0 || (size_t)index >= array->size) {
+        char message[96];
+        sprintf(message, "index %d is out of range for an array of %lu elements.", index,
+                (unsigned long)array->size);
+        rt_error(line, message);
+    }
+    return array;
+}
+
+/* bool elements only ever hold 0 or 1, char elements the low byte */
+static inline int rt_get(const rt_array *array, int index) {
+    return array->type == RT_INT ? array->ints[index] : array->bytes[index];
+}
+
+static inline void rt_set(rt_array *array, int index, int value) {
+    switch (array->type) {
+        case RT_INT:
+            array->ints[index] = value;
+            break;
+        case RT_BOOL:
+            array->bytes[index] = value != 0;
+            break;
+        default:
+            array->bytes[index] = (char)value;
+            break;
+    }
+}
+
+static inline int rt_load(int handle, int index, int line) {
+    return rt_get(rt_array_with_index(handle, index, line), index);
+}
+
+static inline int rt_load_unchecked(int handle, int index) {
+    return rt_get(&rt_arrays[handle], index);
+}
+
+static inline void rt_store(int handle, int index, int value, int line) {
+    rt_set(rt_array_with_index(handle, index, line), index, value);
+}
+
+static inline void rt_store_unchecked(int handle, int index, int value) {
+    rt_set(&rt_arrays[handle], index, value);
+}
+
+/* copies the elements of source and zeroes the rest, target keeps its
+   declared size */
+static inline void rt_copy(int target, int source, int line) {
+    rt_array *to = rt_array_at(target, line);
+    rt_array *from = rt_array_at(source, line);
+    if ((to->type == RT_INT) != (from->type == RT_INT)) {
+        rt_error(line, "arrays of different types.");
+    }
+    if (from->size > to->size) {
+        char message[96];
+        sprintf(message, "%lu elements do not fit in an array of %lu elements.",
+                (unsigned long)from->size, (unsigned long)to->size);
+        rt_error(line, message);
+    }
+    if (to == from) {
+        return;
+    }
+    if (to->type == RT_INT) {
+        memcpy(to->ints, from->ints, from->size * sizeof(int));
+        memset(to->ints + from->size, 0, (to->size - from->size) * sizeof(int));
+    } else {
+        memcpy(to->bytes, from->bytes, from->size);
+        memset(to->bytes + from->size, 0, to->size - from->size);
+    }
+}
+
+/* what %s prints: up to the first NUL, or to a literal \x0 of a string
+   constant */
+static inline void rt_print_string(int handle, int line) {
+    rt_array *array = rt_array_at(handle, line);
+    size_t length = 0;
+    if (array->type != RT_INT) {
+        while (length < array->size && array->bytes[length] != '\0' &&
+               !(array->bytes[length] == '\\' && length + 2 < array->size && array->bytes[length + 1] == 'x' &&
+                 array->bytes[length + 2] == '0')) {
+            length++;
+        }
+    }
+    fwrite(array->bytes, 1, length, stdout);
+}
+
+/* arithmetic wraps around at 32 bits */
+static inline int rt_add(int lhs, int rhs) {
+    return (int)((unsigned)lhs + (unsigned)rhs);
+}
+
+static inline int rt_sub(int lhs, int rhs) {
+    return (int)((unsigned)lhs - (unsigned)rhs);
+}
+
+static inline int rt_mul(int lhs, int rhs) {
+    return (int)((unsigned)lhs * (unsigned)rhs);
+}
+
+static inline int rt_div(int lhs, int rhs, int line) {
+    if (rhs == 0) {
+        rt_error(line, "division by zero.");
+    }
+    /* INT_MIN / -1 is undefined in C, the engines wrap it to INT_MIN */
+    return rhs == -1 ? (int)(0u - (unsigned)lhs) : lhs / rhs;
+}
+
+static inline int rt_mod(int lhs, int rhs, int line) {
+    if (rhs == 0) {
+        rt_error(line, "division by zero.");
+    }
+    return rhs == -1 ? 0 : lhs % rhs;
+}
+
+/* a negative exponent is 1 / base ^ -exponent rounded toward zero */
+static inline int rt_pow(int base, int exponent, int line) {
+    unsigned result = 1;
+    unsigned factor = (unsigned)base;
+    if (base == 0 && exponent < 0) {
+        rt_error(line, "division by zero.");
+    }
+    if (exponent < 0) {
+        return base == 1 ? 1 : base == -1 ? (exponent % 2 ? -1 : 1) : 0;
+    }
+    while (exponent) {
+        if (exponent & 1) {
+            result *= factor;
+        }
+        factor *= factor;
+        exponent >>= 1;
+    }
+    return (int)result;
+}
+)";
+
+// An expression of the program, parsed from its postfix form so the
+// operands of && and || are known before any C is written for them
+struct CExpression {
+    enum class Kind {
+        Constant,    // text is the value
+        Local,       // text is the C variable
+        Global,      // text is the C variable
+        Element,     // array[index]
+        Not,
+        Arithmetic,  // text is rt_add, rt_sub or rt_mul
+        Comparison,  // text is the C operator
+        Checked,     // text is rt_div, rt_mod or rt_pow, which may fail
+        And,
+        Or,
+        Call,        // text is the C function
+    };
+
+    Kind kind;
+    std::string text;
+    std::vector<std::unique_ptr<CExpression>> operands;
+    bool checked{true};  // Element
+    int line{0};
+};
+
+// C for the value of an expression, stable when no call or store can
+// change it (constants, locals and what is computed from them)
+struct CValue {
+    std::string text;
+    bool stable;
+};
+
+namespace {
+
+const char* elementTypeName(ElementType type) {
+    switch (type) {
+        case ElementType::Int:
+            return "RT_INT";
+        case ElementType::Bool:
+            return "RT_BOOL";
+        default:
+            return "RT_CHAR";
+    }
+}
+
+// text as the inside of a C string literal, % doubled in a format
+std::string quoted(const std::string& text, bool format) {
+    static const char digits[] = "01234567";
+    std::string result;
+    for (unsigned char c : text) {
+        if (c == '\\' || c == '"' || c == '?') {
+            result += '\\';
+            result += c;
+        } else if (c == '%' && format) {
+            result += "%%";
+        } else if (c >= 0x20 && c < 0x7f) {
+            result += c;
+        } else {
+            result += '\\';
+            result += digits[c >> 6];
+            result += digits[(c >> 3) & 7];
+            result += digits[c & 7];
+        }
+    }
+    return result;
+}
+
+std::string constant(int value) {
+    return value == INT_MIN ? "(-2147483647 - 1)" : std::to_string(value);
+}
+
+// a condition without the parentheses around all of it
+std::string condition(const std::string& text) {
+    if (text.size() > 1 && text.front() == '(' && text.back() == ')') {
+        return text.substr(1, text.size() - 2);
+    }
+    return text;
+}
+
+std::string joined(const std::vector<CValue>& values) {
+    std::string text;
+    for (const CValue& value : values) {
+        text += (text.empty() ? "" : ", ") + value.text;
+    }
+    return text;
+}
+
+void appendIndented(std::vector<std::string>& code, const std::vector<std::string>& block) {
+    for (const std::string& line : block) {
+        code.push_back(line.empty() || line.back() == ':' ? line : "    " + line);
+    }
+}
+
+std::unique_ptr<CExpression> expression(CExpression::Kind kind, std::string text, int line) {
+    auto result = std::make_unique<CExpression>();
+    result->kind = kind;
+    result->text = std::move(text);
+    result->line = line;
+    return result;
+}
+
+}  // namespace
+
+CTranspiler::CTranspiler(Interpreter& interpreter) : interpreter(interpreter) {}
+
+std::string CTranspiler::transpile() {
+    // the globals, and the arrays among them in the order they are allocated
+    std::map<int, std::string> globals;
+    std::vector<std::string> globalArrays;
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        ASTListNode* row = interpreter.getAddressAtInd(i);
+        for (ASTListNode* node = row; node; node = node->sibling) {
+            if (node->symbol && node->symbol->scope == 0 && node->symbol->slot >= 0 && !node->callee) {
+                globals[node->symbol->slot] = variableName(node->symbol);
+            }
+        }
+        if (row->type == ASTNodeType::DECLARATION && row->symbol->scope == 0 && row->symbol->isArray) {
+            globalArrays.push_back(variableName(row->symbol) + " = rt_new_array(" +
+                                   elementTypeName(elementTypeOf(row->symbol->datatype)) + ", " +
+                                   std::to_string(row->symbol->arraySize) + ");");
+        }
+    }
+
+    // only functions reachable from main are translated, like in the Compiler
+    std::vector<ASTListNode*> translated;
+    std::vector<Lines> definitions;
+    ASTListNode* main = interpreter.getMain();
+    if (main) {
+        reference(main);
+    }
+    while (!_pending.empty()) {
+        ASTListNode* declaration = _pending.back();
+        _pending.pop_back();
+        translated.push_back(declaration);
+        definitions.push_back(translateFunction(declaration));
+    }
+
+    std::string source = "/* Translated to C by program.exe --emit-c */\n\n";
+    source += runtime;
+    source += "\n";
+    for (const auto& [slot, name] : globals) {
+        source += "static int " + name + ";\n";
+    }
+    source += "\n";
+    for (ASTListNode* declaration : translated) {
+        source += signature(declaration) + ";\n";
+    }
+    for (const Lines& definition : definitions) {
+        source += "\n";
+        for (const std::string& line : definition) {
+            source += line + "\n";
+        }
+    }
+
+    source += "\nint main(void) {\n    rt_start();\n";
+    for (const std::string& text : _strings) {
+        source += "    rt_string(\"" + quoted(text, false) + "\", " + std::to_string(text.size()) + ");\n";
+    }
+    for (const std::string& allocation : globalArrays) {
+        source += "    " + allocation + "\n";
+    }
+    if (main) {
+        source += "    " + reference(main) + "();\n";
+    }
+    source += "    return 0;\n}\n";
+    return source;
+}
+
+CTranspiler::Lines CTranspiler::translateFunction(ASTListNode* declaration) {
+    _locals.clear();
+    _temporaries = 0;
+    _tailCalls = false;
+
+    // every local variable the function uses, by slot
+    std::vector<std::string> arrays;
+    for (ASTListNode* row = declaration; row && row != declaration->end; row = lastSibling(row)->child) {
+        for (ASTListNode* node = row; node; node = node->sibling) {
+            if (node->symbol && node->symbol->scope != 0 && node->symbol->slot >= 0 && !node->callee) {
+                variableName(node->symbol);
+            }
+        }
+        if (row->type == ASTNodeType::DECLARATION && row != declaration && row->symbol->isArray) {
+            arrays.push_back(variableName(row->symbol) + " = rt_new_array(" +
+                             elementTypeName(elementTypeOf(row->symbol->datatype)) + ", " +
+                             std::to_string(row->symbol->arraySize) + ");");
+        }
+    }
+    _hasArrays = !arrays.empty();
+
+    Lines body = translateBlock(declaration->body);
+
+    Lines code{signature(declaration) + " {"};
+    std::map<int, std::string> locals(_locals.begin(), _locals.end());
+    for (const auto& [slot, name] : locals) {
+        if (slot >= (int)declaration->symbol->parameterCount) {
+            code.push_back("    int " + name + " = 0;");
+        }
+    }
+    if (_hasArrays) {
+        // local arrays are allocated once per call, wherever they are declared
+        code.push_back("    int arrayBase = rt_mark();");
+        for (const std::string& allocation : arrays) {
+            code.push_back("    " + allocation);
+        }
+    }
+    if (_tailCalls) {
+        code.push_back("start:");
+    }
+    appendIndented(code, body);
+    // falling off the end returns 0
+    if (_hasArrays) {
+        code.push_back("    rt_release(arrayBase);");
+    }
+    code.push_back("    return 0;");
+    code.push_back("}");
+    return code;
+}
+
+std::string CTranspiler::signature(ASTListNode* declaration) {
+    std::string parameters;
+    for (SymbolTableListNode* param = declaration->symbol->parameterList; param; param = param->next()) {
+        // named like variableName does, without looking at _locals
+        parameters += (parameters.empty() ? "int " : ", int ") + param->identifierName + "_" +
+                      std::to_string(param->slot);
+    }
+    return "static int " + reference(declaration) + "(" + (parameters.empty() ? "void" : parameters) + ")";
+}
+
+// The statements from node up to the END_BLOCK closing them
+CTranspiler::Lines CTranspiler::translateBlock(ASTListNode* node) {
+    Lines code;
+    while (node->type != ASTNodeType::END_BLOCK) {
+        Lines statement = translateStatement(node);
+        code.insert(code.end(), statement.begin(), statement.end());
+        node = node->child;
+    }
+    return code;
+}
+
+// Leaves node on the last node of the statement, the next statement is its
+// child
+CTranspiler::Lines CTranspiler::translateStatement(ASTListNode*& node) {
+    if (node->token) {
+        _line = node->token->lineNumber;
+    }
+
+    Lines code;
+    switch (node->type) {
+        case ASTNodeType::ASSIGNMENT:
+            code = translateAssignment(node);
+            break;
+        case ASTNodeType::IF:
+            code = translateIf(node);
+            node = node->end;
+            return code;
+        case ASTNodeType::WHILE:
+            code = translateWhile(node);
+            node = node->end;
+            return code;
+        case ASTNodeType::FOR1:
+            code = translateFor(node);
+            node = node->end;
+            return code;
+        case ASTNodeType::PRINTF:
+            code = translatePrintf(node);
+            break;
+        case ASTNodeType::RETURN:
+            code = translateReturn(node);
+            break;
+        case ASTNodeType::CALL:
+            code = node->tailCall ? translateTailCall(node) : translateCall(node);
+            break;
+        default:
+            // declarations are allocated on entry
+            break;
+    }
+    node = lastSibling(node);
+    return code;
+}
+
+CTranspiler::Lines CTranspiler::translateAssignment(ASTListNode* node) {
+    ASTListNode* target = node->sibling;
+    ASTListNode* next = target->sibling;
+    Lines code;
+
+    // element store: target [ index ] value =
+    if (next && next->token->type == TokenType::L_BRACKET) {
+        CExpression store;
+        store.operands.push_back(parseLoad(target));
+        next = next->sibling;
+        store.operands.push_back(parseExpression(next));
+        next = next->sibling;
+        store.operands.push_back(parseExpression(next));
+        std::string values = joined(emitOperands(store, code));
+        if (target->inBounds) {
+            code.push_back("rt_store_unchecked(" + values + ");");
+        } else {
+            code.push_back("rt_store(" + values + ", " + std::to_string(_line) + ");");
+        }
+        return code;
+    }
+
+    std::unique_ptr<CExpression> value = parseExpression(next);
+    SymbolTableListNode* symbol = variableOf(target);
+    if (symbol->isArray) {
+        // the value first, like the VM
+        CExpression copy;
+        copy.operands.push_back(std::move(value));
+        copy.operands.push_back(parseLoad(target));
+        std::vector<CValue> values = emitOperands(copy, code);
+        code.push_back("rt_copy(" + values[1].text + ", " + values[0].text + ", " + std::to_string(_line) + ");");
+        return code;
+    }
+    code.push_back(variableName(symbol) + " = " + emit(*value, code).text + ";");
+    return code;
+}
+
+CTranspiler::Lines CTranspiler::translateIf(ASTListNode* node) {
+    ASTListNode* conditionNode = node->sibling;
+    std::unique_ptr<CExpression> test = parseExpression(conditionNode);
+    Lines body = translateBlock(node->body);
+    Lines elseBody;
+    if (node->elseBody) {
+        elseBody = translateBlock(node->elseBody);
+    }
+
+    Lines code;
+    CValue value = emit(*test, code);
+    code.push_back("if (" + condition(value.text) + ") {");
+    appendIndented(code, body);
+    if (node->elseBody) {
+        code.push_back("} else {");
+        appendIndented(code, elseBody);
+    }
+    code.push_back("}");
+    return code;
+}
+
+CTranspiler::Lines CTranspiler::translateWhile(ASTListNode* node) {
+    ASTListNode* conditionNode = node->sibling;
+    std::unique_ptr<CExpression> test = parseExpression(conditionNode);
+    return loop(test.get(), translateBlock(node->body));
+}
+
+CTranspiler::Lines CTranspiler::translateFor(ASTListNode* node) {
+    // For node is split into FOR1, FOR2, FOR3
+    ASTListNode* conditionRow = lastSibling(node)->child;
+    ASTListNode* incrementRow = lastSibling(conditionRow)->child;
+
+    // in the order of the Compiler, the increment takes the line of the
+    // body's last statement like there
+    Lines code;
+    if (node->sibling) {
+        code = translateAssignment(node);
+    }
+    std::unique_ptr<CExpression> test;
+    if (conditionRow->sibling) {
+        ASTListNode* conditionNode = conditionRow->sibling;
+        test = parseExpression(conditionNode);
+    }
+    Lines body = translateBlock(node->body);
+    if (incrementRow->sibling) {
+        Lines increment = translateAssignment(incrementRow);
+        body.insert(body.end(), increment.begin(), increment.end());
+    }
+    Lines loopCode = loop(test.get(), std::move(body));
+    code.insert(code.end(), loopCode.begin(), loopCode.end());
+    return code;
+}
+
+// body as long as condition holds, always without one. A condition that
+// needs statements of its own is computed at the top of every iteration.
+CTranspiler::Lines CTranspiler::loop(const CExpression* test, Lines body) {
+    Lines code;
+    if (!test) {
+        code.push_back("for (;;) {");
+    } else {
+        Lines computation;
+        CValue value = emit(*test, computation);
+        if (computation.empty()) {
+            code.push_back("while (" + condition(value.text) + ") {");
+        } else {
+            code.push_back("for (;;) {");
+            appendIndented(code, computation);
+            code.push_back("    if (!" + (value.text.front() == '(' ? value.text : "(" + value.text + ")") + ") {");
+            code.push_back("        break;");
+            code.push_back("    }");
+        }
+    }
+    appendIndented(code, body);
+    code.push_back("}");
+    return code;
+}
+
+CTranspiler::Lines CTranspiler::translatePrintf(ASTListNode* node) {
+    ASTListNode* format = node->sibling;
+    CExpression arguments;
+
+    for (ASTListNode* arg = format->sibling; arg; arg = arg->sibling) {
+        TokenType type = arg->token->type;
+        if (type == TokenType::SINGLE_QUOTE || type == TokenType::DOUBLE_QUOTE) {
+            continue;
+        }
+        // an element, name [ index ], leaves arg on the ]. printf arguments
+        // are not turned into postfix, so the index is a single value.
+        ASTListNode* next = arg->sibling;
+        if (type == TokenType::IDENTIFIER && next && next->token->type == TokenType::L_BRACKET) {
+            ASTListNode* index = next->sibling;
+            if (!index || !index->sibling || index->sibling->token->type != TokenType::R_BRACKET) {
+                throwError(arg->token, "printf can only index \"" + arg->token->lexeme + "\" with a single value.");
+            }
+            std::unique_ptr<CExpression> element = expression(CExpression::Kind::Element, "", _line);
+            element->checked = !arg->inBounds;
+            element->operands.push_back(parseLoad(arg));
+            element->operands.push_back(parseOperand(index));
+            arguments.operands.push_back(std::move(element));
+            arg = index->sibling;
+        } else {
+            arguments.operands.push_back(parseOperand(arg));
+        }
+    }
+    PrintfFormat compiled = compileFormat(format->token->lexeme);
+    if ((int)arguments.operands.size() < compiled.argumentCount) {
+        throwError(format->token, "printf format expects " + std::to_string(compiled.argumentCount) +
+                                      " argument(s), got " + std::to_string(arguments.operands.size()) + ".");
+    }
+
+    // every argument is computed before anything is printed, a %s is
+    // printed on its own since its argument may turn out not to be an array
+    Lines code;
+    std::vector<CValue> values = emitOperands(arguments, code);
+    std::string text;
+    std::string printed;
+    auto print = [&]() {
+        if (!text.empty()) {
+            code.push_back("printf(\"" + text + "\"" + printed + ");");
+        }
+        text.clear();
+        printed.clear();
+    };
+    for (const FormatSegment& segment : compiled.segments) {
+        switch (segment.kind) {
+            case FormatSegment::Kind::Literal:
+                text += quoted(segment.text, true);
+                break;
+            case FormatSegment::Kind::Newline:
+                text += "\\n";
+                break;
+            case FormatSegment::Kind::Int:
+                text += "%d";
+                printed += ", " + values[segment.argument].text;
+                break;
+            case FormatSegment::Kind::Hex:
+                text += "%x";
+                printed += ", (unsigned)" + values[segment.argument].text;
+                break;
+            case FormatSegment::Kind::Char:
+                text += "%c";
+                printed += ", " + values[segment.argument].text;
+                break;
+            case FormatSegment::Kind::String:
+                print();
+                code.push_back("rt_print_string(" + values[segment.argument].text + ", " + std::to_string(_line) +
+                               ");");
+                break;
+        }
+    }
+    print();
+    return code;
+}
+
+CTranspiler::Lines CTranspiler::translateReturn(ASTListNode* node) {
+    Lines code;
+    if (!node->sibling) {
+        code.push_back(returnValue("0"));
+        return code;
+    }
+    ASTListNode* value = node->sibling;
+    if (value->tailCall) {
+        return translateTailCall(value);
+    }
+    std::unique_ptr<CExpression> result = parseExpression(value);
+    CValue computed = emit(*result, code);
+    if (_hasArrays) {
+        // read before the arrays it may be read from are gone
+        computed = temporary(computed.text, code);
+        code.push_back("rt_release(arrayBase);");
+    }
+    code.push_back("return " + computed.text + ";");
+    return code;
+}
+
+// The running function called again as the last thing it does: the new
+// arguments replace the parameters and it starts over
+CTranspiler::Lines CTranspiler::translateTailCall(ASTListNode* node) {
+    std::unique_ptr<CExpression> call = parseCall(node);
+    Lines code;
+    std::vector<CValue> values = emitOperands(*call, code);
+    for (size_t i = 0; i < values.size(); i++) {
+        if (call->operands[i]->kind != CExpression::Kind::Constant) {
+            values[i] = temporary(values[i].text, code);
+        }
+    }
+    std::map<int, std::string> locals(_locals.begin(), _locals.end());
+    for (const auto& [slot, name] : locals) {
+        code.push_back(name + " = " + (slot < (int)values.size() ? values[slot].text : "0") + ";");
+    }
+    code.push_back("goto start;");
+    _tailCalls = true;
+    return code;
+}
+
+// a call statement, its value is dropped
+CTranspiler::Lines CTranspiler::translateCall(ASTListNode* node) {
+    std::unique_ptr<CExpression> call = parseCall(node);
+    Lines code;
+    std::string arguments = joined(emitOperands(*call, code));
+    code.push_back("rt_check_stack(" + std::to_string(call->line) + ");");
+    code.push_back(call->text + "(" + arguments + ");");
+    return code;
+}
+
+// From a call site, name ( arg , ... ), leaving node on the closing paren
+std::unique_ptr<CExpression> CTranspiler::parseCall(ASTListNode*& node) {
+    ASTListNode* callNode = node;
+    if (!callNode->callee) {
+        throwError(callNode->token, "\"" + callNode->token->lexeme + "\" is not defined.");
+    }
+
+    std::unique_ptr<CExpression> call = expression(CExpression::Kind::Call, "", 0);
+    node = node->sibling;
+    while (node->token->type != TokenType::R_PAREN) {
+        node = node->sibling;
+        if (node->token->type == TokenType::R_PAREN) {
+            break;
+        }
+        call->operands.push_back(parseExpression(node));
+    }
+
+    SymbolTableListNode* function = callNode->callee->symbol;
+    if (call->operands.size() != function->parameterCount) {
+        throwError(callNode->token, "\"" + function->identifierName + "\" expects " +
+                                        std::to_string(function->parameterCount) + " argument(s), got " +
+                                        std::to_string(call->operands.size()) + ".");
+    }
+    call->text = reference(callNode->callee);
+    call->line = _line;
+    return call;
+}
+
+// Parses the postfix expression starting at node, stopping on the closing
+// ] ) or , of an enclosing index or call, or on the last node of the row
+std::unique_ptr<CExpression> CTranspiler::parseExpression(ASTListNode*& node) {
+    std::vector<std::unique_ptr<CExpression>> operands;
+    ASTListNode* start = node;
+
+    while (node) {
+        TokenType type = node->token->type;
+
+        // end of an array index, a call argument or the argument list
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
+        }
+
+        if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = node->sibling;
+            if (next && next->token->type == TokenType::L_PAREN) {
+                operands.push_back(parseCall(node));
+            } else if (next && next->token->type == TokenType::L_BRACKET) {
+                std::unique_ptr<CExpression> element = expression(CExpression::Kind::Element, "", _line);
+                element->checked = !node->inBounds;
+                element->operands.push_back(parseLoad(node));
+                node = next->sibling;
+                element->operands.push_back(parseExpression(node));
+                operands.push_back(std::move(element));
+            } else {
+                operands.push_back(parseLoad(node));
+            }
+        } else if (type == TokenType::BOOLEAN_NOT) {
+            if (operands.empty()) {
+                throwError(node->token, "missing operand of \"" + node->token->lexeme + "\".");
+            }
+            std::unique_ptr<CExpression> negation = expression(CExpression::Kind::Not, "", _line);
+            negation->operands.push_back(std::move(operands.back()));
+            operands.back() = std::move(negation);
+        } else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            if (operands.size() < 2) {
+                throwError(node->token, "missing operand of \"" + node->token->lexeme + "\".");
+            }
+            std::unique_ptr<CExpression> operation;
+            switch (type) {
+                case TokenType::BOOLEAN_AND:
+                    operation = expression(CExpression::Kind::And, "", _line);
+                    break;
+                case TokenType::BOOLEAN_OR:
+                    operation = expression(CExpression::Kind::Or, "", _line);
+                    break;
+                case TokenType::PLUS:
+                    operation = expression(CExpression::Kind::Arithmetic, "rt_add", _line);
+                    break;
+                case TokenType::MINUS:
+                    operation = expression(CExpression::Kind::Arithmetic, "rt_sub", _line);
+                    break;
+                case TokenType::ASTERISK:
+                    operation = expression(CExpression::Kind::Arithmetic, "rt_mul", _line);
+                    break;
+                case TokenType::DIVIDE:
+                    operation = expression(CExpression::Kind::Checked, "rt_div", _line);
+                    break;
+                case TokenType::MODULO:
+                    operation = expression(CExpression::Kind::Checked, "rt_mod", _line);
+                    break;
+                case TokenType::CARET:
+                    operation = expression(CExpression::Kind::Checked, "rt_pow", _line);
+                    break;
+                case TokenType::GT:
+                    operation = expression(CExpression::Kind::Comparison, ">", _line);
+                    break;
+                case TokenType::GT_EQUAL:
+                    operation = expression(CExpression::Kind::Comparison, ">=", _line);
+                    break;
+                case TokenType::LT:
+                    operation = expression(CExpression::Kind::Comparison, "<", _line);
+                    break;
+                case TokenType::LT_EQUAL:
+                    operation = expression(CExpression::Kind::Comparison, "<=", _line);
+                    break;
+                case TokenType::BOOLEAN_EQUAL:
+                    operation = expression(CExpression::Kind::Comparison, "==", _line);
+                    break;
+                case TokenType::BOOLEAN_NOT_EQUAL:
+                    operation = expression(CExpression::Kind::Comparison, "!=", _line);
+                    break;
+                default:
+                    throwError(node->token, "unsupported operator \"" + node->token->lexeme + "\".");
+            }
+            std::unique_ptr<CExpression> rhs = std::move(operands.back());
+            operands.pop_back();
+            operation->operands.push_back(std::move(operands.back()));
+            operation->operands.push_back(std::move(rhs));
+            operands.back() = std::move(operation);
+        }
+        // quotes and the assignment operator carry no value
+        else if (type == TokenType::STRING || type == TokenType::CHAR_LITERAL || type == TokenType::INTEGER ||
+                 type == TokenType::TRUE || type == TokenType::FALSE) {
+            operands.push_back(parseOperand(node));
+        }
+
+        if (node->sibling == nullptr) {
+            break;
+        }
+        node = node->sibling;
+    }
+
+    if (operands.empty()) {
+        throwError(start->token, "missing value.");
+    }
+    return std::move(operands.back());
+}
+
+// a single literal or variable
+std::unique_ptr<CExpression> CTranspiler::parseOperand(ASTListNode* node) {
+    switch (node->token->type) {
+        case TokenType::STRING:
+            return expression(CExpression::Kind::Constant, constant(stringConstant(node->token->lexeme)), _line);
+        case TokenType::CHAR_LITERAL:
+            return expression(CExpression::Kind::Constant, constant(node->token->lexeme[0]), _line);
+        case TokenType::INTEGER:
+            return expression(CExpression::Kind::Constant, constant(std::stoi(node->token->lexeme)), _line);
+        case TokenType::TRUE:
+            return expression(CExpression::Kind::Constant, "1", _line);
+        case TokenType::FALSE:
+            return expression(CExpression::Kind::Constant, "0", _line);
+        default:
+            return parseLoad(node);
+    }
+}
+
+std::unique_ptr<CExpression> CTranspiler::parseLoad(ASTListNode* node) {
+    SymbolTableListNode* symbol = variableOf(node);
+    return expression(symbol->scope == 0 ? CExpression::Kind::Global : CExpression::Kind::Local,
+                      variableName(symbol), _line);
+}
+
+// Appends to code what has to run before the value of expression is read
+CValue CTranspiler::emit(const CExpression& expression, Lines& code) {
+    std::string line = std::to_string(expression.line);
+    switch (expression.kind) {
+        case CExpression::Kind::Constant:
+        case CExpression::Kind::Local:
+            return {expression.text, true};
+        case CExpression::Kind::Global:
+            return {expression.text, false};
+        case CExpression::Kind::Element: {
+            std::vector<CValue> values = emitOperands(expression, code);
+            if (expression.checked) {
+                return temporary("rt_load(" + joined(values) + ", " + line + ")", code);
+            }
+            return {"rt_load_unchecked(" + joined(values) + ")", false};
+        }
+        case CExpression::Kind::Not: {
+            CValue value = emit(*expression.operands[0], code);
+            return {"!" + value.text, value.stable};
+        }
+        case CExpression::Kind::Arithmetic: {
+            std::vector<CValue> values = emitOperands(expression, code);
+            return {expression.text + "(" + joined(values) + ")", values[0].stable && values[1].stable};
+        }
+        case CExpression::Kind::Comparison: {
+            std::vector<CValue> values = emitOperands(expression, code);
+            return {"(" + values[0].text + " " + expression.text + " " + values[1].text + ")",
+                    values[0].stable && values[1].stable};
+        }
+        case CExpression::Kind::Checked: {
+            std::vector<CValue> values = emitOperands(expression, code);
+            return temporary(expression.text + "(" + joined(values) + ", " + line + ")", code);
+        }
+        case CExpression::Kind::And:
+        case CExpression::Kind::Or: {
+            bool isAnd = expression.kind == CExpression::Kind::And;
+            CValue lhs = emit(*expression.operands[0], code);
+            Lines right;
+            CValue rhs = emit(*expression.operands[1], right);
+            if (right.empty()) {
+                return {"(" + lhs.text + (isAnd ? " && " : " || ") + rhs.text + ")", lhs.stable && rhs.stable};
+            }
+            // the right operand needs statements, which only run when the
+            // left one does not decide
+            CValue result = temporary("(" + lhs.text + " != 0)", code);
+            code.push_back("if (" + std::string(isAnd ? "" : "!") + result.text + ") {");
+            appendIndented(code, right);
+            code.push_back("    " + result.text + " = (" + rhs.text + " != 0);");
+            code.push_back("}");
+            return result;
+        }
+        case CExpression::Kind::Call: {
+            std::vector<CValue> values = emitOperands(expression, code);
+            code.push_back("rt_check_stack(" + line + ");");
+            return temporary(expression.text + "(" + joined(values) + ")", code);
+        }
+    }
+    return {"0", true};
+}
+
+// The values of the operands, in order: an operand that needs statements
+// first has the unstable operands before it read into temporaries
+std::vector<CValue> CTranspiler::emitOperands(const CExpression& expression, Lines& code) {
+    std::vector<CValue> values;
+    for (const std::unique_ptr<CExpression>& operand : expression.operands) {
+        Lines own;
+        CValue value = emit(*operand, own);
+        if (!own.empty()) {
+            for (CValue& earlier : values) {
+                if (!earlier.stable) {
+                    earlier = temporary(earlier.text, code);
+                }
+            }
+        }
+        code.insert(code.end(), own.begin(), own.end());
+        values.push_back(value);
+    }
+    return values;
+}
+
+CValue CTranspiler::temporary(const std::string& value, Lines& code) {
+    std::string name = "tmp" + std::to_string(++_temporaries);
+    code.push_back("int " + name + " = " + value + ";");
+    return {name, true};
+}
+
+std::string CTranspiler::returnValue(const std::string& value) {
+    return _hasArrays ? "rt_release(arrayBase); return " + value + ";" : "return " + value + ";";
+}
+
+// The C function of declaration, queueing its body the first time it is
+// called
+std::string CTranspiler::reference(ASTListNode* declaration) {
+    if (_queued.insert(declaration).second) {
+        _pending.push_back(declaration);
+    }
+    return "fn_" + declaration->symbol->identifierName;
+}
+
+std::string CTranspiler::variableName(SymbolTableListNode* symbol) {
+    if (symbol->scope == 0) {
+        return "g_" + symbol->identifierName;
+    }
+    auto found = _locals.find(symbol->slot);
+    if (found != _locals.end()) {
+        return found->second;
+    }
+    return _locals[symbol->slot] = symbol->identifierName + "_" + std::to_string(symbol->slot);
+}
+
+int CTranspiler::stringConstant(const std::string& str) {
+    auto found = _stringIndex.find(str);
+    if (found != _stringIndex.end()) {
+        return found->second;
+    }
+    _strings.push_back(str);
+    return _stringIndex[str] = _strings.size() - 1;
+}
+
+SymbolTableListNode* CTranspiler::variableOf(ASTListNode* node) {
+    SymbolTableListNode* symbol = node->symbol;
+    if (!symbol || symbol->slot < 0) {
+        throwError(node->token, "\"" + node->token->lexeme + "\" is not a declared variable.");
+    }
+    return symbol;
+}
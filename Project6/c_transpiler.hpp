@@ -0,0 +1,81 @@
+#ifndef C_TRANSPILER_HPP
+#define C_TRANSPILER_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+#include "ast_list_node.hpp"
+#include "interpreter.hpp"
+
+struct CExpression;
+struct CValue;
+
+// Translates the program into one self-contained C file: a C function per
+// function and procedure reachable from main, and a small runtime in front
+// holding the arrays, printf's %s and the runtime errors. The program prints
+// what the other engines print and fails with the same errors, so it can
+// stand in for them once compiled with any C99 compiler.
+//
+// Values are ints. Arrays are handles into the runtime's heap, whose first
+// entries are the string constants, like in the VirtualMachine. C leaves
+// the order of operands open, so everything that may print or fail (calls,
+// /, %, ^, checked element loads) is computed into a temporary of its own,
+// after the reads of globals and elements that come before it.
+class CTranspiler {
+   public:
+    explicit CTranspiler(Interpreter& interpreter);
+    std::string transpile();
+
+   private:
+    using Lines = std::vector<std::string>;
+
+    Interpreter& interpreter;
+
+    std::unordered_map<std::string, int> _stringIndex;
+    std::vector<std::string> _strings;
+    std::vector<ASTListNode*> _pending;  // called functions not translated yet
+    std::unordered_set<ASTListNode*> _queued;
+    int _line{0};
+
+    // the function being translated
+    std::unordered_map<int, std::string> _locals;  // C name of each slot used
+    bool _hasArrays{false};
+    bool _tailCalls{false};  // it starts over at its start label
+    int _temporaries{0};
+
+   private:
+    Lines translateFunction(ASTListNode* declaration);
+    std::string signature(ASTListNode* declaration);
+    Lines translateBlock(ASTListNode* node);
+    Lines translateStatement(ASTListNode*& node);
+    Lines translateAssignment(ASTListNode* node);
+    Lines translateIf(ASTListNode* node);
+    Lines translateWhile(ASTListNode* node);
+    Lines translateFor(ASTListNode* node);
+    Lines translatePrintf(ASTListNode* node);
+    Lines translateReturn(ASTListNode* node);
+    Lines translateTailCall(ASTListNode* node);
+    Lines translateCall(ASTListNode* node);
+    Lines loop(const CExpression* condition, Lines body);
+
+    std::unique_ptr<CExpression> parseCall(ASTListNode*& node);
+    std::unique_ptr<CExpression> parseExpression(ASTListNode*& node);
+    std::unique_ptr<CExpression> parseOperand(ASTListNode* node);
+    std::unique_ptr<CExpression> parseLoad(ASTListNode* node);
+
+    CValue emit(const CExpression& expression, Lines& code);
+    std::vector<CValue> emitOperands(const CExpression& expression, Lines& code);
+    CValue temporary(const std::string& value, Lines& code);
+    std::string returnValue(const std::string& value);
+
+    std::string reference(ASTListNode* declaration);
+    std::string variableName(SymbolTableListNode* symbol);
+    int stringConstant(const std::string& str);
+    SymbolTableListNode* variableOf(ASTListNode* node);
+};
+
+#endif  // C_TRANSPILER_HPP
@@ -0,0 +1,406 @@
+#include "closure_compiler.hpp"
+
+#include "array.hpp"
+#include "token_error.hpp"
+
+ClosureCompiler::ClosureCompiler(Interpreter& interpreter) : interpreter(interpreter) {}
+
+ClosureProgram ClosureCompiler::compile() {
+    _program.globalCount = interpreter.getGlobalCount();
+
+    // every function exists up front so calls can point at it before its
+    // body is compiled
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        auto function = std::make_unique<ClosureFunction>();
+        function->name = declaration->symbol->identifierName;
+        function->frameSize = declaration->symbol->frameSize;
+        function->parameterCount = declaration->symbol->parameterCount;
+        _functions[declaration] = function.get();
+        _program.functions.push_back(std::move(function));
+    }
+
+    // global arrays exist before main runs
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        ASTListNode* node = interpreter.getAddressAtInd(i);
+        if (node->type == ASTNodeType::DECLARATION && node->symbol->scope == 0 && node->symbol->isArray) {
+            _program.globalArrays.push_back(
+                {node->symbol->slot, node->symbol->arraySize, elementTypeOf(node->symbol->datatype)});
+        }
+    }
+
+    // only functions reachable from main are compiled, like in the Compiler
+    if (ASTListNode* main = interpreter.getMain()) {
+        _program.main = reference(main);
+    }
+    while (!_pending.empty()) {
+        ASTListNode* declaration = _pending.back();
+        _pending.pop_back();
+        compileFunction(declaration);
+    }
+
+    return std::move(_program);
+}
+
+void ClosureCompiler::compileFunction(ASTListNode* declaration) {
+    ClosureFunction& function = *_functions[declaration];
+
+    // local arrays are allocated once per call, wherever they are declared
+    for (ASTListNode* node = declaration; node != declaration->end; node = lastSibling(node)->child) {
+        if (node->type == ASTNodeType::DECLARATION && node != declaration && node->symbol->isArray) {
+            function.arrays.push_back(
+                {node->symbol->slot, node->symbol->arraySize, elementTypeOf(node->symbol->datatype)});
+        }
+    }
+
+    function.body = compileBlock(declaration->body);
+}
+
+// The statements from node up to the END_BLOCK closing them
+StatementPtr ClosureCompiler::compileBlock(ASTListNode* node) {
+    std::vector<StatementPtr> statements;
+    while (node->type != ASTNodeType::END_BLOCK) {
+        if (StatementPtr statement = compileStatement(node)) {
+            statements.push_back(std::move(statement));
+        }
+        node = node->child;
+    }
+    if (statements.size() == 1) {
+        return std::move(statements.front());
+    }
+    return blockNode(std::move(statements));
+}
+
+// Leaves node on the last node of the statement, the next statement is its
+// child. Declarations give no statement, they are allocated by the call.
+StatementPtr ClosureCompiler::compileStatement(ASTListNode*& node) {
+    if (node->token) {
+        _line = node->token->lineNumber;
+    }
+
+    StatementPtr statement;
+    switch (node->type) {
+        case ASTNodeType::ASSIGNMENT:
+            statement = compileAssignment(node);
+            break;
+        case ASTNodeType::IF:
+            statement = compileIf(node);
+            node = node->end;
+            return statement;
+        case ASTNodeType::WHILE:
+            statement = compileWhile(node);
+            node = node->end;
+            return statement;
+        case ASTNodeType::FOR1:
+            statement = compileFor(node);
+            node = node->end;
+            return statement;
+        case ASTNodeType::PRINTF:
+            statement = compilePrintf(node);
+            break;
+        case ASTNodeType::RETURN:
+            statement = compileReturn(node);
+            break;
+        case ASTNodeType::CALL: {
+            // a call statement discards the result
+            ASTListNode* callNode = node;
+            if (node->tailCall) {
+                statement = compileTailCall(callNode);
+            } else {
+                statement = evaluateNode(compileCall(callNode));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    node = lastSibling(node);
+    return statement;
+}
+
+StatementPtr ClosureCompiler::compileAssignment(ASTListNode* node) {
+    ASTListNode* target = node->sibling;
+    ASTListNode* next = target->sibling;
+
+    // element store: target [ index ] value =
+    if (next && next->token->type == TokenType::L_BRACKET) {
+        ExpressionPtr array = compileLoad(target);
+        next = next->sibling;
+        ExpressionPtr index = compileExpression(next);
+        next = next->sibling;
+        ExpressionPtr value = compileExpression(next);
+        return storeElementNode(std::move(array), std::move(index), std::move(value), !target->inBounds, _line);
+    }
+
+    ExpressionPtr value = compileExpression(next);
+    SymbolTableListNode* symbol = variableOf(target);
+    if (symbol->isArray) {
+        return copyArrayNode(compileLoad(target), std::move(value), _line);
+    }
+    if (symbol->scope == 0) {
+        return storeGlobalNode(symbol->slot, std::move(value));
+    }
+    return storeLocalNode(symbol->slot, std::move(value));
+}
+
+StatementPtr ClosureCompiler::compileIf(ASTListNode* node) {
+    ASTListNode* condition = node->sibling;
+    ExpressionPtr test = compileExpression(condition);
+    StatementPtr body = compileBlock(node->body);
+    StatementPtr elseBody = node->elseBody ? compileBlock(node->elseBody) : nullptr;
+    return ifNode(std::move(test), std::move(body), std::move(elseBody));
+}
+
+StatementPtr ClosureCompiler::compileWhile(ASTListNode* node) {
+    ASTListNode* condition = node->sibling;
+    ExpressionPtr test = compileExpression(condition);
+    return whileNode(std::move(test), compileBlock(node->body));
+}
+
+StatementPtr ClosureCompiler::compileFor(ASTListNode* node) {
+    // For node is split into FOR1, FOR2, FOR3
+    ASTListNode* conditionRow = lastSibling(node)->child;
+    ASTListNode* incrementRow = lastSibling(conditionRow)->child;
+
+    // in the order of the Compiler, the increment takes the line of the
+    // body's last statement like there
+    StatementPtr init = node->sibling ? compileAssignment(node) : nullptr;
+    ExpressionPtr test;
+    if (conditionRow->sibling) {
+        ASTListNode* condition = conditionRow->sibling;
+        test = compileExpression(condition);
+    }
+    StatementPtr body = compileBlock(node->body);
+    StatementPtr increment = incrementRow->sibling ? compileAssignment(incrementRow) : nullptr;
+    return forNode(std::move(init), std::move(test), std::move(increment), std::move(body));
+}
+
+StatementPtr ClosureCompiler::compilePrintf(ASTListNode* node) {
+    ASTListNode* format = node->sibling;
+    std::vector<ExpressionPtr> arguments;
+
+    for (ASTListNode* arg = format->sibling; arg; arg = arg->sibling) {
+        TokenType type = arg->token->type;
+        if (type == TokenType::SINGLE_QUOTE || type == TokenType::DOUBLE_QUOTE) {
+            continue;
+        }
+        // an element, name [ index ], leaves arg on the ]. printf arguments
+        // are not turned into postfix, so the index is a single value.
+        ASTListNode* next = arg->sibling;
+        if (type == TokenType::IDENTIFIER && next && next->token->type == TokenType::L_BRACKET) {
+            ASTListNode* index = next->sibling;
+            if (!index || !index->sibling || index->sibling->token->type != TokenType::R_BRACKET) {
+                throwError(arg->token, "printf can only index \"" + arg->token->lexeme + "\" with a single value.");
+            }
+            arguments.push_back(loadElementNode(compileLoad(arg), compileOperand(index), !arg->inBounds, _line));
+            arg = index->sibling;
+        } else {
+            arguments.push_back(compileOperand(arg));
+        }
+    }
+    PrintfFormat compiled = compileFormat(format->token->lexeme);
+    if ((int)arguments.size() < compiled.argumentCount) {
+        throwError(format->token, "printf format expects " + std::to_string(compiled.argumentCount) +
+                                      " argument(s), got " + std::to_string(arguments.size()) + ".");
+    }
+    return printfNode(std::move(compiled), std::move(arguments), _line);
+}
+
+StatementPtr ClosureCompiler::compileReturn(ASTListNode* node) {
+    if (!node->sibling) {
+        return returnNode(constantNode(0));
+    }
+    ASTListNode* value = node->sibling;
+    if (value->tailCall) {
+        return compileTailCall(value);
+    }
+    return returnNode(compileExpression(value));
+}
+
+StatementPtr ClosureCompiler::compileTailCall(ASTListNode*& node) {
+    const ClosureFunction* function = nullptr;
+    std::vector<ExpressionPtr> arguments = compileArguments(node, function);
+    return tailCallNode(function, std::move(arguments), _line);
+}
+
+ExpressionPtr ClosureCompiler::compileCall(ASTListNode*& node) {
+    const ClosureFunction* function = nullptr;
+    std::vector<ExpressionPtr> arguments = compileArguments(node, function);
+    return callNode(function, std::move(arguments), _line);
+}
+
+// From a call site, name ( arg , ... ), leaving node on the closing paren
+// and function on the callee
+std::vector<ExpressionPtr> ClosureCompiler::compileArguments(ASTListNode*& node, const ClosureFunction*& function) {
+    ASTListNode* callNode = node;
+    if (!callNode->callee) {
+        throwError(callNode->token, "\"" + callNode->token->lexeme + "\" is not defined.");
+    }
+
+    std::vector<ExpressionPtr> arguments;
+    node = node->sibling;
+    while (node->token->type != TokenType::R_PAREN) {
+        node = node->sibling;
+        if (node->token->type == TokenType::R_PAREN) {
+            break;
+        }
+        arguments.push_back(compileExpression(node));
+    }
+
+    function = reference(callNode->callee);
+    if (arguments.size() != function->parameterCount) {
+        throwError(callNode->token, "\"" + function->name + "\" expects " + std::to_string(function->parameterCount) +
+                                        " argument(s), got " + std::to_string(arguments.size()) + ".");
+    }
+    return arguments;
+}
+
+// Builds the postfix expression starting at node, stopping on the closing
+// ] ) or , of an enclosing index or call, or on the last node of the row
+ExpressionPtr ClosureCompiler::compileExpression(ASTListNode*& node) {
+    std::vector<ExpressionPtr> operands;
+    ASTListNode* start = node;
+
+    while (node) {
+        TokenType type = node->token->type;
+
+        // end of an array index, a call argument or the argument list
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
+        }
+
+        if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = node->sibling;
+            if (next && next->token->type == TokenType::L_PAREN) {
+                operands.push_back(compileCall(node));
+            } else if (next && next->token->type == TokenType::L_BRACKET) {
+                bool inBounds = node->inBounds;
+                ExpressionPtr array = compileLoad(node);
+                node = next->sibling;
+                ExpressionPtr index = compileExpression(node);
+                operands.push_back(loadElementNode(std::move(array), std::move(index), !inBounds, _line));
+            } else {
+                operands.push_back(compileLoad(node));
+            }
+        } else if (type == TokenType::BOOLEAN_NOT) {
+            if (operands.empty()) {
+                throwError(node->token, "missing operand of \"" + node->token->lexeme + "\".");
+            }
+            operands.back() = notNode(std::move(operands.back()));
+        } else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            if (operands.size() < 2) {
+                throwError(node->token, "missing operand of \"" + node->token->lexeme + "\".");
+            }
+            ExpressionPtr rhs = std::move(operands.back());
+            operands.pop_back();
+            ExpressionPtr lhs = std::move(operands.back());
+            ExpressionPtr& result = operands.back();
+            switch (type) {
+                case TokenType::BOOLEAN_AND:
+                case TokenType::BOOLEAN_OR:
+                    result = shortCircuitNode(type == TokenType::BOOLEAN_AND, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::PLUS:
+                    result = binaryNode(BinaryOp::Add, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::MINUS:
+                    result = binaryNode(BinaryOp::Sub, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::ASTERISK:
+                    result = binaryNode(BinaryOp::Mul, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::DIVIDE:
+                    result = divideNode(false, std::move(lhs), std::move(rhs), _line);
+                    break;
+                case TokenType::MODULO:
+                    result = divideNode(true, std::move(lhs), std::move(rhs), _line);
+                    break;
+                case TokenType::CARET:
+                    result = powerNode(std::move(lhs), std::move(rhs), _line);
+                    break;
+                case TokenType::GT:
+                    result = binaryNode(BinaryOp::Gt, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::GT_EQUAL:
+                    result = binaryNode(BinaryOp::Ge, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::LT:
+                    result = binaryNode(BinaryOp::Lt, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::LT_EQUAL:
+                    result = binaryNode(BinaryOp::Le, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::BOOLEAN_EQUAL:
+                    result = binaryNode(BinaryOp::Eq, std::move(lhs), std::move(rhs));
+                    break;
+                case TokenType::BOOLEAN_NOT_EQUAL:
+                    result = binaryNode(BinaryOp::Ne, std::move(lhs), std::move(rhs));
+                    break;
+                default:
+                    throwError(node->token, "unsupported operator \"" + node->token->lexeme + "\".");
+            }
+        }
+        // quotes and the assignment operator carry no value
+        else if (type == TokenType::STRING || type == TokenType::CHAR_LITERAL || type == TokenType::INTEGER ||
+                 type == TokenType::TRUE || type == TokenType::FALSE) {
+            operands.push_back(compileOperand(node));
+        }
+
+        if (node->sibling == nullptr) {
+            break;
+        }
+        node = node->sibling;
+    }
+
+    if (operands.empty()) {
+        throwError(start->token, "missing value.");
+    }
+    return std::move(operands.back());
+}
+
+// a single literal or variable
+ExpressionPtr ClosureCompiler::compileOperand(ASTListNode* node) {
+    switch (node->token->type) {
+        case TokenType::STRING:
+            return constantNode(stringConstant(node->token->lexeme));
+        case TokenType::CHAR_LITERAL:
+            return constantNode(node->token->lexeme[0]);
+        case TokenType::INTEGER:
+            return constantNode(std::stoi(node->token->lexeme));
+        case TokenType::TRUE:
+            return constantNode(1);
+        case TokenType::FALSE:
+            return constantNode(0);
+        default:
+            return compileLoad(node);
+    }
+}
+
+ExpressionPtr ClosureCompiler::compileLoad(ASTListNode* node) {
+    SymbolTableListNode* symbol = variableOf(node);
+    return symbol->scope == 0 ? loadGlobalNode(symbol->slot) : loadLocalNode(symbol->slot);
+}
+
+// The function, queueing its body the first time it is called
+const ClosureFunction* ClosureCompiler::reference(ASTListNode* declaration) {
+    if (_queued.insert(declaration).second) {
+        _pending.push_back(declaration);
+    }
+    return _functions[declaration];
+}
+
+int ClosureCompiler::stringConstant(const std::string& str) {
+    auto found = _stringIndex.find(str);
+    if (found != _stringIndex.end()) {
+        return found->second;
+    }
+    _program.strings.push_back(str);
+    return _stringIndex[str] = _program.strings.size() - 1;
+}
+
+SymbolTableListNode* ClosureCompiler::variableOf(ASTListNode* node) {
+    SymbolTableListNode* symbol = node->symbol;
+    if (!symbol || symbol->slot < 0) {
+        throwError(node->token, "\"" + node->token->lexeme + "\" is not a declared variable.");
+    }
+    return symbol;
+}
@@ -0,0 +1,56 @@
+#ifndef CLOSURE_COMPILER_HPP
+#define CLOSURE_COMPILER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+#include "ast_list_node.hpp"
+#include "closures.hpp"
+#include "interpreter.hpp"
+
+// Turns the AST into the node tree run by the ClosureMachine, walking it
+// like the Compiler does and failing on the same programs with the same
+// errors. Relies on the slots and call links the Interpreter has put on the
+// AST, the inBounds marks of RangeAnalysis and the tailCall marks of
+// TailCallAnalysis.
+class ClosureCompiler {
+   public:
+    explicit ClosureCompiler(Interpreter& interpreter);
+    ClosureProgram compile();
+
+   private:
+    Interpreter& interpreter;
+
+    ClosureProgram _program;
+    std::unordered_map<ASTListNode*, ClosureFunction*> _functions;
+    std::unordered_map<std::string, int> _stringIndex;
+    std::vector<ASTListNode*> _pending;  // called functions not compiled yet
+    std::unordered_set<ASTListNode*> _queued;
+    int _line{0};
+
+   private:
+    void compileFunction(ASTListNode* declaration);
+    StatementPtr compileBlock(ASTListNode* node);
+    StatementPtr compileStatement(ASTListNode*& node);
+    StatementPtr compileAssignment(ASTListNode* node);
+    StatementPtr compileIf(ASTListNode* node);
+    StatementPtr compileWhile(ASTListNode* node);
+    StatementPtr compileFor(ASTListNode* node);
+    StatementPtr compilePrintf(ASTListNode* node);
+    StatementPtr compileReturn(ASTListNode* node);
+    StatementPtr compileTailCall(ASTListNode*& node);
+    ExpressionPtr compileCall(ASTListNode*& node);
+    std::vector<ExpressionPtr> compileArguments(ASTListNode*& node, const ClosureFunction*& function);
+    ExpressionPtr compileExpression(ASTListNode*& node);
+    ExpressionPtr compileOperand(ASTListNode* node);
+    ExpressionPtr compileLoad(ASTListNode* node);
+
+    const ClosureFunction* reference(ASTListNode* declaration);
+    int stringConstant(const std::string& str);
+    SymbolTableListNode* variableOf(ASTListNode* node);
+};
+
+#endif  // CLOSURE_COMPILER_HPP
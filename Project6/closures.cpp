@@ -0,0 +1,662 @@
+#include "closures.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "arithmetic.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// operand stack slots, like the VirtualMachine's
+static constexpr size_t stackSize = size_t(1) << 24;
+
+namespace {
+
+// Expressions
+
+class Constant final : public Expression {
+   public:
+    explicit Constant(int value) : value(value) {}
+    int evaluate(ClosureMachine&) const override { return value; }
+
+    const int value;
+};
+
+class LoadLocal final : public Expression {
+   public:
+    explicit LoadLocal(int slot) : _slot(slot) {}
+    int evaluate(ClosureMachine& machine) const override { return machine.locals[_slot]; }
+
+   private:
+    int _slot;
+};
+
+class LoadGlobal final : public Expression {
+   public:
+    explicit LoadGlobal(int slot) : _slot(slot) {}
+    int evaluate(ClosureMachine& machine) const override { return machine.globals[_slot]; }
+
+   private:
+    int _slot;
+};
+
+template <bool Checked>
+class LoadElement final : public Expression {
+   public:
+    LoadElement(ExpressionPtr array, ExpressionPtr index, int line)
+        : _array(std::move(array)), _index(std::move(index)), _line(line) {}
+
+    int evaluate(ClosureMachine& machine) const override {
+        int handle = _array->evaluate(machine);
+        int index = _index->evaluate(machine);
+        if constexpr (Checked) {
+            return machine.arrayWithIndex(handle, index, _line).get(index);
+        } else {
+            return machine.arrays[handle].get(index);
+        }
+    }
+
+   private:
+    ExpressionPtr _array;
+    ExpressionPtr _index;
+    int _line;
+};
+
+template <BinaryOp Op>
+inline int apply(int lhs, int rhs) {
+    switch (Op) {
+        case BinaryOp::Add:
+            return wrappingAdd(lhs, rhs);
+        case BinaryOp::Sub:
+            return wrappingSubtract(lhs, rhs);
+        case BinaryOp::Mul:
+            return wrappingMultiply(lhs, rhs);
+        case BinaryOp::Lt:
+            return lhs < rhs;
+        case BinaryOp::Le:
+            return lhs <= rhs;
+        case BinaryOp::Gt:
+            return lhs > rhs;
+        case BinaryOp::Ge:
+            return lhs >= rhs;
+        case BinaryOp::Eq:
+            return lhs == rhs;
+        case BinaryOp::Ne:
+            return lhs != rhs;
+    }
+    return 0;
+}
+
+template <BinaryOp Op>
+class Binary final : public Expression {
+   public:
+    Binary(ExpressionPtr lhs, ExpressionPtr rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
+
+    int evaluate(ClosureMachine& machine) const override {
+        int lhs = _lhs->evaluate(machine);
+        int rhs = _rhs->evaluate(machine);
+        return apply<Op>(lhs, rhs);
+    }
+
+   private:
+    ExpressionPtr _lhs;
+    ExpressionPtr _rhs;
+};
+
+// the common i < 10, n - 1, with the constant bound in
+template <BinaryOp Op>
+class BinaryConstant final : public Expression {
+   public:
+    BinaryConstant(ExpressionPtr lhs, int rhs) : _lhs(std::move(lhs)), _rhs(rhs) {}
+
+    int evaluate(ClosureMachine& machine) const override { return apply<Op>(_lhs->evaluate(machine), _rhs); }
+
+   private:
+    ExpressionPtr _lhs;
+    int _rhs;
+};
+
+template <BinaryOp Op>
+ExpressionPtr makeBinary(ExpressionPtr lhs, ExpressionPtr rhs) {
+    if (const Constant* constant = dynamic_cast<const Constant*>(rhs.get())) {
+        return std::make_unique<BinaryConstant<Op>>(std::move(lhs), constant->value);
+    }
+    return std::make_unique<Binary<Op>>(std::move(lhs), std::move(rhs));
+}
+
+class Divide final : public Expression {
+   public:
+    Divide(bool modulo, ExpressionPtr lhs, ExpressionPtr rhs, int line)
+        : _modulo(modulo), _lhs(std::move(lhs)), _rhs(std::move(rhs)), _line(line) {}
+
+    int evaluate(ClosureMachine& machine) const override {
+        int lhs = _lhs->evaluate(machine);
+        int rhs = _rhs->evaluate(machine);
+        if (rhs == 0) {
+            ClosureMachine::runtimeError(_line, "division by zero.");
+        }
+        return _modulo ? wrappingModulo(lhs, rhs) : wrappingDivide(lhs, rhs);
+    }
+
+   private:
+    bool _modulo;
+    ExpressionPtr _lhs;
+    ExpressionPtr _rhs;
+    int _line;
+};
+
+class Power final : public Expression {
+   public:
+    Power(ExpressionPtr lhs, ExpressionPtr rhs, int line) : _lhs(std::move(lhs)), _rhs(std::move(rhs)), _line(line) {}
+
+    int evaluate(ClosureMachine& machine) const override {
+        int lhs = _lhs->evaluate(machine);
+        int rhs = _rhs->evaluate(machine);
+        if (powerDividesByZero(lhs, rhs)) {
+            ClosureMachine::runtimeError(_line, "division by zero.");
+        }
+        return integerPower(lhs, rhs);
+    }
+
+   private:
+    ExpressionPtr _lhs;
+    ExpressionPtr _rhs;
+    int _line;
+};
+
+class Not final : public Expression {
+   public:
+    explicit Not(ExpressionPtr operand) : _operand(std::move(operand)) {}
+    int evaluate(ClosureMachine& machine) const override { return !_operand->evaluate(machine); }
+
+   private:
+    ExpressionPtr _operand;
+};
+
+template <bool IsAnd>
+class ShortCircuit final : public Expression {
+   public:
+    ShortCircuit(ExpressionPtr lhs, ExpressionPtr rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
+
+    int evaluate(ClosureMachine& machine) const override {
+        if ((_lhs->evaluate(machine) != 0) != IsAnd) {
+            return !IsAnd;
+        }
+        return _rhs->evaluate(machine) != 0;
+    }
+
+   private:
+    ExpressionPtr _lhs;
+    ExpressionPtr _rhs;
+};
+
+class Call final : public Expression {
+   public:
+    Call(const ClosureFunction* function, std::vector<ExpressionPtr> arguments, int line)
+        : _function(function), _arguments(std::move(arguments)), _line(line) {}
+
+    // the arguments go straight into the slots of the new frame, which
+    // starts where the caller's ends
+    int evaluate(ClosureMachine& machine) const override {
+        int* frame = machine.top;
+        machine.checkStack(frame + _function->frameSize, _line);
+        for (size_t i = 0; i < _arguments.size(); i++) {
+            int value = _arguments[i]->evaluate(machine);
+            frame[i] = value;
+            machine.top = frame + i + 1;
+        }
+        return machine.call(*_function, frame);
+    }
+
+   private:
+    const ClosureFunction* _function;
+    std::vector<ExpressionPtr> _arguments;
+    int _line;
+};
+
+// Statements
+
+class Block final : public Statement {
+   public:
+    explicit Block(std::vector<StatementPtr> statements) : _statements(std::move(statements)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        for (const StatementPtr& statement : _statements) {
+            Flow flow = statement->execute(machine);
+            if (flow != Flow::Next) {
+                return flow;
+            }
+        }
+        return Flow::Next;
+    }
+
+   private:
+    std::vector<StatementPtr> _statements;
+};
+
+class StoreLocal final : public Statement {
+   public:
+    StoreLocal(int slot, ExpressionPtr value) : _slot(slot), _value(std::move(value)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        machine.locals[_slot] = _value->evaluate(machine);
+        return Flow::Next;
+    }
+
+   private:
+    int _slot;
+    ExpressionPtr _value;
+};
+
+class StoreGlobal final : public Statement {
+   public:
+    StoreGlobal(int slot, ExpressionPtr value) : _slot(slot), _value(std::move(value)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        machine.globals[_slot] = _value->evaluate(machine);
+        return Flow::Next;
+    }
+
+   private:
+    int _slot;
+    ExpressionPtr _value;
+};
+
+class CopyArray final : public Statement {
+   public:
+    CopyArray(ExpressionPtr target, ExpressionPtr value, int line)
+        : _target(std::move(target)), _value(std::move(value)), _line(line) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        int source = _value->evaluate(machine);
+        int target = _target->evaluate(machine);
+        std::string error = machine.arrayAt(target, _line).assign(machine.arrayAt(source, _line));
+        if (!error.empty()) {
+            ClosureMachine::runtimeError(_line, error);
+        }
+        return Flow::Next;
+    }
+
+   private:
+    ExpressionPtr _target;
+    ExpressionPtr _value;
+    int _line;
+};
+
+template <bool Checked>
+class StoreElement final : public Statement {
+   public:
+    StoreElement(ExpressionPtr array, ExpressionPtr index, ExpressionPtr value, int line)
+        : _array(std::move(array)), _index(std::move(index)), _value(std::move(value)), _line(line) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        int handle = _array->evaluate(machine);
+        int index = _index->evaluate(machine);
+        int value = _value->evaluate(machine);
+        if constexpr (Checked) {
+            machine.arrayWithIndex(handle, index, _line).set(index, value);
+        } else {
+            machine.arrays[handle].set(index, value);
+        }
+        return Flow::Next;
+    }
+
+   private:
+    ExpressionPtr _array;
+    ExpressionPtr _index;
+    ExpressionPtr _value;
+    int _line;
+};
+
+class Evaluate final : public Statement {
+   public:
+    explicit Evaluate(ExpressionPtr expression) : _expression(std::move(expression)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        _expression->evaluate(machine);
+        return Flow::Next;
+    }
+
+   private:
+    ExpressionPtr _expression;
+};
+
+class If final : public Statement {
+   public:
+    If(ExpressionPtr condition, StatementPtr body, StatementPtr elseBody)
+        : _condition(std::move(condition)), _body(std::move(body)), _elseBody(std::move(elseBody)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        if (_condition->evaluate(machine)) {
+            return _body->execute(machine);
+        }
+        return _elseBody ? _elseBody->execute(machine) : Flow::Next;
+    }
+
+   private:
+    ExpressionPtr _condition;
+    StatementPtr _body;
+    StatementPtr _elseBody;
+};
+
+class While final : public Statement {
+   public:
+    While(ExpressionPtr condition, StatementPtr body) : _condition(std::move(condition)), _body(std::move(body)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        while (_condition->evaluate(machine)) {
+            Flow flow = _body->execute(machine);
+            if (flow != Flow::Next) {
+                return flow;
+            }
+        }
+        return Flow::Next;
+    }
+
+   private:
+    ExpressionPtr _condition;
+    StatementPtr _body;
+};
+
+class For final : public Statement {
+   public:
+    For(StatementPtr init, ExpressionPtr condition, StatementPtr step, StatementPtr body)
+        : _init(std::move(init)), _condition(std::move(condition)), _step(std::move(step)), _body(std::move(body)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        if (_init) {
+            _init->execute(machine);
+        }
+        while (!_condition || _condition->evaluate(machine)) {
+            Flow flow = _body->execute(machine);
+            if (flow != Flow::Next) {
+                return flow;
+            }
+            if (_step) {
+                _step->execute(machine);
+            }
+        }
+        return Flow::Next;
+    }
+
+   private:
+    StatementPtr _init;
+    ExpressionPtr _condition;
+    StatementPtr _step;
+    StatementPtr _body;
+};
+
+class Printf final : public Statement {
+   public:
+    Printf(PrintfFormat format, std::vector<ExpressionPtr> arguments, int line)
+        : _format(std::move(format)), _arguments(std::move(arguments)), _line(line) {}
+
+    // every argument is evaluated before anything is printed, like the VM,
+    // into the free stack above the frame
+    Flow execute(ClosureMachine& machine) const override {
+        int* values = machine.top;
+        machine.checkStack(values + _arguments.size(), _line);
+        for (size_t i = 0; i < _arguments.size(); i++) {
+            values[i] = _arguments[i]->evaluate(machine);
+        }
+        writeFormatted(
+            _format, machine.output, [&](int i) { return values[i]; },
+            [&](int i) { return machine.arrayAt(values[i], _line).chars(); });
+        return Flow::Next;
+    }
+
+   private:
+    PrintfFormat _format;
+    std::vector<ExpressionPtr> _arguments;
+    int _line;
+};
+
+class Return final : public Statement {
+   public:
+    explicit Return(ExpressionPtr value) : _value(std::move(value)) {}
+
+    Flow execute(ClosureMachine& machine) const override {
+        machine.result = _value->evaluate(machine);
+        return Flow::Return;
+    }
+
+   private:
+    ExpressionPtr _value;
+};
+
+class TailCall final : public Statement {
+   public:
+    TailCall(const ClosureFunction* function, std::vector<ExpressionPtr> arguments, int line)
+        : _function(function), _arguments(std::move(arguments)), _line(line) {}
+
+    // the arguments are evaluated above the frame, the frame is only
+    // overwritten once all of them have its old values
+    Flow execute(ClosureMachine& machine) const override {
+        int* values = machine.top;
+        machine.checkStack(values + _arguments.size(), _line);
+        for (size_t i = 0; i < _arguments.size(); i++) {
+            int value = _arguments[i]->evaluate(machine);
+            values[i] = value;
+            machine.top = values + i + 1;
+        }
+        std::copy(values, values + _arguments.size(), machine.locals);
+        std::fill(machine.locals + _arguments.size(), machine.locals + _function->frameSize, 0);
+        machine.top = machine.locals + _function->frameSize;
+        return Flow::TailCall;
+    }
+
+   private:
+    const ClosureFunction* _function;
+    std::vector<ExpressionPtr> _arguments;
+    int _line;
+};
+
+}  // namespace
+
+size_t nativeStackBudget() {
+    size_t budget = size_t(64) << 20;
+#if defined(__unix__) || defined(__APPLE__)
+    rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        budget = limit.rlim_cur - limit.rlim_cur / 8;
+    }
+#endif
+    return budget;
+}
+
+ExpressionPtr constantNode(int value) {
+    return std::make_unique<Constant>(value);
+}
+
+ExpressionPtr loadLocalNode(int slot) {
+    return std::make_unique<LoadLocal>(slot);
+}
+
+ExpressionPtr loadGlobalNode(int slot) {
+    return std::make_unique<LoadGlobal>(slot);
+}
+
+ExpressionPtr loadElementNode(ExpressionPtr array, ExpressionPtr index, bool checked, int line) {
+    if (checked) {
+        return std::make_unique<LoadElement<true>>(std::move(array), std::move(index), line);
+    }
+    return std::make_unique<LoadElement<false>>(std::move(array), std::move(index), line);
+}
+
+ExpressionPtr binaryNode(BinaryOp op, ExpressionPtr lhs, ExpressionPtr rhs) {
+    switch (op) {
+        case BinaryOp::Add:
+            return makeBinary<BinaryOp::Add>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Sub:
+            return makeBinary<BinaryOp::Sub>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Mul:
+            return makeBinary<BinaryOp::Mul>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Lt:
+            return makeBinary<BinaryOp::Lt>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Le:
+            return makeBinary<BinaryOp::Le>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Gt:
+            return makeBinary<BinaryOp::Gt>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Ge:
+            return makeBinary<BinaryOp::Ge>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Eq:
+            return makeBinary<BinaryOp::Eq>(std::move(lhs), std::move(rhs));
+        case BinaryOp::Ne:
+            return makeBinary<BinaryOp::Ne>(std::move(lhs), std::move(rhs));
+    }
+    return nullptr;
+}
+
+ExpressionPtr divideNode(bool modulo, ExpressionPtr lhs, ExpressionPtr rhs, int line) {
+    return std::make_unique<Divide>(modulo, std::move(lhs), std::move(rhs), line);
+}
+
+ExpressionPtr powerNode(ExpressionPtr lhs, ExpressionPtr rhs, int line) {
+    return std::make_unique<Power>(std::move(lhs), std::move(rhs), line);
+}
+
+ExpressionPtr notNode(ExpressionPtr operand) {
+    return std::make_unique<Not>(std::move(operand));
+}
+
+ExpressionPtr shortCircuitNode(bool isAnd, ExpressionPtr lhs, ExpressionPtr rhs) {
+    if (isAnd) {
+        return std::make_unique<ShortCircuit<true>>(std::move(lhs), std::move(rhs));
+    }
+    return std::make_unique<ShortCircuit<false>>(std::move(lhs), std::move(rhs));
+}
+
+ExpressionPtr callNode(const ClosureFunction* function, std::vector<ExpressionPtr> arguments, int line) {
+    return std::make_unique<Call>(function, std::move(arguments), line);
+}
+
+StatementPtr blockNode(std::vector<StatementPtr> statements) {
+    return std::make_unique<Block>(std::move(statements));
+}
+
+StatementPtr storeLocalNode(int slot, ExpressionPtr value) {
+    return std::make_unique<StoreLocal>(slot, std::move(value));
+}
+
+StatementPtr storeGlobalNode(int slot, ExpressionPtr value) {
+    return std::make_unique<StoreGlobal>(slot, std::move(value));
+}
+
+StatementPtr copyArrayNode(ExpressionPtr target, ExpressionPtr value, int line) {
+    return std::make_unique<CopyArray>(std::move(target), std::move(value), line);
+}
+
+StatementPtr storeElementNode(ExpressionPtr array, ExpressionPtr index, ExpressionPtr value, bool checked,
+                              int line) {
+    if (checked) {
+        return std::make_unique<StoreElement<true>>(std::move(array), std::move(index), std::move(value), line);
+    }
+    return std::make_unique<StoreElement<false>>(std::move(array), std::move(index), std::move(value), line);
+}
+
+StatementPtr evaluateNode(ExpressionPtr expression) {
+    return std::make_unique<Evaluate>(std::move(expression));
+}
+
+StatementPtr ifNode(ExpressionPtr condition, StatementPtr body, StatementPtr elseBody) {
+    return std::make_unique<If>(std::move(condition), std::move(body), std::move(elseBody));
+}
+
+StatementPtr whileNode(ExpressionPtr condition, StatementPtr body) {
+    return std::make_unique<While>(std::move(condition), std::move(body));
+}
+
+StatementPtr forNode(StatementPtr init, ExpressionPtr condition, StatementPtr step, StatementPtr body) {
+    return std::make_unique<For>(std::move(init), std::move(condition), std::move(step), std::move(body));
+}
+
+StatementPtr printfNode(PrintfFormat format, std::vector<ExpressionPtr> arguments, int line) {
+    return std::make_unique<Printf>(std::move(format), std::move(arguments), line);
+}
+
+StatementPtr returnNode(ExpressionPtr value) {
+    return std::make_unique<Return>(std::move(value));
+}
+
+StatementPtr tailCallNode(const ClosureFunction* function, std::vector<ExpressionPtr> arguments, int line) {
+    return std::make_unique<TailCall>(function, std::move(arguments), line);
+}
+
+ClosureMachine::ClosureMachine(const ClosureProgram& program, OutputBuffer& output)
+    : program(program), output(output), stack(new int[stackSize]), stackEnd(stack.get() + stackSize) {}
+
+void ClosureMachine::run() {
+    globals.assign(program.globalCount, 0);
+    arrays.clear();
+    for (const std::string& text : program.strings) {
+        arrays.emplace_back(text);
+    }
+    for (const ClosureProgram::GlobalArray& array : program.globalArrays) {
+        newArray(globals[array.slot], array.type, array.size);
+    }
+    if (!program.main) {
+        return;
+    }
+
+    char marker;
+    _nativeStackLimit = reinterpret_cast<uintptr_t>(&marker) - nativeStackBudget();
+    locals = top = stack.get();
+    call(*program.main, top);
+}
+
+void ClosureMachine::checkStack(const int* frameEnd, int line) const {
+    char marker;
+    if (frameEnd > stackEnd || reinterpret_cast<uintptr_t>(&marker) < _nativeStackLimit) {
+        runtimeError(line, "stack overflow.");
+    }
+}
+
+int ClosureMachine::call(const ClosureFunction& function, int* frame) {
+    std::fill(frame + function.parameterCount, frame + function.frameSize, 0);
+    int* callerLocals = locals;
+    size_t arrayBase = arrays.size();
+    locals = frame;
+    top = frame + function.frameSize;
+    for (const ClosureFunction::LocalArray& array : function.arrays) {
+        newArray(frame[array.slot], array.type, array.size);
+    }
+
+    Flow flow;
+    do {
+        flow = function.body->execute(*this);
+    } while (flow == Flow::TailCall);
+    int value = flow == Flow::Return ? result : 0;
+
+    arrays.resize(arrayBase);
+    locals = callerLocals;
+    top = frame;
+    return value;
+}
+
+void ClosureMachine::newArray(int& slot, ElementType type, size_t size) {
+    slot = arrays.size();
+    arrays.emplace_back(type, size);
+}
+
+Array& ClosureMachine::arrayAt(int handle, int line) {
+    if (handle < 0 || static_cast<size_t>(handle) >= arrays.size()) {
+        runtimeError(line, "value is not an array.");
+    }
+    return arrays[handle];
+}
+
+// the array at handle, which has an element index
+Array& ClosureMachine::arrayWithIndex(int handle, int index, int line) {
+    Array& array = arrayAt(handle, line);
+    if (!array.contains(index)) {
+        runtimeError(line, outOfRange(index, array.size()));
+    }
+    return array;
+}
+
+void ClosureMachine::runtimeError(int line, const std::string& message) {
+    throw std::runtime_error("Error on line " + std::to_string(line) + ": " + message);
+}
@@ -0,0 +1,153 @@
+#ifndef CLOSURES_HPP
+#define CLOSURES_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "array.hpp"
+#include "output_buffer.hpp"
+#include "printf_format.hpp"
+
+// The closure engine runs a program as a tree of precompiled nodes, one per
+// statement and per operation of an expression, each holding its operands,
+// slots and callee. Running a node is a virtual call that runs its children:
+// no tokens are looked at and no rows walked. Values are ints like in the
+// VirtualMachine, arrays are handles into a heap whose first entries are the
+// string constants, and errors read the same as in the other engines.
+
+class ClosureMachine;
+struct ClosureFunction;
+
+// what a statement leaves its block to do next
+enum class Flow {
+    Next,      // go on with the next statement
+    Return,    // leave the function, the value is in ClosureMachine::result
+    TailCall,  // start the function over, its frame holds the new arguments
+};
+
+class Expression {
+   public:
+    virtual ~Expression() = default;
+    virtual int evaluate(ClosureMachine& machine) const = 0;
+};
+
+class Statement {
+   public:
+    virtual ~Statement() = default;
+    virtual Flow execute(ClosureMachine& machine) const = 0;
+};
+
+using ExpressionPtr = std::unique_ptr<Expression>;
+using StatementPtr = std::unique_ptr<Statement>;
+
+// Expressions
+
+enum class BinaryOp { Add, Sub, Mul, Lt, Le, Gt, Ge, Eq, Ne };
+
+ExpressionPtr constantNode(int value);
+ExpressionPtr loadLocalNode(int slot);
+ExpressionPtr loadGlobalNode(int slot);
+// array[index], the array an expression giving its handle
+ExpressionPtr loadElementNode(ExpressionPtr array, ExpressionPtr index, bool checked, int line);
+ExpressionPtr binaryNode(BinaryOp op, ExpressionPtr lhs, ExpressionPtr rhs);
+// / and %, which fail on 0, and ^
+ExpressionPtr divideNode(bool modulo, ExpressionPtr lhs, ExpressionPtr rhs, int line);
+ExpressionPtr powerNode(ExpressionPtr lhs, ExpressionPtr rhs, int line);
+ExpressionPtr notNode(ExpressionPtr operand);
+// && and ||, 0 or 1 with the right operand only evaluated when it decides
+ExpressionPtr shortCircuitNode(bool isAnd, ExpressionPtr lhs, ExpressionPtr rhs);
+ExpressionPtr callNode(const ClosureFunction* function, std::vector<ExpressionPtr> arguments, int line);
+
+// Statements
+
+StatementPtr blockNode(std::vector<StatementPtr> statements);
+StatementPtr storeLocalNode(int slot, ExpressionPtr value);
+StatementPtr storeGlobalNode(int slot, ExpressionPtr value);
+// copies the elements of value into the array of target
+StatementPtr copyArrayNode(ExpressionPtr target, ExpressionPtr value, int line);
+StatementPtr storeElementNode(ExpressionPtr array, ExpressionPtr index, ExpressionPtr value, bool checked,
+                              int line);
+// a call statement, its value is dropped
+StatementPtr evaluateNode(ExpressionPtr expression);
+StatementPtr ifNode(ExpressionPtr condition, StatementPtr body, StatementPtr elseBody);
+StatementPtr whileNode(ExpressionPtr condition, StatementPtr body);
+// every part but the body may be missing
+StatementPtr forNode(StatementPtr init, ExpressionPtr condition, StatementPtr step, StatementPtr body);
+StatementPtr printfNode(PrintfFormat format, std::vector<ExpressionPtr> arguments, int line);
+StatementPtr returnNode(ExpressionPtr value);
+// a call of the running function that ends it, its arguments
+StatementPtr tailCallNode(const ClosureFunction* function, std::vector<ExpressionPtr> arguments, int line);
+
+struct ClosureFunction {
+    struct LocalArray {
+        int slot;
+        size_t size;
+        ElementType type;
+    };
+
+    std::string name;
+    size_t parameterCount{0};
+    size_t frameSize{0};
+    std::vector<LocalArray> arrays;  // allocated on every call
+    StatementPtr body;               // nullptr while not compiled
+};
+
+struct ClosureProgram {
+    struct GlobalArray {
+        int slot;
+        size_t size;
+        ElementType type;
+    };
+
+    std::vector<std::unique_ptr<ClosureFunction>> functions;
+    const ClosureFunction* main{nullptr};
+    std::vector<std::string> strings;
+    std::vector<GlobalArray> globalArrays;
+    size_t globalCount{0};
+};
+
+// C++ stack the engines recursing on it, this one and the Executor's tree
+// walker, may use: all but an eighth of its limit, which is left for the
+// error thrown from the deepest call
+size_t nativeStackBudget();
+
+// State of a running ClosureProgram. Frames sit back to back on a stack of
+// ints, the running one starts at locals and the next one at top.
+class ClosureMachine {
+   public:
+    ClosureMachine(const ClosureProgram& program, OutputBuffer& output);
+
+    // runs main, printf goes to output
+    void run();
+
+    // fails when a frame ending at frameEnd does not fit, on the VM stack
+    // or on the C++ stack the call recurses on
+    void checkStack(const int* frameEnd, int line) const;
+    // runs function on frame, whose first slots hold the arguments
+    int call(const ClosureFunction& function, int* frame);
+
+    Array& arrayAt(int handle, int line);
+    Array& arrayWithIndex(int handle, int index, int line);
+    [[noreturn]] static void runtimeError(int line, const std::string& message);
+
+    const ClosureProgram& program;
+    OutputBuffer& output;
+
+    std::unique_ptr<int[]> stack;
+    int* stackEnd{nullptr};
+    int* locals{nullptr};
+    int* top{nullptr};
+    int result{0};  // of the return statement that ended the running call
+
+    std::vector<int> globals;
+    std::vector<Array> arrays;
+
+   private:
+    void newArray(int& slot, ElementType type, size_t size);
+
+    uintptr_t _nativeStackLimit{0};  // calls fail once the C++ stack is below this
+};
+
+#endif  // CLOSURES_HPP
@@ -0,0 +1,526 @@
+#include "compiler.hpp"
+
+#include "array.hpp"
+#include "token_error.hpp"
+
+Compiler::Compiler(ASTree* ast, Interpreter& interpreter) : ast(ast), interpreter(interpreter) {}
+
+Program Compiler::compile() {
+    _program.globalCount = interpreter.getGlobalCount();
+
+    // every function gets its index up front so calls can be emitted before
+    // their callee is compiled
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        _functionIndex[declaration] = _program.functions.size();
+        FunctionInfo function;
+        function.name = declaration->symbol->identifierName;
+        function.frameSize = declaration->symbol->frameSize;
+        function.parameterCount = declaration->symbol->parameterCount;
+        function.procedure = declaration->symbol->identifierType == TokenType::PROCEDURE;
+        _program.functions.push_back(function);
+    }
+    _queued.assign(_program.functions.size(), false);
+
+    // global arrays exist before main runs
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        ASTListNode* node = interpreter.getAddressAtInd(i);
+        if (node->type == ASTNodeType::DECLARATION && node->symbol->scope == 0 && node->symbol->isArray) {
+            _line = node->token->lineNumber;
+            emit(OpCode::NEW_ARRAY_GLOBAL, node->symbol->slot, node->symbol->arraySize,
+                 static_cast<int>(elementTypeOf(node->symbol->datatype)));
+        }
+    }
+
+    ASTListNode* main = interpreter.getMain();
+    if (main) {
+        emit(OpCode::CALL, reference(main), 0);
+        emit(OpCode::POP);
+    }
+    emit(OpCode::HALT);
+
+    // only functions reachable from main are compiled, like the tree walker
+    // never looks at a function nobody calls
+    if (main) {
+        reference(main);
+    }
+    while (!_pending.empty()) {
+        ASTListNode* declaration = _pending.back();
+        _pending.pop_back();
+        compileFunction(declaration);
+    }
+
+    return _program;
+}
+
+void Compiler::compileFunction(ASTListNode* declaration) {
+    FunctionInfo& function = _program.functions[_functionIndex[declaration]];
+    function.entry = _program.code.size();
+
+    // local arrays are allocated once per call, wherever they are declared
+    for (ASTListNode* node = declaration; node != declaration->end; node = lastSibling(node)->child) {
+        if (node->type == ASTNodeType::DECLARATION && node != declaration && node->symbol->isArray) {
+            _line = node->token->lineNumber;
+            emit(OpCode::NEW_ARRAY_LOCAL, node->symbol->slot, node->symbol->arraySize,
+                 static_cast<int>(elementTypeOf(node->symbol->datatype)));
+        }
+    }
+
+    compileBlock(declaration->body);
+
+    // falling off the end returns 0
+    emit(OpCode::PUSH, 0);
+    emit(OpCode::RETURN);
+    threadJumps(function.entry);
+
+    // statements leave the operand stack empty, so a straight walk over the
+    // body finds its deepest point
+    int depth = 0;
+    for (size_t pc = function.entry; pc < _program.code.size(); pc++) {
+        depth += stackEffect(_program.code[pc]);
+        if (depth > (int)function.maxStack) {
+            function.maxStack = depth;
+        }
+    }
+}
+
+void Compiler::compileBlock(ASTListNode* node) {
+    while (node->type != ASTNodeType::END_BLOCK) {
+        node = compileStatement(node)->child;
+    }
+}
+
+// Returns the last node of the statement, the next statement is its child
+ASTListNode* Compiler::compileStatement(ASTListNode* node) {
+    if (node->token) {
+        _line = node->token->lineNumber;
+    }
+
+    switch (node->type) {
+        case ASTNodeType::ASSIGNMENT:
+            compileAssignment(node);
+            break;
+        case ASTNodeType::IF:
+            compileIf(node);
+            return node->end;
+        case ASTNodeType::WHILE:
+            compileWhile(node);
+            return node->end;
+        case ASTNodeType::FOR1:
+            compileFor(node);
+            return node->end;
+        case ASTNodeType::PRINTF:
+            compilePrintf(node);
+            break;
+        case ASTNodeType::RETURN:
+            compileReturn(node);
+            break;
+        case ASTNodeType::CALL: {
+            // a call statement discards the result
+            ASTListNode* callNode = node;
+            compileCall(callNode);
+            emit(OpCode::POP);
+            break;
+        }
+        default:
+            // declarations are allocated by the function prologue
+            break;
+    }
+    return lastSibling(node);
+}
+
+void Compiler::compileAssignment(ASTListNode* node) {
+    ASTListNode* target = node->sibling;
+    ASTListNode* next = target->sibling;
+
+    // element store: target [ index ] value =
+    if (next && next->token->type == TokenType::L_BRACKET) {
+        compileLoad(target);
+        next = next->sibling;
+        compileExpression(next);
+        next = next->sibling;
+        compileExpression(next);
+        emit(target->inBounds ? OpCode::STORE_ELEMENT_UNCHECKED : OpCode::STORE_ELEMENT);
+        return;
+    }
+
+    compileExpression(next);
+    compileStore(target);
+}
+
+void Compiler::compileIf(ASTListNode* node) {
+    ASTListNode* condition = node->sibling;
+    compileExpression(condition);
+    size_t toElse = emit(OpCode::JUMP_IF_FALSE);
+
+    compileBlock(node->body);
+    if (node->elseBody) {
+        size_t toEnd = emit(OpCode::JUMP);
+        patch(toElse, _program.code.size());
+        compileBlock(node->elseBody);
+        patch(toEnd, _program.code.size());
+    } else {
+        patch(toElse, _program.code.size());
+    }
+}
+
+void Compiler::compileWhile(ASTListNode* node) {
+    size_t loop = _program.code.size();
+    ASTListNode* condition = node->sibling;
+    compileExpression(condition);
+    size_t toEnd = emit(OpCode::JUMP_IF_FALSE);
+
+    compileBlock(node->body);
+    emit(OpCode::JUMP, loop);
+    patch(toEnd, _program.code.size());
+}
+
+void Compiler::compileFor(ASTListNode* node) {
+    // For node is split into FOR1, FOR2, FOR3
+    ASTListNode* conditionRow = lastSibling(node)->child;
+    ASTListNode* incrementRow = lastSibling(conditionRow)->child;
+
+    // FOR1: Initialization
+    if (node->sibling) {
+        compileAssignment(node);
+    }
+
+    // FOR2 end condition, an empty one is always true
+    size_t loop = _program.code.size();
+    size_t toEnd = 0;
+    if (conditionRow->sibling) {
+        ASTListNode* condition = conditionRow->sibling;
+        compileExpression(condition);
+        toEnd = emit(OpCode::JUMP_IF_FALSE);
+    }
+
+    compileBlock(node->body);
+
+    // FOR3
+    if (incrementRow->sibling) {
+        compileAssignment(incrementRow);
+    }
+    emit(OpCode::JUMP, loop);
+    if (conditionRow->sibling) {
+        patch(toEnd, _program.code.size());
+    }
+}
+
+void Compiler::compilePrintf(ASTListNode* node) {
+    ASTListNode* format = node->sibling;
+    int argCount = 0;
+
+    for (ASTListNode* arg = format->sibling; arg; arg = arg->sibling) {
+        TokenType type = arg->token->type;
+        if (type == TokenType::SINGLE_QUOTE || type == TokenType::DOUBLE_QUOTE) {
+            continue;
+        }
+        // an element, name [ index ], leaves arg on the ]. printf arguments
+        // are not turned into postfix, so the index is a single value.
+        ASTListNode* next = arg->sibling;
+        if (type == TokenType::IDENTIFIER && next && next->token->type == TokenType::L_BRACKET) {
+            ASTListNode* index = next->sibling;
+            if (!index || !index->sibling || index->sibling->token->type != TokenType::R_BRACKET) {
+                throwError(arg->token, "printf can only index \"" + arg->token->lexeme + "\" with a single value.");
+            }
+            compileLoad(arg);
+            compileOperand(index);
+            emit(arg->inBounds ? OpCode::LOAD_ELEMENT_UNCHECKED : OpCode::LOAD_ELEMENT);
+            arg = index->sibling;
+        } else {
+            compileOperand(arg);
+        }
+        argCount++;
+    }
+    PrintfFormat compiled = compileFormat(format->token->lexeme);
+    if (argCount < compiled.argumentCount) {
+        throwError(format->token, "printf format expects " + std::to_string(compiled.argumentCount) +
+                                      " argument(s), got " + std::to_string(argCount) + ".");
+    }
+    _program.formats.push_back(std::move(compiled));
+    emit(OpCode::PRINTF, _program.formats.size() - 1, argCount);
+}
+
+void Compiler::compileReturn(ASTListNode* node) {
+    if (node->sibling) {
+        ASTListNode* value = node->sibling;
+        compileExpression(value);
+    } else {
+        emit(OpCode::PUSH, 0);
+    }
+    emit(OpCode::RETURN);
+}
+
+// From a call site, name ( arg , ... ), leaving node on the closing paren
+void Compiler::compileCall(ASTListNode*& node) {
+    ASTListNode* callNode = node;
+    if (!callNode->callee) {
+        throwError(callNode->token, "\"" + callNode->token->lexeme + "\" is not defined.");
+    }
+
+    int argCount = 0;
+    node = node->sibling;
+    while (node->token->type != TokenType::R_PAREN) {
+        node = node->sibling;
+        if (node->token->type == TokenType::R_PAREN) {
+            break;
+        }
+        compileExpression(node);
+        argCount++;
+    }
+
+    const FunctionInfo& function = _program.functions[_functionIndex[callNode->callee]];
+    if (argCount != (int)function.parameterCount) {
+        throwError(callNode->token, "\"" + function.name + "\" expects " + std::to_string(function.parameterCount) +
+                                        " argument(s), got " + std::to_string(argCount) + ".");
+    }
+    emit(OpCode::CALL, reference(callNode->callee), argCount);
+}
+
+// Compiles the postfix expression starting at node, stopping on the closing
+// ] ) or , of an enclosing index or call, or on the last node of the row
+void Compiler::compileExpression(ASTListNode*& node) {
+    // where the code of each operand on the stack starts
+    std::vector<size_t> operands;
+
+    while (node) {
+        TokenType type = node->token->type;
+
+        // end of an array index, a call argument or the argument list
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
+        }
+
+        if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = node->sibling;
+            operands.push_back(_program.code.size());
+
+            if (next && next->token->type == TokenType::L_PAREN) {
+                compileCall(node);
+            } else if (next && next->token->type == TokenType::L_BRACKET) {
+                bool inBounds = node->inBounds;
+                compileLoad(node);
+                node = next->sibling;
+                compileExpression(node);
+                emit(inBounds ? OpCode::LOAD_ELEMENT_UNCHECKED : OpCode::LOAD_ELEMENT);
+            } else {
+                compileLoad(node);
+            }
+        } else if (type == TokenType::BOOLEAN_NOT) {
+            emit(OpCode::NOT);
+        } else if (type == TokenType::BOOLEAN_AND || type == TokenType::BOOLEAN_OR) {
+            if (operands.size() < 2) {
+                throwError(node->token, "missing operand of \"" + node->token->lexeme + "\".");
+            }
+            compileShortCircuit(type, operands.back());
+            operands.pop_back();
+        } else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            if (operands.size() > 1) {
+                operands.pop_back();
+            }
+            switch (type) {
+                case TokenType::PLUS:
+                    emit(OpCode::ADD);
+                    break;
+                case TokenType::MINUS:
+                    emit(OpCode::SUB);
+                    break;
+                case TokenType::ASTERISK:
+                    emit(OpCode::MUL);
+                    break;
+                case TokenType::DIVIDE:
+                    emit(OpCode::DIV);
+                    break;
+                case TokenType::MODULO:
+                    emit(OpCode::MOD);
+                    break;
+                case TokenType::CARET:
+                    emit(OpCode::POW);
+                    break;
+                case TokenType::GT:
+                    emit(OpCode::GT);
+                    break;
+                case TokenType::GT_EQUAL:
+                    emit(OpCode::GE);
+                    break;
+                case TokenType::LT:
+                    emit(OpCode::LT);
+                    break;
+                case TokenType::LT_EQUAL:
+                    emit(OpCode::LE);
+                    break;
+                case TokenType::BOOLEAN_EQUAL:
+                    emit(OpCode::EQ);
+                    break;
+                case TokenType::BOOLEAN_NOT_EQUAL:
+                    emit(OpCode::NE);
+                    break;
+                default:
+                    throwError(node->token, "unsupported operator \"" + node->token->lexeme + "\".");
+            }
+        }
+        // quotes and the assignment operator carry no value
+        else if (type == TokenType::STRING || type == TokenType::CHAR_LITERAL || type == TokenType::INTEGER ||
+                 type == TokenType::TRUE || type == TokenType::FALSE) {
+            operands.push_back(_program.code.size());
+            compileOperand(node);
+        }
+
+        if (node->sibling == nullptr) {
+            break;
+        }
+        node = node->sibling;
+    }
+}
+
+// The operands of && and || are already compiled, the right one from right
+// on. A jump in front of it skips it when the left one decides the result,
+// which is 0 or 1 like the result of a comparison.
+void Compiler::compileShortCircuit(TokenType type, size_t right) {
+    bool isAnd = type == TokenType::BOOLEAN_AND;
+    insert(right, {isAnd ? OpCode::JUMP_IF_FALSE_OR_POP : OpCode::JUMP_IF_TRUE_OR_POP, 0, 0, 0});
+
+    switch (_program.code.back().op) {
+        case OpCode::LT:
+        case OpCode::LE:
+        case OpCode::GT:
+        case OpCode::GE:
+        case OpCode::EQ:
+        case OpCode::NE:
+        case OpCode::NOT:
+            break;
+        default:
+            emit(OpCode::PUSH, 0);
+            emit(OpCode::NE);
+            break;
+    }
+    patch(right, _program.code.size());
+}
+
+// a single literal or variable
+void Compiler::compileOperand(ASTListNode* node) {
+    switch (node->token->type) {
+        case TokenType::STRING:
+            emit(OpCode::PUSH_STRING, stringConstant(node->token->lexeme));
+            break;
+        case TokenType::CHAR_LITERAL:
+            emit(OpCode::PUSH, node->token->lexeme[0]);
+            break;
+        case TokenType::INTEGER:
+            emit(OpCode::PUSH, std::stoi(node->token->lexeme));
+            break;
+        case TokenType::TRUE:
+            emit(OpCode::PUSH, 1);
+            break;
+        case TokenType::FALSE:
+            emit(OpCode::PUSH, 0);
+            break;
+        default:
+            compileLoad(node);
+            break;
+    }
+}
+
+void Compiler::compileLoad(ASTListNode* node) {
+    SymbolTableListNode* symbol = variableOf(node);
+    emit(symbol->scope == 0 ? OpCode::LOAD_GLOBAL : OpCode::LOAD_LOCAL, symbol->slot);
+}
+
+void Compiler::compileStore(ASTListNode* node) {
+    SymbolTableListNode* symbol = variableOf(node);
+    if (symbol->isArray) {
+        emit(symbol->scope == 0 ? OpCode::COPY_ARRAY_GLOBAL : OpCode::COPY_ARRAY_LOCAL, symbol->slot);
+    } else {
+        emit(symbol->scope == 0 ? OpCode::STORE_GLOBAL : OpCode::STORE_LOCAL, symbol->slot);
+    }
+}
+
+// Index of the function, queueing its body the first time it is called
+int Compiler::reference(ASTListNode* declaration) {
+    int index = _functionIndex[declaration];
+    if (!_queued[index]) {
+        _queued[index] = true;
+        _pending.push_back(declaration);
+    }
+    return index;
+}
+
+size_t Compiler::emit(OpCode op, int a, int b, int c) {
+    _program.code.push_back({op, a, b, c});
+    _program.lines.push_back(_line);
+    return _program.code.size() - 1;
+}
+
+void Compiler::patch(size_t jump, size_t target) {
+    *jumpTarget(_program.code[jump]) = target;
+}
+
+// Inserts instruction at pc, which is inside the expression being compiled.
+// Jumps before pc never go past it, the targets of those after it move along.
+void Compiler::insert(size_t pc, Instruction instruction) {
+    for (size_t i = pc; i < _program.code.size(); i++) {
+        int* target = jumpTarget(_program.code[i]);
+        if (target && *target > (int)pc) {
+            (*target)++;
+        }
+    }
+    _program.code.insert(_program.code.begin() + pc, instruction);
+    _program.lines.insert(_program.lines.begin() + pc, _line);
+}
+
+// A jump of && or || is only taken with a known value on the stack, 0 for
+// && and 1 for ||. When it lands on another conditional jump, that value
+// already decides where execution goes from there, so it jumps straight on.
+// A condition then leaves nothing behind for the JUMP_IF_FALSE testing it.
+void Compiler::threadJumps(size_t entry) {
+    std::vector<Instruction>& code = _program.code;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t pc = entry; pc < code.size(); pc++) {
+            Instruction& jump = code[pc];
+            if (jump.op != OpCode::JUMP_IF_FALSE_OR_POP && jump.op != OpCode::JUMP_IF_TRUE_OR_POP) {
+                continue;
+            }
+            bool value = jump.op == OpCode::JUMP_IF_TRUE_OR_POP;
+            OpCode popping = value ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE;
+            const Instruction& target = code[jump.a];
+
+            switch (target.op) {
+                case OpCode::JUMP_IF_FALSE_OR_POP:
+                case OpCode::JUMP_IF_TRUE_OR_POP:
+                    if (target.op == jump.op) {
+                        jump.a = target.a;  // keeps the value
+                    } else {
+                        jump = {popping, jump.a + 1, 0, 0};
+                    }
+                    break;
+                case OpCode::JUMP_IF_FALSE:
+                    jump = {popping, value ? jump.a + 1 : target.a, 0, 0};
+                    break;
+                case OpCode::JUMP_IF_TRUE:
+                    jump = {popping, value ? target.a : jump.a + 1, 0, 0};
+                    break;
+                default:
+                    continue;
+            }
+            changed = true;
+        }
+    }
+}
+
+int Compiler::stringConstant(const std::string& str) {
+    auto found = _stringIndex.find(str);
+    if (found != _stringIndex.end()) {
+        return found->second;
+    }
+    _program.strings.push_back(str);
+    return _stringIndex[str] = _program.strings.size() - 1;
+}
+
+SymbolTableListNode* Compiler::variableOf(ASTListNode* node) {
+    SymbolTableListNode* symbol = node->symbol;
+    if (!symbol || symbol->slot < 0) {
+        throwError(node->token, "\"" + node->token->lexeme + "\" is not a declared variable.");
+    }
+    return symbol;
+}
@@ -0,0 +1,58 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+#include "ast_list_node.hpp"
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+
+// Lowers the AST into the linear instruction stream run by the
+// VirtualMachine. Relies on the slots, jump targets and call links the
+// Interpreter has put on the AST.
+class Compiler {
+   public:
+    Compiler(ASTree* ast, Interpreter& interpreter);
+    Program compile();
+
+   private:
+    ASTree* ast;
+    Interpreter& interpreter;
+
+    Program _program;
+    std::unordered_map<ASTListNode*, int> _functionIndex;
+    std::unordered_map<std::string, int> _stringIndex;
+    std::vector<ASTListNode*> _pending;  // called functions not compiled yet
+    std::vector<bool> _queued;
+    int _line{0};
+
+   private:
+    void compileFunction(ASTListNode* declaration);
+    void compileBlock(ASTListNode* node);
+    ASTListNode* compileStatement(ASTListNode* node);
+    void compileAssignment(ASTListNode* node);
+    void compileIf(ASTListNode* node);
+    void compileWhile(ASTListNode* node);
+    void compileFor(ASTListNode* node);
+    void compilePrintf(ASTListNode* node);
+    void compileReturn(ASTListNode* node);
+    void compileCall(ASTListNode*& node);
+    void compileExpression(ASTListNode*& node);
+    void compileShortCircuit(TokenType type, size_t right);
+    void compileOperand(ASTListNode* node);
+    void compileLoad(ASTListNode* node);
+    void compileStore(ASTListNode* node);
+
+    int reference(ASTListNode* declaration);
+    size_t emit(OpCode op, int a = 0, int b = 0, int c = 0);
+    void patch(size_t jump, size_t target);
+    void insert(size_t pc, Instruction instruction);
+    void threadJumps(size_t entry);
+    int stringConstant(const std::string& str);
+    SymbolTableListNode* variableOf(ASTListNode* node);
+};
+
+#endif  // COMPILER_HPP
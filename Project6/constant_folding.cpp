@@ -0,0 +1,461 @@
+#include "constant_folding.hpp"
+
+#include <climits>
+#include <iterator>
+#include <string>
+
+#include "arithmetic.hpp"
+
+static bool isLiteral(TokenType type) {
+    return type == TokenType::INTEGER || type == TokenType::CHAR_LITERAL || type == TokenType::TRUE ||
+           type == TokenType::FALSE;
+}
+
+static int literalValue(const TokenNode* token) {
+    switch (token->type) {
+        case TokenType::CHAR_LITERAL:
+            return token->lexeme[0];
+        case TokenType::INTEGER:
+            return std::stoi(token->lexeme);
+        case TokenType::TRUE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static ASTListNode* newNode(TokenType type, const std::string& lexeme, int line) {
+    ASTListNode* node = new ASTListNode(ASTNodeType::SIBLING);
+    node->token = new TokenNode(Token(type, lexeme, line));
+    return node;
+}
+
+static ASTListNode* literalNode(TokenType type, int value, int line) {
+    switch (type) {
+        case TokenType::CHAR_LITERAL:
+            return newNode(type, std::string(1, static_cast<char>(value)), line);
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+            return newNode(value ? TokenType::TRUE : TokenType::FALSE, value ? "TRUE" : "FALSE", line);
+        default:
+            return newNode(TokenType::INTEGER, std::to_string(value), line);
+    }
+}
+
+// Puts node in place of the nodes after before up to and including last,
+// keeping the link to the next row when last ends its row
+static void replace(ASTListNode* before, ASTListNode* last, ASTListNode* node) {
+    node->sibling = last->sibling;
+    node->child = last->child;
+    before->sibling = node;
+}
+
+// lhs op rhs as the engines compute it, false when it fails at run time
+static bool evaluate(TokenType op, int lhs, int rhs, int& result, TokenType& literal) {
+    literal = TokenType::INTEGER;
+    switch (op) {
+        case TokenType::PLUS:
+            result = wrappingAdd(lhs, rhs);
+            return true;
+        case TokenType::MINUS:
+            result = wrappingSubtract(lhs, rhs);
+            return true;
+        case TokenType::ASTERISK:
+            result = wrappingMultiply(lhs, rhs);
+            return true;
+        case TokenType::DIVIDE:
+        case TokenType::MODULO:
+            if (rhs == 0) {
+                return false;
+            }
+            result = op == TokenType::DIVIDE ? wrappingDivide(lhs, rhs) : wrappingModulo(lhs, rhs);
+            return true;
+        case TokenType::CARET:
+            if (powerDividesByZero(lhs, rhs)) {
+                return false;
+            }
+            result = integerPower(lhs, rhs);
+            return true;
+        default:
+            break;
+    }
+
+    literal = TokenType::TRUE;
+    switch (op) {
+        case TokenType::GT:
+            result = lhs > rhs;
+            return true;
+        case TokenType::GT_EQUAL:
+            result = lhs >= rhs;
+            return true;
+        case TokenType::LT:
+            result = lhs < rhs;
+            return true;
+        case TokenType::LT_EQUAL:
+            result = lhs <= rhs;
+            return true;
+        case TokenType::BOOLEAN_EQUAL:
+            result = lhs == rhs;
+            return true;
+        case TokenType::BOOLEAN_NOT_EQUAL:
+            result = lhs != rhs;
+            return true;
+        case TokenType::BOOLEAN_AND:
+            result = lhs && rhs;
+            return true;
+        case TokenType::BOOLEAN_OR:
+            result = lhs || rhs;
+            return true;
+        default:
+            return false;
+    }
+}
+
+ConstantFolder::ConstantFolder(Interpreter& interpreter) : interpreter(interpreter) {}
+
+void ConstantFolder::run() {
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        foldFunction(declaration);
+    }
+    if (!_removed.empty()) {
+        interpreter.removeAddresses(_removed);
+    }
+}
+
+void ConstantFolder::foldFunction(ASTListNode* declaration) {
+    if (!declaration->body || !declaration->end) {
+        return;
+    }
+    _function = declaration;
+    _known.clear();
+
+    // last node of the row in front of row, the BEGIN_BLOCK of the body at first
+    ASTListNode* previous = nextRow(declaration);
+    ASTListNode* row = declaration->body;
+    while (row && row != declaration->end) {
+        if (row->type == ASTNodeType::IF) {
+            Operand condition;
+            fold(row, condition);
+            if (condition.constant && removeBranch(row, previous, condition.value != 0)) {
+                // the block that runs follows right on, still in the same basic block
+                row = previous->child;
+                continue;
+            }
+            _known.clear();
+        } else {
+            foldStatement(row);
+        }
+        previous = lastSibling(row);
+        row = previous->child;
+    }
+}
+
+void ConstantFolder::foldStatement(ASTListNode* row) {
+    Operand value;
+    switch (row->type) {
+        case ASTNodeType::ASSIGNMENT:
+            foldAssignment(row);
+            break;
+        case ASTNodeType::FOR1:
+            // runs once, right after the statements in front of it
+            foldAssignment(row);
+            _known.clear();
+            break;
+        case ASTNodeType::WHILE:
+        case ASTNodeType::FOR2:
+        case ASTNodeType::FOR3:
+            // run again after the body, nothing is known there
+            _known.clear();
+            if (row->type == ASTNodeType::FOR3) {
+                foldAssignment(row);
+            } else {
+                fold(row, value);
+            }
+            _known.clear();
+            break;
+        case ASTNodeType::RETURN:
+            fold(row, value);
+            _known.clear();
+            break;
+        case ASTNodeType::PRINTF:
+            substituteArguments(row);
+            break;
+        case ASTNodeType::CALL:
+            foldArguments(row->sibling);
+            forgetGlobals();
+            break;
+        case ASTNodeType::DECLARATION:
+            break;
+        default:
+            // blocks and else
+            _known.clear();
+            break;
+    }
+}
+
+// target = value, or target [ index ] = value
+void ConstantFolder::foldAssignment(ASTListNode* row) {
+    ASTListNode* target = row->sibling;
+    if (!target) {
+        return;
+    }
+
+    Operand value;
+    ASTListNode* next = target->sibling;
+    if (next && next->token->type == TokenType::L_BRACKET) {
+        Operand index;
+        ASTListNode* close = fold(next, index);
+        if (close) {
+            fold(close, value);
+        }
+        return;
+    }
+
+    fold(target, value);
+    if (isVariable(target)) {
+        if (value.constant) {
+            _known[target->symbol] = {value.literal, value.value};
+        } else {
+            _known.erase(target->symbol);
+        }
+    }
+}
+
+// printf arguments are not in postfix, a variable is replaced where it is
+// a whole argument or a whole index
+void ConstantFolder::substituteArguments(ASTListNode* row) {
+    ASTListNode* previous = row->sibling;
+    if (!previous) {
+        return;
+    }
+    for (ASTListNode* node = previous->sibling; node; previous = node, node = node->sibling) {
+        auto known = isVariable(node) ? _known.find(node->symbol) : _known.end();
+        if (known == _known.end()) {
+            continue;
+        }
+        ASTListNode* next = node->sibling;
+        if (next && (next->token->type == TokenType::L_BRACKET || next->token->type == TokenType::L_PAREN)) {
+            continue;
+        }
+        ASTListNode* literal = literalNode(known->second.literal, known->second.value, node->token->lineNumber);
+        replace(previous, node, literal);
+        node = literal;
+    }
+}
+
+// Links the rows in front of an if whose condition is constant to the block
+// that runs, or to the rows after it
+bool ConstantFolder::removeBranch(ASTListNode* ifNode, ASTListNode* previous, bool taken) {
+    if (!ifNode->body || !ifNode->end) {
+        return false;
+    }
+    std::vector<ASTListNode*> rows;
+    for (ASTListNode* row = ifNode; row != ifNode->end; row = nextRow(row)) {
+        if (row->type == ASTNodeType::DECLARATION) {
+            return false;
+        }
+        rows.push_back(row);
+    }
+    rows.push_back(ifNode->end);
+
+    ASTListNode* after = nextRow(ifNode->end);
+    ASTListNode* kept = taken ? ifNode->body : ifNode->elseBody;
+    ASTListNode* next = after;
+    std::unordered_set<ASTListNode*> keptRows;
+    if (kept && kept->type != ASTNodeType::END_BLOCK) {
+        // the END_BLOCK closing the kept block
+        int depth = 0;
+        ASTListNode* last = nullptr;
+        for (ASTListNode* row = kept;; row = nextRow(row)) {
+            if (row->type == ASTNodeType::BEGIN_BLOCK) {
+                depth++;
+            } else if (row->type == ASTNodeType::END_BLOCK && depth-- == 0) {
+                break;
+            }
+            keptRows.insert(row);
+            last = row;
+        }
+        lastSibling(last)->child = after;
+        next = kept;
+    }
+    previous->child = next;
+
+    for (ASTListNode* row : rows) {
+        if (!keptRows.count(row)) {
+            _removed.insert(row);
+        }
+    }
+
+    // a statement whose block started with the if now starts with next
+    for (ASTListNode* row = _function; row && row != _function->end; row = nextRow(row)) {
+        if (row->body == ifNode) {
+            row->body = next;
+        }
+        if (row->elseBody == ifNode) {
+            row->elseBody = next;
+        }
+    }
+    return true;
+}
+
+// Folds the expression after before, up to the ] ) or , closing an index or
+// argument or the end of the row, which is returned (nullptr at the end).
+// result is the value of the whole expression.
+ASTListNode* ConstantFolder::fold(ASTListNode* before, Operand& result) {
+    std::vector<Operand> operands;
+    ASTListNode* previous = before;
+    ASTListNode* node = before->sibling;
+
+    while (node) {
+        TokenType type = node->token->type;
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
+        }
+
+        if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = node->sibling;
+            ASTListNode* close = nullptr;
+            if (next && next->token->type == TokenType::L_PAREN) {
+                close = foldArguments(next);
+                forgetGlobals();
+            } else if (next && next->token->type == TokenType::L_BRACKET) {
+                Operand index;
+                close = fold(next, index);
+            } else if (isVariable(node) && _known.count(node->symbol)) {
+                const Constant& known = _known[node->symbol];
+                ASTListNode* literal = literalNode(known.literal, known.value, node->token->lineNumber);
+                replace(previous, node, literal);
+                operands.push_back({previous, literal, true, known.literal, known.value});
+                node = literal;
+            } else {
+                operands.push_back({previous, node});
+            }
+
+            // a call or an element is one value up to its ) or ]
+            if (next && (next->token->type == TokenType::L_PAREN || next->token->type == TokenType::L_BRACKET)) {
+                if (!close) {
+                    break;
+                }
+                operands.push_back({previous, close});
+                node = close;
+            }
+        } else if (type == TokenType::SINGLE_QUOTE || type == TokenType::DOUBLE_QUOTE) {
+            // ' c ' and " text " are one value
+            ASTListNode* value = node->sibling;
+            if (value && value->sibling && value->sibling->token->type == type) {
+                bool character = value->token->type == TokenType::CHAR_LITERAL;
+                operands.push_back({previous, value->sibling, character, TokenType::CHAR_LITERAL,
+                                    character ? literalValue(value->token) : 0});
+                node = value->sibling;
+            }
+        } else if (isLiteral(type)) {
+            operands.push_back({previous, node, true, type, literalValue(node->token)});
+        } else if (type == TokenType::STRING) {
+            operands.push_back({previous, node});
+        } else if (type == TokenType::BOOLEAN_NOT) {
+            node = applyNot(operands, node);
+        } else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            node = applyBinary(operands, node);
+        }
+
+        previous = node;
+        node = node->sibling;
+    }
+
+    result = operands.size() == 1 ? operands.back() : Operand{};
+    return node;
+}
+
+// From the ( of a call, folds every argument and returns the closing )
+ASTListNode* ConstantFolder::foldArguments(ASTListNode* open) {
+    ASTListNode* node = open;
+    while (node && node->token->type != TokenType::R_PAREN) {
+        Operand argument;
+        node = fold(node, argument);
+    }
+    return node;
+}
+
+// Returns the node that now stands where op was
+ASTListNode* ConstantFolder::applyBinary(std::vector<Operand>& operands, ASTListNode* op) {
+    if (operands.size() < 2) {
+        // not an expression the engines can run, leave it to them
+        operands.clear();
+        return op;
+    }
+    TokenType type = op->token->type;
+    int line = op->token->lineNumber;
+    Operand rhs = operands.back();
+    operands.pop_back();
+    Operand& lhs = operands.back();
+
+    int value = 0;
+    TokenType literal = TokenType::INTEGER;
+    if (lhs.constant && rhs.constant && evaluate(type, lhs.value, rhs.value, value, literal)) {
+        ASTListNode* node = literalNode(literal, value, line);
+        replace(lhs.before, op, node);
+        lhs = {lhs.before, node, true, literal, value};
+        return node;
+    }
+
+    // FALSE && x and TRUE || x never look at x
+    bool decides = (type == TokenType::BOOLEAN_AND && !lhs.value) || (type == TokenType::BOOLEAN_OR && lhs.value);
+    if (lhs.constant && decides) {
+        ASTListNode* node = literalNode(TokenType::TRUE, lhs.value != 0, line);
+        replace(lhs.before, op, node);
+        lhs = {lhs.before, node, true, TokenType::TRUE, lhs.value != 0};
+        return node;
+    }
+
+    if (!lhs.constant && rhs.constant && (type == TokenType::PLUS || type == TokenType::MINUS)) {
+        int offset = type == TokenType::PLUS ? rhs.value : wrappingNegate(rhs.value);
+        if (!lhs.offsetBefore) {
+            lhs.offsetBefore = rhs.before;
+            lhs.offset = offset;
+            lhs.last = op;
+            return op;
+        }
+
+        // x + j + k as x + (j + k), written as a subtraction when negative
+        offset = wrappingAdd(lhs.offset, offset);
+        bool subtract = offset < 0 && offset != INT_MIN;
+        ASTListNode* constant = literalNode(TokenType::INTEGER, subtract ? -offset : offset, line);
+        ASTListNode* node = subtract ? newNode(TokenType::MINUS, "-", line) : newNode(TokenType::PLUS, "+", line);
+        constant->sibling = node;
+        replace(lhs.offsetBefore, op, node);
+        lhs.offsetBefore->sibling = constant;
+        lhs.offset = offset;
+        lhs.last = node;
+        return node;
+    }
+
+    lhs = {lhs.before, op};
+    return op;
+}
+
+ASTListNode* ConstantFolder::applyNot(std::vector<Operand>& operands, ASTListNode* op) {
+    if (operands.empty()) {
+        return op;
+    }
+    Operand& operand = operands.back();
+    if (operand.constant) {
+        ASTListNode* node = literalNode(TokenType::TRUE, !operand.value, op->token->lineNumber);
+        replace(operand.before, op, node);
+        operand = {operand.before, node, true, TokenType::TRUE, !operand.value};
+        return node;
+    }
+    operand = {operand.before, op};
+    return op;
+}
+
+// a scalar variable, which a constant can stand in for
+bool ConstantFolder::isVariable(ASTListNode* node) const {
+    SymbolTableListNode* symbol = node->symbol;
+    return node->token->type == TokenType::IDENTIFIER && symbol && symbol->slot >= 0 && !symbol->isArray;
+}
+
+void ConstantFolder::forgetGlobals() {
+    for (auto known = _known.begin(); known != _known.end();) {
+        known = known->first->scope == 0 ? _known.erase(known) : std::next(known);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef CONSTANT_FOLDING_HPP
+#define CONSTANT_FOLDING_HPP
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast_list_node.hpp"
+#include "interpreter.hpp"
+#include "symbol_table_list_node.hpp"
+
+// Simplifies the postfix expressions of every function before either engine
+// sees them:
+//
+//   - operators whose operands are all constants are replaced by their
+//     result, and x + j - k becomes x + (j - k)
+//   - a variable last assigned a constant earlier in the same basic block
+//     is replaced by that constant
+//   - an if whose condition ends up constant is replaced by the block that
+//     runs, or removed
+//
+// Folding follows the engines: ints wrap around, INT_MIN / -1 too,
+// comparisons give TRUE or FALSE, and anything that fails at run time (a
+// division by zero) is left for the engine to report. A basic block ends
+// at every block, loop, if, else and return. A call forgets the constants of globals, since the
+// callee may assign them. An if declaring variables is kept, they may be
+// used after it.
+class ConstantFolder {
+   public:
+    explicit ConstantFolder(Interpreter& interpreter);
+    void run();
+
+   private:
+    // a value of the expression being folded, the nodes after before up to
+    // and including last
+    struct Operand {
+        ASTListNode* before{nullptr};
+        ASTListNode* last{nullptr};
+        bool constant{false};
+        TokenType literal{TokenType::INTEGER};  // of a constant
+        int value{0};
+        // x + k or x - k with x not constant: the node in front of k, and
+        // the k added
+        ASTListNode* offsetBefore{nullptr};
+        int offset{0};
+    };
+
+    // what a variable holds while it is known
+    struct Constant {
+        TokenType literal;
+        int value;
+    };
+
+    void foldFunction(ASTListNode* declaration);
+    void foldStatement(ASTListNode* row);
+    void foldAssignment(ASTListNode* row);
+    void substituteArguments(ASTListNode* row);
+    bool removeBranch(ASTListNode* ifNode, ASTListNode* previous, bool taken);
+
+    ASTListNode* fold(ASTListNode* before, Operand& result);
+    ASTListNode* foldArguments(ASTListNode* open);
+    ASTListNode* applyBinary(std::vector<Operand>& operands, ASTListNode* op);
+    ASTListNode* applyNot(std::vector<Operand>& operands, ASTListNode* op);
+
+    bool isVariable(ASTListNode* node) const;
+    void forgetGlobals();
+
+   private:
+    Interpreter& interpreter;
+    ASTListNode* _function{nullptr};  // declaration being folded
+    std::unordered_map<SymbolTableListNode*, Constant> _known;
+    std::unordered_set<ASTListNode*> _removed;  // rows of removed branches
+};
+
+#endif  // CONSTANT_FOLDING_HPP
@@ -563,12 +563,16 @@ bool CSTree::isNumericalExpression() {
       return true;
     }
     case TokenType::MINUS: {
-      // --i
       addSiblingAndAdvance(first);
       TokenNode *minus = getNextToken();
       if (minus->type != TokenType::MINUS) {
-        throwMissingMinusOperatorError(minus);
+        // - numExp, negation
+        _nIt--;
+        delete minus;
+        return isNumericalExpression();
       }
+
+      // --i
       addSiblingAndAdvance(minus);
 
       TokenNode *identifier = getNextToken();
@@ -1,27 +1,269 @@
 #include "executor.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <set>
+#include <sstream>
 #include <stack>
 
+#include "arithmetic.hpp"
+#include "c_transpiler.hpp"
+#include "closure_compiler.hpp"
+#include "closures.hpp"
+#include "compiler.hpp"
+#include "ir_builder.hpp"
+#include "ir_inliner.hpp"
+#include "ir_lowering.hpp"
+#include "ir_passes.hpp"
+#include "native_codegen.hpp"
+#include "purity_analysis.hpp"
+#include "range_analysis.hpp"
+#include "strength_reduction.hpp"
+#include "superinstructions.hpp"
+#include "tail_calls.hpp"
+#include "token_error.hpp"
+#include "type_checker.hpp"
+#include "vm.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+
+// one line of --report-memoization
+static void reportMemoTable(const ASTListNode* declaration, const MemoTable& table) {
+    std::cerr << "memoized " << declaration->symbol->identifierName << ": " << table.hits() << " hits, "
+              << table.misses() << " misses, " << table.size() << " of " << MemoTable::capacity
+              << " entries used\n";
+}
+
+// Writes text to file, failing like the dumps in main.cpp when it cannot
+static void writeOutputFile(const std::string& file, const std::string& text) {
+    std::ofstream out(file);
+    if (!out.is_open()) {
+        throw std::runtime_error("Error: Could not open output file '" + file + "'\n");
+    }
+    out << text;
+    if (!out.flush()) {
+        throw std::runtime_error("Error: Could not write output file '" + file + "'\n");
+    }
+}
+
+// Runs the tool named by the environment variable, or fallback, with
+// arguments. The tool may hold arguments of its own, split at spaces. Where
+// it can, the tool is run without a shell, so paths need no quoting.
+static void runTool(const char* variable, const char* fallback, const std::vector<std::string>& arguments) {
+    const char* tool = std::getenv(variable);
+    std::istringstream words(tool && *tool ? tool : fallback);
+    std::vector<std::string> argv;
+    for (std::string word; words >> word;) {
+        argv.push_back(word);
+    }
+    argv.insert(argv.end(), arguments.begin(), arguments.end());
+
+    std::string command;
+    for (const std::string& argument : argv) {
+        command += (command.empty() ? "" : " ") + argument;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    std::vector<char*> pointers;
+    for (std::string& argument : argv) {
+        pointers.push_back(argument.data());
+    }
+    pointers.push_back(nullptr);
+    std::cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        execvp(pointers[0], pointers.data());
+        _exit(127);
+    }
+    int status = 0;
+    bool ok = child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+    std::string quoted;
+    for (const std::string& argument : argv) {
+        quoted += (quoted.empty() ? "\"" : " \"") + argument + "\"";
+    }
+    bool ok = std::system(quoted.c_str()) == 0;
+#endif
+    if (!ok) {
+        throw std::runtime_error("\"" + command + "\" failed.");
+    }
+}
+
+Executor::Executor(ASTree* ast, SymbolTable* symbolTable, Interpreter interpreter, Options options)
+        : ast(ast), symbolTable(symbolTable), currentNode(nullptr), interpreter(interpreter), options(options),
+          returning(false) {
 
-Executor::Executor(ASTree* ast, SymbolTable* symbolTable, Interpreter interpreter)
-        : ast(ast), symbolTable(symbolTable), currentNode(nullptr), interpreter(interpreter) {
+    globals.resize(interpreter.getGlobalCount());
+    findArrays();
 
-    // currentNode is now pointing at main, could also push this onto a stack if we use one
+    // currentNode is now pointing at main
     currentNode = interpreter.getMain();
 }
 
 void Executor::execute() {
-    while (currentNode) {
-        executeNode(currentNode);
+    // both engines leave out the bounds checks it proves unnecessary
+    RangeAnalysis ranges(interpreter);
+    ranges.run();
+    if (options.reportBoundsChecks) {
+        std::cerr << "bounds checks: " << ranges.eliminated() << " of " << ranges.accesses() << " eliminated\n";
+    }
+    if (options.memoize) {
+        PurityAnalysis(interpreter).run();
+    }
 
-        // all functions should move currentNode node to the last sibling
-        // so here we just take the child of currentNode
-        currentNode = currentNode->child;
+    if (!options.emitC.empty() || !options.buildC.empty()) {
+        if (options.tailCalls) {
+            TailCallAnalysis(interpreter).run();
+        }
+        std::string file = options.emitC.empty() ? options.buildC + ".c" : options.emitC;
+        writeOutputFile(file, CTranspiler(interpreter).transpile());
+        std::cout << "Output saved to '" << file << "'\n";
+        if (!options.buildC.empty()) {
+            runTool("CC", "cc", {"-O2", "-o", options.buildC, file});
+            std::cout << "Output saved to '" << options.buildC << "'\n";
+        }
+        return;
+    }
+
+    if (!options.emitAsm.empty() || !options.buildAsm.empty()) {
+        IrModule module = buildIr();
+        std::string file = options.emitAsm.empty() ? options.buildAsm + ".s" : options.emitAsm;
+        writeOutputFile(file, generateAssembly(module, options.tailCalls));
+        std::cout << "Output saved to '" << file << "'\n";
+        if (!options.buildAsm.empty()) {
+            std::string object = options.buildAsm + ".o";
+            runTool("AS", "as", {"-o", object, file});
+            runTool("LD", "ld", {"-o", options.buildAsm, object});
+            std::remove(object.c_str());
+            std::cout << "Output saved to '" << options.buildAsm << "'\n";
+        }
+        return;
+    }
+
+    if (options.engine == Engine::Bytecode) {
+        Program program;
+        if (options.ir) {
+            IrModule module = buildIr();
+            program = lowerIr(module);
+        } else {
+            Compiler compiler(ast, interpreter);
+            program = compiler.compile();
+        }
+        if (options.tailCalls) {
+            eliminateTailCalls(program);
+        }
+        if (options.superinstructions) {
+            fuseSuperinstructions(program);
+        }
+        if (options.strengthReduction) {
+            reduceStrength(program);
+        }
+        // the calls of pure functions left after inlining
+        const std::vector<ASTListNode*>& functions = interpreter.getFunctions();
+        if (options.memoize) {
+            for (Instruction& instruction : program.code) {
+                if (instruction.op == OpCode::CALL && functions[instruction.a]->pure) {
+                    instruction.op = OpCode::CALL_MEMOIZED;
+                }
+            }
+        }
+        VirtualMachine vm(program, output);
+        if (options.jit) {
+            vm.enableJit(options.jitThreshold, options.traceTiering);
+        }
+        vm.run(options.dispatch);
+        output.flush();
+        if (options.reportMemoization) {
+            for (size_t function = 0; function < functions.size(); function++) {
+                if (const MemoTable* table = vm.memoTable(function)) {
+                    reportMemoTable(functions[function], *table);
+                }
+            }
+        }
+        return;
+    }
+
+    if (options.engine == Engine::Closure) {
+        if (options.tailCalls) {
+            TailCallAnalysis(interpreter).run();
+        }
+        ClosureProgram program = ClosureCompiler(interpreter).compile();
+        ClosureMachine(program, output).run();
+        output.flush();
+        return;
+    }
+
+    if (!currentNode) {
+        return;
+    }
+
+    TypeChecker(interpreter).check();
+    if (options.tailCalls) {
+        TailCallAnalysis(interpreter).run();
+    }
+
+    char marker;
+    nativeStackLimit = reinterpret_cast<uintptr_t>(&marker) - nativeStackBudget();
+
+    // main is called like any other procedure, it just has no caller to return to
+    call(currentNode, operands.size());
+    output.flush();
+    if (options.reportMemoization) {
+        for (ASTListNode* function : interpreter.getFunctions()) {
+            auto table = memoTables.find(function);
+            if (table != memoTables.end()) {
+                reportMemoTable(function, table->second);
+            }
+        }
     }
 }
 
+// The IR of the program after the passes the options ask for
+IrModule Executor::buildIr() {
+    IrModule module = IrBuilder(ast, interpreter).build();
+    std::ofstream dump;
+    if (options.dumpIr) {
+        dump.open("ir_output.txt");
+    }
+    IrPassManager passes(options.dumpIr ? &dump : nullptr);
+    auto addCleanup = [&]() {
+        passes.add("sccp", propagateConstants);
+        passes.add("copy propagation", propagateCopies);
+        passes.add("cse", eliminateCommonSubexpressions);
+        passes.add("dce", eliminateDeadCode);
+    };
+    addCleanup();
+    // callees are measured once cleaned up, and what they become
+    // inside their callers is cleaned up again, together with what
+    // leaves the loops
+    if (options.inlineThreshold > 0) {
+        std::ostream* report = options.reportInlining ? &std::cerr : nullptr;
+        size_t threshold = options.inlineThreshold;
+        passes.addModulePass("inline", [threshold, report](IrModule& module) {
+            return inlineFunctions(module, threshold, report);
+        });
+    }
+    if (options.licm) {
+        passes.addModulePass("licm", hoistLoopInvariants);
+    }
+    if (options.unroll) {
+        passes.add("unroll", unrollCountedLoops);
+    }
+    if (options.inlineThreshold > 0 || options.licm || options.unroll) {
+        addCleanup();
+    }
+    passes.run(module);
+    if (options.dumpIr) {
+        std::cout << "Output saved to 'ir_output.txt'\n";
+    }
+    return module;
+}
+
 void Executor::executeNode(ASTListNode* node) {
     switch (node->type) {
         case ASTNodeType::DECLARATION:
@@ -48,7 +290,7 @@ void Executor::executeNode(ASTListNode* node) {
         case ASTNodeType::SIBLING:
             //std::cout << "Found sibling token." << std::endl;
 
-            if (symbolTable->find(node->token->lexeme) && symbolTable->find(node->token->lexeme)->identifierType == TokenType::FUNCTION) {
+            if (node->callee) {
                 executeFunction();
             }
             break;
@@ -65,12 +307,32 @@ void Executor::executeNode(ASTListNode* node) {
     }
 }
 
-void Executor::executeDeclaration(ASTListNode* node) {
+void Executor::executeDeclaration(ASTListNode*) {
     //std::string varName = node->token->lexeme;
     // Initialize with default value
     //setVariable(varName, 0);
 }
 
+// Global arrays are allocated right away, local ones by every call of the
+// function declaring them
+void Executor::findArrays() {
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        ASTListNode* node = interpreter.getAddressAtInd(i);
+        if (node->type == ASTNodeType::DECLARATION && node->symbol->scope == 0 && node->symbol->isArray) {
+            globals[node->symbol->slot] = &newArray(node->symbol);
+        }
+    }
+
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        std::vector<SymbolTableListNode*>& declared = localArrays[declaration->symbol];
+        for (ASTListNode* node = nextRow(declaration); node != declaration->end; node = nextRow(node)) {
+            if (node->type == ASTNodeType::DECLARATION && node->symbol->isArray) {
+                declared.push_back(node->symbol);
+            }
+        }
+    }
+}
+
 void Executor::executeAssignment() {
     // need to move to first node in expression
     currentNode = currentNode->sibling;
@@ -78,8 +340,30 @@ void Executor::executeAssignment() {
     // save current node to update its value
     ASTListNode* nodeToBeAssigned = currentNode;
     currentNode = currentNode->sibling;
+
+    // element store: target [ index ] value =
+    if (currentNode && currentNode->token->type == TokenType::L_BRACKET) {
+        currentNode = currentNode->sibling;
+        int index = toInt(evaluateExpression());
+        currentNode = currentNode->sibling;
+        int value = toInt(evaluateExpression());
+        arrayWithIndex(nodeToBeAssigned, index).set(index, value);
+        return;
+    }
+
     //check for assignment type?
-    nodeToBeAssigned->symbol->value = evaluateExpression();
+    // evaluated first, a call inside the expression may grow the slots
+    Value value = evaluateExpression();
+    if (nodeToBeAssigned->symbol && nodeToBeAssigned->symbol->isArray) {
+        // the elements are copied, the variable keeps its own storage
+        Array& target = arrayOf(slotOf(nodeToBeAssigned), nodeToBeAssigned);
+        std::string error = target.assign(arrayOf(value, nodeToBeAssigned));
+        if (!error.empty()) {
+            throwError(nodeToBeAssigned->token, error);
+        }
+        return;
+    }
+    slotOf(nodeToBeAssigned) = normalize(value);
 
     // assume for now that curentNode is at assignment operator after
     // evaluateNumExpPostfix, else we need to move currentNode to last sibling here
@@ -87,332 +371,433 @@ void Executor::executeAssignment() {
 }
 
 void Executor::executeIf() {
-    int bracketCount = 0;
+    ASTListNode* ifNode = currentNode;
 
     currentNode = currentNode->sibling;
-    bool condition = std::get<bool>(evaluateExpression());
+    bool condition = isTrue(evaluateExpression());
     if (condition) {
-        currentNode = currentNode->child->child;
+        currentNode = ifNode->body;
         executeBlock();
-
-        if (currentNode->child->type == ASTNodeType::ELSE) {
-            currentNode = currentNode->child->child;
-            //advance past else to first bracket
-            bracketCount++;
-            while (bracketCount > 0) {
-                if (currentNode->sibling) {
-                    currentNode = currentNode->sibling;
-                }
-                else {
-                    currentNode = currentNode->child;
-                    if (currentNode->type == ASTNodeType::BEGIN_BLOCK) {
-                        bracketCount++;
-                    }
-                    else if (currentNode->type == ASTNodeType::END_BLOCK) {
-                        bracketCount--;
-                    }
-                }
-            }
-        }
     }
-    else {
-        //if condition false, need to advance past the if block to the APPROPRIATE end_block
-        while (currentNode->type != ASTNodeType::END_BLOCK) {
-            if (currentNode->sibling) {
-                currentNode = currentNode->sibling;
-            }
-            else {
-                currentNode = currentNode->child;
-            }
-        }
-        //std::cout << "cond false" << std::endl;
-        if (currentNode->child->type == ASTNodeType::ELSE) {
-            //std::cout << "else exec" << std::endl;
-            currentNode = currentNode->child->child;
-            executeBlock();
-            //currentNode = currentNode->child;
-        }
+    else if (ifNode->elseBody) {
+        currentNode = ifNode->elseBody;
+        executeBlock();
+    }
+
+    if (!returning) {
+        // end of the else block when there is one
+        currentNode = ifNode->end;
     }
 }
 
 void Executor::executeWhile() {
-    int bracketCount = 0;
-    currentNode = currentNode->sibling;
-    ASTListNode* conditionNode = currentNode;
-    ASTListNode* whileEndNode = nullptr;
-    bool condition = std::get<bool>(evaluateExpression());
+    ASTListNode* whileNode = currentNode;
+    ASTListNode* conditionNode = currentNode->sibling;
+
+    currentNode = conditionNode;
+    bool condition = isTrue(evaluateExpression());
 
     while (condition) {
-        currentNode = currentNode->child->child;
+        currentNode = whileNode->body;
         executeBlock();
-        whileEndNode = currentNode;
+        if (returning) {
+            return;
+        }
         currentNode = conditionNode;
-        condition = std::get<bool>(evaluateExpression());
+        condition = isTrue(evaluateExpression());
     }
 
     //once it fails move to end
-    if (whileEndNode) {
-        currentNode = whileEndNode;
-    }
-    else {
-        //advance past first bracket
-        currentNode = currentNode->child;
-        bracketCount++;
-
-        while (bracketCount > 0) {
-            if (currentNode->sibling) {
-                currentNode = currentNode->sibling;
-            }
-            else {
-                currentNode = currentNode->child;
-                if (currentNode->type == ASTNodeType::BEGIN_BLOCK) {
-                    bracketCount++;
-                }
-                else if (currentNode->type == ASTNodeType::END_BLOCK) {
-                    bracketCount--;
-                }
-            }
-        }
-    }
-
+    currentNode = whileNode->end;
 }
 
 void Executor::executeFor() {
-    int bracketCount = 0;
-    ASTListNode* forEndNode = nullptr;
-
     // For node is split into FOR1, FOR2, FOR3
+    ASTListNode* forNode = currentNode;
+    ASTListNode* conditionNode = nextRow(forNode)->sibling;
+    ASTListNode* incrementNode = nextRow(nextRow(forNode));
+
     // FOR1: Initialization
-    executeAssignment();
-    currentNode = currentNode->child;
+    if (forNode->sibling) {
+        executeAssignment();
+    }
 
-    // FOR2 end condition
-    currentNode = currentNode->sibling;
-    ASTListNode* conditionNode = currentNode;
-    bool condition = std::get<bool>(evaluateExpression());
-    //eval ends on last node in expression
-    currentNode = currentNode->child;
-
-    //FOR3
-    //currentNode = currentNode->sibling;
-    ASTListNode* incrementNode = currentNode;
-    //proceed through to next ast row w/out incrementing
-    while (currentNode->sibling) {
-        currentNode = currentNode->sibling;
+    // a counted loop counts in an int, its body never assigns the variable
+    if (forNode->countedStep) {
+        for (int i = toInt(slotOf(forNode->sibling)); i <= forNode->countedHigh;) {
+            currentNode = forNode->body;
+            executeBlock();
+            if (returning) {
+                return;
+            }
+            i += forNode->countedStep;
+            slotOf(forNode->sibling) = i;
+        }
+        currentNode = forNode->end;
+        return;
     }
-    currentNode = currentNode->child;
 
-    //evaluate endCondition
+    // FOR2 end condition, an empty one is always true
+    currentNode = conditionNode;
+    bool condition = !conditionNode || isTrue(evaluateExpression());
+
     while (condition) {
+        currentNode = forNode->body;
         executeBlock();
-        forEndNode = currentNode;
-        currentNode = incrementNode;
-        executeAssignment();
+        if (returning) {
+            return;
+        }
+
+        // FOR3
+        if (incrementNode->sibling) {
+            currentNode = incrementNode;
+            executeAssignment();
+        }
         currentNode = conditionNode;
-        condition = std::get<bool>(evaluateExpression());
+        condition = !conditionNode || isTrue(evaluateExpression());
     }
 
     //once it fails move to end
-    if (forEndNode) {
-        currentNode = forEndNode;
-    }
-    else {
-        //advance past first bracket
-        currentNode = currentNode->child;
-        bracketCount++;
-
-        while (bracketCount > 0) {
-            if (currentNode->sibling) {
-                currentNode = currentNode->sibling;
-            }
-            else {
-                currentNode = currentNode->child;
-                if (currentNode->type == ASTNodeType::BEGIN_BLOCK) {
-                    bracketCount++;
-                }
-                else if (currentNode->type == ASTNodeType::END_BLOCK) {
-                    bracketCount--;
-                }
-            }
-        }
-    }
+    currentNode = forNode->end;
 }
 
 void Executor::executePrintf() {
-    currentNode = currentNode->sibling;
-    std::string formatString = currentNode->token->lexeme;
-    std::vector<Value> args;
-
-    //if there are arguments
-    if (currentNode->sibling) {
-        currentNode = currentNode->sibling;
+    const PreparedPrintf& prepared = preparePrintf(currentNode);
+
+    writeFormatted(
+        prepared.format, output,
+        [&](int i) {
+            ASTListNode* argument = prepared.arguments[i];
+            ASTListNode* next = argument->sibling;
+            if (next && next->token->type == TokenType::L_BRACKET) {
+                return loadElement(argument);
+            }
+            return toInt(loadOperand(argument));
+        },
+        [&](int i) {
+            ASTListNode* argument = prepared.arguments[i];
+            return arrayOf(loadOperand(argument), argument).chars();
+        });
+
+    currentNode = prepared.last;
+}
 
-        while (currentNode) {
-            args.emplace_back(symbolTable->find(currentNode->token->lexeme)->value);
+const Executor::PreparedPrintf& Executor::preparePrintf(ASTListNode* node) {
+    if (node->printfIndex >= 0) {
+        return printfs[node->printfIndex];
+    }
 
-            if (currentNode->sibling == nullptr) {
-                break;
-            }
-            else {
-                currentNode = currentNode->sibling;
+    ASTListNode* format = node->sibling;
+    PreparedPrintf prepared;
+    prepared.format = compileFormat(format->token->lexeme);
+    prepared.last = format;
+
+    // quotes around string arguments carry no value, an element, name
+    // [ index ], is one argument ending on the ]
+    for (ASTListNode* argument = format->sibling; argument; argument = argument->sibling) {
+        TokenType type = argument->token->type;
+        if (type != TokenType::SINGLE_QUOTE && type != TokenType::DOUBLE_QUOTE) {
+            prepared.arguments.push_back(argument);
+        }
+        ASTListNode* next = argument->sibling;
+        if (type == TokenType::IDENTIFIER && next && next->token->type == TokenType::L_BRACKET) {
+            ASTListNode* index = next->sibling;
+            if (!index || !index->sibling || index->sibling->token->type != TokenType::R_BRACKET) {
+                throwError(argument->token,
+                           "printf can only index \"" + argument->token->lexeme + "\" with a single value.");
             }
+            argument = index->sibling;
         }
+        prepared.last = argument;
     }
 
-    std::string strArg;
-    std::string escape = "\\x0";
-    size_t posOfStringEnd;
-    int arg_count = 0;
-
-    for (std::string::iterator it = formatString.begin(); it != formatString.end(); it++)
-    {
-        if (*it == '\\')
-        {
-            if (*++it == 'n') {
-                std::cout << std::endl;
-                continue;
-            }
-            else {
-                --it;
-            }
-        }
+    if ((int)prepared.arguments.size() < prepared.format.argumentCount) {
+        throwError(format->token, "printf format expects " + std::to_string(prepared.format.argumentCount) +
+                                      " argument(s), got " + std::to_string(prepared.arguments.size()) + ".");
+    }
 
-        if (*it != '%')
-        {
-            putchar(*it);
-            continue;
-        }
-        switch (*++it)
-        {
-            case 'd':
-                printf("%d", std::get<int>(args[arg_count]));
-                break;
-            case 's':
-                //printf("%s", std::get<std::string>(args[arg_count]).c_str());
-                strArg = std::get<std::string>(args[arg_count]);
-                posOfStringEnd = strArg.find(escape);
+    node->printfIndex = printfs.size();
+    printfs.push_back(std::move(prepared));
+    return printfs.back();
+}
 
-                if (posOfStringEnd != std::string::npos) {
-                    strArg = strArg.substr(0, posOfStringEnd);
-                }
-                printf("%s", strArg.c_str());
-                break;
-            default:
-                putchar(*it);
-                break;
-        }
+void Executor::executeReturn() {
+    Value value = 0;
 
-        arg_count++;
+    if (currentNode->sibling && currentNode->sibling->tailCall) {
+        size_t argBase = operands.size();
+        currentNode = currentNode->sibling->sibling;
+        evaluateArguments();
+        tailCall(argBase);
+        return;
     }
-}
-
-Executor::Value Executor::executeReturn() {
-    Value returnValue = 0;
 
     if (currentNode->sibling) {
         //should call numPostFixExpression
         currentNode = currentNode->sibling;
-        returnValue = evaluateExpression();
+        value = evaluateExpression();
     }
 
-    //moving currentNode back to caller node position
-    currentNode = programCounter.top();
-    programCounter.pop();
-
-    return returnValue;
+    // unwind the blocks of the current call, the caller's node is restored
+    // when its frame is popped
+    returnValue = normalize(value);
+    returning = true;
 }
 
 Executor::Value Executor::executeFunction() {
-    ASTListNode* returnNode;
-    ASTListNode* functionNode = interpreter.getAddressAtInd(symbolTable->find(currentNode->token->lexeme)->address);
-    SymbolTableListNode* curParamNode = functionNode->symbol->parameterList;
+    ASTListNode* callNode = currentNode;
+    if (!callNode->callee || callNode->symbol->identifierType != TokenType::FUNCTION) {
+        throwError(callNode->token, "function \"" + callNode->token->lexeme + "\" is not defined.");
+    }
+
+    size_t argBase = operands.size();
     currentNode = currentNode->sibling;
+    evaluateArguments();
 
+    // currentNode is left on the closing paren for the caller to resume from
+    return call(callNode->callee, argBase);
+}
 
-    // iterate through parameter nodes to assign corresponding values into symbol table
-    while(curParamNode) {
-        //curParamNode->value = symbolTable->find(currentNode->token->lexeme, currentNode->symbol->scope)->value;
-        curParamNode->value = evaluateExpression();
-        //problem in evalExpression is no stopping after correct # of args
-        curParamNode = curParamNode->next();
-        //currentNode = currentNode->sibling;
+void Executor::executeProcedure() {
+    ASTListNode* callNode = currentNode;
+    if (!callNode->callee) {
+        throwError(callNode->token, "procedure \"" + callNode->token->lexeme + "\" is not defined.");
+    }
 
-        if (curParamNode) {
-            currentNode = currentNode->sibling;
+    size_t argBase = operands.size();
+    currentNode = currentNode->sibling;
+    evaluateArguments();
+    if (callNode->tailCall) {
+        tailCall(argBase);
+        return;
+    }
+    call(callNode->callee, argBase);
+}
+
+// Unwinds the running call like a return, for call to start it over with
+// the arguments at operands[argBase...]
+void Executor::tailCall(size_t argBase) {
+    tailArgBase = argBase;
+    tailCalling = true;
+    returning = true;
+}
+
+// From the opening paren of an argument list, push each argument up to its
+// comma or the closing paren, where currentNode is left
+void Executor::evaluateArguments() {
+    while (currentNode->token->type != TokenType::R_PAREN) {
+        currentNode = currentNode->sibling;
+        if (currentNode->token->type == TokenType::R_PAREN) {
+            break;
         }
-        else {
-            // push returnNode onto stack to reset currentNode once function ends
-            returnNode = currentNode;
-            programCounter.push(returnNode);
+        Value arg = evaluateExpression();
+        operands.push_back(arg);
+    }
+}
+
+// Runs the body of callee with the arguments at operands[argBase...],
+// leaving currentNode where it was when the call was made
+Executor::Value Executor::call(ASTListNode* callee, size_t argBase) {
+    // a pure function called with --memoize answers from its table when it can
+    size_t keyBase = memoKeys.size();
+    MemoTable* table = options.memoize && callee->pure ? memoKey(callee, argBase) : nullptr;
+    if (table) {
+        if (const int* result = table->find(memoKeys.data() + keyBase)) {
+            memoKeys.resize(keyBase);
+            operands.resize(argBase);
+            return *result;
         }
+    }
+
+    pushFrame(callee->symbol, argBase);
 
+    currentNode = callee->body;
+    executeBlock();
+    while (tailCalling) {
+        tailCalling = false;
+        returning = false;
+        restartFrame(callee->symbol, tailArgBase);
+        currentNode = callee->body;
+        executeBlock();
     }
 
-    // currentNode is now pointing at the location of the function so that
-    // other execution functions will be processing inside the function body
-    currentNode = functionNode;
+    Value result = returnValue;
+    returning = false;
+    popFrame();
 
-    // loop through function and handle executions
-    while (currentNode->type != ASTNodeType::RETURN) {
-        executeNode(currentNode);
-        if (currentNode->sibling) {
-            currentNode = currentNode->sibling;
+    if (table) {
+        if (!std::holds_alternative<Array*>(result)) {
+            table->remember(memoKeys.data() + keyBase, toInt(result));
         }
-        else {
-            currentNode = currentNode->child;
+        memoKeys.resize(keyBase);
+    }
+    return result;
+}
+
+// Pushes the arguments at operands[argBase...] onto memoKeys, returning the
+// table of callee they are looked up in. nullptr, and nothing pushed, when
+// the call is left to pushFrame to report or an argument is an array.
+MemoTable* Executor::memoKey(ASTListNode* callee, size_t argBase) {
+    size_t argCount = operands.size() - argBase;
+    if (argCount != callee->symbol->parameterCount) {
+        return nullptr;
+    }
+    for (size_t i = argBase; i < operands.size(); i++) {
+        if (std::holds_alternative<Array*>(operands[i])) {
+            return nullptr;
         }
     }
+    for (size_t i = argBase; i < operands.size(); i++) {
+        memoKeys.push_back(toInt(operands[i]));
+    }
+    return &memoTables.try_emplace(callee, argCount).first->second;
+}
 
-    return executeReturn();
+void Executor::checkArgumentCount(SymbolTableListNode* function, size_t argCount) {
+    if (argCount != function->parameterCount) {
+        throwError(currentNode->token, "\"" + function->identifierName + "\" expects " +
+                   std::to_string(function->parameterCount) + " argument(s), got " + std::to_string(argCount) + ".");
+    }
 }
 
-void Executor::executeProcedure() {
-    ASTListNode* returnNode;
-    ASTListNode* functionNode = interpreter.getAddressAtInd(symbolTable->find(currentNode->token->lexeme)->address);
-    SymbolTableListNode* curParamNode = functionNode->symbol->parameterList;
-    currentNode = currentNode->sibling;
+void Executor::pushFrame(SymbolTableListNode* function, size_t argBase) {
+    checkArgumentCount(function, operands.size() - argBase);
+    // every call recurses on the C++ stack, like in the closure engine
+    char marker;
+    if (reinterpret_cast<uintptr_t>(&marker) < nativeStackLimit) {
+        throwError(currentNode->token, "stack overflow.");
+    }
 
-    // iterate through parameter nodes to assign corresponding values into symbol table
-    while(curParamNode) {
-        curParamNode->value = symbolTable->find(currentNode->token->lexeme, currentNode->symbol->scope)->value;
-        curParamNode = curParamNode->next();
+    Frame frame{currentNode, slots.size(), argBase, arrays.size()};
+    slots.resize(frame.base + function->frameSize);
 
-        if (curParamNode) {
-            currentNode = currentNode->sibling;
-        }
-        else {
-            // push returnNode onto stack to reset currentNode once function ends
-            returnNode = currentNode;
-            programCounter.push(returnNode);
+    // parameters occupy the first slots of the frame, in order
+    std::transform(operands.begin() + argBase, operands.end(), slots.begin() + frame.base, normalize);
+    operands.resize(argBase);
+
+    auto declared = localArrays.find(function);
+    if (declared != localArrays.end()) {
+        for (SymbolTableListNode* symbol : declared->second) {
+            slots[frame.base + symbol->slot] = &newArray(symbol);
         }
+    }
+
+    callStack.push_back(frame);
+    returnValue = 0;
+}
+
+// Starts the running call over for a tail call: the arguments at
+// operands[argBase...] replace its parameters and its locals are zeroed. The
+// TailCallAnalysis leaves out functions with local arrays.
+void Executor::restartFrame(SymbolTableListNode* function, size_t argBase) {
+    checkArgumentCount(function, operands.size() - argBase);
+
+    Frame& frame = callStack.back();
+    auto base = slots.begin() + frame.base;
+    std::transform(operands.begin() + argBase, operands.end(), base, normalize);
+    std::fill(base + function->parameterCount, base + function->frameSize, Value(0));
+    operands.resize(frame.operandBase);
+    returnValue = 0;
+}
 
+void Executor::popFrame() {
+    Frame& frame = callStack.back();
+    currentNode = frame.returnNode;
+    slots.resize(frame.base);
+    operands.resize(frame.operandBase);
+    arrays.resize(frame.arrayBase);
+    callStack.pop_back();
+}
+
+Executor::Value& Executor::slotOf(ASTListNode* node) {
+    SymbolTableListNode* symbol = node->symbol;
+    if (!symbol || symbol->slot < 0) {
+        throwError(node->token, "\"" + node->token->lexeme + "\" is not a declared variable.");
+    }
+    if (symbol->scope == 0) {
+        return globals[symbol->slot];
     }
+    return slots[callStack.back().base + symbol->slot];
+}
 
-    // currentNode is now pointing at the location of the function so that
-    // other execution functions will be processing inside the function body
-    currentNode = functionNode;
+Executor::Value Executor::loadOperand(ASTListNode* node) {
+    switch (node->token->type) {
+        case TokenType::STRING:
+            return &stringConstant(node->token->lexeme);
+        case TokenType::CHAR_LITERAL:
+            return node->token->lexeme[0];
+        case TokenType::INTEGER:
+            return std::stoi(node->token->lexeme);
+        case TokenType::TRUE:
+            return 1;
+        case TokenType::FALSE:
+            return 0;
+        default:
+            return slotOf(node);
+    }
+}
 
-    // loop through function and handle executions
-    while (currentNode->type != ASTNodeType::END_BLOCK) {
-        executeNode(currentNode);
-        if (currentNode->sibling) {
-            currentNode = currentNode->sibling;
-        }
-        else {
-            currentNode = currentNode->child;
-        }
+Array& Executor::newArray(SymbolTableListNode* symbol) {
+    return arrays.emplace_back(elementTypeOf(symbol->datatype), symbol->arraySize);
+}
+
+// char array holding a string literal, made the first time it is used
+Array& Executor::stringConstant(const std::string& text) {
+    auto found = strings.find(text);
+    if (found == strings.end()) {
+        found = strings.emplace(text, Array(text)).first;
+    }
+    return found->second;
+}
+
+Array& Executor::arrayOf(const Value& value, ASTListNode* node) {
+    if (value.index() != 3) {
+        throwError(node->token, "value is not an array.");
+    }
+    return *std::get<Array*>(value);
+}
+
+// Element name [ index ] of the array at node, leaving currentNode on the ]
+int Executor::loadElement(ASTListNode* node) {
+    currentNode = node->sibling->sibling;
+    int index = toInt(evaluateExpression());
+    return arrayWithIndex(node, index).get(index);
+}
+
+// The array of variable node, which has an element index unless the
+// RangeAnalysis proved it does
+Array& Executor::arrayWithIndex(ASTListNode* node, int index) {
+    Array& array = arrayOf(slotOf(node), node);
+    if (!node->inBounds && !array.contains(index)) {
+        throwError(node->token, outOfRange(index, array.size()));
     }
+    return array;
+}
 
-    currentNode = programCounter.top();
-    programCounter.pop();
+// lhs / rhs or lhs % rhs for the operator at node
+int Executor::divide(ASTListNode* node, int lhs, int rhs) {
+    if (rhs == 0) {
+        throwError(node->token, "division by zero.");
+    }
+    return node->token->type == TokenType::DIVIDE ? wrappingDivide(lhs, rhs) : wrappingModulo(lhs, rhs);
+}
+
+// base ^ exponent for the operator at node
+int Executor::power(ASTListNode* node, int base, int exponent) {
+    if (powerDividesByZero(base, exponent)) {
+        throwError(node->token, "division by zero.");
+    }
+    return integerPower(base, exponent);
 }
 
 void Executor::executeBlock() {
-    //callStack.emplace_back();  // New scope
     //move past begin block
 
     while (currentNode->type != ASTNodeType::END_BLOCK) {
         executeNode(currentNode);
+        if (returning) {
+            return;
+        }
         //std::cout << currentNode->lexeme << std::endl;
         if (currentNode->sibling) {
             currentNode = currentNode->sibling;
@@ -421,138 +806,211 @@ void Executor::executeBlock() {
             currentNode = currentNode->child;
         }
     }
-    //callStack.pop_back();  // End scope
 }
 
 Executor::Value Executor::evaluateExpression() {
-    std::set<TokenType> doNothingTokens = {TokenType::ASSIGNMENT_OPERATOR, TokenType::DOUBLE_QUOTE, TokenType::SINGLE_QUOTE};
-    std::stack<Value> stack;
+    if (currentNode && currentNode->scalarExpression) {
+        return evaluateScalarExpression();
+    }
+
+    // operands below base belong to expressions further up the call chain
+    size_t base = operands.size();
 
     while (currentNode) {
-        if (currentNode->token->type == TokenType::STRING) {
-            stack.push(currentNode->token->lexeme);
-        }
-        else if (currentNode->token->type == TokenType::CHAR_LITERAL) {
-            stack.push(currentNode->token->lexeme[0]);
-        }
-        else if (currentNode->token->type == TokenType::INTEGER) {
-            stack.push(std::stoi(currentNode->token->lexeme));
-        }
-        else if (currentNode->token->type == TokenType::TRUE) {
-            stack.push(1);
+        TokenType type = currentNode->token->type;
+
+        // end of an array index, a call argument or the argument list
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
         }
-        else if (currentNode->token->type == TokenType::FALSE) {
-            stack.push(0);
+
+        // the left operand of && or || decides it, its result replaces the
+        // left operand and evaluation continues after the operator
+        if (currentNode->shortCircuit && decidesShortCircuit(isTrue(operands.back()))) {
+            operands.back() = isTrue(operands.back()) ? 1 : 0;
+            currentNode = currentNode->shortCircuit;
         }
-        else if (currentNode->token->type == TokenType::IDENTIFIER) {
-            Value varValue;
+        else if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = currentNode->sibling;
 
-            // check if identifier is a function call
-            // if true, push the function's return value onto the stack as an int
-            if (symbolTable->find(currentNode->token->lexeme)->identifierType == TokenType::FUNCTION) {
-                varValue = executeFunction();
+            // function call, push its return value
+            if (next && next->token->type == TokenType::L_PAREN) {
+                Value result = executeFunction();
+                operands.push_back(result);
             }
-            else {
-                varValue = currentNode->symbol->value;
+            //array access case, stops at r_bracket
+            else if (next && next->token->type == TokenType::L_BRACKET) {
+                operands.push_back(loadElement(currentNode));
             }
-            //array access case
-            if (currentNode->sibling) {
-                if (currentNode->sibling->token->type == TokenType::L_BRACKET) {
-                    //std::cout << "found begin of array" << std::endl;
-                    ASTListNode* firstIdentifier = currentNode;
-                    //advance past l_bracket
-                    currentNode = currentNode->sibling->sibling;
-
-                    //eval expr inside brackets
-                    int idxValue = std::get<int>(evaluateExpression());
-                    // stop at r_bracket
-
-                    varValue = std::get<std::string>((firstIdentifier->symbol->value))[idxValue];
-                }
+            else {
+                operands.push_back(slotOf(currentNode));
             }
+        }
+        else if (type == TokenType::BOOLEAN_NOT) {
+            operands.back() = !isTrue(operands.back());
+        }
+        else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            auto [lhs_initial, rhs_initial] = getTwoThingsFromStack();
+            int lhs = toInt(lhs_initial);
+            int rhs = toInt(rhs_initial);
 
-            // push identifier's value onto the stack
-            stack.push(varValue);
+            switch (type) {
+                case TokenType::PLUS:
+                    operands.push_back(wrappingAdd(lhs, rhs));
+                    break;
+                case TokenType::MINUS:
+                    operands.push_back(wrappingSubtract(lhs, rhs));
+                    break;
+                case TokenType::ASTERISK:
+                    operands.push_back(wrappingMultiply(lhs, rhs));
+                    break;
+                case TokenType::DIVIDE:
+                case TokenType::MODULO:
+                    operands.push_back(divide(currentNode, lhs, rhs));
+                    break;
+                case TokenType::CARET:
+                    operands.push_back(power(currentNode, lhs, rhs));
+                    break;
+                case TokenType::GT:
+                    operands.push_back(lhs > rhs);
+                    break;
+                case TokenType::GT_EQUAL:
+                    operands.push_back(lhs >= rhs);
+                    break;
+                case TokenType::LT:
+                    operands.push_back(lhs < rhs);
+                    break;
+                case TokenType::LT_EQUAL:
+                    operands.push_back(lhs <= rhs);
+                    break;
+                case TokenType::BOOLEAN_AND:
+                    operands.push_back(lhs && rhs);
+                    break;
+                case TokenType::BOOLEAN_OR:
+                    operands.push_back(lhs || rhs);
+                    break;
+                case TokenType::BOOLEAN_EQUAL:
+                    operands.push_back(lhs == rhs);
+                    break;
+                case TokenType::BOOLEAN_NOT_EQUAL:
+                    operands.push_back(lhs != rhs);
+                    break;
+                default:
+                    break;// err
+            }
+        }
+        // quotes and the assignment operator carry no value
+        else if (type == TokenType::STRING || type == TokenType::CHAR_LITERAL || type == TokenType::INTEGER ||
+                 type == TokenType::TRUE || type == TokenType::FALSE) {
+            operands.push_back(loadOperand(currentNode));
         }
-        else if (doNothingTokens.count(currentNode->token->type)) {
 
+        if (currentNode->sibling == nullptr) {
+            break;
         }
-        else if (currentNode->token->type == TokenType::R_BRACKET) {
-            //std::cout << "found end of array" << std::endl;
+        else {
+            currentNode = currentNode->sibling;
+        }
+    }
+
+    Value result = operands.size() > base ? operands.back() : Value(0);
+    operands.resize(base);
+    return result;
+}
+
+
+// Same walk as evaluateExpression for an expression the TypeChecker proved to
+// only produce ints. Variables of such expressions hold ints, so operands are
+// read without converting them.
+int Executor::evaluateScalarExpression() {
+    size_t base = scalarOperands.size();
+
+    while (currentNode) {
+        TokenType type = currentNode->token->type;
+
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
             break;
         }
-        else if (isOperator(currentNode->token->type)) {
-            // is operator
-            auto [lhs_initial, rhs_initial] = getTwoThingsFromStack(stack);
-            int lhs, rhs;
 
-            if (lhs_initial.index() == 0) {
-                lhs = std::get<int>(lhs_initial);
-            }
-            if (lhs_initial.index() == 1) {
-                char lhs_char = std::get<char>(lhs_initial);
-                lhs = lhs_char;
-            }
-            if (lhs_initial.index() == 2) {
-                bool lhs_bool = std::get<bool>(lhs_initial);
-                lhs = lhs_bool;
-            }
-            if (rhs_initial.index() == 0) {
-                rhs = std::get<int>(rhs_initial);
+        if (currentNode->shortCircuit && decidesShortCircuit(scalarOperands.back() != 0)) {
+            scalarOperands.back() = scalarOperands.back() != 0;
+            currentNode = currentNode->shortCircuit;
+        }
+        else if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = currentNode->sibling;
+
+            if (next && next->token->type == TokenType::L_PAREN) {
+                scalarOperands.push_back(std::get<int>(executeFunction()));
             }
-            if (lhs_initial.index() == 1) {
-                char rhs_char = std::get<char>(rhs_initial);
-                rhs = rhs_char;
+            else if (next && next->token->type == TokenType::L_BRACKET) {
+                scalarOperands.push_back(loadElement(currentNode));
             }
-            if (rhs_initial.index() == 2) {
-                bool rhs_bool = std::get<bool>(rhs_initial);
-                rhs = rhs_bool;
+            else {
+                scalarOperands.push_back(std::get<int>(slotOf(currentNode)));
             }
+        }
+        else if (type == TokenType::BOOLEAN_NOT) {
+            scalarOperands.back() = !scalarOperands.back();
+        }
+        else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            int rhs = scalarOperands.back();
+            scalarOperands.pop_back();
+            int& lhs = scalarOperands.back();
 
-            switch (currentNode->token->type) {
+            switch (type) {
                 case TokenType::PLUS:
-                    stack.push(lhs + rhs);
+                    lhs = wrappingAdd(lhs, rhs);
                     break;
                 case TokenType::MINUS:
-                    stack.push(lhs - rhs);
+                    lhs = wrappingSubtract(lhs, rhs);
                     break;
                 case TokenType::ASTERISK:
-                    stack.push(lhs * rhs);
+                    lhs = wrappingMultiply(lhs, rhs);
                     break;
                 case TokenType::DIVIDE:
-                    stack.push(lhs / rhs);
-                    break;
                 case TokenType::MODULO:
-                    stack.push(lhs % rhs);
+                    lhs = divide(currentNode, lhs, rhs);
+                    break;
+                case TokenType::CARET:
+                    lhs = power(currentNode, lhs, rhs);
                     break;
                 case TokenType::GT:
-                    stack.push(lhs > rhs);
+                    lhs = lhs > rhs;
                     break;
                 case TokenType::GT_EQUAL:
-                    stack.push(lhs >= rhs);
+                    lhs = lhs >= rhs;
                     break;
                 case TokenType::LT:
-                    stack.push(lhs < rhs);
+                    lhs = lhs < rhs;
                     break;
                 case TokenType::LT_EQUAL:
-                    stack.push(lhs <= rhs);
+                    lhs = lhs <= rhs;
                     break;
                 case TokenType::BOOLEAN_AND:
-                    stack.push(lhs && rhs);
+                    lhs = lhs && rhs;
                     break;
                 case TokenType::BOOLEAN_OR:
-                    stack.push(lhs || rhs);
+                    lhs = lhs || rhs;
                     break;
                 case TokenType::BOOLEAN_EQUAL:
-                    stack.push(lhs == rhs);
+                    lhs = lhs == rhs;
                     break;
                 case TokenType::BOOLEAN_NOT_EQUAL:
-                    stack.push(lhs != rhs);
+                    lhs = lhs != rhs;
                     break;
                 default:
-                    break;// err
+                    break;
             }
         }
+        else if (type == TokenType::INTEGER) {
+            scalarOperands.push_back(std::stoi(currentNode->token->lexeme));
+        }
+        else if (type == TokenType::CHAR_LITERAL) {
+            scalarOperands.push_back(currentNode->token->lexeme[0]);
+        }
+        else if (type == TokenType::TRUE || type == TokenType::FALSE) {
+            scalarOperands.push_back(type == TokenType::TRUE);
+        }
 
         if (currentNode->sibling == nullptr) {
             break;
@@ -562,15 +1020,48 @@ Executor::Value Executor::evaluateExpression() {
         }
     }
 
-    Value result = stack.top();
+    int result = scalarOperands.size() > base ? scalarOperands.back() : 0;
+    scalarOperands.resize(base);
     return result;
 }
 
+// true when a left operand that is lhs decides the && or || whose right
+// operand starts at currentNode
+bool Executor::decidesShortCircuit(bool lhs) const {
+    bool isAnd = currentNode->shortCircuit->token->type == TokenType::BOOLEAN_AND;
+    return lhs != isAnd;
+}
 
-std::pair<Executor::Value, Executor::Value> Executor::getTwoThingsFromStack(std::stack<Value>& stack) {
-    Value rhs = stack.top();
-    stack.pop();
-    Value lhs = stack.top();
-    stack.pop();
+std::pair<Executor::Value, Executor::Value> Executor::getTwoThingsFromStack() {
+    Value rhs = operands.back();
+    operands.pop_back();
+    Value lhs = operands.back();
+    operands.pop_back();
     return {lhs, rhs};
-}
\ No newline at end of file
+}
+
+// int, char and bool values are all kept as int, the TypeChecker relies on
+// it to read variables of scalar expressions without checking their type
+Executor::Value Executor::normalize(const Value& value) {
+    if (value.index() == 3) {
+        return value;
+    }
+    return toInt(value);
+}
+
+bool Executor::isTrue(const Value& value) {
+    return toInt(value) != 0;
+}
+
+int Executor::toInt(const Value& value) {
+    switch (value.index()) {
+        case 0:
+            return std::get<int>(value);
+        case 1:
+            return std::get<char>(value);
+        case 2:
+            return std::get<bool>(value);
+        default:
+            return 0;
+    }
+}
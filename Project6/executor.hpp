@@ -1,30 +1,55 @@
 #ifndef EXECUTOR_HPP
 #define EXECUTOR_HPP
 
+#include <cstdint>
+#include <deque>
+#include <string>
 #include <unordered_map>
 #include <variant>
 #include <vector>
+#include "array.hpp"
 #include "interpreter.hpp"
+#include "ir.hpp"
 #include "ast.hpp"
+#include "memo_table.hpp"
+#include "options.hpp"
+#include "output_buffer.hpp"
+#include "printf_format.hpp"
 #include "symbol_table.hpp"
 #include "token_enum.hpp"
 
 class Executor {
 public:
-    Executor(ASTree* ast, SymbolTable* symbolTable, Interpreter interpreter);
+    Executor(ASTree* ast, SymbolTable* symbolTable, Interpreter interpreter, Options options = Options());
     void execute();
 
 private:
     // same variant type that exists in symbol table
     using Value = SymbolTableListNode::Value;
 
-    // Variant type to store different possible values
-    //using Value = std::variant<int, char, bool, std::string>;
+    // Activation record of a single function/procedure call. Its arguments
+    // and locals live contiguously in slots[base, base + frameSize).
+    struct Frame {
+        ASTListNode* returnNode;  // where the caller resumes
+        size_t base;              // first slot of this frame
+        size_t operandBase;       // caller's operand stack height at the call
+        size_t arrayBase;         // arrays below it belong to the callers
+    };
+
+    // A printf statement parsed the first time it runs
+    struct PreparedPrintf {
+        PrintfFormat format;
+        std::vector<ASTListNode*> arguments;
+        ASTListNode* last;  // last node of the row, where execution continues
+    };
+
+    IrModule buildIr();
 
     // Helper functions
     void executeNode(ASTListNode* node);
     Value evaluateExpression();
-    std::pair<Value, Value> getTwoThingsFromStack(std::stack<Value>& stack);
+    int evaluateScalarExpression();
+    std::pair<Value, Value> getTwoThingsFromStack();
 
     // Execution functions for different AST node types
     void executeDeclaration(ASTListNode* node);
@@ -33,25 +58,80 @@ private:
     void executeWhile();
     void executeFor();
     void executePrintf();
-    Value executeReturn();
+    const PreparedPrintf& preparePrintf(ASTListNode* node);
+    void executeReturn();
     Value executeFunction();
     void executeProcedure();
     void executeBlock();
 
+    // Call frames
+    void evaluateArguments();
+    Value call(ASTListNode* callee, size_t argBase);
+    MemoTable* memoKey(ASTListNode* callee, size_t argBase);
+    void pushFrame(SymbolTableListNode* function, size_t argBase);
+    void restartFrame(SymbolTableListNode* function, size_t argBase);
+    void checkArgumentCount(SymbolTableListNode* function, size_t argCount);
+    void tailCall(size_t argBase);
+    void popFrame();
+    Value& slotOf(ASTListNode* node);
+    Value loadOperand(ASTListNode* node);
+
+    // Arrays
+    void findArrays();
+    Array& newArray(SymbolTableListNode* symbol);
+    Array& stringConstant(const std::string& text);
+    Array& arrayOf(const Value& value, ASTListNode* node);
+    int loadElement(ASTListNode* node);
+    Array& arrayWithIndex(ASTListNode* node, int index);
+
     // Utility functions
+    int divide(ASTListNode* node, int lhs, int rhs);
+    int power(ASTListNode* node, int base, int exponent);
+    bool decidesShortCircuit(bool lhs) const;
+    static Value normalize(const Value& value);
     bool isTrue(const Value& value);
+    static int toInt(const Value& value);
 
 private:
     ASTree* ast;
     SymbolTable* symbolTable;
     ASTListNode* currentNode;
     Interpreter interpreter;
+    Options options;
+
+    // call stack, the top frame belongs to the running function
+    std::vector<Frame> callStack;
+    uintptr_t nativeStackLimit{0};  // calls fail once the C++ stack is below this
+    std::vector<Value> slots;
+    std::vector<Value> globals;
+
+    // every array a running call declared, in declaration order, and the
+    // string constants, which are char arrays too
+    std::deque<Array> arrays;
+    std::unordered_map<std::string, Array> strings;
+    // array variables declared in the body of each function
+    std::unordered_map<SymbolTableListNode*, std::vector<SymbolTableListNode*>> localArrays;
+
+    // results of the pure functions called with --memoize, and the
+    // arguments of the memoized calls still running, innermost last
+    std::unordered_map<ASTListNode*, MemoTable> memoTables;
+    std::vector<int> memoKeys;
+
+    // operands of the expressions being evaluated, shared by all frames
+    std::vector<Value> operands;
+    // operands of expressions the TypeChecker proved to be ints
+    std::vector<int> scalarOperands;
 
-    // either astnodes or just integers that are used to index the vector of addresses?  I'm not sure
-    std::stack<ASTListNode*> programCounter;
+    // everything the program prints, flushed when it ends or fails
+    OutputBuffer output;
+    std::vector<PreparedPrintf> printfs;
 
-    // not sure if this should be nodes or the actual values
-    std::stack<ASTListNode> expStack;
+    // set by a return statement until the enclosing call has unwound
+    bool returning;
+    Value returnValue;
+    // set with returning by a tail call, whose arguments start at tailArgBase
+    bool tailCalling{false};
+    size_t tailArgBase{0};
 };
 
-#endif // EXECUTOR_HPP
\ No newline at end of file
+#endif // EXECUTOR_HPP
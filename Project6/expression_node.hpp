@@ -0,0 +1,40 @@
+#ifndef EXPRESSION_NODE_HPP
+#define EXPRESSION_NODE_HPP
+
+#include <vector>
+
+#include "symbol_table_list_node.hpp"
+#include "token_node.hpp"
+
+enum class ExpressionType {
+    LITERAL,   // 5, TRUE, 'c', "text"
+    VARIABLE,  // name
+    INDEX,     // name [ index ]
+    CALL,      // name ( argument , ... )
+    UNARY,     // - operand, ! operand
+    BINARY,    // left operator right, = included
+};
+
+// One node of the expression tree the ExpressionParser builds for the
+// expression of an AST row. The row's postfix siblings are derived from it.
+class ExpressionNode {
+   public:
+    ExpressionNode(ExpressionType type, TokenNode* token) : type(type), token(token) {}
+
+    ExpressionType type;
+    // the literal, the name, or the operator
+    TokenNode* token;
+    // VARIABLE, INDEX and CALL, filled in by the ASTree from its scopes
+    SymbolTableListNode* symbol{nullptr};
+
+    // UNARY: the operand. BINARY: left, right. INDEX: the index. CALL: the
+    // arguments in order.
+    std::vector<ExpressionNode*> operands;
+
+    // source tokens around the operands, kept for the postfix form: the
+    // quotes of a char or string literal, [ ] of an index, ( , ... ) of a
+    // call
+    std::vector<TokenNode*> delimiters;
+};
+
+#endif  // EXPRESSION_NODE_HPP
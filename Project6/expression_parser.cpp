@@ -0,0 +1,171 @@
+#include "expression_parser.hpp"
+
+#include "token_error.hpp"
+
+namespace {
+
+// How tightly an operator binds its operands, higher binds tighter, 0 when
+// the token cannot be used that way
+struct Operator {
+    TokenType type;
+    int prefix;  // op x
+    int infix;   // x op y
+    bool rightAssociative;
+};
+
+const Operator operators[] = {
+    {TokenType::ASSIGNMENT_OPERATOR, 0, 1, true},
+    {TokenType::BOOLEAN_OR, 0, 2, false},
+    {TokenType::BOOLEAN_AND, 0, 3, false},
+    {TokenType::BOOLEAN_EQUAL, 0, 4, false},
+    {TokenType::BOOLEAN_NOT_EQUAL, 0, 4, false},
+    {TokenType::LT, 0, 5, false},
+    {TokenType::LT_EQUAL, 0, 5, false},
+    {TokenType::GT, 0, 5, false},
+    {TokenType::GT_EQUAL, 0, 5, false},
+    {TokenType::PLUS, 0, 6, false},
+    {TokenType::MINUS, 8, 6, false},
+    {TokenType::ASTERISK, 0, 7, false},
+    {TokenType::DIVIDE, 0, 7, false},
+    {TokenType::MODULO, 0, 7, false},
+    {TokenType::BOOLEAN_NOT, 8, 0, false},
+    {TokenType::CARET, 0, 9, true},
+};
+
+// the loosest binding, a whole expression
+const int lowest = 1;
+
+const Operator* findOperator(const TokenNode* token) {
+    if (!token) {
+        return nullptr;
+    }
+    for (const Operator& op : operators) {
+        if (op.type == token->type) {
+            return &op;
+        }
+    }
+    return nullptr;
+}
+
+// tokens an expression stops in front of
+bool endsExpression(TokenType type) {
+    return type == TokenType::SEMICOLON || type == TokenType::COMMA || type == TokenType::R_PAREN ||
+           type == TokenType::R_BRACKET;
+}
+
+}  // namespace
+
+ExpressionNode* ExpressionParser::parse() {
+    if (!_token || endsExpression(_token->type)) {
+        return nullptr;
+    }
+    return parseExpression(lowest);
+}
+
+// Parses operators binding at least as tightly as precedence
+ExpressionNode* ExpressionParser::parseExpression(int precedence) {
+    ExpressionNode* left = parsePrefix();
+
+    for (const Operator* op = findOperator(_token); op && op->infix >= precedence; op = findOperator(_token)) {
+        auto* node = new ExpressionNode(ExpressionType::BINARY, advance());
+        // the right operand of a left associative operator stops at the next
+        // one of the same precedence, which then takes this node as its left
+        ExpressionNode* right = parseExpression(op->rightAssociative ? op->infix : op->infix + 1);
+        node->operands = {left, right};
+        left = node;
+    }
+    return left;
+}
+
+ExpressionNode* ExpressionParser::parsePrefix() {
+    if (!_token) {
+        throwSyntaxError(_last, "missing operand after \"" + _last->lexeme + "\".");
+    }
+
+    const Operator* op = findOperator(_token);
+    if (op && op->prefix) {
+        auto* node = new ExpressionNode(ExpressionType::UNARY, advance());
+        node->operands = {parseExpression(op->prefix)};
+        return node;
+    }
+
+    switch (_token->type) {
+        case TokenType::INTEGER:
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+            return new ExpressionNode(ExpressionType::LITERAL, advance());
+        case TokenType::SINGLE_QUOTE:
+        case TokenType::DOUBLE_QUOTE:
+            return parseQuoted();
+        case TokenType::IDENTIFIER:
+        case TokenType::PRINTF:
+            return parseName();
+        case TokenType::L_PAREN: {
+            advance();
+            ExpressionNode* inner = parseExpression(lowest);
+            expect(TokenType::R_PAREN, "closing parenthesis");
+            return inner;
+        }
+        default:
+            throwSyntaxError(_token, "unexpected \"" + _token->lexeme + "\" in expression.");
+            return nullptr;
+    }
+}
+
+// name, name [ index ] or name ( argument , ... )
+ExpressionNode* ExpressionParser::parseName() {
+    TokenNode* name = advance();
+
+    if (_token && _token->type == TokenType::L_PAREN) {
+        auto* node = new ExpressionNode(ExpressionType::CALL, name);
+        node->delimiters.push_back(advance());
+        if (_token && _token->type == TokenType::R_PAREN) {
+            node->delimiters.push_back(advance());
+            return node;
+        }
+        while (true) {
+            node->operands.push_back(parseExpression(lowest));
+            if (_token && _token->type == TokenType::COMMA) {
+                node->delimiters.push_back(advance());
+                continue;
+            }
+            node->delimiters.push_back(expect(TokenType::R_PAREN, "closing parenthesis"));
+            return node;
+        }
+    }
+
+    if (_token && _token->type == TokenType::L_BRACKET) {
+        auto* node = new ExpressionNode(ExpressionType::INDEX, name);
+        node->delimiters.push_back(advance());
+        node->operands.push_back(parseExpression(lowest));
+        node->delimiters.push_back(expect(TokenType::R_BRACKET, "closing bracket"));
+        return node;
+    }
+
+    return new ExpressionNode(ExpressionType::VARIABLE, name);
+}
+
+// ' c ' or " text ", the tokenizer always gives all three tokens
+ExpressionNode* ExpressionParser::parseQuoted() {
+    TokenNode* open = advance();
+    if (!_token) {
+        throwSyntaxError(open, "unterminated literal.");
+    }
+    auto* node = new ExpressionNode(ExpressionType::LITERAL, advance());
+    node->delimiters.push_back(open);
+    node->delimiters.push_back(expect(open->type, "closing quote"));
+    return node;
+}
+
+TokenNode* ExpressionParser::advance() {
+    _last = _token;
+    _token = _token->sibling;
+    return _last;
+}
+
+TokenNode* ExpressionParser::expect(TokenType type, const std::string& what) {
+    if (!_token || _token->type != type) {
+        throwSyntaxError(_token ? _token : _last, "missing " + what + ".");
+    }
+    return advance();
+}
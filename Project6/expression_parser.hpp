@@ -0,0 +1,54 @@
+#ifndef EXPRESSION_PARSER_HPP
+#define EXPRESSION_PARSER_HPP
+
+#include <string>
+
+#include "expression_node.hpp"
+#include "token_enum.hpp"
+#include "token_node.hpp"
+
+// Pratt parser turning the tokens of an expression in a CST row into an
+// ExpressionNode tree. How tightly each operator binds is looked up in one
+// table, from loosest to tightest:
+//
+//   =                      right to left
+//   ||
+//   &&
+//   == !=
+//   < <= > >=
+//   + -
+//   * / %
+//   - !                    prefix, so -x ^ 2 is -(x ^ 2)
+//   ^                      right to left
+//
+// Every binary operator but = and ^ groups left to right. A name followed by
+// ( is a call and by [ an element, ( ) around an expression only group it.
+// The expression ends at the first token that cannot continue it: ; , ) ]
+// or the end of the row.
+class ExpressionParser {
+   public:
+    explicit ExpressionParser(TokenNode* first) : _token(first) {}
+
+    // the expression, nullptr when the row has none there (for (;;), return;)
+    ExpressionNode* parse();
+
+    // first token after the expression, nullptr when it ends the row
+    TokenNode* current() const { return _token; }
+    // last token of the expression, nullptr when there is none
+    TokenNode* last() const { return _last; }
+
+   private:
+    ExpressionNode* parseExpression(int precedence);
+    ExpressionNode* parsePrefix();
+    ExpressionNode* parseName();
+    ExpressionNode* parseQuoted();
+
+    TokenNode* advance();
+    TokenNode* expect(TokenType type, const std::string& what);
+
+   private:
+    TokenNode* _token;
+    TokenNode* _last{nullptr};
+};
+
+#endif  // EXPRESSION_PARSER_HPP
@@ -1,17 +1,65 @@
 #include "interpreter.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 Interpreter::Interpreter(ASTree* ast, SymbolTable* symTable) : ast(ast), symbolTable(symTable), main(nullptr), current(nullptr) {
     current = ast->head();
     size_t addressIdx = 0;  // not needed to store as member? can access with .size()
 
+    // function/procedure whose body is currently being addressed, its locals
+    // are given slots in that function's frame instead of in the globals
+    SymbolTableListNode* function = nullptr;
+    int blockDepth = 0;
+
+    // statements owning the blocks that are still open, so each END_BLOCK can
+    // be recorded as the jump target of its IF/WHILE/FOR1 (nullptr for a body)
+    std::vector<ASTListNode*> openBlocks;
+    ASTListNode* header = nullptr;     // statement waiting for its block
+    bool headerIsElse = false;         // the block is the else block of header
+    ASTListNode* lastClosed = nullptr; // owner of the last block closed
+
     // address assignment
     while (current) {
-        if (current->type != ASTNodeType::BEGIN_BLOCK && current->type != ASTNodeType::END_BLOCK) {
+        if (current->type == ASTNodeType::BEGIN_BLOCK) {
+            blockDepth++;
+            if (header) {
+                (headerIsElse ? header->elseBody : header->body) = current->child;
+            }
+            openBlocks.push_back(header);
+            header = nullptr;
+        } else if (current->type == ASTNodeType::END_BLOCK) {
+            if (--blockDepth == 0) {
+                function = nullptr;
+            }
+            lastClosed = openBlocks.back();
+            if (lastClosed) {
+                // an else block moves the end of its IF past itself
+                lastClosed->end = current;
+            }
+            openBlocks.pop_back();
+        } else {
+            if (current->type == ASTNodeType::IF || current->type == ASTNodeType::WHILE ||
+                current->type == ASTNodeType::FOR1) {
+                header = current;
+                headerIsElse = false;
+            } else if (current->type == ASTNodeType::ELSE) {
+                header = lastClosed && lastClosed->type == ASTNodeType::IF ? lastClosed : nullptr;
+                headerIsElse = true;
+            }
+
             // set symbolNode's address
             if (current->type == ASTNodeType::DECLARATION) {
                 current->symbol->address = addressIdx;
+                assignSlot(current->symbol, function);
+
+                // a function's body is the target of its calls
+                if (current->symbol == function) {
+                    _functions[function->identifierName] = current;
+                    _functionDeclarations.push_back(current);
+                    header = current;
+                    headerIsElse = false;
+                }
 
                 // set program start point
                 if (current->token->type == TokenType::MAIN) {
@@ -24,9 +72,45 @@ Interpreter::Interpreter(ASTree* ast, SymbolTable* symTable) : ast(ast), symbolT
         advanceAddress();
     }
 
+    linkCalls();
+
     //printAddresses();
 }
 
+// parameters come first in a frame so arguments can be copied in order
+void Interpreter::assignSlot(SymbolTableListNode* symbol, SymbolTableListNode*& function) {
+    if (symbol->identifierType == TokenType::FUNCTION || symbol->identifierType == TokenType::PROCEDURE) {
+        function = symbol;
+        for (SymbolTableListNode* param = symbol->parameterList; param; param = param->next()) {
+            param->slot = symbol->frameSize++;
+        }
+        symbol->parameterCount = symbol->frameSize;
+    } else if (function) {
+        symbol->slot = function->frameSize++;
+    } else {
+        symbol->slot = _globalCount++;
+    }
+}
+
+// Resolve every call site, CALL rows and function calls inside expressions,
+// to the declaration of the function it invokes
+void Interpreter::linkCalls() {
+    for (ASTListNode* row : _addresses) {
+        for (ASTListNode* node = row; node; node = node->sibling) {
+            bool isCallSite = node->token && node->token->type == TokenType::IDENTIFIER && node->sibling &&
+                              node->sibling->token && node->sibling->token->type == TokenType::L_PAREN;
+            if (!isCallSite) {
+                continue;
+            }
+            auto function = _functions.find(node->token->lexeme);
+            if (function != _functions.end()) {
+                node->callee = function->second;
+                node->symbol = function->second->symbol;
+            }
+        }
+    }
+}
+
 void Interpreter::printAddresses() {
     for (size_t i = 0; i < _addresses.size(); i++) {
         std::cout << i << " " << _addresses[i]->lexeme;
@@ -66,3 +150,22 @@ ASTListNode* Interpreter::getAddressAtInd(int index) {
 ASTListNode* Interpreter::getMain() {
     return main;
 }
+
+size_t Interpreter::getGlobalCount() {
+    return _globalCount;
+}
+
+size_t Interpreter::getAddressCount() {
+    return _addresses.size();
+}
+
+std::vector<ASTListNode*>& Interpreter::getFunctions() {
+    return _functionDeclarations;
+}
+
+// rows an optimization unlinked from the AST
+void Interpreter::removeAddresses(const std::unordered_set<ASTListNode*>& rows) {
+    _addresses.erase(std::remove_if(_addresses.begin(), _addresses.end(),
+                                    [&](ASTListNode* row) { return rows.count(row) > 0; }),
+                     _addresses.end());
+}
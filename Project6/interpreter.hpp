@@ -2,6 +2,10 @@
 #ifndef INTERPRETER_HPP
 #define INTERPRETER_HPP
 
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "ast.hpp"
 #include "ast_list_node.hpp"
 #include "symbol_table.hpp"
@@ -11,6 +15,10 @@ class Interpreter {
     Interpreter(ASTree* ast, SymbolTable* symTable);
     ASTListNode* getAddressAtInd(int index);
     ASTListNode* getMain();
+    size_t getGlobalCount();
+    size_t getAddressCount();
+    std::vector<ASTListNode*>& getFunctions();
+    void removeAddresses(const std::unordered_set<ASTListNode*>& rows);
 
    private:
     ASTree* ast;
@@ -19,10 +27,15 @@ class Interpreter {
     ASTListNode* current;  // pc?
     ASTListNode* main;
     std::vector<ASTListNode*> _addresses;
+    std::unordered_map<std::string, ASTListNode*> _functions;
+    std::vector<ASTListNode*> _functionDeclarations;  // in source order
+    size_t _globalCount{0};
 
    private:
     void advanceAST();
     void advanceAddress();
+    void assignSlot(SymbolTableListNode* symbol, SymbolTableListNode*& function);
+    void linkCalls();
 
     // testing
    private:
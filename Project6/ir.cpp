@@ -0,0 +1,656 @@
+#include "ir.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_set>
+
+const char* irOpName(IrOp op) {
+    switch (op) {
+#define CS460_IR_NAME(name) \
+    case IrOp::name:        \
+        return #name;
+        CS460_IR_OPS(CS460_IR_NAME)
+#undef CS460_IR_NAME
+    }
+    return "UNKNOWN";
+}
+
+bool IrInstruction::isTerminator() const {
+    return op == IrOp::JUMP || op == IrOp::BRANCH || op == IrOp::RETURN;
+}
+
+bool IrInstruction::hasValue() const {
+    switch (op) {
+        case IrOp::STORE_GLOBAL:
+        case IrOp::COPY_ARRAY:
+        case IrOp::STORE_ELEMENT:
+        case IrOp::PRINTF:
+        case IrOp::JUMP:
+        case IrOp::BRANCH:
+        case IrOp::RETURN:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool IrInstruction::mayFail() const {
+    switch (op) {
+        case IrOp::DIV:
+        case IrOp::MOD: {
+            const IrInstruction* divisor = operands[1];
+            return divisor->op != IrOp::CONST || divisor->a == 0 || divisor->a == -1;
+        }
+        case IrOp::POW: {
+            const IrInstruction* base = operands[0];
+            const IrInstruction* exponent = operands[1];
+            return !(exponent->op == IrOp::CONST && exponent->a >= 0) && !(base->op == IrOp::CONST && base->a != 0);
+        }
+        case IrOp::LOAD_ELEMENT:
+            return !b;
+        default:
+            return false;
+    }
+}
+
+IrInstruction* IrBlock::terminator() const {
+    if (instructions.empty() || !instructions.back()->isTerminator()) {
+        return nullptr;
+    }
+    return instructions.back();
+}
+
+size_t IrBlock::firstNonPhi() const {
+    size_t i = 0;
+    while (i < instructions.size() && instructions[i]->op == IrOp::PHI) {
+        i++;
+    }
+    return i;
+}
+
+IrBlock* IrFunction::newBlock() {
+    _blocks.push_back(std::make_unique<IrBlock>());
+    IrBlock* block = _blocks.back().get();
+    block->id = _nextBlock++;
+    blocks.push_back(block);
+    return block;
+}
+
+IrInstruction* IrFunction::create(IrOp op, std::vector<IrInstruction*> operands, int a, int b, int line) {
+    _instructions.push_back(std::make_unique<IrInstruction>());
+    IrInstruction* instruction = _instructions.back().get();
+    instruction->op = op;
+    instruction->id = _nextValue++;
+    instruction->a = a;
+    instruction->b = b;
+    instruction->line = line;
+    instruction->operands = std::move(operands);
+    return instruction;
+}
+
+IrInstruction* IrFunction::append(IrBlock* block, IrInstruction* instruction) {
+    instruction->block = block;
+    block->instructions.push_back(instruction);
+    return instruction;
+}
+
+IrInstruction* IrFunction::insert(IrBlock* block, size_t position, IrInstruction* instruction) {
+    instruction->block = block;
+    block->instructions.insert(block->instructions.begin() + position, instruction);
+    return instruction;
+}
+
+void IrFunction::link(IrBlock* from, IrBlock* to) {
+    from->successors.push_back(to);
+    to->predecessors.push_back(from);
+}
+
+void IrFunction::erase(IrInstruction* instruction) {
+    std::vector<IrInstruction*>& instructions = instruction->block->instructions;
+    instructions.erase(std::find(instructions.begin(), instructions.end(), instruction));
+    instruction->block = nullptr;
+}
+
+namespace {
+
+const char* elementTypeName(ElementType type) {
+    switch (type) {
+        case ElementType::Char:
+            return "char";
+        case ElementType::Bool:
+            return "bool";
+        default:
+            return "int";
+    }
+}
+
+std::string blockName(const IrBlock* block) {
+    return "b" + std::to_string(block->id);
+}
+
+std::string valueName(const IrInstruction* value) {
+    return "%" + std::to_string(value->id);
+}
+
+// operands every op takes, -1 when it takes any number
+int operandCount(IrOp op) {
+    switch (op) {
+        case IrOp::CONST:
+        case IrOp::STRING:
+        case IrOp::PARAM:
+        case IrOp::ARRAY:
+        case IrOp::LOAD_GLOBAL:
+        case IrOp::JUMP:
+            return 0;
+        case IrOp::STORE_GLOBAL:
+        case IrOp::COPY_ARRAY:
+        case IrOp::NOT:
+        case IrOp::COPY:
+        case IrOp::BRANCH:
+        case IrOp::RETURN:
+            return 1;
+        case IrOp::STORE_ELEMENT:
+            return 3;
+        case IrOp::CALL:
+        case IrOp::PRINTF:
+        case IrOp::PHI:
+            return -1;
+        default:
+            return 2;
+    }
+}
+
+size_t successorCount(IrOp op) {
+    switch (op) {
+        case IrOp::JUMP:
+            return 1;
+        case IrOp::BRANCH:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+}  // namespace
+
+void printIr(const IrFunction& function, std::ostream& out) {
+    out << "function " << function.name << " (" << function.parameterCount << " parameter(s), " << function.frameSize
+        << " slot(s))\n";
+    for (const IrFunction::LocalArray& array : function.arrays) {
+        out << "    array slot " << array.slot << ": " << array.size << " " << elementTypeName(array.type) << "\n";
+    }
+
+    for (const IrBlock* block : function.blocks) {
+        out << blockName(block) << ":";
+        if (!block->predecessors.empty()) {
+            out << "  ; preds";
+            for (const IrBlock* predecessor : block->predecessors) {
+                out << " " << blockName(predecessor);
+            }
+        }
+        out << "\n";
+
+        for (const IrInstruction* instruction : block->instructions) {
+            out << "    ";
+            if (instruction->hasValue()) {
+                out << valueName(instruction) << " = ";
+            }
+            out << irOpName(instruction->op);
+
+            // the ints an op carries, then the values it reads
+            std::vector<std::string> parts;
+            switch (instruction->op) {
+                case IrOp::CONST:
+                case IrOp::STRING:
+                case IrOp::PARAM:
+                case IrOp::ARRAY:
+                case IrOp::LOAD_GLOBAL:
+                case IrOp::STORE_GLOBAL:
+                case IrOp::CALL:
+                case IrOp::PRINTF:
+                    parts.push_back(std::to_string(instruction->a));
+                    break;
+                case IrOp::COPY_ARRAY:
+                    parts.push_back(std::string(instruction->b ? "global " : "") + std::to_string(instruction->a));
+                    break;
+                default:
+                    break;
+            }
+            for (size_t i = 0; i < instruction->operands.size(); i++) {
+                std::string operand = valueName(instruction->operands[i]);
+                if (instruction->op == IrOp::PHI && i < block->predecessors.size()) {
+                    operand = "[" + operand + ", " + blockName(block->predecessors[i]) + "]";
+                }
+                parts.push_back(operand);
+            }
+            for (const IrBlock* successor : block->successors) {
+                if (instruction->isTerminator()) {
+                    parts.push_back(blockName(successor));
+                }
+            }
+            for (size_t i = 0; i < parts.size(); i++) {
+                out << (i ? ", " : " ") << parts[i];
+            }
+
+            if ((instruction->op == IrOp::LOAD_ELEMENT || instruction->op == IrOp::STORE_ELEMENT) && instruction->b) {
+                out << "  ; in bounds";
+            } else if (instruction->variable >= 0) {
+                out << "  ; slot " << instruction->variable;
+            }
+            out << "\n";
+        }
+    }
+}
+
+void printIr(const IrModule& module, std::ostream& out) {
+    for (const IrModule::GlobalArray& array : module.globalArrays) {
+        out << "global array " << array.slot << ": " << array.size << " " << elementTypeName(array.type) << "\n";
+    }
+    for (size_t i = 0; i < module.strings.size(); i++) {
+        out << "string " << i << ": \"" << module.strings[i] << "\"\n";
+    }
+    for (size_t i = 0; i < module.formatText.size(); i++) {
+        out << "format " << i << ": \"" << module.formatText[i] << "\"\n";
+    }
+    for (const auto& function : module.functions) {
+        if (!function->blocks.empty()) {
+            out << "\n";
+            printIr(*function, out);
+        }
+    }
+}
+
+void verifyIr(const IrFunction& function) {
+    auto fail = [&](const IrBlock* block, const std::string& message) {
+        throw std::logic_error("IR of " + function.name + ", " + blockName(block) + ": " + message);
+    };
+
+    if (function.blocks.empty()) {
+        return;
+    }
+    if (!function.entry()->predecessors.empty()) {
+        fail(function.entry(), "the entry block has predecessors.");
+    }
+
+    std::unordered_set<const IrBlock*> blocks(function.blocks.begin(), function.blocks.end());
+    for (const IrBlock* block : function.blocks) {
+        const IrInstruction* terminator = block->terminator();
+        if (!terminator) {
+            fail(block, "does not end in a terminator.");
+        }
+        if (block->successors.size() != successorCount(terminator->op)) {
+            fail(block, std::string(irOpName(terminator->op)) + " with " + std::to_string(block->successors.size()) +
+                            " successor(s).");
+        }
+
+        for (const IrBlock* successor : block->successors) {
+            if (!blocks.count(successor)) {
+                fail(block, "branches to " + blockName(successor) + ", which is not in the function.");
+            }
+            if (std::count(block->successors.begin(), block->successors.end(), successor) !=
+                std::count(successor->predecessors.begin(), successor->predecessors.end(), block)) {
+                fail(block, "edge to " + blockName(successor) + " is missing from its predecessors.");
+            }
+        }
+        for (const IrBlock* predecessor : block->predecessors) {
+            if (!blocks.count(predecessor)) {
+                fail(block, "has predecessor " + blockName(predecessor) + ", which is not in the function.");
+            }
+            if (std::find(predecessor->successors.begin(), predecessor->successors.end(), block) ==
+                predecessor->successors.end()) {
+                fail(block, "edge from " + blockName(predecessor) + " is missing from its successors.");
+            }
+        }
+
+        bool phis = true;
+        for (size_t i = 0; i < block->instructions.size(); i++) {
+            const IrInstruction* instruction = block->instructions[i];
+            std::string where = valueName(instruction) + " " + irOpName(instruction->op);
+            if (instruction->block != block) {
+                fail(block, where + " belongs to another block.");
+            }
+            if (instruction->isTerminator() && i + 1 != block->instructions.size()) {
+                fail(block, where + " is not at the end of the block.");
+            }
+            if (instruction->op == IrOp::PHI) {
+                if (!phis) {
+                    fail(block, where + " follows other instructions.");
+                }
+                if (instruction->operands.size() != block->predecessors.size()) {
+                    fail(block, where + " has " + std::to_string(instruction->operands.size()) + " operand(s) for " +
+                                    std::to_string(block->predecessors.size()) + " predecessor(s).");
+                }
+            } else {
+                phis = false;
+                int count = operandCount(instruction->op);
+                if (count >= 0 && (size_t)count != instruction->operands.size()) {
+                    fail(block, where + " has " + std::to_string(instruction->operands.size()) + " operand(s).");
+                }
+            }
+            if (instruction->op == IrOp::PARAM &&
+                (block != function.entry() || (i > 0 && block->instructions[i - 1]->op != IrOp::PARAM))) {
+                fail(block, where + " is not among the parameters leading the entry block.");
+            }
+        }
+    }
+
+    // every value is defined before it is used, on every path
+    IrDominators dominators(function);
+    for (const IrBlock* block : function.blocks) {
+        if (!dominators.reachable(block)) {
+            fail(block, "cannot be reached from the entry block.");
+        }
+    }
+    for (const IrBlock* block : function.blocks) {
+        for (size_t i = 0; i < block->instructions.size(); i++) {
+            const IrInstruction* instruction = block->instructions[i];
+            for (size_t j = 0; j < instruction->operands.size(); j++) {
+                const IrInstruction* operand = instruction->operands[j];
+                std::string where = valueName(instruction) + " " + irOpName(instruction->op) + " uses " +
+                                    valueName(operand);
+                if (!operand->block || !blocks.count(operand->block)) {
+                    fail(block, where + ", which is in no block of the function.");
+                }
+                if (!operand->hasValue()) {
+                    fail(block, where + ", which has no value.");
+                }
+
+                // a phi uses its operand at the end of the predecessor
+                const IrBlock* at = instruction->op == IrOp::PHI ? block->predecessors[j] : block;
+                if (!dominators.dominates(operand->block, at)) {
+                    fail(block, where + ", whose block does not dominate the use.");
+                }
+                if (operand->block == block && instruction->op != IrOp::PHI) {
+                    const auto& instructions = block->instructions;
+                    if (std::find(instructions.begin(), instructions.begin() + i, operand) ==
+                        instructions.begin() + i) {
+                        fail(block, where + " before it is defined.");
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<IrBlock*> reversePostorder(const IrFunction& function) {
+    std::vector<IrBlock*> order;
+    if (function.blocks.empty()) {
+        return order;
+    }
+
+    // iterative depth-first search, a block is done once its last successor is
+    std::unordered_set<IrBlock*> visited;
+    std::vector<std::pair<IrBlock*, size_t>> stack;
+    stack.push_back({function.entry(), 0});
+    visited.insert(function.entry());
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < block->successors.size()) {
+            IrBlock* successor = block->successors[next++];
+            if (visited.insert(successor).second) {
+                stack.push_back({successor, 0});
+            }
+        } else {
+            order.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Cooper, Harvey and Kennedy's iterative algorithm over the reverse postorder
+IrDominators::IrDominators(const IrFunction& function) : _order(reversePostorder(function)) {
+    for (size_t i = 0; i < _order.size(); i++) {
+        _index[_order[i]] = i;
+    }
+
+    const size_t undefined = _order.size();
+    _idom.assign(_order.size(), undefined);
+    if (_order.empty()) {
+        return;
+    }
+    _idom[0] = 0;
+
+    auto intersect = [&](size_t a, size_t b) {
+        while (a != b) {
+            while (a > b) {
+                a = _idom[a];
+            }
+            while (b > a) {
+                b = _idom[b];
+            }
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < _order.size(); i++) {
+            size_t idom = undefined;
+            for (IrBlock* predecessor : _order[i]->predecessors) {
+                auto found = _index.find(predecessor);
+                if (found == _index.end() || _idom[found->second] == undefined) {
+                    continue;
+                }
+                idom = idom == undefined ? found->second : intersect(found->second, idom);
+            }
+            if (idom != _idom[i]) {
+                _idom[i] = idom;
+                changed = true;
+            }
+        }
+    }
+
+    _children.resize(_order.size());
+    for (size_t i = 1; i < _order.size(); i++) {
+        _children[_idom[i]].push_back(_order[i]);
+    }
+}
+
+bool IrDominators::reachable(const IrBlock* block) const {
+    return _index.count(block);
+}
+
+bool IrDominators::dominates(const IrBlock* dominator, const IrBlock* block) const {
+    auto found = _index.find(dominator);
+    auto at = _index.find(block);
+    if (found == _index.end() || at == _index.end()) {
+        return false;
+    }
+    // a dominator always comes first in the reverse postorder
+    size_t i = at->second;
+    while (i > found->second) {
+        i = _idom[i];
+    }
+    return i == found->second;
+}
+
+IrBlock* IrDominators::immediate(const IrBlock* block) const {
+    size_t i = _index.at(block);
+    return i == 0 ? nullptr : _order[_idom[i]];
+}
+
+const std::vector<IrBlock*>& IrDominators::children(const IrBlock* block) const {
+    return _children[_index.at(block)];
+}
+
+std::vector<IrBlock*> copyBlocks(IrFunction& function, const std::vector<IrBlock*>& blocks,
+                                 std::unordered_map<const IrInstruction*, IrInstruction*>& values) {
+    std::unordered_map<const IrBlock*, IrBlock*> copies;
+    std::vector<IrBlock*> result;
+    for (IrBlock* block : blocks) {
+        copies[block] = function.newBlock();
+        result.push_back(copies[block]);
+    }
+    auto copyOf = [&](IrBlock* block) {
+        auto found = copies.find(block);
+        return found == copies.end() ? block : found->second;
+    };
+
+    for (IrBlock* block : blocks) {
+        IrBlock* copy = copies[block];
+        for (IrInstruction* instruction : block->instructions) {
+            if (values.count(instruction)) {
+                continue;
+            }
+            IrInstruction* clone = function.create(instruction->op, instruction->operands, instruction->a,
+                                                   instruction->b, instruction->line);
+            clone->variable = instruction->variable;
+            function.append(copy, clone);
+            values[instruction] = clone;
+        }
+        for (IrBlock* successor : block->successors) {
+            copy->successors.push_back(copyOf(successor));
+        }
+        for (IrBlock* predecessor : block->predecessors) {
+            copy->predecessors.push_back(copyOf(predecessor));
+        }
+    }
+
+    // operands last, a phi can read a value of a block copied after its own
+    for (IrBlock* copy : result) {
+        for (IrInstruction* instruction : copy->instructions) {
+            for (IrInstruction*& operand : instruction->operands) {
+                auto found = values.find(operand);
+                if (found != values.end()) {
+                    operand = found->second;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void replaceValues(IrFunction& function, const std::unordered_map<IrInstruction*, IrInstruction*>& replacements) {
+    if (replacements.empty()) {
+        return;
+    }
+    auto resolve = [&](IrInstruction* value) {
+        for (auto found = replacements.find(value); found != replacements.end(); found = replacements.find(value)) {
+            value = found->second;
+        }
+        return value;
+    };
+    for (IrBlock* block : function.blocks) {
+        for (IrInstruction* instruction : block->instructions) {
+            for (IrInstruction*& operand : instruction->operands) {
+                operand = resolve(operand);
+            }
+        }
+    }
+}
+
+IrBlock* IrLoop::preheader() const {
+    IrBlock* entry = nullptr;
+    for (IrBlock* predecessor : header->predecessors) {
+        if (contains.count(predecessor)) {
+            continue;
+        }
+        if ((entry && entry != predecessor) || predecessor->successors.size() != 1) {
+            return nullptr;
+        }
+        entry = predecessor;
+    }
+    return entry;
+}
+
+std::vector<IrLoop> findLoops(const IrDominators& dominators) {
+    std::vector<IrLoop> loops;
+    const std::vector<IrBlock*>& order = dominators.order();
+    for (IrBlock* header : order) {
+        IrLoop loop{header, {}, {header}};
+        std::vector<IrBlock*> worklist;
+        for (IrBlock* predecessor : header->predecessors) {
+            if (dominators.reachable(predecessor) && dominators.dominates(header, predecessor)) {
+                worklist.push_back(predecessor);
+            }
+        }
+        if (worklist.empty()) {
+            continue;
+        }
+        while (!worklist.empty()) {
+            IrBlock* block = worklist.back();
+            worklist.pop_back();
+            if (loop.contains.insert(block).second) {
+                for (IrBlock* predecessor : block->predecessors) {
+                    if (dominators.reachable(predecessor)) {
+                        worklist.push_back(predecessor);
+                    }
+                }
+            }
+        }
+        for (IrBlock* block : order) {
+            if (loop.contains.count(block)) {
+                loop.blocks.push_back(block);
+            }
+        }
+        loops.push_back(std::move(loop));
+    }
+    // a loop inside another has fewer blocks
+    std::stable_sort(loops.begin(), loops.end(),
+                     [](const IrLoop& a, const IrLoop& b) { return a.blocks.size() < b.blocks.size(); });
+    return loops;
+}
+
+void unlink(IrBlock* from, IrBlock* to) {
+    auto predecessor = std::find(to->predecessors.begin(), to->predecessors.end(), from);
+    size_t index = predecessor - to->predecessors.begin();
+    to->predecessors.erase(predecessor);
+    for (size_t i = 0; i < to->firstNonPhi(); i++) {
+        std::vector<IrInstruction*>& operands = to->instructions[i]->operands;
+        operands.erase(operands.begin() + index);
+    }
+    from->successors.erase(std::find(from->successors.begin(), from->successors.end(), to));
+}
+
+bool removeUnreachableBlocks(IrFunction& function) {
+    std::vector<IrBlock*> reachable = reversePostorder(function);
+    if (reachable.size() == function.blocks.size()) {
+        return false;
+    }
+    std::unordered_set<IrBlock*> keep(reachable.begin(), reachable.end());
+    for (IrBlock* block : function.blocks) {
+        if (!keep.count(block)) {
+            while (!block->successors.empty()) {
+                unlink(block, block->successors.back());
+            }
+        }
+    }
+    function.blocks.erase(std::remove_if(function.blocks.begin(), function.blocks.end(),
+                                         [&](IrBlock* block) { return !keep.count(block); }),
+                          function.blocks.end());
+    return true;
+}
+
+void splitCriticalEdges(IrFunction& function) {
+    // the blocks are appended to, so only the ones there now are looked at
+    size_t count = function.blocks.size();
+    for (size_t i = 0; i < count; i++) {
+        IrBlock* block = function.blocks[i];
+        if (block->successors.size() < 2) {
+            continue;
+        }
+        for (IrBlock*& successor : block->successors) {
+            if (successor->predecessors.size() < 2 || successor->firstNonPhi() == 0) {
+                continue;
+            }
+            IrBlock* split = function.newBlock();
+            int line = block->terminator()->line;
+            function.append(split, function.create(IrOp::JUMP, {}, 0, 0, line));
+            *std::find(successor->predecessors.begin(), successor->predecessors.end(), block) = split;
+            split->predecessors.push_back(block);
+            split->successors.push_back(successor);
+            successor = split;
+        }
+    }
+}
+
+void splitCriticalEdges(IrModule& module) {
+    for (const auto& function : module.functions) {
+        splitCriticalEdges(*function);
+    }
+}
@@ -0,0 +1,219 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "array.hpp"
+#include "printf_format.hpp"
+
+// Every operation of the IR. Operands are noted as a and b of the
+// IrInstruction, values it reads as its operands.
+#define CS460_IR_OPS(X)                                                          \
+    X(CONST)          /* the int a */                                            \
+    X(STRING)         /* handle of string constant a */                          \
+    X(PARAM)          /* argument a, only at the start of the entry block */     \
+    X(ARRAY)          /* handle in the local array slot a */                     \
+    X(LOAD_GLOBAL)    /* global slot a */                                        \
+    X(STORE_GLOBAL)   /* global slot a = value */                                \
+    X(COPY_ARRAY)     /* copy array value into the array of slot a, global if b */ \
+    X(LOAD_ELEMENT)   /* array [ index ], b when the index is proven in range */ \
+    X(STORE_ELEMENT)  /* array [ index ] = value, b as for LOAD_ELEMENT */       \
+    X(ADD)                                                                       \
+    X(SUB)                                                                       \
+    X(MUL)                                                                       \
+    X(DIV)                                                                       \
+    X(MOD)                                                                       \
+    X(POW)                                                                       \
+    X(LT)                                                                        \
+    X(LE)                                                                        \
+    X(GT)                                                                        \
+    X(GE)                                                                        \
+    X(EQ)                                                                        \
+    X(NE)                                                                        \
+    X(NOT)                                                                       \
+    X(CALL)           /* function a with the values as arguments */              \
+    X(PRINTF)         /* format a with the values */                             \
+    X(COPY)           /* the value, left behind by x = y */                      \
+    X(PHI)            /* the value of the predecessor control came from */       \
+    /* terminators, the last instruction of every block */                      \
+    X(JUMP)           /* to the only successor */                                \
+    X(BRANCH)         /* to the first successor if the value is not 0, else the second */ \
+    X(RETURN)         /* the value to the caller */
+
+enum class IrOp {
+#define CS460_IR_ENUM(name) name,
+    CS460_IR_OPS(CS460_IR_ENUM)
+#undef CS460_IR_ENUM
+};
+
+const char* irOpName(IrOp op);
+
+class IrBlock;
+
+// An instruction, and the SSA value it defines when it has one
+class IrInstruction {
+   public:
+    IrOp op;
+    int id{0};  // %id in the printed IR, unique within the function
+    int a{0};
+    int b{0};
+    int line{0};       // source line, the one runtime errors report
+    int variable{-1};  // local slot assigned this value, -1 for temporaries
+    std::vector<IrInstruction*> operands;  // of a PHI, in the order of the block's predecessors
+    IrBlock* block{nullptr};
+
+    bool isTerminator() const;
+    // leaves a value other instructions can use
+    bool hasValue() const;
+    // can stop the program with a runtime error: a division by what may be
+    // 0 or -1, 0 to what may be a negative power, a checked element load
+    bool mayFail() const;
+};
+
+class IrBlock {
+   public:
+    int id{0};
+    std::vector<IrInstruction*> instructions;  // phis first, the terminator last
+    std::vector<IrBlock*> predecessors;
+    std::vector<IrBlock*> successors;  // of a BRANCH, where it goes when true first
+
+    // nullptr while the block is being built
+    IrInstruction* terminator() const;
+    // index of the first instruction after the phis
+    size_t firstNonPhi() const;
+};
+
+// A function or procedure in SSA form. Its scalar locals, parameters
+// included, are values. Globals and array elements are loaded and stored.
+class IrFunction {
+   public:
+    struct LocalArray {
+        int slot;
+        int size;
+        ElementType type;
+        int line;
+    };
+
+    std::string name;
+    size_t parameterCount{0};
+    bool procedure{false};            // its callers drop the result
+    size_t frameSize{0};              // slots of the locals in the symbol table
+    std::vector<LocalArray> arrays;   // allocated on entry
+    std::vector<IrBlock*> blocks;     // in layout order, the entry first
+
+    IrBlock* entry() const { return blocks.front(); }
+    // one more than the highest %id handed out
+    size_t valueCount() const { return _nextValue; }
+
+    IrBlock* newBlock();
+    // an instruction in no block yet
+    IrInstruction* create(IrOp op, std::vector<IrInstruction*> operands, int a = 0, int b = 0, int line = 0);
+    IrInstruction* append(IrBlock* block, IrInstruction* instruction);
+    IrInstruction* insert(IrBlock* block, size_t position, IrInstruction* instruction);
+    void link(IrBlock* from, IrBlock* to);
+    // takes the instruction out of its block, uses of it have to be gone
+    void erase(IrInstruction* instruction);
+
+   private:
+    std::vector<std::unique_ptr<IrBlock>> _blocks;
+    std::vector<std::unique_ptr<IrInstruction>> _instructions;
+    int _nextBlock{0};
+    int _nextValue{0};
+};
+
+// The IR of a whole program, functions in the order of Program::functions.
+// A function main never reaches has no blocks.
+struct IrModule {
+    struct GlobalArray {
+        int slot;
+        int size;
+        ElementType type;
+        int line;
+    };
+
+    std::vector<std::unique_ptr<IrFunction>> functions;
+    std::vector<GlobalArray> globalArrays;
+    int main{-1};
+    size_t globalCount{0};
+    std::vector<std::string> strings;
+    std::vector<std::string> formatText;  // source of every printf format
+    std::vector<PrintfFormat> formats;
+};
+
+void printIr(const IrModule& module, std::ostream& out);
+void printIr(const IrFunction& function, std::ostream& out);
+
+// Throws std::logic_error naming the first broken rule: blocks end in one
+// terminator, phis lead and match the predecessors, the edges agree, and
+// every value is defined in a block that dominates its use.
+void verifyIr(const IrFunction& function);
+
+// reachable blocks in reverse postorder, the entry first
+std::vector<IrBlock*> reversePostorder(const IrFunction& function);
+
+// Dominator tree of the reachable blocks
+class IrDominators {
+   public:
+    explicit IrDominators(const IrFunction& function);
+
+    bool reachable(const IrBlock* block) const;
+    bool dominates(const IrBlock* dominator, const IrBlock* block) const;
+    IrBlock* immediate(const IrBlock* block) const;
+    const std::vector<IrBlock*>& children(const IrBlock* block) const;
+    const std::vector<IrBlock*>& order() const { return _order; }
+
+   private:
+    std::vector<IrBlock*> _order;  // reverse postorder
+    std::unordered_map<const IrBlock*, size_t> _index;
+    std::vector<size_t> _idom;
+    std::vector<std::vector<IrBlock*>> _children;
+};
+
+// A natural loop: its header and every block that reaches one of the back
+// edges to the header without passing through it
+struct IrLoop {
+    IrBlock* header;
+    std::vector<IrBlock*> blocks;  // in reverse postorder, the header first
+    std::unordered_set<const IrBlock*> contains;
+
+    // the only block outside the loop the header is entered from, when it
+    // jumps nowhere else; nullptr when there is none
+    IrBlock* preheader() const;
+};
+
+// The loops of the reachable blocks, each loop before the loops it is in
+std::vector<IrLoop> findLoops(const IrDominators& dominators);
+
+// Copies blocks, which may come from another function, into function,
+// appended to its layout like newBlock does. Instructions that are already
+// keys of values are not copied, their uses read what they map to; every
+// copy is added to values. Edges between the blocks lead to their copies,
+// an edge to or from any other block is copied on the copy's side only.
+std::vector<IrBlock*> copyBlocks(IrFunction& function, const std::vector<IrBlock*>& blocks,
+                                 std::unordered_map<const IrInstruction*, IrInstruction*>& values);
+
+// Rewrites every operand found in replacements, following chains
+void replaceValues(IrFunction& function, const std::unordered_map<IrInstruction*, IrInstruction*>& replacements);
+
+// Drops the edge, and the operand the phis of to had for it
+void unlink(IrBlock* from, IrBlock* to);
+
+// Drops blocks control cannot reach from the entry, true when there were any
+bool removeUnreachableBlocks(IrFunction& function);
+
+// Puts an empty block, appended to the function, on every edge from a block
+// with several successors to one with phis, so the copies of the phis have
+// a place of their own
+void splitCriticalEdges(IrFunction& function);
+
+// The same for every function of the module. Backends split the edges
+// before sizing anything by valueCount, as the splits add instructions.
+void splitCriticalEdges(IrModule& module);
+
+#endif  // IR_HPP
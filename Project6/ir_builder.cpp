@@ -0,0 +1,675 @@
+#include "ir_builder.hpp"
+
+#include <algorithm>
+
+#include "array.hpp"
+#include "printf_format.hpp"
+#include "token_error.hpp"
+
+namespace {
+
+IrOp binaryOp(TokenType type) {
+    switch (type) {
+        case TokenType::PLUS:
+            return IrOp::ADD;
+        case TokenType::MINUS:
+            return IrOp::SUB;
+        case TokenType::ASTERISK:
+            return IrOp::MUL;
+        case TokenType::DIVIDE:
+            return IrOp::DIV;
+        case TokenType::MODULO:
+            return IrOp::MOD;
+        case TokenType::CARET:
+            return IrOp::POW;
+        case TokenType::GT:
+            return IrOp::GT;
+        case TokenType::GT_EQUAL:
+            return IrOp::GE;
+        case TokenType::LT:
+            return IrOp::LT;
+        case TokenType::LT_EQUAL:
+            return IrOp::LE;
+        case TokenType::BOOLEAN_EQUAL:
+            return IrOp::EQ;
+        case TokenType::BOOLEAN_NOT_EQUAL:
+            return IrOp::NE;
+        default:
+            return IrOp::JUMP;
+    }
+}
+
+}  // namespace
+
+IrBuilder::IrBuilder(ASTree* ast, Interpreter& interpreter) : ast(ast), interpreter(interpreter) {}
+
+IrModule IrBuilder::build() {
+    _module.globalCount = interpreter.getGlobalCount();
+
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        _functionIndex[declaration] = _module.functions.size();
+        auto function = std::make_unique<IrFunction>();
+        function->name = declaration->symbol->identifierName;
+        function->frameSize = declaration->symbol->frameSize;
+        function->parameterCount = declaration->symbol->parameterCount;
+        function->procedure = declaration->symbol->identifierType == TokenType::PROCEDURE;
+        _module.functions.push_back(std::move(function));
+    }
+    _queued.assign(_module.functions.size(), false);
+
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        ASTListNode* node = interpreter.getAddressAtInd(i);
+        if (node->type == ASTNodeType::DECLARATION && node->symbol->scope == 0 && node->symbol->isArray) {
+            _module.globalArrays.push_back({node->symbol->slot, (int)node->symbol->arraySize,
+                                            elementTypeOf(node->symbol->datatype), node->token->lineNumber});
+        }
+    }
+
+    // only functions reachable from main are built, in the Compiler's order
+    ASTListNode* main = interpreter.getMain();
+    if (main) {
+        _module.main = reference(main);
+    }
+    while (!_pending.empty()) {
+        ASTListNode* declaration = _pending.back();
+        _pending.pop_back();
+        buildFunction(declaration);
+    }
+
+    return std::move(_module);
+}
+
+void IrBuilder::buildFunction(ASTListNode* declaration) {
+    _function = _module.functions[_functionIndex[declaration]].get();
+    _layout.clear();
+    _definitions.clear();
+    _incompletePhis.clear();
+    _sealed.clear();
+
+    for (ASTListNode* node = declaration; node != declaration->end; node = lastSibling(node)->child) {
+        if (node->type == ASTNodeType::DECLARATION && node != declaration && node->symbol->isArray) {
+            _function->arrays.push_back({node->symbol->slot, (int)node->symbol->arraySize,
+                                         elementTypeOf(node->symbol->datatype), node->token->lineNumber});
+        }
+    }
+
+    // arguments arrive in the first slots, every other local starts out 0
+    IrBlock* entry = newBlock();
+    seal(entry);
+    start(entry);
+    _line = declaration->token ? declaration->token->lineNumber : 0;
+    for (size_t i = 0; i < _function->parameterCount; i++) {
+        IrInstruction* parameter = emit(IrOp::PARAM, {}, i);
+        parameter->variable = i;
+        writeVariable(i, entry, parameter);
+    }
+    _zero = emit(IrOp::CONST, {}, 0);
+
+    buildBlock(declaration->body);
+
+    // falling off the end returns 0
+    emit(IrOp::RETURN, {emit(IrOp::CONST, {}, 0)});
+
+    _function->blocks = _layout;
+    removeUnreachableBlocks(*_function);
+    removeTrivialPhis();
+}
+
+void IrBuilder::buildBlock(ASTListNode* node) {
+    while (node->type != ASTNodeType::END_BLOCK) {
+        node = buildStatement(node)->child;
+    }
+}
+
+// Returns the last node of the statement, the next statement is its child
+ASTListNode* IrBuilder::buildStatement(ASTListNode* node) {
+    if (node->token) {
+        _line = node->token->lineNumber;
+    }
+
+    switch (node->type) {
+        case ASTNodeType::ASSIGNMENT:
+            buildAssignment(node);
+            break;
+        case ASTNodeType::IF:
+            buildIf(node);
+            return node->end;
+        case ASTNodeType::WHILE:
+            buildWhile(node);
+            return node->end;
+        case ASTNodeType::FOR1:
+            buildFor(node);
+            return node->end;
+        case ASTNodeType::PRINTF:
+            buildPrintf(node);
+            break;
+        case ASTNodeType::RETURN:
+            buildReturn(node);
+            break;
+        case ASTNodeType::CALL: {
+            // a call statement discards the result
+            ASTListNode* callNode = node;
+            call(parseCall(callNode));
+            break;
+        }
+        default:
+            // declarations are allocated on entry
+            break;
+    }
+    return lastSibling(node);
+}
+
+void IrBuilder::buildAssignment(ASTListNode* node) {
+    ASTListNode* target = node->sibling;
+    ASTListNode* next = target->sibling;
+
+    // element store: target [ index ] value =
+    if (next && next->token->type == TokenType::L_BRACKET) {
+        IrInstruction* array = load(target);
+        next = next->sibling;
+        IrInstruction* index = value(parseExpression(next));
+        next = next->sibling;
+        IrInstruction* stored = value(parseExpression(next));
+        emit(IrOp::STORE_ELEMENT, {array, index, stored}, 0, target->inBounds);
+        return;
+    }
+
+    store(target, value(parseExpression(next)));
+}
+
+void IrBuilder::buildIf(ASTListNode* node) {
+    ASTListNode* conditionNode = node->sibling;
+    Term test = parseExpression(conditionNode);
+
+    IrBlock* thenBlock = newBlock();
+    IrBlock* elseBlock = node->elseBody ? newBlock() : nullptr;
+    IrBlock* join = newBlock();
+    condition(test, thenBlock, elseBlock ? elseBlock : join);
+    seal(thenBlock);
+
+    start(thenBlock);
+    buildBlock(node->body);
+    jump(join);
+    if (elseBlock) {
+        seal(elseBlock);
+        start(elseBlock);
+        buildBlock(node->elseBody);
+        jump(join);
+    }
+    seal(join);
+    start(join);
+}
+
+void IrBuilder::buildWhile(ASTListNode* node) {
+    IrBlock* header = newBlock();
+    jump(header);
+    start(header);
+
+    ASTListNode* conditionNode = node->sibling;
+    IrBlock* body = newBlock();
+    IrBlock* exit = newBlock();
+    condition(parseExpression(conditionNode), body, exit);
+    seal(body);
+    seal(exit);
+
+    start(body);
+    buildBlock(node->body);
+    jump(header);
+    seal(header);
+    start(exit);
+}
+
+void IrBuilder::buildFor(ASTListNode* node) {
+    // For node is split into FOR1, FOR2, FOR3
+    ASTListNode* conditionRow = lastSibling(node)->child;
+    ASTListNode* incrementRow = lastSibling(conditionRow)->child;
+
+    // FOR1: Initialization
+    if (node->sibling) {
+        buildAssignment(node);
+    }
+
+    // FOR2 end condition, an empty one is always true
+    IrBlock* header = newBlock();
+    jump(header);
+    start(header);
+    IrBlock* body = newBlock();
+    IrBlock* exit = newBlock();
+    if (conditionRow->sibling) {
+        ASTListNode* conditionNode = conditionRow->sibling;
+        condition(parseExpression(conditionNode), body, exit);
+    } else {
+        jump(body);
+    }
+    seal(body);
+    seal(exit);
+
+    start(body);
+    buildBlock(node->body);
+
+    // FOR3
+    if (incrementRow->sibling) {
+        buildAssignment(incrementRow);
+    }
+    jump(header);
+    seal(header);
+    start(exit);
+}
+
+void IrBuilder::buildPrintf(ASTListNode* node) {
+    ASTListNode* format = node->sibling;
+    std::vector<IrInstruction*> arguments;
+
+    for (ASTListNode* arg = format->sibling; arg; arg = arg->sibling) {
+        TokenType type = arg->token->type;
+        if (type == TokenType::SINGLE_QUOTE || type == TokenType::DOUBLE_QUOTE) {
+            continue;
+        }
+        // an element, name [ index ], the index has to be a single value
+        // as the Compiler takes it
+        ASTListNode* next = arg->sibling;
+        if (type == TokenType::IDENTIFIER && next && next->token->type == TokenType::L_BRACKET) {
+            ASTListNode* index = next->sibling;
+            if (!index || !index->sibling || index->sibling->token->type != TokenType::R_BRACKET) {
+                throwError(arg->token, "printf can only index \"" + arg->token->lexeme + "\" with a single value.");
+            }
+            IrInstruction* array = load(arg);
+            arguments.push_back(emit(IrOp::LOAD_ELEMENT, {array, operand(index)}, 0, arg->inBounds));
+            arg = index->sibling;
+        } else {
+            arguments.push_back(operand(arg));
+        }
+    }
+    PrintfFormat compiled = compileFormat(format->token->lexeme);
+    if ((int)arguments.size() < compiled.argumentCount) {
+        throwError(format->token, "printf format expects " + std::to_string(compiled.argumentCount) +
+                                      " argument(s), got " + std::to_string(arguments.size()) + ".");
+    }
+    _module.formats.push_back(std::move(compiled));
+    _module.formatText.push_back(format->token->lexeme);
+    emit(IrOp::PRINTF, arguments, _module.formats.size() - 1);
+}
+
+void IrBuilder::buildReturn(ASTListNode* node) {
+    IrInstruction* result;
+    if (node->sibling) {
+        ASTListNode* valueNode = node->sibling;
+        result = value(parseExpression(valueNode));
+    } else {
+        result = emit(IrOp::CONST, {}, 0);
+    }
+    emit(IrOp::RETURN, {result});
+
+    // whatever follows the return in the block is never run
+    IrBlock* unreachable = newBlock();
+    seal(unreachable);
+    start(unreachable);
+}
+
+// Rebuilds the postfix expression starting at node, stopping on the closing
+// ] ) or , of an enclosing index or call, or on the last node of the row.
+// Nothing is checked here, errors come up while the tree is turned into IR,
+// in the order the Compiler finds them.
+IrBuilder::Term IrBuilder::parseExpression(ASTListNode*& node) {
+    std::vector<Term> stack;
+
+    while (node) {
+        TokenType type = node->token->type;
+
+        // end of an array index, a call argument or the argument list
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
+        }
+
+        if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = node->sibling;
+            if (next && next->token->type == TokenType::L_PAREN) {
+                stack.push_back(parseCall(node));
+            } else if (next && next->token->type == TokenType::L_BRACKET) {
+                Term element{Term::ELEMENT, node, {}};
+                node = next->sibling;
+                element.operands.push_back(parseExpression(node));
+                stack.push_back(std::move(element));
+            } else {
+                stack.push_back({Term::VARIABLE, node, {}});
+            }
+        } else if (type == TokenType::BOOLEAN_NOT || (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR)) {
+            size_t count = type == TokenType::BOOLEAN_NOT ? 1 : 2;
+            if (stack.size() < count) {
+                throwError(node->token, "missing operand of \"" + node->token->lexeme + "\".");
+            }
+            Term applied{type == TokenType::BOOLEAN_NOT ? Term::NOT : Term::BINARY, node, {}};
+            applied.operands.assign(std::make_move_iterator(stack.end() - count), std::make_move_iterator(stack.end()));
+            stack.resize(stack.size() - count);
+            stack.push_back(std::move(applied));
+        }
+        // quotes and the assignment operator carry no value
+        else if (type == TokenType::STRING || type == TokenType::CHAR_LITERAL || type == TokenType::INTEGER ||
+                 type == TokenType::TRUE || type == TokenType::FALSE) {
+            stack.push_back({Term::LITERAL, node, {}});
+        }
+
+        if (node->sibling == nullptr) {
+            break;
+        }
+        node = node->sibling;
+    }
+
+    if (stack.empty()) {
+        return {Term::LITERAL, nullptr, {}};
+    }
+    return std::move(stack.back());
+}
+
+// From a call site, name ( arg , ... ), leaving node on the closing paren
+IrBuilder::Term IrBuilder::parseCall(ASTListNode*& node) {
+    Term term{Term::CALL, node, {}};
+    node = node->sibling;
+    while (node->token->type != TokenType::R_PAREN) {
+        node = node->sibling;
+        if (node->token->type == TokenType::R_PAREN) {
+            break;
+        }
+        term.operands.push_back(parseExpression(node));
+    }
+    return term;
+}
+
+IrInstruction* IrBuilder::value(const Term& term) {
+    switch (term.kind) {
+        case Term::LITERAL:
+            return term.node ? operand(term.node) : emit(IrOp::CONST, {}, 0);
+        case Term::VARIABLE:
+            return load(term.node);
+        case Term::ELEMENT: {
+            IrInstruction* array = load(term.node);
+            IrInstruction* index = value(term.operands[0]);
+            return emit(IrOp::LOAD_ELEMENT, {array, index}, 0, term.node->inBounds);
+        }
+        case Term::CALL:
+            return call(term);
+        case Term::NOT:
+            return emit(IrOp::NOT, {value(term.operands[0])});
+        case Term::BINARY:
+            break;
+    }
+
+    TokenType type = term.node->token->type;
+    if (type == TokenType::BOOLEAN_AND || type == TokenType::BOOLEAN_OR) {
+        return shortCircuit(term);
+    }
+    IrInstruction* lhs = value(term.operands[0]);
+    IrInstruction* rhs = value(term.operands[1]);
+    IrOp op = binaryOp(type);
+    if (op == IrOp::JUMP) {
+        throwError(term.node->token, "unsupported operator \"" + term.node->token->lexeme + "\".");
+    }
+    return emit(op, {lhs, rhs});
+}
+
+IrInstruction* IrBuilder::call(const Term& term) {
+    ASTListNode* callNode = term.node;
+    if (!callNode->callee) {
+        throwError(callNode->token, "\"" + callNode->token->lexeme + "\" is not defined.");
+    }
+
+    std::vector<IrInstruction*> arguments;
+    for (const Term& argument : term.operands) {
+        arguments.push_back(value(argument));
+    }
+
+    const IrFunction& function = *_module.functions[_functionIndex[callNode->callee]];
+    if (arguments.size() != function.parameterCount) {
+        throwError(callNode->token, "\"" + function.name + "\" expects " + std::to_string(function.parameterCount) +
+                                        " argument(s), got " + std::to_string(arguments.size()) + ".");
+    }
+    return emit(IrOp::CALL, arguments, reference(callNode->callee));
+}
+
+// && and || as a value: the right operand only runs when the left one does
+// not decide the result, which is 0 or 1 like the result of a comparison
+IrInstruction* IrBuilder::shortCircuit(const Term& term) {
+    bool isAnd = term.node->token->type == TokenType::BOOLEAN_AND;
+    IrInstruction* lhs = value(term.operands[0]);
+    IrInstruction* decided = emit(IrOp::CONST, {}, isAnd ? 0 : 1);
+
+    IrBlock* right = newBlock();
+    IrBlock* join = newBlock();
+    emit(IrOp::BRANCH, {lhs});
+    _function->link(_block, isAnd ? right : join);
+    _function->link(_block, isAnd ? join : right);
+    seal(right);
+
+    start(right);
+    const Term& rightTerm = term.operands[1];
+    IrInstruction* rhs = value(rightTerm);
+    bool normalized = rightTerm.kind == Term::NOT;
+    if (rightTerm.kind == Term::BINARY) {
+        TokenType type = rightTerm.node->token->type;
+        IrOp op = binaryOp(type);
+        normalized = (op >= IrOp::LT && op <= IrOp::NE) || type == TokenType::BOOLEAN_AND ||
+                     type == TokenType::BOOLEAN_OR;
+    }
+    if (!normalized) {
+        rhs = emit(IrOp::NE, {rhs, emit(IrOp::CONST, {}, 0)});
+    }
+    jump(join);
+    seal(join);
+
+    start(join);
+    // the block branching on the left operand is the first predecessor
+    IrInstruction* result = _function->insert(join, 0, _function->create(IrOp::PHI, {decided, rhs}, 0, 0, _line));
+    return result;
+}
+
+// Branches to whenTrue or whenFalse on the value of term, && || and ! only
+// decide which block the branches of their operands go to
+void IrBuilder::condition(const Term& term, IrBlock* whenTrue, IrBlock* whenFalse) {
+    if (term.kind == Term::NOT) {
+        condition(term.operands[0], whenFalse, whenTrue);
+        return;
+    }
+    if (term.kind == Term::BINARY) {
+        TokenType type = term.node->token->type;
+        if (type == TokenType::BOOLEAN_AND || type == TokenType::BOOLEAN_OR) {
+            IrBlock* right = newBlock();
+            if (type == TokenType::BOOLEAN_AND) {
+                condition(term.operands[0], right, whenFalse);
+            } else {
+                condition(term.operands[0], whenTrue, right);
+            }
+            seal(right);
+            start(right);
+            condition(term.operands[1], whenTrue, whenFalse);
+            return;
+        }
+    }
+
+    emit(IrOp::BRANCH, {value(term)});
+    _function->link(_block, whenTrue);
+    _function->link(_block, whenFalse);
+}
+
+// a single literal or variable
+IrInstruction* IrBuilder::operand(ASTListNode* node) {
+    switch (node->token->type) {
+        case TokenType::STRING:
+            return emit(IrOp::STRING, {}, stringConstant(node->token->lexeme));
+        case TokenType::CHAR_LITERAL:
+            return emit(IrOp::CONST, {}, node->token->lexeme[0]);
+        case TokenType::INTEGER:
+            return emit(IrOp::CONST, {}, std::stoi(node->token->lexeme));
+        case TokenType::TRUE:
+            return emit(IrOp::CONST, {}, 1);
+        case TokenType::FALSE:
+            return emit(IrOp::CONST, {}, 0);
+        default:
+            return load(node);
+    }
+}
+
+IrInstruction* IrBuilder::load(ASTListNode* node) {
+    SymbolTableListNode* symbol = variableOf(node);
+    if (symbol->scope == 0) {
+        return emit(IrOp::LOAD_GLOBAL, {}, symbol->slot);
+    }
+    if (symbol->isArray) {
+        return emit(IrOp::ARRAY, {}, symbol->slot);
+    }
+    return readVariable(symbol->slot, _block);
+}
+
+void IrBuilder::store(ASTListNode* node, IrInstruction* value) {
+    SymbolTableListNode* symbol = variableOf(node);
+    if (symbol->isArray) {
+        emit(IrOp::COPY_ARRAY, {value}, symbol->slot, symbol->scope == 0);
+    } else if (symbol->scope == 0) {
+        emit(IrOp::STORE_GLOBAL, {value}, symbol->slot);
+    } else {
+        // a value another variable holds is copied, so each value names
+        // the variable it was computed for
+        if (value->variable >= 0 || value == _zero) {
+            value = emit(IrOp::COPY, {value});
+        }
+        value->variable = symbol->slot;
+        writeVariable(symbol->slot, _block, value);
+    }
+}
+
+void IrBuilder::writeVariable(int slot, IrBlock* block, IrInstruction* value) {
+    _definitions[block][slot] = value;
+}
+
+IrInstruction* IrBuilder::readVariable(int slot, IrBlock* block) {
+    auto& definitions = _definitions[block];
+    auto found = definitions.find(slot);
+    if (found != definitions.end()) {
+        return found->second;
+    }
+
+    IrInstruction* value;
+    if (!_sealed.count(block)) {
+        // more predecessors are coming, the phi gets its operands once
+        // the block is sealed
+        value = newPhi(slot, block);
+        _incompletePhis[block].push_back(value);
+    } else if (block->predecessors.size() == 1) {
+        value = readVariable(slot, block->predecessors[0]);
+    } else if (block->predecessors.empty()) {
+        value = _zero;
+    } else {
+        // the phi is defined first, so a loop through it ends there
+        value = newPhi(slot, block);
+        writeVariable(slot, block, value);
+        addPhiOperands(value);
+    }
+    writeVariable(slot, block, value);
+    return value;
+}
+
+IrInstruction* IrBuilder::newPhi(int slot, IrBlock* block) {
+    IrInstruction* phi = _function->create(IrOp::PHI, {}, 0, 0, _line);
+    phi->variable = slot;
+    return _function->insert(block, block->firstNonPhi(), phi);
+}
+
+void IrBuilder::addPhiOperands(IrInstruction* phi) {
+    for (IrBlock* predecessor : phi->block->predecessors) {
+        phi->operands.push_back(readVariable(phi->variable, predecessor));
+    }
+}
+
+// No more predecessors will be added to block
+void IrBuilder::seal(IrBlock* block) {
+    for (IrInstruction* phi : _incompletePhis[block]) {
+        addPhiOperands(phi);
+    }
+    _incompletePhis.erase(block);
+    _sealed.insert(block);
+}
+
+// A phi whose operands are all one value, or itself, is that value
+void IrBuilder::removeTrivialPhis() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::unordered_map<IrInstruction*, IrInstruction*> replacements;
+        for (IrBlock* block : _function->blocks) {
+            for (size_t i = 0; i < block->firstNonPhi(); i++) {
+                IrInstruction* phi = block->instructions[i];
+                IrInstruction* same = nullptr;
+                bool trivial = true;
+                for (IrInstruction* operand : phi->operands) {
+                    if (operand == phi || operand == same) {
+                        continue;
+                    }
+                    if (same) {
+                        trivial = false;
+                        break;
+                    }
+                    same = operand;
+                }
+                if (!trivial) {
+                    continue;
+                }
+                // phis replaced earlier in the round may lead back to this one
+                for (auto found = replacements.find(same); found != replacements.end();
+                     found = replacements.find(same)) {
+                    same = found->second;
+                }
+                replacements[phi] = same && same != phi ? same : _zero;
+            }
+        }
+        for (auto& [phi, same] : replacements) {
+            _function->erase(phi);
+            changed = true;
+        }
+        replaceValues(*_function, replacements);
+    }
+}
+
+IrBlock* IrBuilder::newBlock() {
+    return _function->newBlock();
+}
+
+// Continues building in block, which comes next in the layout
+void IrBuilder::start(IrBlock* block) {
+    _block = block;
+    _layout.push_back(block);
+}
+
+IrInstruction* IrBuilder::emit(IrOp op, std::vector<IrInstruction*> operands, int a, int b) {
+    return _function->append(_block, _function->create(op, std::move(operands), a, b, _line));
+}
+
+void IrBuilder::jump(IrBlock* target) {
+    emit(IrOp::JUMP);
+    _function->link(_block, target);
+}
+
+// Index of the function, queueing its body the first time it is called
+int IrBuilder::reference(ASTListNode* declaration) {
+    int index = _functionIndex[declaration];
+    if (!_queued[index]) {
+        _queued[index] = true;
+        _pending.push_back(declaration);
+    }
+    return index;
+}
+
+int IrBuilder::stringConstant(const std::string& str) {
+    auto found = _stringIndex.find(str);
+    if (found != _stringIndex.end()) {
+        return found->second;
+    }
+    _module.strings.push_back(str);
+    return _stringIndex[str] = _module.strings.size() - 1;
+}
+
+SymbolTableListNode* IrBuilder::variableOf(ASTListNode* node) {
+    SymbolTableListNode* symbol = node->symbol;
+    if (!symbol || symbol->slot < 0) {
+        throwError(node->token, "\"" + node->token->lexeme + "\" is not a declared variable.");
+    }
+    return symbol;
+}
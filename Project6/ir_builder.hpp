@@ -0,0 +1,94 @@
+#ifndef IR_BUILDER_HPP
+#define IR_BUILDER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+#include "ast_list_node.hpp"
+#include "interpreter.hpp"
+#include "ir.hpp"
+
+// Translates the AST into the SSA IR, walking it like the Compiler does:
+// the functions main reaches, in the same order, with the same errors. The
+// scalar locals of a function become values, read and written with Braun
+// et al.'s construction over sealed blocks. &&, || and ! in the condition
+// of an if or loop become branches, elsewhere && and || give 0 or 1
+// through a phi.
+class IrBuilder {
+   public:
+    IrBuilder(ASTree* ast, Interpreter& interpreter);
+    IrModule build();
+
+   private:
+    // A postfix expression of a row rebuilt into a tree, so conditions can
+    // branch on its operators
+    struct Term {
+        enum Kind { LITERAL, VARIABLE, ELEMENT, CALL, NOT, BINARY };
+        Kind kind;
+        ASTListNode* node;  // the literal, name or operator, nullptr for an empty expression
+        std::vector<Term> operands;
+    };
+
+    ASTree* ast;
+    Interpreter& interpreter;
+
+    IrModule _module;
+    std::unordered_map<ASTListNode*, int> _functionIndex;
+    std::unordered_map<std::string, int> _stringIndex;
+    std::vector<ASTListNode*> _pending;  // called functions not built yet
+    std::vector<bool> _queued;
+    int _line{0};
+
+    // state of the function being built
+    IrFunction* _function{nullptr};
+    IrBlock* _block{nullptr};
+    IrInstruction* _zero{nullptr};  // what a local holds before it is assigned
+    std::vector<IrBlock*> _layout;  // blocks in the order they were started
+    std::unordered_map<IrBlock*, std::unordered_map<int, IrInstruction*>> _definitions;
+    std::unordered_map<IrBlock*, std::vector<IrInstruction*>> _incompletePhis;
+    std::unordered_set<IrBlock*> _sealed;
+
+   private:
+    void buildFunction(ASTListNode* declaration);
+    void buildBlock(ASTListNode* node);
+    ASTListNode* buildStatement(ASTListNode* node);
+    void buildAssignment(ASTListNode* node);
+    void buildIf(ASTListNode* node);
+    void buildWhile(ASTListNode* node);
+    void buildFor(ASTListNode* node);
+    void buildPrintf(ASTListNode* node);
+    void buildReturn(ASTListNode* node);
+
+    Term parseExpression(ASTListNode*& node);
+    Term parseCall(ASTListNode*& node);
+
+    IrInstruction* value(const Term& term);
+    IrInstruction* call(const Term& term);
+    IrInstruction* shortCircuit(const Term& term);
+    void condition(const Term& term, IrBlock* whenTrue, IrBlock* whenFalse);
+    IrInstruction* operand(ASTListNode* node);
+    IrInstruction* load(ASTListNode* node);
+    void store(ASTListNode* node, IrInstruction* value);
+
+    // SSA construction
+    void writeVariable(int slot, IrBlock* block, IrInstruction* value);
+    IrInstruction* readVariable(int slot, IrBlock* block);
+    IrInstruction* newPhi(int slot, IrBlock* block);
+    void addPhiOperands(IrInstruction* phi);
+    void seal(IrBlock* block);
+    void removeTrivialPhis();
+
+    IrBlock* newBlock();
+    void start(IrBlock* block);
+    IrInstruction* emit(IrOp op, std::vector<IrInstruction*> operands = {}, int a = 0, int b = 0);
+    void jump(IrBlock* target);
+
+    int reference(ASTListNode* declaration);
+    int stringConstant(const std::string& str);
+    SymbolTableListNode* variableOf(ASTListNode* node);
+};
+
+#endif  // IR_BUILDER_HPP
@@ -0,0 +1,207 @@
+#include "ir_inliner.hpp"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::vector<IrInstruction*> callsIn(const IrFunction& function) {
+    std::vector<IrInstruction*> calls;
+    for (IrBlock* block : function.blocks) {
+        for (IrInstruction* instruction : block->instructions) {
+            if (instruction->op == IrOp::CALL) {
+                calls.push_back(instruction);
+            }
+        }
+    }
+    return calls;
+}
+
+// what inlining the function copies into its callers
+size_t sizeOf(const IrFunction& function) {
+    size_t size = 0;
+    for (IrBlock* block : function.blocks) {
+        for (IrInstruction* instruction : block->instructions) {
+            if (instruction->op != IrOp::PARAM && instruction->op != IrOp::PHI) {
+                size++;
+            }
+        }
+    }
+    return size;
+}
+
+class Inliner {
+   public:
+    Inliner(IrModule& module, size_t threshold, std::ostream* report)
+            : _module(module), _threshold(threshold), _report(report) {}
+
+    bool run() {
+        // callees before their callers, so each is final by the time it is
+        // copied; the calls of a cycle are never inlined anyway
+        std::vector<bool> visited(_module.functions.size());
+        std::vector<int> order;
+        for (size_t i = 0; i < _module.functions.size(); i++) {
+            postorder(i, visited, order);
+        }
+
+        bool changed = false;
+        for (int index : order) {
+            IrFunction& caller = *_module.functions[index];
+            std::unordered_map<int, int> offsets;  // of each callee's slots in the caller
+            for (IrInstruction* call : callsIn(caller)) {
+                const IrFunction& callee = *_module.functions[call->a];
+                std::string reason = refusal(caller, callee);
+                if (_report) {
+                    *_report << (reason.empty() ? "inlined " : "not inlined ") << callee.name << " into "
+                             << caller.name << " at line " << call->line;
+                    if (reason.empty()) {
+                        *_report << " (" << sizeOf(callee) << " instructions)\n";
+                    } else {
+                        *_report << ": " << reason << "\n";
+                    }
+                }
+                if (!reason.empty()) {
+                    continue;
+                }
+                if (!offsets.count(call->a)) {
+                    offsets[call->a] = caller.frameSize;
+                    caller.frameSize += callee.frameSize;
+                }
+                inlineCall(caller, call, callee, offsets[call->a]);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+   private:
+    void postorder(int index, std::vector<bool>& visited, std::vector<int>& order) {
+        if (visited[index]) {
+            return;
+        }
+        visited[index] = true;
+        for (IrInstruction* call : callsIn(*_module.functions[index])) {
+            postorder(call->a, visited, order);
+        }
+        order.push_back(index);
+    }
+
+    // why a call of callee stays a call, empty when it is inlined
+    std::string refusal(const IrFunction& caller, const IrFunction& callee) const {
+        if (&caller == &callee) {
+            return "recursive";
+        }
+        std::vector<IrInstruction*> calls = callsIn(callee);
+        if (std::any_of(calls.begin(), calls.end(), [&](IrInstruction* call) {
+                return _module.functions[call->a].get() == &callee;
+            })) {
+            return "recursive";
+        }
+        if (!calls.empty()) {
+            return "calls other functions";
+        }
+        if (callee.blocks.empty()) {
+            return "never built";
+        }
+        if (!callee.arrays.empty()) {
+            return "has local arrays";
+        }
+        for (IrBlock* block : callee.blocks) {
+            for (IrInstruction* instruction : block->instructions) {
+                if (instruction->op == IrOp::COPY_ARRAY && !instruction->b) {
+                    return "assigns a whole array parameter";
+                }
+            }
+        }
+        if (std::none_of(callee.blocks.begin(), callee.blocks.end(),
+                         [](IrBlock* block) { return block->terminator()->op == IrOp::RETURN; })) {
+            return "never returns";
+        }
+        size_t size = sizeOf(callee);
+        if (size > _threshold) {
+            return std::to_string(size) + " instructions, over the threshold of " + std::to_string(_threshold);
+        }
+        return "";
+    }
+
+    void inlineCall(IrFunction& caller, IrInstruction* call, const IrFunction& callee, int offset) {
+        // the code after the call moves to a block of its own, which the
+        // blocks the call ended in now come from
+        IrBlock* before = call->block;
+        IrBlock* after = caller.newBlock();
+        std::vector<IrInstruction*>& instructions = before->instructions;
+        auto position = std::find(instructions.begin(), instructions.end(), call);
+        for (auto it = position + 1; it != instructions.end(); ++it) {
+            caller.append(after, *it);
+        }
+        instructions.erase(position, instructions.end());
+        call->block = nullptr;
+        after->successors = std::move(before->successors);
+        before->successors.clear();
+        for (IrBlock* successor : after->successors) {
+            std::replace(successor->predecessors.begin(), successor->predecessors.end(), before, after);
+        }
+
+        // a copy of every block, the parameters read the arguments and an
+        // array parameter, read through its slot, the array passed
+        std::unordered_map<const IrInstruction*, IrInstruction*> values;
+        for (IrBlock* block : callee.blocks) {
+            for (IrInstruction* instruction : block->instructions) {
+                bool parameterArray = instruction->op == IrOp::ARRAY && instruction->a < (int)callee.parameterCount;
+                if (instruction->op == IrOp::PARAM || parameterArray) {
+                    values[instruction] = call->operands[instruction->a];
+                }
+            }
+        }
+        std::vector<IrBlock*> copies = copyBlocks(caller, callee.blocks, values);
+        for (IrBlock* copy : copies) {
+            for (IrInstruction* instruction : copy->instructions) {
+                if (instruction->variable >= 0) {
+                    instruction->variable += offset;
+                }
+            }
+        }
+
+        // every return jumps past the call, its value meets the others there
+        std::vector<IrInstruction*> results;
+        for (IrBlock* copy : copies) {
+            IrInstruction* terminator = copy->terminator();
+            if (terminator->op == IrOp::RETURN) {
+                results.push_back(terminator->operands[0]);
+                copy->instructions.back() = caller.create(IrOp::JUMP, {}, 0, 0, terminator->line);
+                copy->instructions.back()->block = copy;
+                terminator->block = nullptr;
+                caller.link(copy, after);
+            }
+        }
+        IrInstruction* result = results.front();
+        if (std::any_of(results.begin(), results.end(), [&](IrInstruction* value) { return value != result; })) {
+            result = caller.insert(after, 0, caller.create(IrOp::PHI, results, 0, 0, call->line));
+        }
+
+        caller.append(before, caller.create(IrOp::JUMP, {}, 0, 0, call->line));
+        caller.link(before, copies.front());
+
+        // laid out where the call was, instead of at the end
+        // where newBlock put them
+        caller.blocks.resize(caller.blocks.size() - copies.size() - 1);
+        auto at = std::find(caller.blocks.begin(), caller.blocks.end(), before) + 1;
+        copies.push_back(after);
+        caller.blocks.insert(at, copies.begin(), copies.end());
+
+        replaceValues(caller, {{call, result}});
+    }
+
+    IrModule& _module;
+    size_t _threshold;
+    std::ostream* _report;
+};
+
+}  // namespace
+
+bool inlineFunctions(IrModule& module, size_t threshold, std::ostream* report) {
+    return Inliner(module, threshold, report).run();
+}
@@ -0,0 +1,23 @@
+#ifndef IR_INLINER_HPP
+#define IR_INLINER_HPP
+
+#include <cstddef>
+#include <iosfwd>
+
+#include "ir.hpp"
+
+// Replaces calls of small leaf functions by a copy of their body: the
+// arguments take the place of the parameters, the locals get slots of
+// their own past the caller's, and every return jumps to the code after
+// the call with its value. A function is inlined when it calls no other
+// function (so it is not recursive either), has no local arrays, which are
+// allocated anew on every call, and has at most threshold instructions
+// apart from its parameters and phis. Callers are rewritten in module
+// order until no call is left to inline, so a function whose calls have
+// all been inlined is a leaf for its own callers.
+//
+// With a report stream every call site considered is listed with the
+// decision and why.
+bool inlineFunctions(IrModule& module, size_t threshold, std::ostream* report);
+
+#endif  // IR_INLINER_HPP
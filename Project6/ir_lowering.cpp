@@ -0,0 +1,555 @@
+#include "ir_lowering.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Set of values, by id
+class ValueSet {
+   public:
+    explicit ValueSet(size_t size = 0) : _words((size + 63) / 64, 0) {}
+
+    void insert(int id) { _words[id / 64] |= uint64_t(1) << (id % 64); }
+    void erase(int id) { _words[id / 64] &= ~(uint64_t(1) << (id % 64)); }
+    bool contains(int id) const { return _words[id / 64] >> (id % 64) & 1; }
+
+    // adds other, true when that added anything
+    bool merge(const ValueSet& other) {
+        bool changed = false;
+        for (size_t i = 0; i < _words.size(); i++) {
+            uint64_t merged = _words[i] | other._words[i];
+            changed |= merged != _words[i];
+            _words[i] = merged;
+        }
+        return changed;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < _words.size(); i++) {
+            for (uint64_t word = _words[i]; word; word &= word - 1) {
+                f(static_cast<int>(i * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+   private:
+    std::vector<uint64_t> _words;
+};
+
+OpCode opcodeOf(const IrInstruction* instruction) {
+    switch (instruction->op) {
+        case IrOp::LOAD_GLOBAL:
+            return OpCode::LOAD_GLOBAL;
+        case IrOp::STORE_GLOBAL:
+            return OpCode::STORE_GLOBAL;
+        case IrOp::COPY_ARRAY:
+            return instruction->b ? OpCode::COPY_ARRAY_GLOBAL : OpCode::COPY_ARRAY_LOCAL;
+        case IrOp::LOAD_ELEMENT:
+            return instruction->b ? OpCode::LOAD_ELEMENT_UNCHECKED : OpCode::LOAD_ELEMENT;
+        case IrOp::STORE_ELEMENT:
+            return instruction->b ? OpCode::STORE_ELEMENT_UNCHECKED : OpCode::STORE_ELEMENT;
+        case IrOp::ADD:
+            return OpCode::ADD;
+        case IrOp::SUB:
+            return OpCode::SUB;
+        case IrOp::MUL:
+            return OpCode::MUL;
+        case IrOp::DIV:
+            return OpCode::DIV;
+        case IrOp::MOD:
+            return OpCode::MOD;
+        case IrOp::POW:
+            return OpCode::POW;
+        case IrOp::LT:
+            return OpCode::LT;
+        case IrOp::LE:
+            return OpCode::LE;
+        case IrOp::GT:
+            return OpCode::GT;
+        case IrOp::GE:
+            return OpCode::GE;
+        case IrOp::EQ:
+            return OpCode::EQ;
+        case IrOp::NE:
+            return OpCode::NE;
+        case IrOp::NOT:
+            return OpCode::NOT;
+        case IrOp::CALL:
+            return OpCode::CALL;
+        default:
+            return OpCode::PRINTF;
+    }
+}
+
+// pushed wherever it is used
+bool isRematerialized(const IrInstruction* value) {
+    return value->op == IrOp::CONST || value->op == IrOp::STRING || value->op == IrOp::ARRAY;
+}
+
+class FunctionLowering {
+   public:
+    FunctionLowering(IrFunction& function, Program& program, FunctionInfo& info)
+        : function(function),
+          program(program),
+          info(info),
+          _uses(function.valueCount(), 0),
+          _inline(function.valueCount(), false),
+          _home(function.valueCount(), -1) {}
+
+    // the function's critical edges are split already
+    void run() {
+        _order = reversePostorder(function);
+        for (IrBlock* block : function.blocks) {
+            for (IrInstruction* instruction : block->instructions) {
+                for (IrInstruction* operand : instruction->operands) {
+                    _uses[operand->id]++;
+                    if (instruction->op == IrOp::PHI) {
+                        _phiUsers[operand].push_back(instruction);
+                    }
+                }
+            }
+        }
+        for (IrBlock* block : function.blocks) {
+            findStackValues(block);
+        }
+        computeLiveness();
+        assignHomes();
+        emitFunction();
+    }
+
+   private:
+    IrFunction& function;
+    Program& program;
+    FunctionInfo& info;
+
+    std::vector<IrBlock*> _order;  // reverse postorder
+    std::vector<int> _uses;
+    std::vector<bool> _inline;  // left on the operand stack for its only user
+    std::vector<int> _home;     // frame slot of the value, -1 when it has none
+    std::unordered_map<IrInstruction*, std::vector<IrInstruction*>> _phiUsers;
+    std::unordered_map<IrBlock*, ValueSet> _liveIn;  // not counting the block's phis
+    std::vector<std::unordered_set<int>> _interferes;
+    std::unordered_map<IrBlock*, size_t> _start;                 // pc of each block
+    std::vector<std::pair<size_t, IrBlock*>> _jumps;  // to patch once every block has its pc
+    int _line{0};
+
+    // emits no code where it is defined
+    bool isSilent(const IrInstruction* instruction) const {
+        return isRematerialized(instruction) || instruction->op == IrOp::PARAM || instruction->op == IrOp::PHI ||
+               _inline[instruction->id];
+    }
+
+    bool needsHome(const IrInstruction* value) const {
+        return value->hasValue() && !isRematerialized(value) && !_inline[value->id] && _uses[value->id] > 0;
+    }
+
+    // An operand computed by the instructions right in front of its only
+    // user is left on the stack for it, as long as every later operand is
+    // too or is only loaded from a slot, so nothing is evaluated in a
+    // different order
+    void findStackValues(IrBlock* block) {
+        const std::vector<IrInstruction*>& instructions = block->instructions;
+        std::unordered_map<const IrInstruction*, int> start;  // first instruction of each value's code
+
+        for (int p = 0; p < (int)instructions.size(); p++) {
+            IrInstruction* instruction = instructions[p];
+            if (instruction->op == IrOp::PHI) {
+                continue;
+            }
+            int q = p - 1;
+            for (int k = (int)instruction->operands.size() - 1; k >= 0; k--) {
+                IrInstruction* operand = instruction->operands[k];
+                if (isRematerialized(operand)) {
+                    continue;
+                }
+                while (q >= 0 && isSilent(instructions[q])) {
+                    q--;
+                }
+                if (q < 0) {
+                    break;
+                }
+                if (instructions[q] != operand) {
+                    // read from its slot, which nothing in between writes
+                    continue;
+                }
+                bool candidate = _uses[operand->id] == 1 && operand->op != IrOp::PHI && operand->op != IrOp::PARAM;
+                if (!candidate) {
+                    break;
+                }
+                _inline[operand->id] = true;
+                q = start[operand] - 1;
+            }
+            start[instruction] = q + 1;
+        }
+    }
+
+    // the values an instruction reads from slots, through the ones left on the stack
+    void slotUses(const IrInstruction* instruction, std::vector<const IrInstruction*>& uses) const {
+        for (const IrInstruction* operand : instruction->operands) {
+            if (isRematerialized(operand)) {
+                continue;
+            }
+            if (_inline[operand->id]) {
+                slotUses(operand, uses);
+            } else {
+                uses.push_back(operand);
+            }
+        }
+    }
+
+    // Values live at the end of the block, which includes those its
+    // successors' phis take from it
+    ValueSet liveOut(IrBlock* block) {
+        ValueSet live(function.valueCount());
+        for (IrBlock* successor : block->successors) {
+            live.merge(_liveIn[successor]);
+            size_t edge = std::find(successor->predecessors.begin(), successor->predecessors.end(), block) -
+                          successor->predecessors.begin();
+            for (size_t i = 0; i < successor->firstNonPhi(); i++) {
+                const IrInstruction* phi = successor->instructions[i];
+                const IrInstruction* operand = phi->operands[edge];
+                if (needsHome(phi) && needsHome(operand)) {
+                    live.insert(operand->id);
+                }
+            }
+        }
+        return live;
+    }
+
+    // Walks block backwards from live, the values live after it, calling
+    // defined for each value given a slot there with the values live right
+    // after it. Leaves live as the values live after the phis.
+    template <typename F>
+    void walkBackwards(IrBlock* block, ValueSet& live, F defined) {
+        std::vector<const IrInstruction*> uses;
+        for (size_t i = block->instructions.size(); i-- > block->firstNonPhi();) {
+            const IrInstruction* instruction = block->instructions[i];
+            if (isRematerialized(instruction) || _inline[instruction->id]) {
+                continue;
+            }
+            if (needsHome(instruction)) {
+                live.erase(instruction->id);
+                defined(instruction, live);
+            }
+            uses.clear();
+            slotUses(instruction, uses);
+            for (const IrInstruction* use : uses) {
+                live.insert(use->id);
+            }
+        }
+    }
+
+    void computeLiveness() {
+        for (IrBlock* block : function.blocks) {
+            _liveIn[block] = ValueSet(function.valueCount());
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto it = _order.rbegin(); it != _order.rend(); ++it) {
+                IrBlock* block = *it;
+                ValueSet live = liveOut(block);
+                walkBackwards(block, live, [](const IrInstruction*, const ValueSet&) {});
+                for (size_t i = 0; i < block->firstNonPhi(); i++) {
+                    live.erase(block->instructions[i]->id);
+                }
+                changed |= _liveIn[block].merge(live);
+            }
+        }
+
+        // two values interfere when one is live where the other is defined
+        _interferes.resize(function.valueCount());
+        auto interfere = [&](int a, int b) {
+            _interferes[a].insert(b);
+            _interferes[b].insert(a);
+        };
+        for (IrBlock* block : _order) {
+            ValueSet live = liveOut(block);
+            walkBackwards(block, live, [&](const IrInstruction* value, const ValueSet& after) {
+                after.forEach([&](int other) { interfere(value->id, other); });
+            });
+
+            // the phis are all defined on the way in, together
+            std::vector<int> phis;
+            for (size_t i = 0; i < block->firstNonPhi(); i++) {
+                if (needsHome(block->instructions[i])) {
+                    phis.push_back(block->instructions[i]->id);
+                    live.erase(block->instructions[i]->id);
+                }
+            }
+            for (size_t i = 0; i < phis.size(); i++) {
+                live.forEach([&](int other) { interfere(phis[i], other); });
+                for (size_t j = 0; j < i; j++) {
+                    interfere(phis[i], phis[j]);
+                }
+            }
+        }
+    }
+
+    void assignHomes() {
+        // slots the arrays' handles are kept in are never reused
+        std::unordered_set<int> reserved;
+        for (const IrFunction::LocalArray& array : function.arrays) {
+            reserved.insert(array.slot);
+        }
+        for (IrBlock* block : function.blocks) {
+            for (const IrInstruction* instruction : block->instructions) {
+                if (instruction->op == IrOp::ARRAY || (instruction->op == IrOp::COPY_ARRAY && !instruction->b)) {
+                    reserved.insert(instruction->a);
+                }
+            }
+        }
+
+        std::vector<std::vector<const IrInstruction*>> slots(function.frameSize);
+        auto fits = [&](const IrInstruction* value, int slot) {
+            if (slot < 0 || reserved.count(slot)) {
+                return false;
+            }
+            if (slot >= (int)slots.size()) {
+                slots.resize(slot + 1);
+            }
+            for (const IrInstruction* other : slots[slot]) {
+                if (_interferes[value->id].count(other->id)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // definitions come before their uses in reverse postorder, apart from
+        // the operands phis take over loop back edges
+        for (IrBlock* block : _order) {
+            for (IrInstruction* value : block->instructions) {
+                if (!needsHome(value)) {
+                    continue;
+                }
+                // the variable's slot, or one a phi it meets already has
+                std::vector<int> preferred;
+                preferred.push_back(value->op == IrOp::PARAM ? value->a : value->variable);
+                if (value->op == IrOp::PHI) {
+                    for (const IrInstruction* operand : value->operands) {
+                        preferred.push_back(_home[operand->id]);
+                    }
+                }
+                for (const IrInstruction* phi : _phiUsers[value]) {
+                    preferred.push_back(_home[phi->id]);
+                }
+
+                int home = -1;
+                for (int slot : preferred) {
+                    if (fits(value, slot)) {
+                        home = slot;
+                        break;
+                    }
+                }
+                for (int slot = 0; home < 0; slot++) {
+                    if (fits(value, slot)) {
+                        home = slot;
+                    }
+                }
+                _home[value->id] = home;
+                slots[home].push_back(value);
+            }
+        }
+        info.frameSize = std::max(function.frameSize, slots.size());
+    }
+
+    size_t emit(OpCode op, int a = 0, int b = 0, int c = 0) {
+        program.code.push_back({op, a, b, c});
+        program.lines.push_back(_line);
+        return program.code.size() - 1;
+    }
+
+    void emitOperand(const IrInstruction* value) {
+        switch (value->op) {
+            case IrOp::CONST:
+                emit(OpCode::PUSH, value->a);
+                return;
+            case IrOp::STRING:
+                emit(OpCode::PUSH_STRING, value->a);
+                return;
+            case IrOp::ARRAY:
+                emit(OpCode::LOAD_LOCAL, value->a);
+                return;
+            default:
+                break;
+        }
+        if (_inline[value->id]) {
+            emitTree(value);
+        } else {
+            emit(OpCode::LOAD_LOCAL, _home[value->id]);
+        }
+    }
+
+    // the instruction, after the operands it takes from the stack
+    void emitTree(const IrInstruction* instruction) {
+        for (const IrInstruction* operand : instruction->operands) {
+            emitOperand(operand);
+        }
+        // runtime errors report the line of the statement computing the value
+        _line = instruction->line;
+        switch (instruction->op) {
+            case IrOp::COPY:
+                break;
+            case IrOp::LOAD_GLOBAL:
+            case IrOp::STORE_GLOBAL:
+            case IrOp::COPY_ARRAY:
+                emit(opcodeOf(instruction), instruction->a);
+                break;
+            case IrOp::CALL:
+            case IrOp::PRINTF:
+                emit(opcodeOf(instruction), instruction->a, instruction->operands.size());
+                break;
+            default:
+                emit(opcodeOf(instruction));
+                break;
+        }
+    }
+
+    // the phis of the only successor of block take their values from it
+    void emitPhiCopies(IrBlock* block) {
+        if (block->successors.size() != 1) {
+            return;
+        }
+        IrBlock* successor = block->successors[0];
+        size_t edge = std::find(successor->predecessors.begin(), successor->predecessors.end(), block) -
+                      successor->predecessors.begin();
+
+        std::vector<const IrInstruction*> targets;
+        for (size_t i = 0; i < successor->firstNonPhi(); i++) {
+            const IrInstruction* phi = successor->instructions[i];
+            const IrInstruction* source = phi->operands[edge];
+            if (!needsHome(phi) || (!isRematerialized(source) && _home[source->id] == _home[phi->id])) {
+                continue;
+            }
+            emitOperand(source);
+            targets.push_back(phi);
+        }
+        for (auto it = targets.rbegin(); it != targets.rend(); ++it) {
+            emit(OpCode::STORE_LOCAL, _home[(*it)->id]);
+        }
+    }
+
+    void emitJump(OpCode op, IrBlock* target) {
+        _jumps.push_back({emit(op), target});
+    }
+
+    void emitFunction() {
+        info.entry = program.code.size();
+        for (const IrFunction::LocalArray& array : function.arrays) {
+            _line = array.line;
+            emit(OpCode::NEW_ARRAY_LOCAL, array.slot, array.size, static_cast<int>(array.type));
+        }
+
+        for (size_t b = 0; b < function.blocks.size(); b++) {
+            IrBlock* block = function.blocks[b];
+            IrBlock* next = b + 1 < function.blocks.size() ? function.blocks[b + 1] : nullptr;
+            _start[block] = program.code.size();
+
+            for (IrInstruction* instruction : block->instructions) {
+                if (isSilent(instruction)) {
+                    continue;
+                }
+                _line = instruction->line;
+                switch (instruction->op) {
+                    case IrOp::JUMP:
+                        emitPhiCopies(block);
+                        if (block->successors[0] != next) {
+                            emitJump(OpCode::JUMP, block->successors[0]);
+                        }
+                        break;
+                    case IrOp::BRANCH: {
+                        emitOperand(instruction->operands[0]);
+                        IrBlock* whenTrue = block->successors[0];
+                        IrBlock* whenFalse = block->successors[1];
+                        if (whenFalse == next) {
+                            emitJump(OpCode::JUMP_IF_TRUE, whenTrue);
+                        } else {
+                            emitJump(OpCode::JUMP_IF_FALSE, whenFalse);
+                            if (whenTrue != next) {
+                                emitJump(OpCode::JUMP, whenTrue);
+                            }
+                        }
+                        break;
+                    }
+                    case IrOp::RETURN:
+                        emitOperand(instruction->operands[0]);
+                        emit(OpCode::RETURN);
+                        break;
+                    default:
+                        emitTree(instruction);
+                        if (needsHome(instruction)) {
+                            emit(OpCode::STORE_LOCAL, _home[instruction->id]);
+                        } else if (instruction->hasValue()) {
+                            emit(OpCode::POP);
+                        }
+                        break;
+                }
+            }
+        }
+
+        for (auto [pc, block] : _jumps) {
+            *jumpTarget(program.code[pc]) = _start[block];
+        }
+        // a jump to a jump goes straight on to where that one goes
+        for (auto [pc, block] : _jumps) {
+            int* target = jumpTarget(program.code[pc]);
+            for (int hops = 0; hops < 8 && program.code[*target].op == OpCode::JUMP; hops++) {
+                *target = program.code[*target].a;
+            }
+        }
+
+        // every block leaves the operand stack empty, so a straight walk
+        // over the code finds its deepest point
+        int depth = 0;
+        for (size_t pc = info.entry; pc < program.code.size(); pc++) {
+            depth += stackEffect(program.code[pc]);
+            if (depth > (int)info.maxStack) {
+                info.maxStack = depth;
+            }
+        }
+    }
+};
+
+}  // namespace
+
+Program lowerIr(IrModule& module) {
+    splitCriticalEdges(module);
+    Program program;
+    program.globalCount = module.globalCount;
+    program.strings = module.strings;
+    program.formats = module.formats;
+
+    for (const auto& function : module.functions) {
+        FunctionInfo info;
+        info.name = function->name;
+        info.frameSize = function->frameSize;
+        info.parameterCount = function->parameterCount;
+        info.procedure = function->procedure;
+        program.functions.push_back(info);
+    }
+
+    // global arrays exist before main runs
+    for (const IrModule::GlobalArray& array : module.globalArrays) {
+        program.code.push_back({OpCode::NEW_ARRAY_GLOBAL, array.slot, array.size, static_cast<int>(array.type)});
+        program.lines.push_back(array.line);
+    }
+    if (module.main >= 0) {
+        program.code.push_back({OpCode::CALL, module.main, 0, 0});
+        program.code.push_back({OpCode::POP, 0, 0, 0});
+        program.lines.insert(program.lines.end(), 2, program.lines.empty() ? 0 : program.lines.back());
+    }
+    program.code.push_back({OpCode::HALT, 0, 0, 0});
+    program.lines.push_back(program.lines.empty() ? 0 : program.lines.back());
+
+    for (size_t i = 0; i < module.functions.size(); i++) {
+        if (!module.functions[i]->blocks.empty()) {
+            FunctionLowering(*module.functions[i], program, program.functions[i]).run();
+        }
+    }
+    return program;
+}
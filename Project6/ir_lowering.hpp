@@ -0,0 +1,25 @@
+#ifndef IR_LOWERING_HPP
+#define IR_LOWERING_HPP
+
+#include "bytecode.hpp"
+#include "ir.hpp"
+
+// Turns the IR back into bytecode for the VirtualMachine, laid out like the
+// Compiler lays out the AST so the superinstructions, strength reduction
+// and the JIT find the same shapes:
+//
+//   - a value used once, right where it was computed, stays on the operand
+//     stack; constants, strings and local arrays are pushed where used
+//   - every other value is stored in a slot of the frame, preferably the
+//     one of the variable it was computed for, else a slot whose values
+//     are never live at the same time as it, else a new one past the
+//     locals
+//   - the phis of a block are copied in at the end of each predecessor,
+//     all sources pushed before the first is stored; an edge from a branch
+//     gets a block of its own for them
+//   - branches fall through to the next block where they can
+//
+// Splits the critical edges of the module's functions.
+Program lowerIr(IrModule& module);
+
+#endif  // IR_LOWERING_HPP
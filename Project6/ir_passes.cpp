@@ -0,0 +1,915 @@
+#include "ir_passes.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "arithmetic.hpp"
+
+void IrPassManager::add(const std::string& name, IrPass pass) {
+    _passes.push_back({name, [pass](IrModule& module) {
+                           bool changed = false;
+                           for (auto& function : module.functions) {
+                               if (!function->blocks.empty()) {
+                                   changed = pass(*function) || changed;
+                               }
+                           }
+                           return changed;
+                       }});
+}
+
+void IrPassManager::addModulePass(const std::string& name, IrModulePass pass) {
+    _passes.push_back({name, std::move(pass)});
+}
+
+void IrPassManager::run(IrModule& module) {
+    verify(module, "construction");
+    dump(module, "as built");
+    for (const Entry& entry : _passes) {
+        entry.pass(module);
+        verify(module, entry.name);
+        dump(module, "after " + entry.name);
+    }
+}
+
+void IrPassManager::verify(const IrModule& module, const std::string& after) {
+    for (const auto& function : module.functions) {
+        try {
+            verifyIr(*function);
+        } catch (const std::logic_error& error) {
+            throw std::logic_error("broken IR after " + after + ": " + error.what());
+        }
+    }
+}
+
+void IrPassManager::dump(const IrModule& module, const std::string& heading) {
+    if (!_dump) {
+        return;
+    }
+    *_dump << "; ---- " << heading << " ----\n";
+    printIr(module, *_dump);
+    *_dump << "\n";
+}
+
+namespace {
+
+// operations computing their value from their operands alone
+bool isArithmetic(IrOp op) {
+    return (op >= IrOp::ADD && op <= IrOp::NOT);
+}
+
+// Result of op on constant operands, false when it fails at run time
+bool fold(IrOp op, int lhs, int rhs, int& result) {
+    switch (op) {
+        case IrOp::ADD:
+            result = wrappingAdd(lhs, rhs);
+            return true;
+        case IrOp::SUB:
+            result = wrappingSubtract(lhs, rhs);
+            return true;
+        case IrOp::MUL:
+            result = wrappingMultiply(lhs, rhs);
+            return true;
+        case IrOp::DIV:
+        case IrOp::MOD:
+            if (rhs == 0) {
+                return false;
+            }
+            result = op == IrOp::DIV ? wrappingDivide(lhs, rhs) : wrappingModulo(lhs, rhs);
+            return true;
+        case IrOp::POW:
+            if (powerDividesByZero(lhs, rhs)) {
+                return false;
+            }
+            result = integerPower(lhs, rhs);
+            return true;
+        case IrOp::LT:
+            result = lhs < rhs;
+            return true;
+        case IrOp::LE:
+            result = lhs <= rhs;
+            return true;
+        case IrOp::GT:
+            result = lhs > rhs;
+            return true;
+        case IrOp::GE:
+            result = lhs >= rhs;
+            return true;
+        case IrOp::EQ:
+            result = lhs == rhs;
+            return true;
+        case IrOp::NE:
+            result = lhs != rhs;
+            return true;
+        case IrOp::NOT:
+            result = !lhs;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Sparse conditional constant propagation
+class ConstantPropagation {
+   public:
+    explicit ConstantPropagation(IrFunction& function)
+        : function(function),
+          _state(function.valueCount(), Top),
+          _constant(function.valueCount(), 0),
+          _users(function.valueCount()) {}
+
+    bool run() {
+        for (IrBlock* block : function.blocks) {
+            _edges[block].assign(block->predecessors.size(), false);
+            for (IrInstruction* instruction : block->instructions) {
+                for (IrInstruction* operand : instruction->operands) {
+                    _users[operand->id].push_back(instruction);
+                }
+            }
+        }
+
+        reach(function.entry());
+        while (!_blocks.empty() || !_values.empty()) {
+            if (!_blocks.empty()) {
+                IrBlock* block = _blocks.back();
+                _blocks.pop_back();
+                for (IrInstruction* instruction : block->instructions) {
+                    visit(instruction);
+                }
+                continue;
+            }
+            IrInstruction* instruction = _values.back();
+            _values.pop_back();
+            if (instruction->block && _executable.count(instruction->block)) {
+                visit(instruction);
+            }
+        }
+        return rewrite();
+    }
+
+   private:
+    enum State { Top, Constant, Bottom };
+
+    IrFunction& function;
+    std::vector<State> _state;
+    std::vector<int> _constant;
+    std::vector<std::vector<IrInstruction*>> _users;
+    std::unordered_set<IrBlock*> _executable;
+    std::unordered_map<IrBlock*, std::vector<bool>> _edges;  // executable edge from each predecessor
+    std::vector<IrBlock*> _blocks;                           // to visit whole
+    std::vector<IrInstruction*> _values;                     // to visit again
+
+    void reach(IrBlock* block) {
+        if (_executable.insert(block).second) {
+            _blocks.push_back(block);
+        }
+    }
+
+    void markEdge(IrBlock* from, IrBlock* to) {
+        for (size_t i = 0; i < to->predecessors.size(); i++) {
+            if (to->predecessors[i] != from || _edges[to][i]) {
+                continue;
+            }
+            _edges[to][i] = true;
+            if (_executable.count(to)) {
+                // a new way in only changes the phis
+                for (size_t j = 0; j < to->firstNonPhi(); j++) {
+                    _values.push_back(to->instructions[j]);
+                }
+            }
+            reach(to);
+        }
+    }
+
+    void visit(IrInstruction* instruction) {
+        IrBlock* block = instruction->block;
+        if (instruction->op == IrOp::JUMP) {
+            markEdge(block, block->successors[0]);
+            return;
+        }
+        if (instruction->op == IrOp::BRANCH) {
+            const IrInstruction* test = instruction->operands[0];
+            if (_state[test->id] == Constant) {
+                markEdge(block, block->successors[_constant[test->id] ? 0 : 1]);
+            } else if (_state[test->id] == Bottom) {
+                markEdge(block, block->successors[0]);
+                markEdge(block, block->successors[1]);
+            }
+            return;
+        }
+        if (!instruction->hasValue()) {
+            return;
+        }
+
+        State state = Bottom;
+        int constant = 0;
+        evaluate(instruction, state, constant);
+
+        // values only move down the lattice, and a second constant is a clash
+        State old = _state[instruction->id];
+        if (old == Bottom || state == Top) {
+            return;
+        }
+        if (old == Constant) {
+            if (state == Constant && constant == _constant[instruction->id]) {
+                return;
+            }
+            state = Bottom;
+        }
+        _state[instruction->id] = state;
+        _constant[instruction->id] = constant;
+        for (IrInstruction* user : _users[instruction->id]) {
+            _values.push_back(user);
+        }
+    }
+
+    void evaluate(const IrInstruction* instruction, State& state, int& constant) {
+        switch (instruction->op) {
+            case IrOp::CONST:
+                state = Constant;
+                constant = instruction->a;
+                return;
+            case IrOp::COPY:
+                state = _state[instruction->operands[0]->id];
+                constant = _constant[instruction->operands[0]->id];
+                return;
+            case IrOp::PHI: {
+                state = Top;
+                const std::vector<bool>& edges = _edges[instruction->block];
+                for (size_t i = 0; i < instruction->operands.size(); i++) {
+                    const IrInstruction* operand = instruction->operands[i];
+                    if (!edges[i] || _state[operand->id] == Top) {
+                        continue;
+                    }
+                    if (_state[operand->id] == Bottom ||
+                        (state == Constant && constant != _constant[operand->id])) {
+                        state = Bottom;
+                        return;
+                    }
+                    state = Constant;
+                    constant = _constant[operand->id];
+                }
+                return;
+            }
+            default:
+                break;
+        }
+        if (!isArithmetic(instruction->op)) {
+            state = Bottom;
+            return;
+        }
+
+        int values[2] = {0, 0};
+        bool constants = true;
+        for (size_t i = 0; i < instruction->operands.size(); i++) {
+            State operand = _state[instruction->operands[i]->id];
+            if (operand == Top) {
+                state = Top;
+                return;
+            }
+            constants &= operand == Constant;
+            values[i] = _constant[instruction->operands[i]->id];
+        }
+        state = constants && fold(instruction->op, values[0], values[1], constant) ? Constant : Bottom;
+    }
+
+    bool rewrite() {
+        bool changed = false;
+
+        // branches on constants only go one way
+        for (IrBlock* block : function.blocks) {
+            IrInstruction* branch = block->terminator();
+            if (!_executable.count(block) || branch->op != IrOp::BRANCH) {
+                continue;
+            }
+            const IrInstruction* test = branch->operands[0];
+            if (_state[test->id] != Constant) {
+                continue;
+            }
+            IrBlock* dropped = block->successors[_constant[test->id] ? 1 : 0];
+            function.erase(branch);
+            function.append(block, function.create(IrOp::JUMP, {}, 0, 0, branch->line));
+            unlink(block, dropped);
+            changed = true;
+        }
+        changed |= removeUnreachableBlocks(function);
+
+        std::unordered_map<IrInstruction*, IrInstruction*> replacements;
+        for (IrBlock* block : function.blocks) {
+            for (size_t i = 0; i < block->instructions.size(); i++) {
+                IrInstruction* instruction = block->instructions[i];
+                if (instruction->op == IrOp::CONST || !instruction->hasValue() ||
+                    _state[instruction->id] != Constant) {
+                    continue;
+                }
+                IrInstruction* constant =
+                    function.create(IrOp::CONST, {}, _constant[instruction->id], 0, instruction->line);
+                constant->variable = instruction->variable;
+                size_t position = instruction->op == IrOp::PHI ? block->firstNonPhi() : i;
+                function.insert(block, position, constant);
+                if (position <= i) {
+                    i++;
+                }
+                replacements[instruction] = constant;
+            }
+        }
+        replaceValues(function, replacements);
+        return changed || !replacements.empty();
+    }
+};
+
+IrInstruction* resolve(const std::unordered_map<IrInstruction*, IrInstruction*>& replacements,
+                       IrInstruction* value) {
+    for (auto found = replacements.find(value); found != replacements.end(); found = replacements.find(value)) {
+        value = found->second;
+    }
+    return value;
+}
+
+}  // namespace
+
+bool propagateConstants(IrFunction& function) {
+    return ConstantPropagation(function).run();
+}
+
+bool propagateCopies(IrFunction& function) {
+    std::unordered_map<IrInstruction*, IrInstruction*> replacements;
+    std::vector<IrInstruction*> removed;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (IrBlock* block : function.blocks) {
+            for (IrInstruction* instruction : block->instructions) {
+                if (replacements.count(instruction)) {
+                    continue;
+                }
+                IrInstruction* same = nullptr;
+                if (instruction->op == IrOp::COPY) {
+                    same = resolve(replacements, instruction->operands[0]);
+                } else if (instruction->op == IrOp::PHI) {
+                    for (IrInstruction* operand : instruction->operands) {
+                        operand = resolve(replacements, operand);
+                        if (operand == instruction || operand == same) {
+                            continue;
+                        }
+                        if (same) {
+                            same = nullptr;
+                            break;
+                        }
+                        same = operand;
+                    }
+                }
+                if (same && same != instruction) {
+                    replacements[instruction] = same;
+                    removed.push_back(instruction);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    replaceValues(function, replacements);
+    for (IrInstruction* instruction : removed) {
+        function.erase(instruction);
+    }
+    return !removed.empty();
+}
+
+namespace {
+
+class CommonSubexpressions {
+   public:
+    explicit CommonSubexpressions(IrFunction& function) : function(function), dominators(function) {}
+
+    bool run() {
+        visit(function.entry());
+        replaceValues(function, _replacements);
+        for (IrInstruction* instruction : _removed) {
+            function.erase(instruction);
+        }
+        return !_removed.empty();
+    }
+
+   private:
+    using Key = std::vector<int>;
+
+    IrFunction& function;
+    IrDominators dominators;
+    std::map<Key, IrInstruction*> _available;  // pure values of the dominating blocks
+    std::unordered_map<IrInstruction*, IrInstruction*> _replacements;
+    std::vector<IrInstruction*> _removed;
+
+    static bool isPure(IrOp op) {
+        return op == IrOp::CONST || op == IrOp::STRING || op == IrOp::ARRAY || isArithmetic(op);
+    }
+
+    static Key keyOf(const IrInstruction* instruction, int a, int b) {
+        Key key{static_cast<int>(instruction->op), a, b};
+        for (const IrInstruction* operand : instruction->operands) {
+            key.push_back(operand->id);
+        }
+        IrOp op = instruction->op;
+        if ((op == IrOp::ADD || op == IrOp::MUL || op == IrOp::EQ || op == IrOp::NE) && key[3] > key[4]) {
+            std::swap(key[3], key[4]);
+        }
+        return key;
+    }
+
+    void replace(IrInstruction* instruction, IrInstruction* by) {
+        _replacements[instruction] = by;
+        _removed.push_back(instruction);
+    }
+
+    void visit(IrBlock* block) {
+        std::vector<Key> added;
+        // loads, valid until the next store or call of the block
+        std::map<Key, IrInstruction*> loaded;
+        int epoch = 0;
+
+        for (IrInstruction* instruction : block->instructions) {
+            for (IrInstruction*& operand : instruction->operands) {
+                operand = resolve(_replacements, operand);
+            }
+
+            switch (instruction->op) {
+                case IrOp::LOAD_GLOBAL:
+                case IrOp::LOAD_ELEMENT: {
+                    Key key = keyOf(instruction, instruction->a, epoch);
+                    auto found = loaded.find(key);
+                    if (found != loaded.end()) {
+                        replace(instruction, found->second);
+                    } else {
+                        loaded[key] = instruction;
+                    }
+                    continue;
+                }
+                case IrOp::STORE_GLOBAL: {
+                    // the global holds the value stored until something else writes
+                    epoch++;
+                    IrInstruction load;
+                    load.op = IrOp::LOAD_GLOBAL;
+                    loaded[keyOf(&load, instruction->a, epoch)] = instruction->operands[0];
+                    continue;
+                }
+                case IrOp::STORE_ELEMENT:
+                case IrOp::COPY_ARRAY:
+                case IrOp::CALL:
+                    epoch++;
+                    continue;
+                default:
+                    break;
+            }
+
+            if (!isPure(instruction->op)) {
+                continue;
+            }
+            Key key = keyOf(instruction, instruction->a, instruction->b);
+            auto found = _available.find(key);
+            if (found != _available.end()) {
+                replace(instruction, found->second);
+            } else {
+                _available[key] = instruction;
+                added.push_back(key);
+            }
+        }
+
+        for (IrBlock* child : dominators.children(block)) {
+            visit(child);
+        }
+        for (const Key& key : added) {
+            _available.erase(key);
+        }
+    }
+};
+
+}  // namespace
+
+bool eliminateCommonSubexpressions(IrFunction& function) {
+    return CommonSubexpressions(function).run();
+}
+
+bool eliminateDeadCode(IrFunction& function) {
+    std::unordered_set<IrInstruction*> live;
+    std::vector<IrInstruction*> worklist;
+    for (IrBlock* block : function.blocks) {
+        for (IrInstruction* instruction : block->instructions) {
+            bool needed = !instruction->hasValue() || instruction->op == IrOp::CALL || instruction->mayFail();
+            if (needed && live.insert(instruction).second) {
+                worklist.push_back(instruction);
+            }
+        }
+    }
+    while (!worklist.empty()) {
+        IrInstruction* instruction = worklist.back();
+        worklist.pop_back();
+        for (IrInstruction* operand : instruction->operands) {
+            if (live.insert(operand).second) {
+                worklist.push_back(operand);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (IrBlock* block : function.blocks) {
+        auto& instructions = block->instructions;
+        for (IrInstruction* instruction : instructions) {
+            if (!live.count(instruction)) {
+                instruction->block = nullptr;
+                changed = true;
+            }
+        }
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+                                          [](IrInstruction* instruction) { return !instruction->block; }),
+                           instructions.end());
+    }
+    return changed;
+}
+
+std::vector<bool> findSpeculatableFunctions(const IrModule& module) {
+    enum class State { Unvisited, Visiting, Done };
+    std::vector<State> state(module.functions.size(), State::Unvisited);
+    std::vector<bool> speculatable(module.functions.size(), false);
+
+    // callees are decided before their callers, a call back into a function
+    // still being looked at is recursion
+    std::function<void(size_t)> visit = [&](size_t index) {
+        state[index] = State::Visiting;
+        const IrFunction& function = *module.functions[index];
+        bool safe = !function.blocks.empty();
+
+        std::vector<IrBlock*> order = reversePostorder(function);
+        std::unordered_map<const IrBlock*, size_t> position;
+        for (size_t i = 0; i < order.size(); i++) {
+            position[order[i]] = i;
+        }
+        for (IrBlock* block : order) {
+            for (IrBlock* successor : block->successors) {
+                if (position[successor] <= position[block]) {
+                    safe = false;  // a loop, which may not end
+                }
+            }
+            for (IrInstruction* instruction : block->instructions) {
+                switch (instruction->op) {
+                    case IrOp::CONST:
+                    case IrOp::STRING:
+                    case IrOp::PARAM:
+                    case IrOp::COPY:
+                    case IrOp::PHI:
+                    case IrOp::JUMP:
+                    case IrOp::BRANCH:
+                    case IrOp::RETURN:
+                        break;
+                    case IrOp::CALL:
+                        if (state[instruction->a] == State::Unvisited) {
+                            visit(instruction->a);
+                        }
+                        safe = safe && state[instruction->a] == State::Done && speculatable[instruction->a];
+                        break;
+                    default:
+                        safe = safe && isArithmetic(instruction->op) && !instruction->mayFail();
+                        break;
+                }
+            }
+        }
+        state[index] = State::Done;
+        speculatable[index] = safe;
+    };
+    for (size_t i = 0; i < module.functions.size(); i++) {
+        if (state[i] == State::Unvisited) {
+            visit(i);
+        }
+    }
+    return speculatable;
+}
+
+namespace {
+
+// Loop-invariant code motion
+class LoopInvariantMotion {
+   public:
+    LoopInvariantMotion(IrFunction& function, const std::vector<bool>& speculatable)
+            : _function(function), _speculatable(speculatable) {}
+
+    bool run() {
+        bool changed = false;
+        for (;;) {
+            IrDominators dominators(_function);
+            std::vector<IrLoop> loops = findLoops(dominators);
+            auto missing = std::find_if(loops.begin(), loops.end(),
+                                        [](const IrLoop& loop) { return !loop.preheader(); });
+            if (missing == loops.end()) {
+                break;
+            }
+            makePreheader(*missing);
+            changed = true;
+        }
+
+        // inner loops first, what leaves one may leave the next one out too
+        IrDominators dominators(_function);
+        for (const IrLoop& loop : findLoops(dominators)) {
+            changed = hoist(loop) || changed;
+        }
+        return changed;
+    }
+
+   private:
+    // A block in front of the header that every edge from outside the loop
+    // goes through instead, the header's phis take what comes from outside
+    // from a phi there
+    void makePreheader(const IrLoop& loop) {
+        IrBlock* header = loop.header;
+        IrBlock* preheader = _function.newBlock();
+        _function.blocks.pop_back();
+        _function.blocks.insert(std::find(_function.blocks.begin(), _function.blocks.end(), header), preheader);
+
+        std::vector<size_t> outside;
+        std::vector<IrBlock*> predecessors{preheader};
+        for (size_t i = 0; i < header->predecessors.size(); i++) {
+            IrBlock* predecessor = header->predecessors[i];
+            if (loop.contains.count(predecessor)) {
+                predecessors.push_back(predecessor);
+            } else {
+                outside.push_back(i);
+                preheader->predecessors.push_back(predecessor);
+                std::replace(predecessor->successors.begin(), predecessor->successors.end(), header, preheader);
+            }
+        }
+
+        for (size_t i = 0; i < header->firstNonPhi(); i++) {
+            IrInstruction* phi = header->instructions[i];
+            std::vector<IrInstruction*> entering;
+            std::vector<IrInstruction*> operands;
+            for (size_t j = 0; j < phi->operands.size(); j++) {
+                if (std::find(outside.begin(), outside.end(), j) != outside.end()) {
+                    entering.push_back(phi->operands[j]);
+                } else {
+                    operands.push_back(phi->operands[j]);
+                }
+            }
+            IrInstruction* value = entering.front();
+            if (std::any_of(entering.begin(), entering.end(), [&](IrInstruction* other) { return other != value; })) {
+                value = _function.insert(preheader, preheader->firstNonPhi(),
+                                         _function.create(IrOp::PHI, entering, 0, 0, phi->line));
+                value->variable = phi->variable;
+            }
+            operands.insert(operands.begin(), value);
+            phi->operands = operands;
+        }
+
+        header->predecessors = predecessors;
+        preheader->successors.push_back(header);
+        int line = preheader->predecessors.front()->terminator()->line;
+        _function.append(preheader, _function.create(IrOp::JUMP, {}, 0, 0, line));
+    }
+
+    bool hoist(const IrLoop& loop) {
+        // what the loop may write: the globals stored, and everything when
+        // it calls a function that is not speculatable
+        std::unordered_set<int> written;
+        bool calls = false;
+        for (IrBlock* block : loop.blocks) {
+            for (IrInstruction* instruction : block->instructions) {
+                if (instruction->op == IrOp::STORE_GLOBAL) {
+                    written.insert(instruction->a);
+                } else if (instruction->op == IrOp::CALL && !_speculatable[instruction->a]) {
+                    calls = true;
+                }
+            }
+        }
+
+        IrBlock* preheader = loop.preheader();
+        bool changed = false;
+        for (IrBlock* block : loop.blocks) {
+            std::vector<IrInstruction*> instructions = block->instructions;
+            for (IrInstruction* instruction : instructions) {
+                if (!invariant(instruction, loop, written, calls)) {
+                    continue;
+                }
+                _function.erase(instruction);
+                _function.insert(preheader, preheader->instructions.size() - 1, instruction);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // the instruction has the same value on every iteration and computing
+    // it ahead of the loop has no effect the program could notice
+    bool invariant(const IrInstruction* instruction, const IrLoop& loop, const std::unordered_set<int>& written,
+                   bool calls) const {
+        bool movable;
+        switch (instruction->op) {
+            case IrOp::CONST:
+            case IrOp::STRING:
+            case IrOp::ARRAY:
+                movable = true;
+                break;
+            case IrOp::LOAD_GLOBAL:
+                movable = !calls && !written.count(instruction->a);
+                break;
+            case IrOp::CALL:
+                movable = _speculatable[instruction->a];
+                break;
+            default:
+                movable = isArithmetic(instruction->op) && !instruction->mayFail();
+                break;
+        }
+        return movable && std::none_of(instruction->operands.begin(), instruction->operands.end(),
+                                       [&](const IrInstruction* operand) { return loop.contains.count(operand->block); });
+    }
+
+    IrFunction& _function;
+    const std::vector<bool>& _speculatable;
+};
+
+}  // namespace
+
+bool hoistLoopInvariants(IrModule& module) {
+    std::vector<bool> speculatable = findSpeculatableFunctions(module);
+    bool changed = false;
+    for (auto& function : module.functions) {
+        if (!function->blocks.empty()) {
+            changed = LoopInvariantMotion(*function, speculatable).run() || changed;
+        }
+    }
+    return changed;
+}
+
+namespace {
+
+// instructions the copies of one loop body may add to the function
+constexpr size_t unrollBudget = 64;
+
+class LoopUnroller {
+   public:
+    explicit LoopUnroller(IrFunction& function) : _function(function) {}
+
+    bool run() {
+        // innermost loops share no blocks, unrolling one leaves the others
+        // as they were found
+        IrDominators dominators(_function);
+        std::vector<IrLoop> loops = findLoops(dominators);
+        bool changed = false;
+        for (const IrLoop& loop : loops) {
+            bool innermost = std::none_of(loops.begin(), loops.end(), [&](const IrLoop& other) {
+                return other.header != loop.header && loop.contains.count(other.header);
+            });
+            int factor = innermost ? unrollFactor(loop) : 0;
+            if (factor > 1) {
+                unroll(loop, factor);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+   private:
+    // How many iterations of a counted loop one trip through the header may
+    // run, 0 when the loop is not one or the trip count does not divide.
+    // The loop is entered from a preheader and has a single latch; control
+    // only leaves it from the header, which holds nothing but its phis,
+    // constants and i < n (or i <= n) on a phi i that starts at a constant
+    // and goes up by a constant on every iteration.
+    int unrollFactor(const IrLoop& loop) const {
+        IrBlock* header = loop.header;
+        IrBlock* preheader = loop.preheader();
+        if (!preheader || header->predecessors.size() != 2) {
+            return 0;
+        }
+        size_t entering = header->predecessors[0] == preheader ? 0 : 1;
+        IrBlock* latch = header->predecessors[1 - entering];
+        IrInstruction* branch = header->terminator();
+        if (latch->terminator()->op != IrOp::JUMP || branch->op != IrOp::BRANCH ||
+            !loop.contains.count(header->successors[0]) || loop.contains.count(header->successors[1])) {
+            return 0;
+        }
+
+        IrInstruction* test = branch->operands[0];
+        if (test->block != header || (test->op != IrOp::LT && test->op != IrOp::LE)) {
+            return 0;
+        }
+        for (size_t i = header->firstNonPhi(); i + 1 < header->instructions.size(); i++) {
+            IrInstruction* instruction = header->instructions[i];
+            if (instruction != test && instruction->op != IrOp::CONST) {
+                return 0;
+            }
+        }
+        IrInstruction* counter = test->operands[0];
+        IrInstruction* bound = test->operands[1];
+        if (counter->op != IrOp::PHI || counter->block != header || bound->op != IrOp::CONST) {
+            return 0;
+        }
+        IrInstruction* start = counter->operands[entering];
+        IrInstruction* next = counter->operands[1 - entering];
+        if (start->op != IrOp::CONST || next->op != IrOp::ADD || next->operands[0] != counter ||
+            next->operands[1]->op != IrOp::CONST || next->operands[1]->a <= 0) {
+            return 0;
+        }
+
+        // the copies read the phis as the previous copy left them, the test
+        // is only true or false in the header itself
+        size_t size = 0;
+        for (IrBlock* block : loop.blocks) {
+            if (block == header) {
+                continue;
+            }
+            for (IrBlock* successor : block->successors) {
+                if (!loop.contains.count(successor)) {
+                    return 0;
+                }
+            }
+            for (IrInstruction* instruction : block->instructions) {
+                if (std::find(instruction->operands.begin(), instruction->operands.end(), test) !=
+                    instruction->operands.end()) {
+                    return 0;
+                }
+                size += instruction->op != IrOp::PHI;
+            }
+        }
+
+        // n - i steps, rounded up; the last step, which fails the test, has
+        // to stay an int for the loop to end the same way
+        long long first = start->a;
+        long long last = (long long)bound->a + (test->op == IrOp::LE);
+        long long step = next->operands[1]->a;
+        if (first >= last) {
+            return 0;
+        }
+        long long trips = (last - first + step - 1) / step;
+        if (first + trips * step > INT_MAX) {
+            return 0;
+        }
+        if (trips % 4 == 0 && size * 3 <= unrollBudget) {
+            return 4;
+        }
+        if (trips % 2 == 0 && size <= unrollBudget) {
+            return 2;
+        }
+        return 0;
+    }
+
+    // Chains factor - 1 copies of the body behind the latch, the last one
+    // jumping back to the header. The trip count divides by factor, so the
+    // test is only needed every factor iterations.
+    void unroll(const IrLoop& loop, int factor) {
+        IrBlock* header = loop.header;
+        size_t back = loop.contains.count(header->predecessors[0]) ? 0 : 1;
+        IrBlock* latch = header->predecessors[back];
+        std::vector<IrBlock*> body(loop.blocks.begin() + 1, loop.blocks.end());
+        size_t entry = std::find(body.begin(), body.end(), header->successors[0]) - body.begin();
+        size_t end = std::find(body.begin(), body.end(), latch) - body.begin();
+        std::vector<IrInstruction*> phis(header->instructions.begin(),
+                                         header->instructions.begin() + header->firstNonPhi());
+
+        // every copy is made of the body as it was, its phis read what the
+        // previous copy sends back; the copies are chained up once all are made
+        std::vector<IrInstruction*> sent;
+        for (IrInstruction* phi : phis) {
+            sent.push_back(phi->operands[back]);
+        }
+        std::vector<IrBlock*> added;
+        std::vector<IrBlock*> entries;
+        std::vector<IrBlock*> latches{latch};
+        for (int copy = 1; copy < factor; copy++) {
+            std::unordered_map<const IrInstruction*, IrInstruction*> values;
+            for (size_t i = 0; i < phis.size(); i++) {
+                values[phis[i]] = phis[i]->operands[back];
+            }
+            std::vector<IrBlock*> copies = copyBlocks(_function, body, values);
+            for (size_t i = 0; i < phis.size(); i++) {
+                auto found = values.find(sent[i]);
+                if (found != values.end()) {
+                    phis[i]->operands[back] = found->second;
+                }
+            }
+            std::replace(copies[entry]->predecessors.begin(), copies[entry]->predecessors.end(), header,
+                         latches.back());
+            entries.push_back(copies[entry]);
+            latches.push_back(copies[end]);
+            added.insert(added.end(), copies.begin(), copies.end());
+        }
+        for (size_t i = 0; i < entries.size(); i++) {
+            std::replace(latches[i]->successors.begin(), latches[i]->successors.end(), header, entries[i]);
+        }
+        header->predecessors[back] = latches.back();
+
+        // laid out after the latch, each copy falls through into the next
+        _function.blocks.resize(_function.blocks.size() - added.size());
+        auto at = std::find(_function.blocks.begin(), _function.blocks.end(), latch) + 1;
+        _function.blocks.insert(at, added.begin(), added.end());
+    }
+
+    IrFunction& _function;
+};
+
+}  // namespace
+
+bool unrollCountedLoops(IrFunction& function) {
+    return LoopUnroller(function).run();
+}
@@ -0,0 +1,84 @@
+#ifndef IR_PASSES_HPP
+#define IR_PASSES_HPP
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+
+// A pass rewrites one function and returns whether it changed anything
+using IrPass = bool (*)(IrFunction& function);
+// A pass that works across functions, such as the inliner
+using IrModulePass = std::function<bool(IrModule& module)>;
+
+// Runs passes in the order they were added over every function of a module,
+// checking the IR with verifyIr after each one. With a dump stream the
+// module is printed as built and again after every pass, so what a pass did
+// shows up in a diff of two neighbouring listings.
+class IrPassManager {
+   public:
+    explicit IrPassManager(std::ostream* dump = nullptr) : _dump(dump) {}
+
+    void add(const std::string& name, IrPass pass);
+    void addModulePass(const std::string& name, IrModulePass pass);
+    void run(IrModule& module);
+
+   private:
+    struct Entry {
+        std::string name;
+        IrModulePass pass;
+    };
+
+    void verify(const IrModule& module, const std::string& after);
+    void dump(const IrModule& module, const std::string& heading);
+
+    std::ostream* _dump;
+    std::vector<Entry> _passes;
+};
+
+// Sparse conditional constant propagation (Wegman and Zadeck): values that
+// are constant on every path that can run become CONSTs and branches on
+// constants become jumps, the blocks only they reached are removed. A
+// division by zero and 0 to a negative power are left for the program to
+// fail on.
+bool propagateConstants(IrFunction& function);
+
+// Replaces every use of a COPY, and of a phi all of whose operands are one
+// value, by that value
+bool propagateCopies(IrFunction& function);
+
+// Common subexpression elimination over the dominator tree: a pure
+// operation already computed by a dominating instruction is replaced by it.
+// Loads of globals and elements only reuse a load (or the global stored)
+// earlier in the same block with no store or call between them.
+bool eliminateCommonSubexpressions(IrFunction& function);
+
+// Removes instructions whose values are never used, dead phi cycles
+// included. Stores, calls, printf, and the operations that can fail at run
+// time (division by something that may be 0, checked element loads) stay.
+bool eliminateDeadCode(IrFunction& function);
+
+// Functions a call of which can be made ahead of time or left out: they
+// compute their value from their arguments alone, without loops, recursion
+// or anything that can fail, so they always return. Indexed like the
+// functions of the module.
+std::vector<bool> findSpeculatableFunctions(const IrModule& module);
+
+// Loop-invariant code motion: gives every loop a preheader and moves into
+// it what has the same value on every iteration, innermost loops first.
+// That is arithmetic that cannot fail on values from outside the loop,
+// loads of globals the loop stores to nowhere (and calls nothing that
+// might), and calls of speculatable functions.
+bool hoistLoopInvariants(IrModule& module);
+
+// Unrolls innermost counted loops, for (i = a; i < n; i = i + k) with
+// constants a, n and k > 0 and no other way out than the test, by 4 or 2
+// when that divides the number of iterations and the body is small: copies
+// of the body follow each other, and only the last one goes back to the
+// test. A loop without a preheader, which hoistLoopInvariants gives every
+// loop, is left alone.
+bool unrollCountedLoops(IrFunction& function);
+
+#endif  // IR_PASSES_HPP
@@ -0,0 +1,665 @@
+#include "jit.hpp"
+
+#include <cstring>
+
+#if CS460_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if CS460_JIT
+
+// Byte-level emitter for the handful of x86-64 instructions the templates use
+class Assembler {
+   public:
+    std::vector<uint8_t> bytes;
+
+    size_t size() const {
+        return bytes.size();
+    }
+
+    void emit(std::initializer_list<uint8_t> code) {
+        bytes.insert(bytes.end(), code);
+    }
+
+    void emit32(int32_t value) {
+        uint8_t raw[4];
+        std::memcpy(raw, &value, 4);
+        bytes.insert(bytes.end(), raw, raw + 4);
+    }
+
+    void emit64(uint64_t value) {
+        uint8_t raw[8];
+        std::memcpy(raw, &value, 8);
+        bytes.insert(bytes.end(), raw, raw + 8);
+    }
+
+    void patch32(size_t at, int32_t value) {
+        std::memcpy(&bytes[at], &value, 4);
+    }
+
+    // sp manipulation, rbx is the operand stack pointer
+    void push() {
+        emit({0x48, 0x83, 0xC3, 0x04});  // add rbx, 4
+    }
+    void pop() {
+        emit({0x48, 0x83, 0xEB, 0x04});  // sub rbx, 4
+    }
+
+    // mov dword [rbx], imm32; add rbx, 4
+    void pushConstant(int32_t value) {
+        emit({0xC7, 0x03});
+        emit32(value);
+        push();
+    }
+
+    // mov eax, [r12 + slot * 4]
+    void loadLocal(int slot) {
+        emit({0x41, 0x8B, 0x84, 0x24});
+        emit32(slot * 4);
+    }
+    // mov [r12 + slot * 4], eax
+    void storeLocal(int slot) {
+        emit({0x41, 0x89, 0x84, 0x24});
+        emit32(slot * 4);
+    }
+    // mov eax, [r13 + slot * 4]
+    void loadGlobal(int slot) {
+        emit({0x41, 0x8B, 0x85});
+        emit32(slot * 4);
+    }
+    // mov [r13 + slot * 4], eax
+    void storeGlobal(int slot) {
+        emit({0x41, 0x89, 0x85});
+        emit32(slot * 4);
+    }
+
+    // mov [rbx], eax; add rbx, 4
+    void pushEax() {
+        emit({0x89, 0x03});
+        push();
+    }
+    // sub rbx, 4; mov eax, [rbx]
+    void popEax() {
+        pop();
+        emit({0x8B, 0x03});
+    }
+    // sub rbx, 4; mov ecx, [rbx]
+    void popEcx() {
+        pop();
+        emit({0x8B, 0x0B});
+    }
+    // mov eax, [rbx - 4]
+    void topToEax() {
+        emit({0x8B, 0x43, 0xFC});
+    }
+    // mov [rbx - 4], eax
+    void eaxToTop() {
+        emit({0x89, 0x43, 0xFC});
+    }
+
+    // setcc al; movzx eax, al; mov [rbx - 4], eax
+    void setTop(uint8_t setcc) {
+        emit({0x0F, setcc, 0xC0, 0x0F, 0xB6, 0xC0});
+        eaxToTop();
+    }
+
+    // jmp/jcc rel32 to a position patched later, returns where the rel32 is
+    size_t jump() {
+        emit({0xE9});
+        emit32(0);
+        return size() - 4;
+    }
+    size_t jumpIf(uint8_t jcc) {
+        emit({0x0F, jcc});
+        emit32(0);
+        return size() - 4;
+    }
+};
+
+// condition codes, as the second byte of setcc (0x9X) and jcc (0x8X)
+enum Condition : uint8_t {
+    Below = 0x2,
+    Above = 0x7,
+    Equal = 0x4,
+    NotEqual = 0x5,
+    Less = 0xC,
+    GreaterEqual = 0xD,
+    LessEqual = 0xE,
+    Greater = 0xF,
+};
+
+uint8_t setcc(Condition condition) {
+    return 0x90 | condition;
+}
+
+uint8_t jcc(Condition condition) {
+    return 0x80 | condition;
+}
+
+Condition negate(Condition condition) {
+    return static_cast<Condition>(condition ^ 1);
+}
+
+Condition conditionOf(OpCode op) {
+    switch (op) {
+        case OpCode::LT:
+        case OpCode::JUMP_UNLESS_LOCAL_LT:
+        case OpCode::LOOP_LT_LOCAL:
+            return Less;
+        case OpCode::LE:
+        case OpCode::JUMP_UNLESS_LOCAL_LE:
+        case OpCode::LOOP_LE_LOCAL:
+            return LessEqual;
+        case OpCode::GT:
+        case OpCode::JUMP_UNLESS_LOCAL_GT:
+            return Greater;
+        case OpCode::GE:
+        case OpCode::JUMP_UNLESS_LOCAL_GE:
+            return GreaterEqual;
+        case OpCode::EQ:
+        case OpCode::JUMP_UNLESS_LOCAL_EQ:
+            return Equal;
+        default:
+            return NotEqual;
+    }
+}
+
+// Emits one function. Native code starts with a prologue that saves the
+// callee-saved registers, loads rbx/r12/r13 from the JitContext in rdi (kept
+// in r14) and jumps to context->entry. Right after it comes the entry native
+// callers use, which saves the same registers and takes the new frame in rdi
+// and its stack pointer in rsi.
+//
+// Natively called functions return their result in eax and edx = 0, or
+// edx = 1 when an error is pending.
+class FunctionEmitter {
+   public:
+    // direct holds the native entry of every function that can be called
+    // without a CallFrame, nullptr for the others
+    FunctionEmitter(const Program& program, const JitRuntime& runtime, size_t function, size_t first,
+                    size_t last, const std::vector<const void*>& direct, bool selfDirect)
+        : program(program),
+          runtime(runtime),
+          function(function),
+          first(first),
+          last(last),
+          direct(direct),
+          selfDirect(selfDirect) {}
+
+    Assembler assembler;
+    std::vector<uint32_t> offsets;
+
+    size_t nativeEntry{0};
+
+    void emit() {
+        prologue();
+        nativeEntry = assembler.size();
+        pushRegisters();
+        assembler.emit({0x49, 0x89, 0xFC});  // mov r12, rdi
+        assembler.emit({0x48, 0x89, 0xF3});  // mov rbx, rsi
+
+        for (size_t pc = first; pc < last; pc++) {
+            offsets.push_back(assembler.size());
+            instruction(program.code[pc]);
+        }
+
+        // runtime functions return nullptr when an error is pending
+        size_t errorExit = assembler.size();
+        assembler.emit({0x31, 0xC0});  // xor eax, eax
+        assembler.emit({0xBA});        // mov edx, 1
+        assembler.emit32(1);
+        epilogue();
+
+        for (const Fixup& fixup : fixups) {
+            size_t target = fixup.pc == errorPc ? errorExit : fixup.pc == entryPc ? nativeEntry : offsets[fixup.pc - first];
+            assembler.patch32(fixup.at, target - (fixup.at + 4));
+        }
+    }
+
+   private:
+    struct Fixup {
+        size_t at;  // position of the rel32
+        size_t pc;  // instruction jumped to
+    };
+    static constexpr size_t errorPc = static_cast<size_t>(-1);
+    static constexpr size_t entryPc = static_cast<size_t>(-2);  // this function's native entry
+
+    const Program& program;
+    const JitRuntime& runtime;
+    size_t function;
+    size_t first;
+    size_t last;
+    const std::vector<const void*>& direct;
+    bool selfDirect;
+    std::vector<Fixup> fixups;
+
+    void pushRegisters() {
+        Assembler& a = assembler;
+        a.emit({0x53});        // push rbx
+        a.emit({0x41, 0x54});  // push r12
+        a.emit({0x41, 0x55});  // push r13
+        a.emit({0x41, 0x56});  // push r14
+        a.emit({0x41, 0x57});  // push r15, keeps rsp 16-byte aligned
+    }
+
+    void prologue() {
+        Assembler& a = assembler;
+        pushRegisters();
+        a.emit({0x49, 0x89, 0xFE});  // mov r14, rdi
+        a.emit({0x49, 0x8B, 0x1E});  // mov rbx, [r14 + sp]
+        a.emit({0x4D, 0x8B, 0x66, static_cast<uint8_t>(offsetof(JitContext, locals))});   // mov r12, [r14 + locals]
+        a.emit({0x4D, 0x8B, 0x6E, static_cast<uint8_t>(offsetof(JitContext, globals))});  // mov r13, [r14 + globals]
+        a.emit({0x41, 0xFF, 0x66, static_cast<uint8_t>(offsetof(JitContext, entry))});    // jmp [r14 + entry]
+    }
+
+    void epilogue() {
+        Assembler& a = assembler;
+        a.emit({0x41, 0x5F});  // pop r15
+        a.emit({0x41, 0x5E});  // pop r14
+        a.emit({0x41, 0x5D});  // pop r13
+        a.emit({0x41, 0x5C});  // pop r12
+        a.emit({0x5B});        // pop rbx
+        a.emit({0xC3});        // ret
+    }
+
+    void jumpTo(size_t at, size_t pc) {
+        fixups.push_back({at, pc});
+    }
+
+    // calls function(context, ip, sp), continuing with the stack pointer it
+    // returns or leaving through the error exit
+    void callRuntime(JitRuntimeFunction function, const Instruction& instruction) {
+        Assembler& a = assembler;
+        a.emit({0x4D, 0x89, 0x66, static_cast<uint8_t>(offsetof(JitContext, locals))});  // mov [r14 + locals], r12
+        a.emit({0x4C, 0x89, 0xF7});  // mov rdi, r14
+        a.emit({0x48, 0xBE});        // mov rsi, imm64
+        a.emit64(reinterpret_cast<uint64_t>(&instruction));
+        a.emit({0x48, 0x89, 0xDA});  // mov rdx, rbx
+        a.emit({0x48, 0xB8});        // mov rax, imm64
+        a.emit64(reinterpret_cast<uint64_t>(function));
+        a.emit({0xFF, 0xD0});        // call rax
+        a.emit({0x48, 0x85, 0xC0});  // test rax, rax
+        jumpTo(a.jumpIf(jcc(Equal)), errorPc);
+        a.emit({0x48, 0x89, 0xC3});  // mov rbx, rax
+    }
+
+    // Calls a compiled function without a CallFrame while there is native
+    // stack and VM stack left, through runtime.call otherwise
+    void call(const Instruction& instruction) {
+        Assembler& a = assembler;
+        size_t callee = instruction.a;
+        bool self = callee == function;
+        if (self ? !selfDirect : direct[callee] == nullptr) {
+            callRuntime(runtime.call, instruction);
+            return;
+        }
+        const FunctionInfo& info = program.functions[callee];
+        int32_t arguments = -4 * instruction.b;
+
+        a.emit({0x49, 0x3B, 0x66, static_cast<uint8_t>(offsetof(JitContext, stackLimit))});  // cmp rsp, [r14 + stackLimit]
+        size_t noStack = a.jumpIf(jcc(Below));
+        a.emit({0x48, 0x8D, 0xBB});  // lea rdi, [rbx + arguments]
+        a.emit32(arguments);
+        a.emit({0x48, 0x8D, 0xB7});  // lea rsi, [rdi + (frameSize + maxStack) * 4]
+        a.emit32((info.frameSize + info.maxStack) * 4);
+        a.emit({0x49, 0x3B, 0x76, static_cast<uint8_t>(offsetof(JitContext, stackEnd))});  // cmp rsi, [r14 + stackEnd]
+        size_t overflow = a.jumpIf(jcc(Above));
+
+        // the arguments already sit in the first slots of the new frame
+        for (size_t slot = instruction.b; slot < info.frameSize; slot++) {
+            a.emit({0xC7, 0x87});  // mov dword [rdi + slot * 4], 0
+            a.emit32(slot * 4);
+            a.emit32(0);
+        }
+        a.emit({0x48, 0x8D, 0xB7});  // lea rsi, [rdi + frameSize * 4]
+        a.emit32(info.frameSize * 4);
+        if (self) {
+            a.emit({0xE8});  // call rel32
+            a.emit32(0);
+            jumpTo(a.size() - 4, entryPc);
+        } else {
+            a.emit({0x48, 0xB8});  // mov rax, imm64
+            a.emit64(reinterpret_cast<uint64_t>(direct[callee]));
+            a.emit({0xFF, 0xD0});  // call rax
+        }
+        a.emit({0x85, 0xD2});  // test edx, edx
+        jumpTo(a.jumpIf(jcc(NotEqual)), errorPc);
+        a.emit({0x89, 0x83});  // mov [rbx + arguments], eax
+        a.emit32(arguments);
+        a.emit({0x48, 0x8D, 0x9B});  // lea rbx, [rbx + arguments + 4]
+        a.emit32(arguments + 4);
+        size_t done = a.jump();
+
+        // runtime.call enters the interpreter, or reports the overflow
+        a.patch32(noStack, a.size() - (noStack + 4));
+        a.patch32(overflow, a.size() - (overflow + 4));
+        callRuntime(runtime.call, instruction);
+        a.patch32(done, a.size() - (done + 4));
+    }
+
+    // Starts the function over in its frame, like the VM: the arguments on
+    // top of the stack become the first slots, the other slots are zeroed
+    void tailCall(const Instruction& instruction) {
+        Assembler& a = assembler;
+        const FunctionInfo& info = program.functions[function];
+        int32_t arguments = -4 * instruction.b;
+        for (int slot = 0; slot < instruction.b; slot++) {
+            a.emit({0x8B, 0x83});  // mov eax, [rbx + arguments + slot * 4]
+            a.emit32(arguments + slot * 4);
+            a.storeLocal(slot);
+        }
+        for (size_t slot = instruction.b; slot < info.frameSize; slot++) {
+            a.emit({0x41, 0xC7, 0x84, 0x24});  // mov dword [r12 + slot * 4], 0
+            a.emit32(slot * 4);
+            a.emit32(0);
+        }
+        a.emit({0x49, 0x8D, 0x9C, 0x24});  // lea rbx, [r12 + frameSize * 4]
+        a.emit32(info.frameSize * 4);
+        jumpTo(a.jump(), first);
+    }
+
+    void instruction(const Instruction& instruction) {
+        Assembler& a = assembler;
+
+        switch (instruction.op) {
+            case OpCode::PUSH:
+            case OpCode::PUSH_STRING:
+                a.pushConstant(instruction.a);
+                break;
+            case OpCode::LOAD_LOCAL:
+                a.loadLocal(instruction.a);
+                a.pushEax();
+                break;
+            case OpCode::STORE_LOCAL:
+                a.popEax();
+                a.storeLocal(instruction.a);
+                break;
+            case OpCode::LOAD_GLOBAL:
+                a.loadGlobal(instruction.a);
+                a.pushEax();
+                break;
+            case OpCode::STORE_GLOBAL:
+                a.popEax();
+                a.storeGlobal(instruction.a);
+                break;
+            case OpCode::ADD:
+                a.popEcx();
+                a.emit({0x01, 0x4B, 0xFC});  // add [rbx - 4], ecx
+                break;
+            case OpCode::SUB:
+                a.popEcx();
+                a.emit({0x29, 0x4B, 0xFC});  // sub [rbx - 4], ecx
+                break;
+            case OpCode::MUL:
+                a.popEcx();
+                a.topToEax();
+                a.emit({0x0F, 0xAF, 0xC1});  // imul eax, ecx
+                a.eaxToTop();
+                break;
+            case OpCode::DIV:
+            case OpCode::MOD: {
+                a.popEcx();
+                a.emit({0x85, 0xC9});  // test ecx, ecx
+                size_t nonZero = a.jumpIf(jcc(NotEqual));
+                callRuntime(runtime.divByZero, instruction);
+                a.patch32(nonZero, a.size() - (nonZero + 4));
+                // idiv traps on INT_MIN / -1, which wraps like wrappingDivide
+                a.emit({0x83, 0xF9, 0xFF});  // cmp ecx, -1
+                size_t notMinusOne = a.jumpIf(jcc(NotEqual));
+                if (instruction.op == OpCode::DIV) {
+                    a.emit({0xF7, 0x5B, 0xFC});  // neg dword [rbx - 4]
+                } else {
+                    a.emit({0xC7, 0x43, 0xFC, 0x00, 0x00, 0x00, 0x00});  // mov dword [rbx - 4], 0
+                }
+                size_t done = a.jump();
+                a.patch32(notMinusOne, a.size() - (notMinusOne + 4));
+                a.topToEax();
+                a.emit({0x99});        // cdq
+                a.emit({0xF7, 0xF9});  // idiv ecx
+                if (instruction.op == OpCode::DIV) {
+                    a.eaxToTop();
+                } else {
+                    a.emit({0x89, 0x53, 0xFC});  // mov [rbx - 4], edx
+                }
+                a.patch32(done, a.size() - (done + 4));
+                break;
+            }
+            case OpCode::LT:
+            case OpCode::LE:
+            case OpCode::GT:
+            case OpCode::GE:
+            case OpCode::EQ:
+            case OpCode::NE:
+                a.popEcx();
+                a.topToEax();
+                a.emit({0x39, 0xC8});  // cmp eax, ecx
+                a.setTop(setcc(conditionOf(instruction.op)));
+                break;
+            case OpCode::NOT:
+                a.topToEax();
+                a.emit({0x85, 0xC0});  // test eax, eax
+                a.setTop(setcc(Equal));
+                break;
+            case OpCode::JUMP:
+                jumpTo(a.jump(), instruction.a);
+                break;
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::JUMP_IF_TRUE:
+                a.popEax();
+                a.emit({0x85, 0xC0});  // test eax, eax
+                jumpTo(a.jumpIf(jcc(instruction.op == OpCode::JUMP_IF_FALSE ? Equal : NotEqual)), instruction.a);
+                break;
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+                a.topToEax();
+                a.emit({0x85, 0xC0});  // test eax, eax
+                jumpTo(a.jumpIf(jcc(Equal)), instruction.a);
+                a.pop();
+                break;
+            case OpCode::JUMP_IF_TRUE_OR_POP: {
+                a.topToEax();
+                a.emit({0x85, 0xC0});  // test eax, eax
+                size_t zero = a.jumpIf(jcc(Equal));
+                a.emit({0xC7, 0x43, 0xFC});  // mov dword [rbx - 4], 1
+                a.emit32(1);
+                jumpTo(a.jump(), instruction.a);
+                a.patch32(zero, a.size() - (zero + 4));
+                a.pop();
+                break;
+            }
+            case OpCode::POP:
+                a.pop();
+                break;
+            case OpCode::DUP:
+                a.topToEax();
+                a.pushEax();
+                break;
+            case OpCode::RETURN:
+                a.topToEax();
+                a.emit({0x31, 0xD2});  // xor edx, edx
+                epilogue();
+                break;
+            case OpCode::CALL:
+                call(instruction);
+                break;
+            case OpCode::TAIL_CALL:
+                tailCall(instruction);
+                break;
+            case OpCode::CALL_MEMOIZED:
+                // the table lives in the VM, the callee's frame is entered
+                // there on a miss
+                callRuntime(runtime.call, instruction);
+                break;
+            case OpCode::INC_LOCAL:
+                a.emit({0x41, 0x81, 0x84, 0x24});  // add dword [r12 + slot * 4], imm32
+                a.emit32(instruction.a * 4);
+                a.emit32(instruction.b);
+                break;
+            case OpCode::INC_GLOBAL:
+                a.emit({0x41, 0x81, 0x85});  // add dword [r13 + slot * 4], imm32
+                a.emit32(instruction.a * 4);
+                a.emit32(instruction.b);
+                break;
+            case OpCode::JUMP_UNLESS_LOCAL_LT:
+            case OpCode::JUMP_UNLESS_LOCAL_LE:
+            case OpCode::JUMP_UNLESS_LOCAL_GT:
+            case OpCode::JUMP_UNLESS_LOCAL_GE:
+            case OpCode::JUMP_UNLESS_LOCAL_EQ:
+            case OpCode::JUMP_UNLESS_LOCAL_NE:
+                a.emit({0x41, 0x81, 0xBC, 0x24});  // cmp dword [r12 + slot * 4], imm32
+                a.emit32(instruction.a * 4);
+                a.emit32(instruction.b);
+                jumpTo(a.jumpIf(jcc(negate(conditionOf(instruction.op)))), instruction.c);
+                break;
+            case OpCode::LOOP_LT_LOCAL:
+            case OpCode::LOOP_LE_LOCAL:
+                // the counter is stepped and tested in eax
+                a.loadLocal(instruction.a);
+                a.emit({0xFF, 0xC0});  // inc eax
+                a.storeLocal(instruction.a);
+                a.emit({0x3D});  // cmp eax, imm32
+                a.emit32(instruction.b);
+                jumpTo(a.jumpIf(jcc(conditionOf(instruction.op))), instruction.c);
+                break;
+            case OpCode::MUL_ADD_LOCAL:
+                a.popEcx();
+                a.emit({0x41, 0x69, 0x84, 0x24});  // imul eax, [r12 + slot * 4], imm32
+                a.emit32(instruction.a * 4);
+                a.emit32(instruction.b);
+                a.emit({0x01, 0xC8});  // add eax, ecx
+                a.storeLocal(instruction.a);
+                break;
+            case OpCode::MUL_POW2:
+                a.emit({0xC1, 0x63, 0xFC, static_cast<uint8_t>(instruction.a)});  // shl dword [rbx - 4], k
+                break;
+            case OpCode::DIV_POW2:
+            case OpCode::MOD_POW2:
+                // ecx = 2^k - 1 for a negative dividend, else 0
+                a.topToEax();
+                a.emit({0x89, 0xC1});  // mov ecx, eax
+                a.emit({0xC1, 0xF9, 0x1F});  // sar ecx, 31
+                a.emit({0xC1, 0xE9, static_cast<uint8_t>(32 - instruction.a)});  // shr ecx, 32 - k
+                if (instruction.op == OpCode::DIV_POW2) {
+                    a.emit({0x01, 0xC8});  // add eax, ecx
+                    a.emit({0xC1, 0xF8, static_cast<uint8_t>(instruction.a)});  // sar eax, k
+                } else {
+                    a.emit({0x01, 0xC1});  // add ecx, eax
+                    a.emit({0x81, 0xE1});  // and ecx, -2^k
+                    a.emit32(-(1 << instruction.a));
+                    a.emit({0x29, 0xC8});  // sub eax, ecx
+                }
+                a.eaxToTop();
+                break;
+            default:
+                // arrays and printf stay in C++
+                callRuntime(runtime.slowPath, instruction);
+                break;
+        }
+    }
+};
+
+#endif  // CS460_JIT
+
+}  // namespace
+
+Jit::Jit(const Program& program, JitRuntime runtime)
+    : program(program), runtime(runtime), functions(program.functions.size()) {}
+
+Jit::~Jit() {
+#if CS460_JIT
+    for (NativeFunction& function : functions) {
+        if (function.code) {
+            munmap(function.code, function.size);
+        }
+    }
+#endif
+}
+
+bool Jit::available() {
+    return CS460_JIT;
+}
+
+bool Jit::compile(size_t function) {
+#if CS460_JIT
+    if (functions[function].code) {
+        return true;
+    }
+
+    // a function's code runs up to the next function's entry, they are laid
+    // out one after the other
+    size_t first = program.functions[function].entry;
+    size_t last = program.code.size();
+    for (const FunctionInfo& other : program.functions) {
+        if (other.entry > first && other.entry < last) {
+            last = other.entry;
+        }
+    }
+
+    std::vector<const void*> direct(functions.size(), nullptr);
+    for (size_t other = 0; other < functions.size(); other++) {
+        if (functions[other].code && functions[other].direct) {
+            direct[other] = functions[other].code + functions[other].nativeEntry;
+        }
+    }
+
+    // local arrays are dropped with the CallFrame, functions that make any
+    // are always called through the runtime
+    bool selfDirect = true;
+    for (size_t pc = first; pc < last; pc++) {
+        if (program.code[pc].op == OpCode::NEW_ARRAY_LOCAL) {
+            selfDirect = false;
+        }
+    }
+
+    FunctionEmitter emitter(program, runtime, function, first, last, direct, selfDirect);
+    emitter.emit();
+    const std::vector<uint8_t>& bytes = emitter.assembler.bytes;
+
+    // written while writable, then switched to executable
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = (bytes.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    std::memcpy(memory, bytes.data(), bytes.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return false;
+    }
+
+    NativeFunction& native = functions[function];
+    native.code = static_cast<uint8_t*>(memory);
+    native.size = size;
+    native.bytes = bytes.size();
+    native.first = first;
+    native.offsets = std::move(emitter.offsets);
+    native.nativeEntry = emitter.nativeEntry;
+    native.direct = selfDirect;
+    return true;
+#else
+    (void)function;
+    return false;
+#endif
+}
+
+bool Jit::compiled(size_t function) const {
+    return functions[function].code != nullptr;
+}
+
+const void* Jit::address(size_t function, size_t pc) const {
+    const NativeFunction& native = functions[function];
+    return native.code + native.offsets[pc - native.first];
+}
+
+int Jit::invoke(size_t function, JitContext& context) const {
+    using Entry = int (*)(JitContext*);
+    Entry entry = reinterpret_cast<Entry>(functions[function].code);
+    return entry(&context);
+}
+
+size_t Jit::codeSize(size_t function) const {
+    return functions[function].bytes;
+}
@@ -0,0 +1,87 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bytecode.hpp"
+
+// The template JIT only emits x86-64 code for the System V ABI, define
+// CS460_NO_JIT to leave it out of the build
+#if defined(__x86_64__) && defined(__linux__) && !defined(CS460_NO_JIT)
+#define CS460_JIT 1
+#else
+#define CS460_JIT 0
+#endif
+
+// State a native function runs with. Native code works on the
+// VirtualMachine's own stack, so the interpreter and native code can hand
+// frames to each other at any jump target.
+struct JitContext {
+    int* sp;                 // next free operand slot
+    int* locals;             // first slot of the running frame
+    int* globals;
+    const void* entry;       // native address execution starts at
+    void* vm;                // passed back to the runtime functions
+    int* stackEnd;           // end of the VM's stack
+    const void* stackLimit;  // native calls go through runtime.call below this rsp
+};
+
+// Everything native code does not do itself goes through these. Each one
+// gets the instruction and the operand stack pointer and returns the new
+// stack pointer, or nullptr when an error is pending, which unwinds the
+// native code back to the VirtualMachine.
+using JitRuntimeFunction = int* (*)(JitContext* context, const Instruction* ip, int* sp);
+
+struct JitRuntime {
+    JitRuntimeFunction call;       // CALL
+    JitRuntimeFunction slowPath;   // arrays, printf
+    JitRuntimeFunction divByZero;  // records the error, always returns nullptr
+};
+
+// Translates a compiled function's instructions into native code, one fixed
+// template per instruction. Operands and locals stay in the VM's memory,
+// rbx holds the operand stack pointer, r12 the locals and r13 the globals.
+// Calls to functions that are already compiled and have no local arrays are
+// native calls, every other call goes through runtime.call.
+class Jit {
+   public:
+    Jit(const Program& program, JitRuntime runtime);
+    ~Jit();
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    static bool available();
+
+    // false when the JIT is not built in
+    bool compile(size_t function);
+    bool compiled(size_t function) const;
+
+    // native address of the instruction at pc of a compiled function
+    const void* address(size_t function, size_t pc) const;
+
+    // runs a compiled function from context.entry until it returns, the
+    // result is the value it returns
+    int invoke(size_t function, JitContext& context) const;
+
+    // bytes of native code emitted for a compiled function
+    size_t codeSize(size_t function) const;
+
+   private:
+    struct NativeFunction {
+        uint8_t* code{nullptr};
+        size_t size{0};                 // mapped, whole pages
+        size_t bytes{0};                // emitted
+        size_t first{0};                // pc of the function's first instruction
+        std::vector<uint32_t> offsets;  // native offset of each instruction
+        size_t nativeEntry{0};          // entry native callers use
+        bool direct{false};             // callable without a CallFrame
+    };
+
+    const Program& program;
+    JitRuntime runtime;
+    std::vector<NativeFunction> functions;
+};
+
+#endif  // JIT_HPP
@@ -7,9 +7,11 @@
 #include <stdexcept>
 
 #include "ast.hpp"
+#include "constant_folding.hpp"
 #include "cst.hpp"
 #include "executor.hpp"
 #include "interpreter.hpp"
+#include "options.hpp"
 #include "symbol_table.hpp"
 #include "token_enum.hpp"
 #include "token_node.hpp"
@@ -266,13 +268,94 @@ void writeAST(ASTree &ast, const std::string &filename) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: tokenizer <input_file>\n";
+    const char *usage =
+        "Usage: program.exe [--engine=ast|bytecode|closure] [--dispatch=switch|threaded] "
+        "[--no-constant-folding] [--dump-optimized-ast] [--no-ir] [--dump-ir] [--inline-threshold=N] [--report-inlining] [--no-licm] [--no-unroll] [--no-superinstructions] [--no-strength-reduction] "
+        "[--no-jit] [--jit-threshold=N] [--trace-tiering] "
+        "[--report-bounds-checks] [--no-tail-calls] [--memoize] [--report-memoization] "
+        "[--emit-c=FILE] [--build-c=EXE] [--emit-asm=FILE] [--build-asm=EXE] <input_file>\n";
+    Options options;
+    std::string inputFile;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--engine=ast") {
+            options.engine = Engine::Ast;
+        } else if (arg == "--engine=bytecode") {
+            options.engine = Engine::Bytecode;
+        } else if (arg == "--engine=closure") {
+            options.engine = Engine::Closure;
+        } else if (arg == "--dispatch=switch") {
+            options.dispatch = Dispatch::Switch;
+        } else if (arg == "--dispatch=threaded") {
+            options.dispatch = Dispatch::Threaded;
+        } else if (arg == "--no-constant-folding") {
+            options.constantFolding = false;
+        } else if (arg == "--dump-optimized-ast") {
+            options.dumpOptimizedAst = true;
+        } else if (arg == "--no-ir") {
+            options.ir = false;
+        } else if (arg == "--dump-ir") {
+            options.dumpIr = true;
+        } else if (arg == "--no-superinstructions") {
+            options.superinstructions = false;
+        } else if (arg == "--no-strength-reduction") {
+            options.strengthReduction = false;
+        } else if (arg == "--no-jit") {
+            options.jit = false;
+        } else if (arg == "--trace-tiering") {
+            options.traceTiering = true;
+        } else if (arg == "--report-bounds-checks") {
+            options.reportBoundsChecks = true;
+        } else if (arg == "--no-tail-calls") {
+            options.tailCalls = false;
+        } else if (arg == "--memoize") {
+            options.memoize = true;
+        } else if (arg == "--report-memoization") {
+            options.reportMemoization = true;
+        } else if (arg.rfind("--emit-c=", 0) == 0 && arg.size() > 9) {
+            options.emitC = arg.substr(9);
+        } else if (arg.rfind("--build-c=", 0) == 0 && arg.size() > 10) {
+            options.buildC = arg.substr(10);
+        } else if (arg.rfind("--emit-asm=", 0) == 0 && arg.size() > 11) {
+            options.emitAsm = arg.substr(11);
+        } else if (arg.rfind("--build-asm=", 0) == 0 && arg.size() > 12) {
+            options.buildAsm = arg.substr(12);
+        } else if (arg == "--report-inlining") {
+            options.reportInlining = true;
+        } else if (arg == "--no-licm") {
+            options.licm = false;
+        } else if (arg == "--no-unroll") {
+            options.unroll = false;
+        } else if (arg.rfind("--jit-threshold=", 0) == 0) {
+            std::string value = arg.substr(std::string("--jit-threshold=").size());
+            if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << usage;
+                return 1;
+            }
+            options.jitThreshold = std::stoi(value);
+        } else if (arg.rfind("--inline-threshold=", 0) == 0) {
+            std::string value = arg.substr(std::string("--inline-threshold=").size());
+            if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << usage;
+                return 1;
+            }
+            options.inlineThreshold = std::stoi(value);
+        } else if (arg.rfind("--", 0) == 0 || !inputFile.empty()) {
+            std::cerr << usage;
+            return 1;
+        } else {
+            inputFile = arg;
+        }
+    }
+
+    if (inputFile.empty()) {
+        std::cerr << usage;
         return 1;
     }
 
     try {
-        Tokenizer tokenizer(argv[1]);
+        Tokenizer tokenizer(inputFile);
         std::vector<Token> tokens = tokenizer.tokenize();
 
         if (!tokenizer.errorMessage.empty()) {
@@ -290,8 +373,14 @@ int main(int argc, char *argv[]) {
             writeAST(aTree, "ast_output.txt");
 
             Interpreter interpreter(&aTree, &symbolTable);
+            if (options.constantFolding) {
+                ConstantFolder(interpreter).run();
+            }
+            if (options.dumpOptimizedAst) {
+                writeAST(aTree, "optimized_ast_output.txt");
+            }
 
-            Executor executor(&aTree, &symbolTable, interpreter);
+            Executor executor(&aTree, &symbolTable, interpreter, options);
             executor.execute();
 
 
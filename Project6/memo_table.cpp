@@ -0,0 +1,32 @@
+#include "memo_table.hpp"
+
+#include <algorithm>
+
+MemoTable::MemoTable(size_t arity) : _arity(arity), _entries(capacity * (arity + 2), 0) {}
+
+const int* MemoTable::find(const int* args) {
+    const int* entry = &_entries[entryOf(args) * (_arity + 2)];
+    if (entry[0] && std::equal(args, args + _arity, entry + 1)) {
+        _hits++;
+        return entry + 1 + _arity;
+    }
+    _misses++;
+    return nullptr;
+}
+
+void MemoTable::remember(const int* args, int result) {
+    int* entry = &_entries[entryOf(args) * (_arity + 2)];
+    _size += !entry[0];
+    entry[0] = 1;
+    std::copy(args, args + _arity, entry + 1);
+    entry[1 + _arity] = result;
+}
+
+// FNV-1a over the arguments, folded down to an entry
+size_t MemoTable::entryOf(const int* args) const {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < _arity; i++) {
+        hash = (hash ^ static_cast<uint32_t>(args[i])) * 1099511628211ull;
+    }
+    return (hash ^ (hash >> 32)) & (capacity - 1);
+}
@@ -0,0 +1,40 @@
+#ifndef MEMO_TABLE_HPP
+#define MEMO_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Results of one pure function, keyed by its arguments. Both engines keep
+// one per memoized function. The table is direct-mapped with a fixed number
+// of entries, each holding the arguments and result of one call: a new
+// result replaces whatever hashed to the same entry, so memory stays
+// bounded however many different arguments the function sees.
+class MemoTable {
+   public:
+    static constexpr size_t capacity = 4096;  // entries, a power of two
+
+    explicit MemoTable(size_t arity);
+
+    // the result remembered for args (arity values), nullptr when there is
+    // none; counts a hit or a miss
+    const int* find(const int* args);
+    void remember(const int* args, int result);
+
+    size_t arity() const { return _arity; }
+    uint64_t hits() const { return _hits; }
+    uint64_t misses() const { return _misses; }
+    size_t size() const { return _size; }  // entries filled
+
+   private:
+    size_t entryOf(const int* args) const;
+
+    size_t _arity;
+    // per entry: 1 once filled, the arguments, the result
+    std::vector<int> _entries;
+    uint64_t _hits{0};
+    uint64_t _misses{0};
+    size_t _size{0};
+};
+
+#endif  // MEMO_TABLE_HPP
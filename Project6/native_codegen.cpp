@@ -0,0 +1,1641 @@
+#include "native_codegen.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "arithmetic.hpp"
+
+namespace {
+
+// Everything the generated functions call, in front of them in every file
+const char* runtime = R"(# Runtime: Linux system calls only, no libc.
+#
+# Arrays are handles into rt_table, whose entries hold the address of the
+# elements, their count as a dword and the element type as a dword. The
+# string constants come first. Elements are taken from a heap every call
+# with local arrays cuts back to where it found it on return. A copy keeps
+# the size an array was declared with.
+#
+# The routines the generated code calls keep every register but rax, rcx,
+# rdx, r10 and r11, which are never handed out to values.
+
+    .equ RT_CHAR, 0
+    .equ RT_BOOL, 1
+    .equ RT_INT, 2
+    .equ RT_OUT_SIZE, 65536
+    .equ RT_TABLE_SIZE, 1 << 30
+    .equ RT_HEAP_SIZE, 1 << 34
+
+    .bss
+    .align 16
+rt_out:             .zero RT_OUT_SIZE
+rt_error_text:      .zero 256
+rt_out_length:      .zero 8
+rt_line_buffered:   .zero 8
+rt_table:           .zero 8
+rt_count:           .zero 8
+rt_heap_top:        .zero 8
+rt_heap_end:        .zero 8
+rt_stack_limit:     .zero 8
+
+    .section .rodata
+rt_msg_prefix:      .asciz "Error on line "
+rt_msg_separator:   .asciz ": "
+rt_msg_index:       .asciz "index "
+rt_msg_range:       .asciz " is out of range for an array of "
+rt_msg_elements:    .asciz " elements."
+rt_msg_fit:         .asciz " elements do not fit in an array of "
+rt_msg_not_array:   .asciz "value is not an array."
+rt_msg_division:    .asciz "division by zero."
+rt_msg_types:       .asciz "arrays of different types."
+rt_msg_stack:       .asciz "stack overflow."
+rt_msg_memory:      .asciz "out of memory."
+rt_hex_digits:      .ascii "0123456789abcdef"
+
+    .text
+
+# Calls fail once the stack is below rt_stack_limit, an eighth of the
+# limit is left for the error of the deepest call. Output is written line
+# by line to a terminal.
+rt_start:
+    sub rsp, 16
+    mov eax, 97                         # getrlimit(RLIMIT_STACK)
+    mov edi, 3
+    mov rsi, rsp
+    syscall
+    mov rcx, 8 << 20
+    test rax, rax
+    jnz 1f
+    mov rcx, [rsp]
+    cmp rcx, -1
+    jne 1f
+    mov rcx, 64 << 20
+1:  add rsp, 16
+    mov rax, rcx
+    shr rax, 3
+    sub rcx, rax
+    mov rax, rsp
+    sub rax, rcx
+    jae 2f
+    xor eax, eax
+2:  mov [rip+rt_stack_limit], rax
+
+    sub rsp, 64
+    mov eax, 16                         # ioctl(1, TCGETS)
+    mov edi, 1
+    mov esi, 0x5401
+    mov rdx, rsp
+    syscall
+    add rsp, 64
+    test rax, rax
+    sete BYTE PTR [rip+rt_line_buffered]
+
+    mov rsi, RT_TABLE_SIZE
+    call rt_map
+    mov [rip+rt_table], rax
+    movabs rsi, RT_HEAP_SIZE
+    call rt_map
+    mov [rip+rt_heap_top], rax
+    add rax, rsi
+    mov [rip+rt_heap_end], rax
+    ret
+
+# rsi bytes of zeroed memory, taken from the system as they are touched
+rt_map:
+    mov eax, 9                          # mmap
+    xor edi, edi
+    mov edx, 3                          # PROT_READ | PROT_WRITE
+    mov r10d, 0x4022                    # MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+    mov r8, -1
+    xor r9d, r9d
+    syscall
+    cmp rax, -4096
+    ja rt_out_of_memory
+    ret
+
+rt_exit:
+    call rt_flush
+    mov eax, 231                        # exit_group(0)
+    xor edi, edi
+    syscall
+
+# writes rdx bytes from rsi to the file edi, all of them
+rt_write_fd:
+    test rdx, rdx
+    jz 2f
+1:  mov eax, 1
+    syscall
+    cmp rax, -4                         # EINTR
+    je 1b
+    test rax, rax
+    jle 2f
+    add rsi, rax
+    sub rdx, rax
+    jnz 1b
+2:  ret
+
+# writes out the output buffer, keeping rcx and r10 too
+rt_flush:
+    push rcx
+    push rsi
+    push rdi
+    mov edi, 1
+    lea rsi, [rip+rt_out]
+    mov rdx, [rip+rt_out_length]
+    call rt_write_fd
+    mov QWORD PTR [rip+rt_out_length], 0
+    pop rdi
+    pop rsi
+    pop rcx
+    ret
+
+# prints rcx bytes from r10
+rt_write:
+    push rsi
+    push rdi
+    mov rax, [rip+rt_out_length]
+    lea rdx, [rax+rcx]
+    cmp rdx, RT_OUT_SIZE
+    jbe 1f
+    call rt_flush
+    cmp rcx, RT_OUT_SIZE
+    jbe 1f
+    mov edi, 1
+    mov rsi, r10
+    mov rdx, rcx
+    call rt_write_fd
+    jmp 2f
+1:  mov rdi, [rip+rt_out_length]
+    add [rip+rt_out_length], rcx
+    lea rax, [rip+rt_out]
+    add rdi, rax
+    mov rsi, r10
+    rep movsb
+2:  pop rdi
+    pop rsi
+    ret
+
+# prints the character al
+rt_putc:
+    mov rdx, [rip+rt_out_length]
+    cmp rdx, RT_OUT_SIZE
+    jb 1f
+    push rax
+    call rt_flush
+    pop rax
+    xor edx, edx
+1:  lea r11, [rip+rt_out]
+    mov [r11+rdx], al
+    inc rdx
+    mov [rip+rt_out_length], rdx
+    ret
+
+rt_newline:
+    mov eax, 10
+    call rt_putc
+    cmp BYTE PTR [rip+rt_line_buffered], 0
+    jne rt_flush
+    ret
+
+# the digits of eax end at r10, which is left on the first of them
+rt_format_int:
+    movsxd rax, eax
+    mov r11, rax
+    test rax, rax
+    jns 1f
+    neg rax
+1:  mov ecx, 10
+2:  xor edx, edx
+    div rcx
+    add dl, '0'
+    dec r10
+    mov [r10], dl
+    test rax, rax
+    jnz 2b
+    test r11, r11
+    jns 3f
+    dec r10
+    mov BYTE PTR [r10], '-'
+3:  ret
+
+# prints eax in decimal
+rt_print_int:
+    sub rsp, 24
+    lea r10, [rsp+24]
+    call rt_format_int
+    lea rcx, [rsp+24]
+    sub rcx, r10
+    call rt_write
+    add rsp, 24
+    ret
+
+# prints eax as unsigned, in lowercase hexadecimal
+rt_print_hex:
+    sub rsp, 24
+    lea r10, [rsp+24]
+    lea r11, [rip+rt_hex_digits]
+1:  mov edx, eax
+    and edx, 15
+    movzx edx, BYTE PTR [r11+rdx]
+    dec r10
+    mov [r10], dl
+    shr eax, 4
+    jnz 1b
+    lea rcx, [rsp+24]
+    sub rcx, r10
+    call rt_write
+    add rsp, 24
+    ret
+
+# What %s prints of the array eax: up to the first NUL, or to a literal \x0
+# of a string constant. edx is the line of the printf.
+rt_print_string:
+    cmp eax, DWORD PTR [rip+rt_count]
+    jae 5f
+    mov r11, [rip+rt_table]
+    shl rax, 4
+    add r11, rax
+    cmp DWORD PTR [r11+12], RT_INT
+    je 4f
+    mov r10, [r11]
+    mov edx, DWORD PTR [r11+8]
+    xor ecx, ecx
+1:  cmp rcx, rdx
+    jae 3f
+    movzx eax, BYTE PTR [r10+rcx]
+    test al, al
+    jz 3f
+    cmp al, '\\'
+    jne 2f
+    lea rax, [rcx+2]
+    cmp rax, rdx
+    jae 2f
+    cmp BYTE PTR [r10+rcx+1], 'x'
+    jne 2f
+    cmp BYTE PTR [r10+rcx+2], '0'
+    je 3f
+2:  inc rcx
+    jmp 1b
+3:  jmp rt_write
+4:  ret
+5:  mov edi, edx
+    lea rsi, [rip+rt_msg_not_array]
+    jmp rt_error
+
+# eax to the power ecx, wrapping around at 32 bits. A negative exponent is
+# 1 / eax ^ -ecx rounded toward zero. edx is the line.
+rt_pow:
+    test ecx, ecx
+    jns 4f
+    test eax, eax
+    jnz 1f
+    mov edi, edx
+    lea rsi, [rip+rt_msg_division]
+    jmp rt_error
+1:  cmp eax, 1
+    je 3f
+    cmp eax, -1
+    jne 2f
+    test ecx, 1
+    jnz 3f
+    mov eax, 1
+    ret
+2:  xor eax, eax
+3:  ret
+4:  mov r10d, eax
+    mov eax, 1
+5:  test ecx, ecx
+    jz 3b
+    test ecx, 1
+    jz 6f
+    imul eax, r10d
+6:  imul r10d, r10d
+    shr ecx, 1
+    jmp 5b
+
+# a new array of ecx zeroed elements of type eax, its handle in eax
+rt_new_array:
+    push rdi
+    mov r10d, eax
+    mov edx, ecx
+    mov r11d, ecx
+    cmp r10d, RT_INT
+    jne 1f
+    shl r11, 2
+1:  add r11, 8
+    and r11, -8
+    mov rdi, [rip+rt_heap_top]
+    lea rax, [rdi+r11]
+    cmp rax, [rip+rt_heap_end]
+    ja rt_out_of_memory
+    mov [rip+rt_heap_top], rax
+    push rdi
+    mov rcx, r11
+    xor eax, eax
+    rep stosb
+    pop rdi
+    mov rax, [rip+rt_count]
+    cmp rax, RT_TABLE_SIZE / 16
+    jae rt_out_of_memory
+    mov r11, rax
+    shl r11, 4
+    add r11, [rip+rt_table]
+    mov [r11], rdi
+    mov [r11+8], edx
+    mov [r11+12], r10d
+    inc QWORD PTR [rip+rt_count]
+    pop rdi
+    ret
+
+# the string constant of ecx chars at r10, as the next array
+rt_string:
+    mov rax, [rip+rt_count]
+    mov r11, rax
+    shl r11, 4
+    add r11, [rip+rt_table]
+    mov [r11], r10
+    mov [r11+8], ecx
+    mov DWORD PTR [r11+12], RT_CHAR
+    inc rax
+    mov [rip+rt_count], rax
+    ret
+
+# Copies the elements of the array ecx into the array eax and zeroes the
+# rest, eax keeps its size. edx is the line.
+rt_copy:
+    push rbx
+    push rsi
+    push rdi
+    push r8
+    mov edi, edx
+    cmp eax, DWORD PTR [rip+rt_count]
+    jae 8f
+    cmp ecx, DWORD PTR [rip+rt_count]
+    jae 8f
+    mov rbx, [rip+rt_table]
+    shl rax, 4
+    shl rcx, 4
+    lea r10, [rbx+rcx]
+    add rbx, rax
+    xor ecx, ecx
+    cmp DWORD PTR [rbx+12], RT_INT
+    sete cl
+    xor edx, edx
+    cmp DWORD PTR [r10+12], RT_INT
+    sete dl
+    cmp ecx, edx
+    jne 9f
+    mov r8d, DWORD PTR [r10+8]
+    mov edx, DWORD PTR [rbx+8]
+    cmp r8d, edx
+    ja rt_size_error
+    cmp rbx, r10
+    je 7f
+    add ecx, ecx                        # elements are 1 << cl bytes
+    mov rdx, r8
+    shl rdx, cl
+    mov r8d, DWORD PTR [rbx+8]
+    shl r8, cl
+    mov rsi, [r10]
+    mov rdi, [rbx]
+    mov rcx, rdx
+    rep movsb
+    mov rcx, r8
+    sub rcx, rdx
+    xor eax, eax
+    rep stosb
+7:  pop r8
+    pop rdi
+    pop rsi
+    pop rbx
+    ret
+8:  lea rsi, [rip+rt_msg_not_array]
+    jmp rt_error
+9:  lea rsi, [rip+rt_msg_types]
+    jmp rt_error
+
+rt_out_of_memory:
+    xor edi, edi
+    lea rsi, [rip+rt_msg_memory]
+    jmp rt_error
+
+# Prints "Error on line edi: rsi" to stderr, after everything printed so
+# far, and exits with 1
+rt_error:
+    mov r12, rsi
+    mov r13d, edi
+    call rt_flush
+    lea rbx, [rip+rt_error_text]
+    call rt_error_start
+    mov rsi, r12
+    call rt_append
+    jmp rt_error_end
+
+# the error of r8d elements copied into an array of edx, on line edi
+rt_size_error:
+    mov r13d, edi
+    mov r14d, r8d
+    mov r15d, edx
+    call rt_flush
+    lea rbx, [rip+rt_error_text]
+    call rt_error_start
+    mov eax, r14d
+    call rt_append_int
+    lea rsi, [rip+rt_msg_fit]
+    call rt_append
+    mov eax, r15d
+    call rt_append_int
+    lea rsi, [rip+rt_msg_elements]
+    call rt_append
+    jmp rt_error_end
+
+# the error of index edx outside the array whose entry is at r11, on line edi
+rt_range_error:
+    mov r13d, edi
+    mov r14d, edx
+    mov r15d, DWORD PTR [r11+8]
+    call rt_flush
+    lea rbx, [rip+rt_error_text]
+    call rt_error_start
+    lea rsi, [rip+rt_msg_index]
+    call rt_append
+    mov eax, r14d
+    call rt_append_int
+    lea rsi, [rip+rt_msg_range]
+    call rt_append
+    mov eax, r15d
+    call rt_append_int
+    lea rsi, [rip+rt_msg_elements]
+    call rt_append
+rt_error_end:
+    mov BYTE PTR [rbx], 10
+    inc rbx
+    mov edi, 2
+    lea rsi, [rip+rt_error_text]
+    mov rdx, rbx
+    sub rdx, rsi
+    call rt_write_fd
+    mov eax, 231                        # exit_group(1)
+    mov edi, 1
+    syscall
+
+# "Error on line r13d: " at rbx
+rt_error_start:
+    lea rsi, [rip+rt_msg_prefix]
+    call rt_append
+    mov eax, r13d
+    call rt_append_int
+    lea rsi, [rip+rt_msg_separator]
+    jmp rt_append
+
+# copies the text at rsi, up to its NUL, to rbx onwards
+rt_append:
+    mov al, [rsi]
+    test al, al
+    jz 1f
+    mov [rbx], al
+    inc rsi
+    inc rbx
+    jmp rt_append
+1:  ret
+
+# eax in decimal at rbx onwards
+rt_append_int:
+    sub rsp, 24
+    lea r10, [rsp+24]
+    call rt_format_int
+    lea rcx, [rsp+24]
+1:  mov al, [r10]
+    mov [rbx], al
+    inc r10
+    inc rbx
+    cmp r10, rcx
+    jb 1b
+    add rsp, 24
+    ret
+)";
+
+// Registers handed out to values, saved by every function using any of
+// them. rax, rcx, rdx, r10 and r11 are left to the code of single
+// instructions.
+const char* const registers32[] = {"ebx", "r12d", "r13d", "r14d", "r15d", "esi", "edi", "r8d", "r9d"};
+const char* const registers64[] = {"rbx", "r12", "r13", "r14", "r15", "rsi", "rdi", "r8", "r9"};
+constexpr int registerCount = 9;
+
+// Set of values, by id
+class ValueSet {
+   public:
+    explicit ValueSet(size_t size = 0) : _words((size + 63) / 64, 0) {}
+
+    void insert(int id) { _words[id / 64] |= uint64_t(1) << (id % 64); }
+    void erase(int id) { _words[id / 64] &= ~(uint64_t(1) << (id % 64)); }
+
+    // adds other, true when that added anything
+    bool merge(const ValueSet& other) {
+        bool changed = false;
+        for (size_t i = 0; i < _words.size(); i++) {
+            uint64_t merged = _words[i] | other._words[i];
+            changed |= merged != _words[i];
+            _words[i] = merged;
+        }
+        return changed;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < _words.size(); i++) {
+            for (uint64_t word = _words[i]; word; word &= word - 1) {
+                f(static_cast<int>(i * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+   private:
+    std::vector<uint64_t> _words;
+};
+
+// an operand wherever used
+bool isRematerialized(const IrInstruction* value) {
+    return value->op == IrOp::CONST || value->op == IrOp::STRING || value->op == IrOp::ARRAY;
+}
+
+bool isComparison(IrOp op) {
+    return op == IrOp::LT || op == IrOp::LE || op == IrOp::GT || op == IrOp::GE || op == IrOp::EQ ||
+           op == IrOp::NE;
+}
+
+// condition code of a comparison, or of its opposite
+const char* conditionOf(IrOp op, bool negated = false) {
+    switch (op) {
+        case IrOp::LT:
+            return negated ? "ge" : "l";
+        case IrOp::LE:
+            return negated ? "g" : "le";
+        case IrOp::GT:
+            return negated ? "le" : "g";
+        case IrOp::GE:
+            return negated ? "l" : "ge";
+        case IrOp::EQ:
+            return negated ? "ne" : "e";
+        default:
+            return negated ? "e" : "ne";
+    }
+}
+
+bool isMemory(const std::string& operand) {
+    return operand.find('[') != std::string::npos;
+}
+
+bool isImmediate(const std::string& operand) {
+    return !operand.empty() && (operand[0] == '-' || (operand[0] >= '0' && operand[0] <= '9'));
+}
+
+// text as the inside of an .ascii string
+std::string quoted(const std::string& text) {
+    static const char digits[] = "01234567";
+    std::string result;
+    for (unsigned char c : text) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+            result += c;
+        } else if (c >= 0x20 && c < 0x7f) {
+            result += c;
+        } else {
+            result += '\\';
+            result += digits[c >> 6];
+            result += digits[(c >> 3) & 7];
+            result += digits[c & 7];
+        }
+    }
+    return result;
+}
+
+int typeCode(ElementType type) {
+    switch (type) {
+        case ElementType::Int:
+            return 2;
+        case ElementType::Bool:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Text shared by all functions: the literal pieces of the printf formats
+struct ModuleText {
+    IrModule& module;
+    std::vector<std::string> literals;  // .Ltext<i>
+    std::unordered_map<std::string, int> literalIndex;
+
+    int literal(const std::string& text) {
+        auto [it, inserted] = literalIndex.emplace(text, (int)literals.size());
+        if (inserted) {
+            literals.push_back(text);
+        }
+        return it->second;
+    }
+};
+
+class FunctionCodegen {
+   public:
+    FunctionCodegen(ModuleText& text, IrFunction& function, int index, bool tailCalls, std::string& out)
+        : text(text),
+          function(function),
+          index(index),
+          out(out),
+          _uses(function.valueCount(), 0),
+          _fused(function.valueCount(), false),
+          _start(function.valueCount(), INT_MAX),
+          _end(function.valueCount(), -1),
+          _location(function.valueCount()) {
+        _allowTailCalls = tailCalls && function.arrays.empty();
+    }
+
+    // the function's critical edges are split already
+    void run() {
+        _order = reversePostorder(function);
+        for (IrBlock* block : _order) {
+            for (IrInstruction* instruction : block->instructions) {
+                for (IrInstruction* operand : instruction->operands) {
+                    _uses[operand->id]++;
+                }
+            }
+        }
+        for (IrBlock* block : _order) {
+            findFusedComparison(block);
+            findTailCall(block);
+        }
+        computeLiveness();
+        buildIntervals();
+        allocateRegisters();
+        layOutFrame();
+        emitFunction();
+    }
+
+   private:
+    // Where a value is between its definition and its last use
+    struct Location {
+        enum class Kind { None, Register, Frame, Argument };
+        Kind kind{Kind::None};
+        int index{0};  // register, frame slot or argument
+    };
+
+    ModuleText& text;
+    IrFunction& function;
+    int index;
+    std::string& out;
+
+    bool _allowTailCalls;
+    std::vector<IrBlock*> _order;  // reverse postorder, also the layout
+    std::vector<int> _uses;
+    std::vector<bool> _fused;  // a comparison the branch after it makes
+    std::unordered_set<const IrInstruction*> _tailCalls;
+    std::unordered_map<IrBlock*, ValueSet> _liveIn;  // not counting the block's phis
+    std::unordered_map<const IrInstruction*, int> _position;
+    std::vector<int> _start;  // first and last position each value is live at
+    std::vector<int> _end;
+    std::vector<Location> _location;
+    std::unordered_map<const IrInstruction*, std::vector<const IrInstruction*>> _phiPartners;
+    int _frameSlots{0};                   // 8 bytes each, under the saved registers
+    std::vector<int> _saved;              // registers handed out
+    std::unordered_map<int, int> _arraySlot;  // frame slot of each local array slot
+    int _arrayMark{-1};                   // frame slots of the array count and heap top on entry
+    size_t _outgoing{0};                  // most arguments of a call
+    std::map<std::pair<std::string, int>, std::string> _errors;  // (message, line) to its label
+    std::vector<std::string> _errorCode;                        // after the function
+    int _labels{0};
+
+    bool needsLocation(const IrInstruction* value) const {
+        return value->hasValue() && _uses[value->id] > 0 && !isRematerialized(value) && !_fused[value->id];
+    }
+
+    // A comparison used only by the branch right after it leaves its
+    // result in the flags
+    void findFusedComparison(IrBlock* block) {
+        const std::vector<IrInstruction*>& instructions = block->instructions;
+        IrInstruction* terminator = instructions.back();
+        if (terminator->op != IrOp::BRANCH || instructions.size() < 2) {
+            return;
+        }
+        IrInstruction* condition = terminator->operands[0];
+        if (isComparison(condition->op) && _uses[condition->id] == 1 &&
+            instructions[instructions.size() - 2] == condition) {
+            _fused[condition->id] = true;
+        }
+    }
+
+    // A call of the function itself that only its return follows, right
+    // away or in a block holding nothing else; in a procedure it does not
+    // matter what is returned
+    void findTailCall(IrBlock* block) {
+        const std::vector<IrInstruction*>& instructions = block->instructions;
+        if (!_allowTailCalls || instructions.size() < 2) {
+            return;
+        }
+        IrInstruction* call = instructions[instructions.size() - 2];
+        if (call->op != IrOp::CALL || call->a != index) {
+            return;
+        }
+        IrInstruction* next = instructions.back();
+        if (next->op == IrOp::JUMP) {
+            IrBlock* successor = block->successors[0];
+            if (successor->firstNonPhi() != 0) {
+                return;
+            }
+            next = successor->instructions.front();
+        }
+        if (next->op == IrOp::RETURN && (function.procedure || next->operands[0] == call)) {
+            _tailCalls.insert(call);
+        }
+    }
+
+    // the values an instruction reads, through a comparison it makes itself
+    void valuesRead(const IrInstruction* instruction, std::vector<const IrInstruction*>& values) const {
+        for (const IrInstruction* operand : instruction->operands) {
+            if (isRematerialized(operand)) {
+                continue;
+            }
+            if (_fused[operand->id]) {
+                valuesRead(operand, values);
+            } else {
+                values.push_back(operand);
+            }
+        }
+    }
+
+    size_t edgeIndex(IrBlock* from, IrBlock* to) const {
+        return std::find(to->predecessors.begin(), to->predecessors.end(), from) - to->predecessors.begin();
+    }
+
+    // Values live at the end of the block, which includes those its
+    // successors' phis take from it
+    ValueSet liveOut(IrBlock* block) {
+        ValueSet live(function.valueCount());
+        for (IrBlock* successor : block->successors) {
+            live.merge(_liveIn[successor]);
+            size_t edge = edgeIndex(block, successor);
+            for (size_t i = 0; i < successor->firstNonPhi(); i++) {
+                const IrInstruction* phi = successor->instructions[i];
+                const IrInstruction* operand = phi->operands[edge];
+                if (needsLocation(phi) && needsLocation(operand)) {
+                    live.insert(operand->id);
+                }
+            }
+        }
+        return live;
+    }
+
+    // Walks block backwards from live, the values live after it, calling
+    // defined and used with each value and its position. Leaves live as the
+    // values live after the phis.
+    template <typename Defined, typename Used>
+    void walkBackwards(IrBlock* block, ValueSet& live, Defined defined, Used used) {
+        std::vector<const IrInstruction*> values;
+        for (size_t i = block->instructions.size(); i-- > block->firstNonPhi();) {
+            const IrInstruction* instruction = block->instructions[i];
+            if (isRematerialized(instruction) || _fused[instruction->id]) {
+                continue;
+            }
+            if (needsLocation(instruction)) {
+                live.erase(instruction->id);
+                defined(instruction);
+            }
+            values.clear();
+            valuesRead(instruction, values);
+            for (const IrInstruction* value : values) {
+                live.insert(value->id);
+                used(value, instruction);
+            }
+        }
+    }
+
+    void computeLiveness() {
+        for (IrBlock* block : _order) {
+            _liveIn[block] = ValueSet(function.valueCount());
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto it = _order.rbegin(); it != _order.rend(); ++it) {
+                IrBlock* block = *it;
+                ValueSet live = liveOut(block);
+                walkBackwards(
+                    block, live, [](const IrInstruction*) {}, [](const IrInstruction*, const IrInstruction*) {});
+                for (size_t i = 0; i < block->firstNonPhi(); i++) {
+                    live.erase(block->instructions[i]->id);
+                }
+                changed |= _liveIn[block].merge(live);
+            }
+        }
+    }
+
+    void extend(const IrInstruction* value, int position) {
+        _start[value->id] = std::min(_start[value->id], position);
+        _end[value->id] = std::max(_end[value->id], position);
+    }
+
+    // Numbers the instructions in layout order, an even position each: its
+    // operands are read there and its value written one later, so a value
+    // may take the register of an operand it outlives. A value's interval
+    // runs from the first to the last position it is live at.
+    void buildIntervals() {
+        int position = 0;
+        for (IrBlock* block : _order) {
+            for (IrInstruction* instruction : block->instructions) {
+                _position[instruction] = position;
+                position += 2;
+            }
+        }
+
+        for (IrBlock* block : _order) {
+            int first = _position[block->instructions.front()];
+            int last = _position[block->instructions.back()];
+            ValueSet live = liveOut(block);
+            live.forEach([&](int id) {
+                _start[id] = std::min(_start[id], last + 1);
+                _end[id] = std::max(_end[id], last + 1);
+            });
+            walkBackwards(
+                block, live, [&](const IrInstruction* value) { extend(value, _position[value] + 1); },
+                [&](const IrInstruction* value, const IrInstruction* user) { extend(value, _position[user]); });
+            _liveIn[block].forEach([&](int id) {
+                _start[id] = std::min(_start[id], first);
+                _end[id] = std::max(_end[id], first);
+            });
+            // A phi is written at the end of every predecessor, but its
+            // interval starts with the block: whatever else holds its
+            // location there is dead on that path or one of the values the
+            // phis take, which the parallel move reads before writing
+            for (size_t i = 0; i < block->firstNonPhi(); i++) {
+                IrInstruction* phi = block->instructions[i];
+                if (needsLocation(phi)) {
+                    extend(phi, first);
+                    for (IrInstruction* operand : phi->operands) {
+                        _phiPartners[phi].push_back(operand);
+                        _phiPartners[operand].push_back(phi);
+                    }
+                }
+            }
+        }
+
+        // the parameters are all loaded on entry
+        for (IrInstruction* instruction : function.entry()->instructions) {
+            if (instruction->op == IrOp::PARAM && needsLocation(instruction)) {
+                extend(instruction, 0);
+            }
+        }
+    }
+
+    // Linear scan: values in the order their intervals start take a free
+    // register, or the one of the value live the longest when that outlives
+    // them, which moves to the frame instead
+    void allocateRegisters() {
+        std::vector<int> values;
+        for (size_t id = 0; id < _start.size(); id++) {
+            if (_end[id] >= 0) {
+                values.push_back((int)id);
+            }
+        }
+        std::sort(values.begin(), values.end(),
+                  [&](int a, int b) { return _start[a] != _start[b] ? _start[a] < _start[b] : a < b; });
+
+        std::vector<const IrInstruction*> byId(function.valueCount(), nullptr);
+        for (IrBlock* block : _order) {
+            for (const IrInstruction* instruction : block->instructions) {
+                byId[instruction->id] = instruction;
+            }
+        }
+
+        std::vector<int> active;
+        bool free[registerCount];
+        std::fill(free, free + registerCount, true);
+        bool used[registerCount] = {};
+        for (int value : values) {
+            for (size_t i = 0; i < active.size();) {
+                if (_end[active[i]] < _start[value]) {
+                    free[_location[active[i]].index] = true;
+                    active.erase(active.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+
+            // the register of a phi it meets, so the copy goes away
+            int chosen = -1;
+            for (const IrInstruction* partner : _phiPartners[byId[value]]) {
+                const Location& location = _location[partner->id];
+                if (chosen < 0 && location.kind == Location::Kind::Register && free[location.index]) {
+                    chosen = location.index;
+                }
+            }
+            for (int r = 0; r < registerCount && chosen < 0; r++) {
+                if (free[r]) {
+                    chosen = r;
+                }
+            }
+            if (chosen < 0) {
+                auto longest = std::max_element(active.begin(), active.end(),
+                                                [&](int a, int b) { return _end[a] < _end[b]; });
+                if (_end[*longest] <= _end[value]) {
+                    toFrame(byId[value]);
+                    continue;
+                }
+                chosen = _location[*longest].index;
+                toFrame(byId[*longest]);
+                active.erase(longest);
+            }
+            _location[value] = {Location::Kind::Register, chosen};
+            free[chosen] = false;
+            used[chosen] = true;
+            active.push_back(value);
+        }
+
+        for (int r = 0; r < registerCount; r++) {
+            if (used[r]) {
+                _saved.push_back(r);
+            }
+        }
+    }
+
+    // a parameter stays where its caller put it
+    void toFrame(const IrInstruction* value) {
+        if (value->op == IrOp::PARAM) {
+            _location[value->id] = {Location::Kind::Argument, value->a};
+        } else {
+            _location[value->id] = {Location::Kind::Frame, _frameSlots++};
+        }
+    }
+
+    void layOutFrame() {
+        for (const IrFunction::LocalArray& array : function.arrays) {
+            _arraySlot[array.slot] = _frameSlots++;
+        }
+        if (!function.arrays.empty()) {
+            _arrayMark = _frameSlots;
+            _frameSlots += 2;
+        }
+        for (IrBlock* block : _order) {
+            for (const IrInstruction* instruction : block->instructions) {
+                if (instruction->op == IrOp::CALL) {
+                    _outgoing = std::max(_outgoing, instruction->operands.size());
+                }
+                // a slot the builder did not declare an array for
+                bool local = instruction->op == IrOp::ARRAY || (instruction->op == IrOp::COPY_ARRAY && !instruction->b);
+                if (local && instruction->a >= (int)function.parameterCount && !_arraySlot.count(instruction->a)) {
+                    _arraySlot[instruction->a] = _frameSlots++;
+                }
+            }
+        }
+    }
+
+    std::string frameSlot(int slot, const char* size = "DWORD") const {
+        return std::string(size) + " PTR [rbp-" + std::to_string(8 * (_saved.size() + 1 + slot)) + "]";
+    }
+
+    std::string argumentSlot(int argument) const {
+        return "DWORD PTR [rbp+" + std::to_string(16 + 8 * argument) + "]";
+    }
+
+    // where the handle of the array in slot a is kept
+    std::string arraySlot(int slot) const {
+        if (slot < (int)function.parameterCount) {
+            return argumentSlot(slot);
+        }
+        return frameSlot(_arraySlot.at(slot));
+    }
+
+    std::string locationOf(const IrInstruction* value) const {
+        const Location& location = _location[value->id];
+        switch (location.kind) {
+            case Location::Kind::Register:
+                return registers32[location.index];
+            case Location::Kind::Frame:
+                return frameSlot(location.index);
+            case Location::Kind::Argument:
+                return argumentSlot(location.index);
+            default:
+                return "";
+        }
+    }
+
+    // the value as an operand of an instruction
+    std::string operand(const IrInstruction* value) const {
+        switch (value->op) {
+            case IrOp::CONST:
+            case IrOp::STRING:
+                return std::to_string(value->a);
+            case IrOp::ARRAY:
+                return arraySlot(value->a);
+            default:
+                return locationOf(value);
+        }
+    }
+
+    void emit(const std::string& line) {
+        out += "    " + line + "\n";
+    }
+
+    void label(const std::string& name) {
+        out += name + ":\n";
+    }
+
+    std::string blockLabel(const IrBlock* block) const {
+        return ".L" + std::to_string(index) + "_" + std::to_string(block->id);
+    }
+
+    std::string newLabel() {
+        return ".L" + std::to_string(index) + "_x" + std::to_string(_labels++);
+    }
+
+    // Where a runtime error of the line jumps to: the message, or the index
+    // out of range when there is none, with edx the index and r11 the entry
+    std::string errorLabel(const char* message, int line) {
+        auto key = std::make_pair(std::string(message ? message : ""), line);
+        auto it = _errors.find(key);
+        if (it != _errors.end()) {
+            return it->second;
+        }
+        std::string target = newLabel();
+        _errors[key] = target;
+        _errorCode.push_back(target + ":");
+        _errorCode.push_back("    mov edi, " + std::to_string(line));
+        if (message) {
+            _errorCode.push_back("    lea rsi, [rip+" + std::string(message) + "]");
+            _errorCode.push_back("    jmp rt_error");
+        } else {
+            _errorCode.push_back("    jmp rt_range_error");
+        }
+        return target;
+    }
+
+    void move(const std::string& to, const std::string& from) {
+        if (to == from) {
+            return;
+        }
+        if (isMemory(to) && isMemory(from)) {
+            emit("mov eax, " + from);
+            emit("mov " + to + ", eax");
+        } else {
+            emit("mov " + to + ", " + from);
+        }
+    }
+
+    // The moves as if all done at once: a move goes once nothing left
+    // reads where it writes, a cycle is broken by keeping one of its values
+    // in r10d
+    void parallelMove(std::vector<std::pair<std::string, std::string>> moves) {
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [](const auto& m) { return m.first == m.second; }),
+                    moves.end());
+        while (!moves.empty()) {
+            bool progress = false;
+            for (size_t i = 0; i < moves.size(); i++) {
+                const std::string& to = moves[i].first;
+                bool read = std::any_of(moves.begin(), moves.end(), [&](const auto& m) { return m.second == to; });
+                if (!read) {
+                    move(to, moves[i].second);
+                    moves.erase(moves.begin() + i);
+                    progress = true;
+                    break;
+                }
+            }
+            if (!progress) {
+                std::string kept = moves.front().first;
+                emit("mov r10d, " + kept);
+                for (auto& m : moves) {
+                    if (m.second == kept) {
+                        m.second = "r10d";
+                    }
+                }
+            }
+        }
+    }
+
+    // cmp of two operands, the first of which has to be a register or memory
+    void compare(const IrInstruction* lhs, const IrInstruction* rhs) {
+        std::string a = operand(lhs);
+        std::string b = operand(rhs);
+        if (isImmediate(a) || (isMemory(a) && isMemory(b))) {
+            emit("mov eax, " + a);
+            a = "eax";
+        }
+        if (b == "0" && !isMemory(a)) {
+            emit("test " + a + ", " + a);
+        } else {
+            emit("cmp " + a + ", " + b);
+        }
+    }
+
+    // the value of eax into the instruction's location, when it has one
+    void storeResult(const IrInstruction* instruction, const std::string& from = "eax") {
+        std::string to = locationOf(instruction);
+        if (!to.empty()) {
+            move(to, from);
+        }
+    }
+
+    void emitArithmetic(const IrInstruction* instruction, const char* op) {
+        std::string to = locationOf(instruction);
+        if (to.empty()) {
+            return;
+        }
+        std::string a = operand(instruction->operands[0]);
+        std::string b = operand(instruction->operands[1]);
+        if (instruction->op != IrOp::SUB && b == to) {
+            std::swap(a, b);
+        }
+        std::string target = to;
+        if (isMemory(to) || b == to) {
+            target = "eax";
+        }
+        move(target, a);
+        if (instruction->op == IrOp::MUL && isImmediate(b)) {
+            emit(std::string(op) + " " + target + ", " + target + ", " + b);
+        } else {
+            emit(std::string(op) + " " + target + ", " + b);
+        }
+        move(to, target);
+    }
+
+    // / and % round toward zero: by 2^k an arithmetic shift, which rounds
+    // down, of the value biased by 2^k - 1 when negative, like
+    // divideByPowerOfTwo and moduloPowerOfTwo
+    void emitDivision(const IrInstruction* instruction) {
+        const IrInstruction* divisor = instruction->operands[1];
+        bool constant = divisor->op == IrOp::CONST;
+        int shift = constant ? powerOfTwo(divisor->a) : -1;
+        if (shift > 0) {
+            emit("mov eax, " + operand(instruction->operands[0]));
+            emit("mov ecx, eax");
+            emit("sar ecx, 31");
+            emit("shr ecx, " + std::to_string(32 - shift));
+            if (instruction->op == IrOp::DIV) {
+                emit("add eax, ecx");
+                emit("sar eax, " + std::to_string(shift));
+            } else {
+                emit("add ecx, eax");
+                emit("and ecx, " + std::to_string(-(1 << shift)));
+                emit("sub eax, ecx");
+            }
+            storeResult(instruction);
+            return;
+        }
+        // idiv traps on INT_MIN / -1, which wraps to INT_MIN and leaves 0
+        // like wrappingDivide and wrappingModulo
+        const char* result = instruction->op == IrOp::DIV ? "eax" : "edx";
+        if (constant && divisor->a == -1) {
+            emit("mov eax, " + operand(instruction->operands[0]));
+            emit(instruction->op == IrOp::DIV ? "neg eax" : "xor edx, edx");
+            storeResult(instruction, result);
+            return;
+        }
+        emit("mov ecx, " + operand(divisor));
+        std::string minusOne;
+        std::string done;
+        if (!constant) {
+            minusOne = newLabel();
+            done = newLabel();
+            emit("cmp ecx, -1");
+            emit("je " + minusOne);
+        }
+        if (!constant || divisor->a == 0) {
+            emit("test ecx, ecx");
+            emit("jz " + errorLabel("rt_msg_division", instruction->line));
+        }
+        emit("mov eax, " + operand(instruction->operands[0]));
+        emit("cdq");
+        emit("idiv ecx");
+        if (!constant) {
+            emit("jmp " + done);
+            label(minusOne);
+            emit("mov eax, " + operand(instruction->operands[0]));
+            emit(instruction->op == IrOp::DIV ? "neg eax" : "xor edx, edx");
+            label(done);
+        }
+        storeResult(instruction, result);
+    }
+
+    // The array's entry into r11 and the index into rdx, checked unless
+    // proven in range
+    void emitElementAddress(const IrInstruction* instruction) {
+        bool checked = !instruction->b;
+        int line = instruction->line;
+        emit("mov ecx, " + operand(instruction->operands[0]));
+        emit("mov edx, " + operand(instruction->operands[1]));
+        if (checked) {
+            emit("cmp ecx, DWORD PTR [rip+rt_count]");
+            emit("jae " + errorLabel("rt_msg_not_array", line));
+        }
+        emit("mov r11, QWORD PTR [rip+rt_table]");
+        emit("shl rcx, 4");
+        emit("add r11, rcx");
+        if (checked) {
+            emit("cmp edx, DWORD PTR [r11+8]");
+            emit("jae " + errorLabel(nullptr, line));
+        }
+        emit("mov r10, QWORD PTR [r11]");
+    }
+
+    // The element type of the array a handle is known to be of: a string
+    // constant, a local array or a global one
+    int knownType(const IrInstruction* handle) const {
+        if (handle->op == IrOp::STRING) {
+            return typeCode(ElementType::Char);
+        }
+        if (handle->op == IrOp::ARRAY) {
+            for (const IrFunction::LocalArray& array : function.arrays) {
+                if (array.slot == handle->a) {
+                    return typeCode(array.type);
+                }
+            }
+        }
+        if (handle->op == IrOp::LOAD_GLOBAL) {
+            for (const IrModule::GlobalArray& array : text.module.globalArrays) {
+                if (array.slot == handle->a) {
+                    return typeCode(array.type);
+                }
+            }
+        }
+        return -1;
+    }
+
+    void emitLoadElement(const IrInstruction* instruction) {
+        if (instruction->b && locationOf(instruction).empty()) {
+            return;
+        }
+        emitElementAddress(instruction);
+        int type = knownType(instruction->operands[0]);
+        if (type == 2) {
+            emit("mov eax, DWORD PTR [r10+rdx*4]");
+        } else if (type >= 0) {
+            emit("movsx eax, BYTE PTR [r10+rdx]");
+        } else {
+            std::string bytes = newLabel();
+            std::string done = newLabel();
+            emit("cmp DWORD PTR [r11+12], RT_INT");
+            emit("jne " + bytes);
+            emit("mov eax, DWORD PTR [r10+rdx*4]");
+            emit("jmp " + done);
+            label(bytes);
+            emit("movsx eax, BYTE PTR [r10+rdx]");
+            label(done);
+        }
+        storeResult(instruction);
+    }
+
+    void emitStoreElement(const IrInstruction* instruction) {
+        emit("mov eax, " + operand(instruction->operands[2]));
+        emitElementAddress(instruction);
+        int type = knownType(instruction->operands[0]);
+        if (type == 2) {
+            emit("mov DWORD PTR [r10+rdx*4], eax");
+        } else if (type == 1) {
+            emit("test eax, eax");
+            emit("setne BYTE PTR [r10+rdx]");
+        } else if (type == 0) {
+            emit("mov BYTE PTR [r10+rdx], al");
+        } else {
+            std::string bytes = newLabel();
+            std::string chars = newLabel();
+            std::string done = newLabel();
+            emit("cmp DWORD PTR [r11+12], RT_INT");
+            emit("jne " + bytes);
+            emit("mov DWORD PTR [r10+rdx*4], eax");
+            emit("jmp " + done);
+            label(bytes);
+            emit("cmp DWORD PTR [r11+12], RT_BOOL");
+            emit("jne " + chars);
+            emit("test eax, eax");
+            emit("setne al");
+            label(chars);
+            emit("mov BYTE PTR [r10+rdx], al");
+            label(done);
+        }
+    }
+
+    void emitCall(const IrInstruction* instruction) {
+        const std::vector<IrInstruction*>& arguments = instruction->operands;
+        if (_tailCalls.count(instruction)) {
+            // the arguments become the parameters, and it starts over
+            std::vector<std::pair<std::string, std::string>> moves;
+            for (size_t i = 0; i < arguments.size(); i++) {
+                moves.push_back({argumentSlot((int)i), operand(arguments[i])});
+            }
+            parallelMove(moves);
+            emit("jmp .L" + std::to_string(index) + "_body");
+            return;
+        }
+        for (size_t i = 0; i < arguments.size(); i++) {
+            move("DWORD PTR [rsp+" + std::to_string(8 * i) + "]", operand(arguments[i]));
+        }
+        emit("cmp rsp, QWORD PTR [rip+rt_stack_limit]");
+        emit("jb " + errorLabel("rt_msg_stack", instruction->line));
+        emit("call fn_" + std::to_string(instruction->a));
+        storeResult(instruction);
+    }
+
+    void emitPrintf(const IrInstruction* instruction) {
+        const PrintfFormat& format = text.module.formats[instruction->a];
+        for (const FormatSegment& segment : format.segments) {
+            switch (segment.kind) {
+                case FormatSegment::Kind::Literal:
+                    if (segment.text.size() == 1) {
+                        emit("mov eax, " + std::to_string((unsigned char)segment.text[0]));
+                        emit("call rt_putc");
+                        break;
+                    }
+                    emit("lea r10, [rip+.Ltext" + std::to_string(text.literal(segment.text)) + "]");
+                    emit("mov ecx, " + std::to_string(segment.text.size()));
+                    emit("call rt_write");
+                    break;
+                case FormatSegment::Kind::Newline:
+                    emit("call rt_newline");
+                    break;
+                case FormatSegment::Kind::Int:
+                    emit("mov eax, " + operand(instruction->operands[segment.argument]));
+                    emit("call rt_print_int");
+                    break;
+                case FormatSegment::Kind::Hex:
+                    emit("mov eax, " + operand(instruction->operands[segment.argument]));
+                    emit("call rt_print_hex");
+                    break;
+                case FormatSegment::Kind::Char:
+                    emit("mov eax, " + operand(instruction->operands[segment.argument]));
+                    emit("call rt_putc");
+                    break;
+                case FormatSegment::Kind::String:
+                    emit("mov eax, " + operand(instruction->operands[segment.argument]));
+                    emit("mov edx, " + std::to_string(instruction->line));
+                    emit("call rt_print_string");
+                    break;
+            }
+        }
+    }
+
+    void emitReturn(const IrInstruction* instruction) {
+        emit("mov eax, " + operand(instruction->operands[0]));
+        if (_arrayMark >= 0) {
+            // the arrays of the call go away with it
+            emit("mov rdx, " + frameSlot(_arrayMark, "QWORD"));
+            emit("mov QWORD PTR [rip+rt_count], rdx");
+            emit("mov rdx, " + frameSlot(_arrayMark + 1, "QWORD"));
+            emit("mov QWORD PTR [rip+rt_heap_top], rdx");
+        }
+        if (_saved.empty()) {
+            emit("mov rsp, rbp");
+        } else {
+            emit("lea rsp, [rbp-" + std::to_string(8 * _saved.size()) + "]");
+            for (auto it = _saved.rbegin(); it != _saved.rend(); ++it) {
+                emit(std::string("pop ") + registers64[*it]);
+            }
+        }
+        emit("pop rbp");
+        emit("ret");
+    }
+
+    // the phis of the only successor of block take their values from it
+    void emitPhiCopies(IrBlock* block) {
+        IrBlock* successor = block->successors[0];
+        size_t edge = edgeIndex(block, successor);
+        std::vector<std::pair<std::string, std::string>> moves;
+        for (size_t i = 0; i < successor->firstNonPhi(); i++) {
+            const IrInstruction* phi = successor->instructions[i];
+            if (needsLocation(phi)) {
+                moves.push_back({locationOf(phi), operand(phi->operands[edge])});
+            }
+        }
+        parallelMove(moves);
+    }
+
+    void emitBranch(const IrInstruction* instruction, IrBlock* next) {
+        IrBlock* block = instruction->block;
+        IrBlock* whenTrue = block->successors[0];
+        IrBlock* whenFalse = block->successors[1];
+        const IrInstruction* condition = instruction->operands[0];
+        IrOp test = IrOp::NE;
+        if (_fused[condition->id]) {
+            compare(condition->operands[0], condition->operands[1]);
+            test = condition->op;
+        } else {
+            std::string value = operand(condition);
+            if (isMemory(value)) {
+                emit("cmp " + value + ", 0");
+            } else {
+                if (isImmediate(value)) {
+                    emit("mov eax, " + value);
+                    value = "eax";
+                }
+                emit("test " + value + ", " + value);
+            }
+        }
+        if (whenFalse == next) {
+            emit(std::string("j") + conditionOf(test) + " " + blockLabel(whenTrue));
+        } else if (whenTrue == next) {
+            emit(std::string("j") + conditionOf(test, true) + " " + blockLabel(whenFalse));
+        } else {
+            emit(std::string("j") + conditionOf(test) + " " + blockLabel(whenTrue));
+            emit("jmp " + blockLabel(whenFalse));
+        }
+    }
+
+    void emitInstruction(const IrInstruction* instruction, IrBlock* next) {
+        switch (instruction->op) {
+            case IrOp::LOAD_GLOBAL:
+                storeResult(instruction, "DWORD PTR [rip+rt_globals+" + std::to_string(4 * instruction->a) + "]");
+                break;
+            case IrOp::STORE_GLOBAL:
+                move("DWORD PTR [rip+rt_globals+" + std::to_string(4 * instruction->a) + "]",
+                     operand(instruction->operands[0]));
+                break;
+            case IrOp::COPY_ARRAY:
+                emit("mov eax, " + (instruction->b ? "DWORD PTR [rip+rt_globals+" + std::to_string(4 * instruction->a) + "]"
+                                                   : arraySlot(instruction->a)));
+                emit("mov ecx, " + operand(instruction->operands[0]));
+                emit("mov edx, " + std::to_string(instruction->line));
+                emit("call rt_copy");
+                break;
+            case IrOp::LOAD_ELEMENT:
+                emitLoadElement(instruction);
+                break;
+            case IrOp::STORE_ELEMENT:
+                emitStoreElement(instruction);
+                break;
+            case IrOp::ADD:
+                emitArithmetic(instruction, "add");
+                break;
+            case IrOp::SUB:
+                emitArithmetic(instruction, "sub");
+                break;
+            case IrOp::MUL:
+                emitArithmetic(instruction, "imul");
+                break;
+            case IrOp::DIV:
+            case IrOp::MOD:
+                emitDivision(instruction);
+                break;
+            case IrOp::POW:
+                emit("mov eax, " + operand(instruction->operands[0]));
+                emit("mov ecx, " + operand(instruction->operands[1]));
+                emit("mov edx, " + std::to_string(instruction->line));
+                emit("call rt_pow");
+                storeResult(instruction);
+                break;
+            case IrOp::LT:
+            case IrOp::LE:
+            case IrOp::GT:
+            case IrOp::GE:
+            case IrOp::EQ:
+            case IrOp::NE:
+                if (!locationOf(instruction).empty()) {
+                    compare(instruction->operands[0], instruction->operands[1]);
+                    emit(std::string("set") + conditionOf(instruction->op) + " al");
+                    emit("movzx eax, al");
+                    storeResult(instruction);
+                }
+                break;
+            case IrOp::NOT:
+                if (!locationOf(instruction).empty()) {
+                    emit("mov eax, " + operand(instruction->operands[0]));
+                    emit("test eax, eax");
+                    emit("sete al");
+                    emit("movzx eax, al");
+                    storeResult(instruction);
+                }
+                break;
+            case IrOp::CALL:
+                emitCall(instruction);
+                break;
+            case IrOp::PRINTF:
+                emitPrintf(instruction);
+                break;
+            case IrOp::COPY:
+                storeResult(instruction, operand(instruction->operands[0]));
+                break;
+            case IrOp::JUMP:
+                emitPhiCopies(instruction->block);
+                if (instruction->block->successors[0] != next) {
+                    emit("jmp " + blockLabel(instruction->block->successors[0]));
+                }
+                break;
+            case IrOp::BRANCH:
+                emitBranch(instruction, next);
+                break;
+            case IrOp::RETURN:
+                emitReturn(instruction);
+                break;
+            default:
+                // CONST, STRING, ARRAY, PARAM and PHI have no code of their own
+                break;
+        }
+    }
+
+    void emitFunction() {
+        size_t bytes = 8 * (_frameSlots + _outgoing);
+        // rsp stays a multiple of 16 at calls
+        if ((8 * _saved.size() + bytes) % 16) {
+            bytes += 8;
+        }
+
+        out += "\n# " + function.name + "\n";
+        label("fn_" + std::to_string(index));
+        emit("push rbp");
+        emit("mov rbp, rsp");
+        for (int r : _saved) {
+            emit(std::string("push ") + registers64[r]);
+        }
+        if (bytes) {
+            emit("sub rsp, " + std::to_string(bytes));
+        }
+        if (_arrayMark >= 0) {
+            // local arrays are allocated once per call
+            emit("mov rax, QWORD PTR [rip+rt_count]");
+            emit("mov " + frameSlot(_arrayMark, "QWORD") + ", rax");
+            emit("mov rax, QWORD PTR [rip+rt_heap_top]");
+            emit("mov " + frameSlot(_arrayMark + 1, "QWORD") + ", rax");
+            for (const IrFunction::LocalArray& array : function.arrays) {
+                emit("mov eax, " + std::to_string(typeCode(array.type)));
+                emit("mov ecx, " + std::to_string(array.size));
+                emit("call rt_new_array");
+                emit("mov " + arraySlot(array.slot) + ", eax");
+            }
+        }
+        if (!_tailCalls.empty()) {
+            label(".L" + std::to_string(index) + "_body");
+        }
+        for (const IrInstruction* instruction : function.entry()->instructions) {
+            if (instruction->op == IrOp::PARAM && _location[instruction->id].kind == Location::Kind::Register) {
+                emit("mov " + locationOf(instruction) + ", " + argumentSlot(instruction->a));
+            }
+        }
+
+        for (size_t b = 0; b < _order.size(); b++) {
+            IrBlock* block = _order[b];
+            IrBlock* next = b + 1 < _order.size() ? _order[b + 1] : nullptr;
+            label(blockLabel(block));
+            for (IrInstruction* instruction : block->instructions) {
+                if (_fused[instruction->id]) {
+                    continue;
+                }
+                emitInstruction(instruction, next);
+                if (_tailCalls.count(instruction)) {
+                    break;
+                }
+            }
+        }
+        for (const std::string& line : _errorCode) {
+            out += line + "\n";
+        }
+    }
+};
+
+}  // namespace
+
+std::string generateAssembly(IrModule& module, bool tailCalls) {
+    splitCriticalEdges(module);
+    ModuleText text{module, {}, {}};
+
+    std::string functions;
+    for (size_t i = 0; i < module.functions.size(); i++) {
+        if (!module.functions[i]->blocks.empty()) {
+            FunctionCodegen(text, *module.functions[i], (int)i, tailCalls, functions).run();
+        }
+    }
+
+    std::string source = "# Generated by program.exe --emit-asm\n    .intel_syntax noprefix\n\n";
+    source += runtime;
+
+    // strings, then global arrays, like the VirtualMachine hands out handles
+    source += "\n    .globl _start\n_start:\n    call rt_start\n";
+    for (size_t i = 0; i < module.strings.size(); i++) {
+        source += "    lea r10, [rip+.Lstring" + std::to_string(i) + "]\n";
+        source += "    mov ecx, " + std::to_string(module.strings[i].size()) + "\n";
+        source += "    call rt_string\n";
+    }
+    for (const IrModule::GlobalArray& array : module.globalArrays) {
+        source += "    mov eax, " + std::to_string(typeCode(array.type)) + "\n";
+        source += "    mov ecx, " + std::to_string(array.size) + "\n";
+        source += "    call rt_new_array\n";
+        source += "    mov DWORD PTR [rip+rt_globals+" + std::to_string(4 * array.slot) + "], eax\n";
+    }
+    if (module.main >= 0) {
+        source += "    call fn_" + std::to_string(module.main) + "\n";
+    }
+    source += "    jmp rt_exit\n";
+    source += functions;
+
+    source += "\n    .bss\n    .align 8\nrt_globals:\n    .zero " + std::to_string(4 * std::max<size_t>(module.globalCount, 1)) +
+              "\n";
+    // string constants are arrays the program may write to
+    source += "\n    .data\n";
+    for (size_t i = 0; i < module.strings.size(); i++) {
+        source += ".Lstring" + std::to_string(i) + ":\n    .ascii \"" + quoted(module.strings[i]) + "\"\n    .byte 0\n";
+    }
+    source += "\n    .section .rodata\n";
+    for (size_t i = 0; i < text.literals.size(); i++) {
+        source += ".Ltext" + std::to_string(i) + ":\n    .ascii \"" + quoted(text.literals[i]) + "\"\n";
+    }
+    return source;
+}
@@ -0,0 +1,30 @@
+#ifndef NATIVE_CODEGEN_HPP
+#define NATIVE_CODEGEN_HPP
+
+#include <string>
+
+#include "ir.hpp"
+
+// Turns the IR into GNU assembler text for x86-64 Linux, a whole program
+// that needs nothing but as and ld: the runtime in front of the functions
+// makes its own system calls, keeps the arrays and prints what printf
+// prints, so the executable prints what the other engines print and fails
+// with the same errors.
+//
+//   - values get registers by linear scan over the blocks in reverse
+//     postorder, one interval from the first to the last position a value
+//     is live at; the values left over live in the frame
+//   - every function saves the registers it hands out, so values keep
+//     theirs across calls; arguments are passed in the caller's frame
+//   - constants, strings and local arrays are operands wherever used
+//   - the phis of a block are copied in at the end of each predecessor, as
+//     one parallel move; an edge from a branch gets a block of its own
+//   - a comparison right before the branch testing it becomes the branch
+//   - with tailCalls, a call of the function itself whose result is
+//     returned right away, or any last call of itself in a procedure, runs
+//     in its frame (functions with local arrays excepted)
+//
+// Splits the critical edges of the module's functions.
+std::string generateAssembly(IrModule& module, bool tailCalls);
+
+#endif  // NATIVE_CODEGEN_HPP
@@ -0,0 +1,45 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <string>
+
+// How a program is run once it has been parsed
+enum class Engine {
+    Ast,       // walk the AST directly
+    Bytecode,  // compile to bytecode and run it on the VirtualMachine
+    Closure,   // compile to a tree of precompiled nodes and run it on the ClosureMachine
+};
+
+// How the VirtualMachine finds the handler of the next instruction
+enum class Dispatch {
+    Switch,    // a central switch over the opcode
+    Threaded,  // every handler jumps straight to the next (labels-as-values)
+};
+
+struct Options {
+    Engine engine{Engine::Bytecode};
+    Dispatch dispatch{Dispatch::Threaded};
+    bool constantFolding{true};    // fold constant expressions and branches in the AST
+    bool dumpOptimizedAst{false};  // write the AST after folding to optimized_ast_output.txt
+    bool ir{true};                 // compile through the SSA IR and its passes, else straight from the AST
+    bool dumpIr{false};            // write the IR as built and after every pass to ir_output.txt
+    int inlineThreshold{40};       // instructions of the largest leaf function inlined, 0 inlines none
+    bool reportInlining{false};    // print every call site the inliner looked at and its decision
+    bool licm{true};               // move loop-invariant computations in front of their loops
+    bool unroll{true};             // unroll counted loops whose trip count is a constant
+    bool superinstructions{true};  // fuse common sequences before running
+    bool strengthReduction{true};  // arithmetic by powers of two as shifts and masks
+    bool jit{true};                // compile hot functions to native code, where built in
+    int jitThreshold{1000};        // calls, or iterations of one loop, before a function is compiled
+    bool traceTiering{false};      // log every function compiled and every loop entered natively
+    bool reportBoundsChecks{false};  // print how many array bounds checks were proven unnecessary
+    bool tailCalls{true};          // run self calls that end a function in its frame, as a loop
+    bool memoize{false};           // cache the results of pure functions by their arguments
+    bool reportMemoization{false};   // print the hits and misses of every function memoized
+    std::string emitC;             // write the program as C to this file instead of running it
+    std::string buildC;            // compile that C with cc -O2 into this executable
+    std::string emitAsm;           // write the program as x86-64 assembly to this file instead of running it
+    std::string buildAsm;          // assemble and link that with as and ld into this executable
+};
+
+#endif  // OPTIONS_HPP
@@ -0,0 +1,66 @@
+#include "output_buffer.hpp"
+
+#include <charconv>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+OutputBuffer::OutputBuffer() : lineBuffered(isatty(fileno(stdout))) {
+    buffer.reserve(capacity);
+}
+
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+void OutputBuffer::append(char c) {
+    buffer.push_back(c);
+    if (buffer.size() >= capacity) {
+        flush();
+    }
+}
+
+void OutputBuffer::append(const char* data, size_t size) {
+    buffer.append(data, size);
+    if (buffer.size() >= capacity) {
+        flush();
+    }
+}
+
+void OutputBuffer::append(const std::string& text) {
+    append(text.data(), text.size());
+}
+
+void OutputBuffer::appendInt(int value) {
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof digits, value);
+    append(digits, result.ptr - digits);
+}
+
+void OutputBuffer::appendHex(int value) {
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof digits, static_cast<unsigned>(value), 16);
+    append(digits, result.ptr - digits);
+}
+
+void OutputBuffer::newline() {
+    buffer.push_back('\n');
+    if (lineBuffered || buffer.size() >= capacity) {
+        flush();
+    }
+}
+
+// written through stdio, after whatever else is already on stdout
+void OutputBuffer::flush() {
+    if (!buffer.empty()) {
+        std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+        buffer.clear();
+    }
+    std::fflush(stdout);
+}
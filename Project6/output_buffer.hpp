@@ -0,0 +1,35 @@
+#ifndef OUTPUT_BUFFER_HPP
+#define OUTPUT_BUFFER_HPP
+
+#include <cstddef>
+#include <string>
+
+// Everything a running program prints goes through one of these, so stdout
+// sees a few large writes instead of a flush per line and a call per
+// character. The buffer is written out once it holds capacity bytes, by
+// flush() and when it is destroyed. When stdout is a terminal every
+// complete line is written right away, like line-buffered stdio.
+class OutputBuffer {
+   public:
+    OutputBuffer();
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void append(char c);
+    void append(const char* data, size_t size);
+    void append(const std::string& text);
+    void appendInt(int value);
+    void appendHex(int value);  // as unsigned, lowercase digits
+    void newline();
+
+    void flush();
+
+   private:
+    static constexpr size_t capacity = 1 << 16;
+
+    std::string buffer;
+    bool lineBuffered;
+};
+
+#endif  // OUTPUT_BUFFER_HPP
@@ -0,0 +1,65 @@
+#include "printf_format.hpp"
+
+// Parses format the way printf used to read it on every call: \n is a
+// newline, %d %x %c and %s print the next argument, and % followed by
+// anything else prints that character but still uses up an argument
+PrintfFormat compileFormat(const std::string& format) {
+    PrintfFormat compiled;
+    std::string literal;
+    int argument = 0;
+
+    auto endLiteral = [&]() {
+        if (!literal.empty()) {
+            compiled.segments.push_back({FormatSegment::Kind::Literal, literal});
+            literal.clear();
+        }
+    };
+
+    for (size_t i = 0; i < format.size(); i++) {
+        if (format[i] == '\\' && i + 1 < format.size() && format[i + 1] == 'n') {
+            endLiteral();
+            compiled.segments.push_back({FormatSegment::Kind::Newline, ""});
+            i++;
+            continue;
+        }
+        if (format[i] != '%' || i + 1 == format.size()) {
+            literal += format[i];
+            continue;
+        }
+
+        FormatSegment::Kind kind;
+        switch (format[++i]) {
+            case 'd':
+                kind = FormatSegment::Kind::Int;
+                break;
+            case 'x':
+                kind = FormatSegment::Kind::Hex;
+                break;
+            case 'c':
+                kind = FormatSegment::Kind::Char;
+                break;
+            case 's':
+                kind = FormatSegment::Kind::String;
+                break;
+            default:
+                literal += format[i];
+                argument++;
+                continue;
+        }
+        endLiteral();
+        compiled.segments.push_back({kind, "", argument++});
+    }
+    endLiteral();
+
+    compiled.argumentCount = argument;
+    return compiled;
+}
+
+size_t printedLength(std::string_view text) {
+    size_t end = text.find("\\x0");
+    if (end == std::string_view::npos) {
+        end = text.size();
+    }
+    size_t nul = text.find('\0');
+    return nul < end ? nul : end;
+}
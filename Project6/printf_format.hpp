@@ -0,0 +1,69 @@
+#ifndef PRINTF_FORMAT_HPP
+#define PRINTF_FORMAT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "output_buffer.hpp"
+
+// One piece of a printf format string
+struct FormatSegment {
+    enum class Kind {
+        Literal,  // text, printed as is
+        Newline,  // \n
+        Int,      // %d
+        Hex,      // %x
+        Char,     // %c
+        String,   // %s
+    };
+
+    Kind kind;
+    std::string text;  // Literal only
+    int argument{0};   // index of the printed argument
+};
+
+// A format string parsed once into the segments printf walks at run time
+struct PrintfFormat {
+    std::vector<FormatSegment> segments;
+    int argumentCount{0};  // arguments the format uses
+};
+
+PrintfFormat compileFormat(const std::string& format);
+
+// Length of the part of a char array %s prints: up to the first NUL, or up
+// to a literal \x0 written in a string constant
+size_t printedLength(std::string_view text);
+
+// Prints format, taking the value of argument i from intArgument(i) for %d,
+// %x and %c and from stringArgument(i) for %s
+template <typename IntArgument, typename StringArgument>
+void writeFormatted(const PrintfFormat& format, OutputBuffer& output, IntArgument intArgument,
+                    StringArgument stringArgument) {
+    for (const FormatSegment& segment : format.segments) {
+        switch (segment.kind) {
+            case FormatSegment::Kind::Literal:
+                output.append(segment.text);
+                break;
+            case FormatSegment::Kind::Newline:
+                output.newline();
+                break;
+            case FormatSegment::Kind::Int:
+                output.appendInt(intArgument(segment.argument));
+                break;
+            case FormatSegment::Kind::Hex:
+                output.appendHex(intArgument(segment.argument));
+                break;
+            case FormatSegment::Kind::Char:
+                output.append(static_cast<char>(intArgument(segment.argument)));
+                break;
+            case FormatSegment::Kind::String: {
+                std::string_view text = stringArgument(segment.argument);
+                output.append(text.data(), printedLength(text));
+                break;
+            }
+        }
+    }
+}
+
+#endif  // PRINTF_FORMAT_HPP
@@ -0,0 +1,65 @@
+#include "purity_analysis.hpp"
+
+#include <unordered_map>
+
+PurityAnalysis::PurityAnalysis(Interpreter& interpreter) : interpreter(interpreter) {}
+
+void PurityAnalysis::run() {
+    std::vector<ASTListNode*> candidates;
+    std::unordered_map<ASTListNode*, std::vector<ASTListNode*>> callees;
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        declaration->pure = declaration->symbol->identifierType == TokenType::FUNCTION &&
+                            bodyIsPure(declaration, callees[declaration]);
+        if (declaration->pure) {
+            candidates.push_back(declaration);
+        }
+    }
+
+    // a call of anything impure makes the caller impure, until nothing changes
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (ASTListNode* declaration : candidates) {
+            if (!declaration->pure) {
+                continue;
+            }
+            for (ASTListNode* callee : callees[declaration]) {
+                if (!callee || !callee->pure) {
+                    declaration->pure = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// No array parameter, global, printf or call of an unknown function in the
+// body; the functions it calls are collected in callees
+bool PurityAnalysis::bodyIsPure(ASTListNode* declaration, std::vector<ASTListNode*>& callees) {
+    for (SymbolTableListNode* param = declaration->symbol->parameterList; param; param = param->next()) {
+        if (param->isArray) {
+            return false;
+        }
+    }
+
+    for (ASTListNode* row = nextRow(declaration); row && row != declaration->end; row = nextRow(row)) {
+        if (row->type == ASTNodeType::PRINTF) {
+            return false;
+        }
+        for (ASTListNode* node = row; node; node = node->sibling) {
+            if (!node->token || node->token->type != TokenType::IDENTIFIER) {
+                continue;
+            }
+            bool isCall = node->sibling && node->sibling->token && node->sibling->token->type == TokenType::L_PAREN;
+            if (isCall) {
+                if (!node->callee) {
+                    return false;
+                }
+                callees.push_back(node->callee);
+            } else if (node->symbol && node->symbol->scope == 0 && node->symbol->slot >= 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
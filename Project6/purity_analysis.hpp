@@ -0,0 +1,30 @@
+#ifndef PURITY_ANALYSIS_HPP
+#define PURITY_ANALYSIS_HPP
+
+#include <vector>
+
+#include "ast_list_node.hpp"
+#include "interpreter.hpp"
+
+// Finds the pure functions, whose result depends on their arguments alone
+// and which do nothing else, and marks their declarations (pure). A
+// function is pure when it takes no array parameters, reads and writes no
+// global, prints nothing and only calls pure functions. Recursion does not
+// stop a function from being pure, functions are assumed pure until one of
+// their bodies or callees says otherwise. Procedures never are.
+//
+// A call of a pure function can be answered with the result of an earlier
+// call with the same arguments, which is what --memoize does.
+class PurityAnalysis {
+   public:
+    explicit PurityAnalysis(Interpreter& interpreter);
+    void run();
+
+   private:
+    bool bodyIsPure(ASTListNode* declaration, std::vector<ASTListNode*>& callees);
+
+   private:
+    Interpreter& interpreter;
+};
+
+#endif  // PURITY_ANALYSIS_HPP
@@ -0,0 +1,254 @@
+#include "range_analysis.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <string>
+
+// A value of a postfix expression: a single node, or an operator and the
+// terms of its operands (-1 when it has fewer)
+struct Term {
+    ASTListNode* node;
+    int left;
+    int right;
+};
+
+static bool isConstant(ASTListNode* node, int& value) {
+    if (!node || node->token->type != TokenType::INTEGER) {
+        return false;
+    }
+    value = std::stoi(node->token->lexeme);
+    return true;
+}
+
+static bool isVariable(ASTListNode* node, SymbolTableListNode* variable) {
+    return node && node->token->type == TokenType::IDENTIFIER && node->symbol == variable;
+}
+
+static bool isElement(ASTListNode* node) {
+    return node->token && node->token->type == TokenType::IDENTIFIER && node->sibling &&
+           node->sibling->token->type == TokenType::L_BRACKET;
+}
+
+// Whether term is only true while variable <= high: variable < N, variable
+// <= N, N > variable, N >= variable, or && with one of those on either side
+static bool boundOf(const std::vector<Term>& terms, int index, SymbolTableListNode* variable, int& high) {
+    const Term& term = terms[index];
+    TokenType type = term.node->token->type;
+
+    if (type == TokenType::BOOLEAN_AND) {
+        int left = 0;
+        int right = 0;
+        bool hasLeft = boundOf(terms, term.left, variable, left);
+        bool hasRight = boundOf(terms, term.right, variable, right);
+        if (!hasLeft && !hasRight) {
+            return false;
+        }
+        high = hasLeft && hasRight ? std::min(left, right) : hasLeft ? left : right;
+        return true;
+    }
+
+    if (term.left < 0 || term.right < 0 || terms[term.left].left >= 0 || terms[term.right].left >= 0) {
+        return false;
+    }
+    ASTListNode* lhs = terms[term.left].node;
+    ASTListNode* rhs = terms[term.right].node;
+    int limit = 0;
+    if (isVariable(lhs, variable) && isConstant(rhs, limit)) {
+        if (type == TokenType::LT && limit > INT_MIN) {
+            high = limit - 1;
+            return true;
+        }
+        if (type == TokenType::LT_EQUAL) {
+            high = limit;
+            return true;
+        }
+    } else if (isConstant(lhs, limit) && isVariable(rhs, variable)) {
+        if (type == TokenType::GT && limit > INT_MIN) {
+            high = limit - 1;
+            return true;
+        }
+        if (type == TokenType::GT_EQUAL) {
+            high = limit;
+            return true;
+        }
+    }
+    return false;
+}
+
+RangeAnalysis::RangeAnalysis(Interpreter& interpreter) : interpreter(interpreter) {}
+
+void RangeAnalysis::run() {
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        for (SymbolTableListNode* param = declaration->symbol->parameterList; param; param = param->next()) {
+            _parameters.insert(param);
+        }
+    }
+
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        ASTListNode* row = interpreter.getAddressAtInd(i);
+        Range range;
+        if (row->type == ASTNodeType::FOR1 && inductionRange(row, range)) {
+            markAccesses(row, range);
+            if (range.exact) {
+                row->countedStep = range.step;
+                row->countedHigh = range.high;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+        for (ASTListNode* node = interpreter.getAddressAtInd(i); node; node = node->sibling) {
+            if (isElement(node)) {
+                _accesses++;
+                _eliminated += node->inBounds;
+            }
+        }
+    }
+}
+
+// FOR1: i = low, FOR2: a bound on i, FOR3: i = i + step
+bool RangeAnalysis::inductionRange(ASTListNode* forNode, Range& range) {
+    ASTListNode* target = forNode->sibling;
+    if (!target || !forNode->body || !forNode->end) {
+        return false;
+    }
+    SymbolTableListNode* variable = target->symbol;
+    if (!variable || variable->slot < 0 || variable->scope == 0 || variable->isArray ||
+        variable->datatype != TokenType::INT) {
+        return false;
+    }
+
+    ASTListNode* first = target->sibling;
+    if (!isConstant(first, range.low) || !first->sibling ||
+        first->sibling->token->type != TokenType::ASSIGNMENT_OPERATOR) {
+        return false;
+    }
+
+    ASTListNode* conditionRow = nextRow(forNode);
+    std::vector<ASTListNode*> condition;
+    for (ASTListNode* node = conditionRow->sibling; node; node = node->sibling) {
+        condition.push_back(node);
+    }
+    if (!upperBound(condition, variable, range.high)) {
+        return false;
+    }
+    range.exact = condition.back()->token->type != TokenType::BOOLEAN_AND;
+
+    ASTListNode* incrementRow = nextRow(conditionRow);
+    std::vector<ASTListNode*> increment;
+    for (ASTListNode* node = incrementRow->sibling; node; node = node->sibling) {
+        increment.push_back(node);
+    }
+    int step = 0;
+    if (increment.size() != 5 || !isVariable(increment[0], variable) ||
+        increment[3]->token->type != TokenType::PLUS ||
+        increment[4]->token->type != TokenType::ASSIGNMENT_OPERATOR) {
+        return false;
+    }
+    bool counts = (isVariable(increment[1], variable) && isConstant(increment[2], step)) ||
+                  (isConstant(increment[1], step) && isVariable(increment[2], variable));
+    // stepping past INT_MAX would wrap around to indexes below low
+    if (!counts || step <= 0 || static_cast<long long>(range.high) + step > INT_MAX) {
+        return false;
+    }
+
+    range.variable = variable;
+    range.step = step;
+    return !assignedIn(forNode, variable);
+}
+
+// Builds the terms of the postfix condition, giving up on anything but
+// variables, constants and operators
+bool RangeAnalysis::upperBound(const std::vector<ASTListNode*>& condition, SymbolTableListNode* variable,
+                               int& high) {
+    std::vector<Term> terms;
+    std::vector<int> values;
+
+    for (ASTListNode* node : condition) {
+        TokenType type = node->token->type;
+        if (type == TokenType::IDENTIFIER || type == TokenType::INTEGER || type == TokenType::CHAR_LITERAL ||
+            type == TokenType::TRUE || type == TokenType::FALSE) {
+            if (isElement(node) || (node->sibling && node->sibling->token->type == TokenType::L_PAREN)) {
+                return false;
+            }
+            terms.push_back({node, -1, -1});
+        } else if (type == TokenType::BOOLEAN_NOT) {
+            if (values.empty()) {
+                return false;
+            }
+            terms.push_back({node, values.back(), -1});
+            values.pop_back();
+        } else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            if (values.size() < 2) {
+                return false;
+            }
+            int right = values.back();
+            values.pop_back();
+            terms.push_back({node, values.back(), right});
+            values.pop_back();
+        } else {
+            return false;
+        }
+        values.push_back(terms.size() - 1);
+    }
+
+    return values.size() == 1 && boundOf(terms, values.back(), variable, high);
+}
+
+// the body, nested loops included, assigns variable
+bool RangeAnalysis::assignedIn(ASTListNode* forNode, SymbolTableListNode* variable) {
+    for (ASTListNode* row = forNode->body; row && row != forNode->end; row = nextRow(row)) {
+        bool assigns = row->type == ASTNodeType::ASSIGNMENT || row->type == ASTNodeType::FOR1 ||
+                       row->type == ASTNodeType::FOR3;
+        if (assigns && row->sibling && row->sibling->symbol == variable) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RangeAnalysis::markAccesses(ASTListNode* forNode, const Range& range) {
+    for (ASTListNode* row = forNode->body; row && row != forNode->end; row = nextRow(row)) {
+        for (ASTListNode* node = row; node; node = node->sibling) {
+            if (!isElement(node)) {
+                continue;
+            }
+            SymbolTableListNode* array = node->symbol;
+            if (array && array->isArray && array->slot >= 0 && !_parameters.count(array) &&
+                indexInRange(node->sibling->sibling, range, array->arraySize)) {
+                node->inBounds = true;
+            }
+        }
+    }
+}
+
+// index is i, i k +, k i + or i k - up to its ], with i the induction variable
+bool RangeAnalysis::indexInRange(ASTListNode* index, const Range& range, size_t size) {
+    std::vector<ASTListNode*> nodes;
+    for (ASTListNode* node = index; node && node->token->type != TokenType::R_BRACKET; node = node->sibling) {
+        nodes.push_back(node);
+    }
+
+    int constant = 0;
+    long long offset = 0;
+    if (nodes.size() == 1 && isVariable(nodes[0], range.variable)) {
+        offset = 0;
+    } else if (nodes.size() == 3 && nodes[2]->token->type == TokenType::PLUS) {
+        if (!(isVariable(nodes[0], range.variable) && isConstant(nodes[1], constant)) &&
+            !(isConstant(nodes[0], constant) && isVariable(nodes[1], range.variable))) {
+            return false;
+        }
+        offset = constant;
+    } else if (nodes.size() == 3 && nodes[2]->token->type == TokenType::MINUS) {
+        if (!isVariable(nodes[0], range.variable) || !isConstant(nodes[1], constant)) {
+            return false;
+        }
+        offset = -static_cast<long long>(constant);
+    } else {
+        return false;
+    }
+
+    long long low = range.low + offset;
+    long long high = range.high + offset;
+    return low >= 0 && high < static_cast<long long>(size);
+}
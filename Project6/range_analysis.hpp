@@ -0,0 +1,57 @@
+#ifndef RANGE_ANALYSIS_HPP
+#define RANGE_ANALYSIS_HPP
+
+#include <unordered_set>
+#include <vector>
+
+#include "ast_list_node.hpp"
+#include "interpreter.hpp"
+#include "symbol_table_list_node.hpp"
+
+// Finds the element accesses whose index a counted for loop keeps in range
+// and marks their array (inBounds), so both engines can leave out their
+// bounds check.
+//
+// A loop is counted when FOR1 sets a local int to a constant, FOR2 compares
+// it with a constant, alone or as one side of &&, FOR3 adds a positive
+// constant to it and nothing in the body assigns it. Inside the body the
+// variable then stays between the first value and the bound, and so does
+// an index i, i + k or i - k within the declared size of the array. Array
+// parameters are never trusted, the caller's array may be shorter than the
+// declaration says.
+//
+// A counted loop whose condition is the comparison alone is also marked on
+// its FOR1 row (countedStep, countedHigh), so the AST engine can count it
+// in an int instead of evaluating FOR2 and FOR3 on every iteration.
+class RangeAnalysis {
+   public:
+    explicit RangeAnalysis(Interpreter& interpreter);
+    void run();
+
+    size_t accesses() const { return _accesses; }      // element accesses in the program
+    size_t eliminated() const { return _eliminated; }  // of those, marked inBounds
+
+   private:
+    // values an induction variable takes inside its loop's body
+    struct Range {
+        SymbolTableListNode* variable;
+        int low;
+        int high;
+        int step;
+        bool exact;  // the condition is nothing but the bound
+    };
+
+    bool inductionRange(ASTListNode* forNode, Range& range);
+    bool upperBound(const std::vector<ASTListNode*>& condition, SymbolTableListNode* variable, int& high);
+    bool assignedIn(ASTListNode* forNode, SymbolTableListNode* variable);
+    void markAccesses(ASTListNode* forNode, const Range& range);
+    bool indexInRange(ASTListNode* index, const Range& range, size_t size);
+
+   private:
+    Interpreter& interpreter;
+    std::unordered_set<SymbolTableListNode*> _parameters;
+    size_t _accesses{0};
+    size_t _eliminated{0};
+};
+
+#endif  // RANGE_ANALYSIS_HPP
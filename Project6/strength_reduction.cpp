@@ -0,0 +1,57 @@
+#include "strength_reduction.hpp"
+
+#include <vector>
+
+#include "arithmetic.hpp"
+
+namespace {
+
+// the instruction replacing PUSH 2^shift followed by op, HALT when there is none
+OpCode reducedFor(OpCode op) {
+    switch (op) {
+        case OpCode::MUL:
+            return OpCode::MUL_POW2;
+        case OpCode::DIV:
+            return OpCode::DIV_POW2;
+        case OpCode::MOD:
+            return OpCode::MOD_POW2;
+        default:
+            return OpCode::HALT;
+    }
+}
+
+}  // namespace
+
+void reduceStrength(Program& program) {
+    const std::vector<Instruction>& code = program.code;
+    std::vector<bool> isTarget = jumpTargets(program);
+
+    std::vector<Instruction> out;
+    std::vector<int> lines;
+    std::vector<size_t> remap(code.size() + 1);
+
+    for (size_t pc = 0; pc < code.size(); pc++) {
+        remap[pc] = out.size();
+        bool paired = code[pc].op == OpCode::PUSH && pc + 1 < code.size() && !isTarget[pc + 1];
+        OpCode op = paired ? code[pc + 1].op : OpCode::HALT;
+        int shift = paired ? powerOfTwo(code[pc].a) : -1;
+
+        if (shift > 0 && reducedFor(op) != OpCode::HALT) {
+            out.push_back({reducedFor(op), shift, 0, 0});
+            lines.push_back(program.lines[pc + 1]);
+            remap[++pc] = out.size() - 1;
+        } else if (paired && op == OpCode::POW && code[pc].a == 2) {
+            out.push_back({OpCode::DUP, 0, 0, 0});
+            lines.push_back(program.lines[pc]);
+            out.push_back({OpCode::MUL, 0, 0, 0});
+            lines.push_back(program.lines[pc + 1]);
+            remap[++pc] = out.size() - 1;
+        } else {
+            out.push_back(code[pc]);
+            lines.push_back(program.lines[pc]);
+        }
+    }
+    remap[code.size()] = out.size();
+
+    relocate(program, std::move(out), std::move(lines), remap);
+}
@@ -0,0 +1,19 @@
+#ifndef STRENGTH_REDUCTION_HPP
+#define STRENGTH_REDUCTION_HPP
+
+#include "bytecode.hpp"
+
+// Replaces arithmetic by a constant with cheaper instructions that give the
+// same result:
+//
+//   PUSH 2^k, MUL  ->  MUL_POW2 k
+//   PUSH 2^k, DIV  ->  DIV_POW2 k     rounds toward zero like DIV
+//   PUSH 2^k, MOD  ->  MOD_POW2 k     keeps the sign of the dividend like MOD
+//   PUSH 2, POW    ->  DUP, MUL
+//
+// for k from 1 to 30. A pair is left alone when a jump lands on its second
+// instruction. Runs after fuseSuperinstructions, which may take the PUSH
+// into a fused instruction first.
+void reduceStrength(Program& program);
+
+#endif  // STRENGTH_REDUCTION_HPP
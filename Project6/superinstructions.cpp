@@ -0,0 +1,230 @@
+#include "superinstructions.hpp"
+
+#include <climits>
+#include <vector>
+
+namespace {
+
+bool isLoad(OpCode op) {
+    return op == OpCode::LOAD_LOCAL || op == OpCode::LOAD_GLOBAL;
+}
+
+OpCode storeFor(OpCode load) {
+    return load == OpCode::LOAD_LOCAL ? OpCode::STORE_LOCAL : OpCode::STORE_GLOBAL;
+}
+
+// compare-and-branch superinstruction of a comparison, HALT when there is none
+OpCode branchFor(OpCode compare) {
+    switch (compare) {
+        case OpCode::LT:
+            return OpCode::JUMP_UNLESS_LOCAL_LT;
+        case OpCode::LE:
+            return OpCode::JUMP_UNLESS_LOCAL_LE;
+        case OpCode::GT:
+            return OpCode::JUMP_UNLESS_LOCAL_GT;
+        case OpCode::GE:
+            return OpCode::JUMP_UNLESS_LOCAL_GE;
+        case OpCode::EQ:
+            return OpCode::JUMP_UNLESS_LOCAL_EQ;
+        case OpCode::NE:
+            return OpCode::JUMP_UNLESS_LOCAL_NE;
+        default:
+            return OpCode::HALT;
+    }
+}
+
+// instructions that only compute a value, they may appear inside a fused
+// multiply-add
+bool isPure(OpCode op) {
+    switch (op) {
+        case OpCode::PUSH:
+        case OpCode::PUSH_STRING:
+        case OpCode::LOAD_LOCAL:
+        case OpCode::LOAD_GLOBAL:
+        case OpCode::LOAD_ELEMENT:
+        case OpCode::LOAD_ELEMENT_UNCHECKED:
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+        case OpCode::MOD:
+        case OpCode::POW:
+        case OpCode::LT:
+        case OpCode::LE:
+        case OpCode::GT:
+        case OpCode::GE:
+        case OpCode::EQ:
+        case OpCode::NE:
+        case OpCode::NOT:
+        case OpCode::CALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+class Fuser {
+   public:
+    explicit Fuser(Program& program) : program(program), code(program.code) {}
+
+    void run() {
+        isTarget = jumpTargets(program);
+
+        std::vector<size_t> remap(code.size() + 1);
+        for (size_t pc = 0; pc < code.size();) {
+            size_t start = out.size();
+            size_t next = fuse(pc);
+            for (size_t old = pc; old < next; old++) {
+                remap[old] = start;
+            }
+            pc = next;
+        }
+        remap[code.size()] = out.size();
+
+        relocate(program, std::move(out), std::move(lines), remap);
+    }
+
+   private:
+    Program& program;
+    const std::vector<Instruction>& code;
+    std::vector<bool> isTarget;
+
+    std::vector<Instruction> out;
+    std::vector<int> lines;
+
+    // true when code[pc, pc + length) exists and no jump lands after its first instruction
+    bool straight(size_t pc, size_t length) {
+        if (pc + length > code.size()) {
+            return false;
+        }
+        for (size_t i = pc + 1; i < pc + length; i++) {
+            if (isTarget[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void emit(Instruction instruction, size_t line) {
+        out.push_back(instruction);
+        lines.push_back(program.lines[line]);
+    }
+
+    // Emits the instruction at pc or a superinstruction starting there,
+    // returns where the next one starts
+    size_t fuse(size_t pc) {
+        const Instruction& load = code[pc];
+        if (isLoad(load.op) && straight(pc, 3) && code[pc + 1].op == OpCode::PUSH) {
+            int slot = load.a;
+            int constant = code[pc + 1].a;
+            OpCode op = code[pc + 2].op;
+
+            // s = s + k, s = s - k
+            if ((op == OpCode::ADD || (op == OpCode::SUB && constant != INT_MIN)) && straight(pc, 4) &&
+                code[pc + 3].op == storeFor(load.op) && code[pc + 3].a == slot) {
+                OpCode inc = load.op == OpCode::LOAD_LOCAL ? OpCode::INC_LOCAL : OpCode::INC_GLOBAL;
+                emit({inc, slot, op == OpCode::ADD ? constant : -constant, 0}, pc + 3);
+                return pc + 4;
+            }
+
+            // s < k as a branch condition
+            if (load.op == OpCode::LOAD_LOCAL && branchFor(op) != OpCode::HALT && straight(pc, 4) &&
+                code[pc + 3].op == OpCode::JUMP_IF_FALSE) {
+                emit({branchFor(op), slot, constant, code[pc + 3].a}, pc + 3);
+                return pc + 4;
+            }
+
+            // s = s * k + y
+            if (load.op == OpCode::LOAD_LOCAL && op == OpCode::MUL) {
+                size_t add = outerAdd(pc + 3);
+                if (add && straight(pc, add - pc + 2) && code[add + 1].op == OpCode::STORE_LOCAL &&
+                    code[add + 1].a == slot) {
+                    for (size_t i = pc + 3; i < add; i++) {
+                        emit(code[i], i);
+                    }
+                    emit({OpCode::MUL_ADD_LOCAL, slot, constant, 0}, add + 1);
+                    return add + 2;
+                }
+            }
+        }
+
+        emit(load, pc);
+        return pc + 1;
+    }
+
+    // From the start of y in s * k + y, the ADD that adds y to s * k, or 0
+    // when y is not a plain expression
+    size_t outerAdd(size_t pc) {
+        int depth = 0;
+        for (size_t i = pc; i < code.size(); i++) {
+            if (depth == 1 && code[i].op == OpCode::ADD) {
+                return i;
+            }
+            int effect = stackEffect(code[i]);
+            if (!isPure(code[i].op) || depth + effect < 1) {
+                return 0;
+            }
+            depth += effect;
+        }
+        return 0;
+    }
+};
+
+// loop superinstruction of the compare-and-branch heading a loop, HALT when
+// there is none
+OpCode loopFor(OpCode test) {
+    switch (test) {
+        case OpCode::JUMP_UNLESS_LOCAL_LT:
+            return OpCode::LOOP_LT_LOCAL;
+        case OpCode::JUMP_UNLESS_LOCAL_LE:
+            return OpCode::LOOP_LE_LOCAL;
+        default:
+            return OpCode::HALT;
+    }
+}
+
+// Joins the step at the end of a counted loop with the test at its head:
+// INC_LOCAL s 1 and JUMP back to JUMP_UNLESS_LOCAL_LT s k exit becomes
+// LOOP_LT_LOCAL s k to the instruction after the test, followed by a JUMP to
+// the exit unless that comes right after anyway. The test stays in place for
+// the first iteration.
+void fuseLoops(Program& program) {
+    const std::vector<Instruction>& code = program.code;
+    std::vector<bool> isTarget = jumpTargets(program);
+
+    std::vector<Instruction> out;
+    std::vector<int> lines;
+    std::vector<size_t> remap(code.size() + 1);
+    for (size_t pc = 0; pc < code.size(); pc++) {
+        remap[pc] = out.size();
+        const Instruction& step = code[pc];
+        if (step.op == OpCode::INC_LOCAL && step.b == 1 && pc + 1 < code.size() && !isTarget[pc + 1] &&
+            code[pc + 1].op == OpCode::JUMP && (size_t)code[pc + 1].a < pc) {
+            size_t header = code[pc + 1].a;
+            const Instruction& test = code[header];
+            if (loopFor(test.op) != OpCode::HALT && test.a == step.a) {
+                out.push_back({loopFor(test.op), step.a, test.b, (int)header + 1});
+                lines.push_back(program.lines[pc]);
+                remap[pc + 1] = out.size();
+                if ((size_t)test.c != pc + 2) {
+                    out.push_back({OpCode::JUMP, test.c, 0, 0});
+                    lines.push_back(program.lines[pc + 1]);
+                }
+                pc++;
+                continue;
+            }
+        }
+        out.push_back(step);
+        lines.push_back(program.lines[pc]);
+    }
+    remap[code.size()] = out.size();
+
+    relocate(program, std::move(out), std::move(lines), remap);
+}
+
+}  // namespace
+
+void fuseSuperinstructions(Program& program) {
+    Fuser(program).run();
+    fuseLoops(program);
+}
@@ -0,0 +1,23 @@
+#ifndef SUPERINSTRUCTIONS_HPP
+#define SUPERINSTRUCTIONS_HPP
+
+#include "bytecode.hpp"
+
+// Replaces the common instruction sequences of compiled programs with single
+// superinstructions:
+//
+//   LOAD s, PUSH k, ADD/SUB, STORE s          ->  INC_LOCAL/INC_GLOBAL s ±k
+//   LOAD_LOCAL s, PUSH k, <cmp>, JUMP_IF_FALSE ->  JUMP_UNLESS_LOCAL_<cmp>
+//   LOAD_LOCAL s, PUSH k, MUL, <y>, ADD, STORE_LOCAL s  ->  <y>, MUL_ADD_LOCAL s k
+//
+// and then closes counted loops, whose step jumps back to the test at their
+// head, with a single instruction that steps and tests:
+//
+//   INC_LOCAL s 1, JUMP h  ->  LOOP_LT_LOCAL/LOOP_LE_LOCAL s k h+1, [JUMP exit]
+//     where h is JUMP_UNLESS_LOCAL_LT/LE s k exit
+//
+// A sequence is only fused when no jump lands inside it. Jump targets,
+// function entries and line numbers are moved along with the code.
+void fuseSuperinstructions(Program& program);
+
+#endif  // SUPERINSTRUCTIONS_HPP
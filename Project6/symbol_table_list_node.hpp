@@ -6,6 +6,8 @@
 #include <variant>
 #include <string>
 
+class Array;
+
 class SymbolTableListNode : public ListNode<SymbolTableListNode> {
 public:
     SymbolTableListNode() = default;
@@ -20,9 +22,9 @@ public:
     SymbolTableListNode *removeParameter(const std::string &identiferName);
 
 public:
-    // Variant type to store different possible values
-    using Value = std::variant<int, char, bool, std::string>;
-    Value value;
+    // Variant type to store different possible values, arrays are held by
+    // pointer and live as long as the frame that declared them
+    using Value = std::variant<int, char, bool, Array*>;
 
     bool isArray{false};
 
@@ -30,6 +32,12 @@ public:
     size_t arraySize{0};
     int address{0};
 
+    // index of this variable's value in its frame (or in the globals)
+    int slot{-1};
+    // number of slots a call to this function/procedure needs
+    size_t frameSize{0};
+    size_t parameterCount{0};
+
     std::string identifierName{};
 
     TokenType identifierType{TokenType::INVALID_TOKEN};
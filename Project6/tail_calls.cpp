@@ -0,0 +1,144 @@
+#include "tail_calls.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+bool declaresArrays(ASTListNode* declaration) {
+    for (ASTListNode* row = nextRow(declaration); row && row != declaration->end; row = nextRow(row)) {
+        if (row->type == ASTNodeType::DECLARATION && row->symbol && row->symbol->isArray) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// where execution goes on from pc, past unconditional jumps
+size_t followJumps(const std::vector<Instruction>& code, size_t pc) {
+    for (size_t hops = 0; pc < code.size() && code[pc].op == OpCode::JUMP && hops < code.size(); hops++) {
+        pc = code[pc].a;
+    }
+    return pc;
+}
+
+// whether the code from pc returns what is on top of the stack, or for a
+// procedure drops it and returns anything
+bool returnsRightAway(const std::vector<Instruction>& code, size_t pc, bool procedure) {
+    pc = followJumps(code, pc);
+    if (procedure && pc < code.size() && code[pc].op == OpCode::POP) {
+        pc = followJumps(code, pc + 1);
+        if (pc >= code.size() || code[pc].op != OpCode::PUSH) {
+            return false;
+        }
+        pc = followJumps(code, pc + 1);
+    }
+    return pc < code.size() && code[pc].op == OpCode::RETURN;
+}
+
+}  // namespace
+
+TailCallAnalysis::TailCallAnalysis(Interpreter& interpreter) : interpreter(interpreter) {}
+
+void TailCallAnalysis::run() {
+    for (ASTListNode* declaration : interpreter.getFunctions()) {
+        if (declaration->body && !declaresArrays(declaration)) {
+            markBlock(declaration, declaration->body, true);
+        }
+    }
+}
+
+// Marks the tail calls in the block whose first row is first, which is the
+// last thing its function does when tail is set
+void TailCallAnalysis::markBlock(ASTListNode* declaration, ASTListNode* first, bool tail) {
+    for (ASTListNode* row = first; row && row->type != ASTNodeType::END_BLOCK;) {
+        switch (row->type) {
+            case ASTNodeType::IF: {
+                if (!row->end) {
+                    return;
+                }
+                // past the else block, when there is one
+                ASTListNode* next = nextRow(row->end);
+                bool last = tail && next && next->type == ASTNodeType::END_BLOCK;
+                markBlock(declaration, row->body, last);
+                markBlock(declaration, row->elseBody, last);
+                row = next;
+                continue;
+            }
+            case ASTNodeType::WHILE:
+            case ASTNodeType::FOR1:
+                if (!row->end) {
+                    return;
+                }
+                markBlock(declaration, row->body, false);
+                row = nextRow(row->end);
+                continue;
+            case ASTNodeType::BEGIN_BLOCK:
+                // a block of its own, its end is not recorded
+                return;
+            case ASTNodeType::RETURN:
+                markReturn(declaration, row);
+                break;
+            case ASTNodeType::CALL: {
+                ASTListNode* next = nextRow(row);
+                bool procedure = declaration->symbol->identifierType == TokenType::PROCEDURE;
+                if (tail && procedure && row->callee == declaration && next && next->type == ASTNodeType::END_BLOCK) {
+                    row->tailCall = true;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        row = nextRow(row);
+    }
+}
+
+// return f(...) where f is the function returning and nothing follows the
+// closing paren of the call
+void TailCallAnalysis::markReturn(ASTListNode* declaration, ASTListNode* row) {
+    ASTListNode* call = row->sibling;
+    if (!call || call->callee != declaration || !call->sibling ||
+        call->sibling->token->type != TokenType::L_PAREN) {
+        return;
+    }
+    int depth = 0;
+    for (ASTListNode* node = call->sibling; node; node = node->sibling) {
+        if (node->token->type == TokenType::L_PAREN) {
+            depth++;
+        } else if (node->token->type == TokenType::R_PAREN && --depth == 0) {
+            if (!node->sibling) {
+                call->tailCall = true;
+            }
+            return;
+        }
+    }
+}
+
+void eliminateTailCalls(Program& program) {
+    std::vector<Instruction>& code = program.code;
+    for (size_t function = 0; function < program.functions.size(); function++) {
+        // a function runs up to the next function's entry, like in Jit::compile
+        const FunctionInfo& info = program.functions[function];
+        if (info.entry == 0) {  // not reachable from main
+            continue;
+        }
+        size_t last = code.size();
+        for (const FunctionInfo& other : program.functions) {
+            if (other.entry > info.entry && other.entry < last) {
+                last = other.entry;
+            }
+        }
+        if (std::any_of(code.begin() + info.entry, code.begin() + last,
+                        [](const Instruction& instruction) { return instruction.op == OpCode::NEW_ARRAY_LOCAL; })) {
+            continue;
+        }
+
+        for (size_t pc = info.entry; pc < last; pc++) {
+            if (code[pc].op == OpCode::CALL && code[pc].a == (int)function &&
+                returnsRightAway(code, pc + 1, info.procedure)) {
+                code[pc].op = OpCode::TAIL_CALL;
+            }
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TAIL_CALLS_HPP
+#define TAIL_CALLS_HPP
+
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+
+// A call of the running function that is the last thing it does, the value
+// of a return or the last statement of a procedure, starts the function over
+// in the frame it already has instead of pushing a new one. Deep recursion
+// then runs in constant stack space. Functions declaring local arrays keep
+// their calls, an argument may be one of the arrays the new frame would drop.
+
+// For the AST engine: marks the call nodes (tailCall) that Executor::call
+// runs in the frame of the call they are in.
+class TailCallAnalysis {
+   public:
+    explicit TailCallAnalysis(Interpreter& interpreter);
+    void run();
+
+   private:
+    void markBlock(ASTListNode* declaration, ASTListNode* first, bool tail);
+    void markReturn(ASTListNode* declaration, ASTListNode* row);
+
+   private:
+    Interpreter& interpreter;
+};
+
+// Rewrites the bytecode: CALL of the function it is in becomes TAIL_CALL when
+// what follows, through unconditional jumps, is
+//
+//   RETURN                      the function returns the call's result
+//   POP, PUSH k, RETURN         a procedure, whose result nobody reads
+//
+// Runs before fuseSuperinstructions, on code of the Compiler or lowerIr.
+void eliminateTailCalls(Program& program);
+
+#endif  // TAIL_CALLS_HPP
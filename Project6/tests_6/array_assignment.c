@@ -0,0 +1,32 @@
+// ***************************************************
+// * Array assignment: the target keeps the size it  *
+// * was declared with, a shorter source is padded   *
+// * with zeros and a longer one is an error         *
+// ***************************************************
+
+procedure main (void)
+{
+  int big[6];
+  int small[3];
+  char name[5];
+  int i;
+
+  for (i = 0; i < 6; i = i + 1)
+  {
+    big[i] = i + 10;
+  }
+  small[0] = 1;
+  small[1] = 2;
+  small[2] = 3;
+
+  big = small;
+  printf ("big %d %d %d %d %d %d\n", big[0], big[1], big[2], big[3], big[4], big[5]);
+
+  name = "Bob";
+  printf ("name %s, name[4] %d\n", name, name[4]);
+  name = "Alice";
+  printf ("name %s\n", name);
+
+  small = big;
+  printf ("not reached %d\n", small[0]);
+}
@@ -0,0 +1,37 @@
+// ***************************************************
+// * Bounds checks: counted loops index without them *
+// * and an index past the end is a runtime error,   *
+// * also after a shorter array is assigned to it    *
+// ***************************************************
+procedure main (void)
+{
+  int a[10];
+  int b[4];
+  int i;
+  int j;
+  int sum;
+
+  for (i = 0; i < 10; i = i + 1)
+  {
+    a[i] = i;
+  }
+  sum = 0;
+  for (i = 1; i <= 9; i = i + 2)
+  {
+    for (j = 0; j < 3; j = j + 1)
+    {
+      sum = sum + a[i - 1] + a[j + 7];
+    }
+  }
+  printf ("sum = %d\n", sum);
+
+  b[3] = 5;
+  a = b;
+  j = 0;
+  while (j < 12)
+  {
+    sum = sum + a[j];
+    j = j + 1;
+  }
+  printf ("not reached %d\n", sum);
+}
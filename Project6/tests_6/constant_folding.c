@@ -0,0 +1,71 @@
+// ***************************************************
+// * Constant folding: constant operators, variables *
+// * assigned a constant in the same basic block and *
+// * ifs whose condition ends up constant            *
+// ***************************************************
+int level;
+
+function int bump (int by)
+{
+  level = level + by;
+  return level;
+}
+
+procedure main (void)
+{
+  int debug;
+  int size;
+  int area;
+  int x;
+  char c;
+
+  size = 4 * 8 + 2;
+  area = size * size - 6 / 4;
+  c = 'a' + 2;
+  printf ("%d %d %c\n", size, area, c);
+  if (size > 30 && area < 2000)
+  {
+    printf ("both hold\n");
+  }
+
+  debug = 0;
+  if (debug)
+  {
+    printf ("not printed\n");
+  }
+  else
+  {
+    printf ("debug is off\n");
+  }
+  if (size - 34 == 0)
+  {
+    x = size + 1 - 3 + 10;
+    printf ("x = %d\n", x);
+  }
+  if (FALSE && bump (100) > 0)
+  {
+    printf ("not printed\n");
+  }
+
+  level = 5;
+  x = bump (1) + level;
+  printf ("level = %d, x = %d\n", level, x);
+
+  x = 3;
+  while (x < 6)
+  {
+    x = x + 1;
+  }
+  printf ("x = %d\n", x);
+
+  x = 0;
+  c = 'z';
+  x = x + c - 'a' + 1;
+  printf ("x = %d\n", x);
+  x = (0 - 2147483647 - 1) / -1;
+  printf ("wrapped %d\n", x);
+  x = (0 - 2147483647 - 1) % -1;
+  printf ("wrapped %d\n", x);
+  x = 7 / (size - 34);
+  printf ("not reached %d\n", x);
+}
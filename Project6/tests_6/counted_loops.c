@@ -0,0 +1,113 @@
+// ***************************************************
+// * Counted loops: unrolled by 4 and by 2, odd trip *
+// * counts, <= and larger steps, branches and swaps *
+// * in the body, a return out of the loop, and the  *
+// * counter after the loop                          *
+// ***************************************************
+
+function int firstOver (int limit)
+{
+  int i;
+  int square;
+  for (i = 0; i < 20; i = i + 1)
+  {
+    square = i * i;
+    if (square > limit)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+procedure main (void)
+{
+  int i;
+  int j;
+  int a;
+  int b;
+  int t;
+  int sum;
+  int odd;
+  int zero;
+  int values[24];
+
+  for (i = 0; i < 24; i = i + 1)
+  {
+    values[i] = i * 3 - 20;
+  }
+  printf ("counter after 24 iterations %d\n", i);
+
+  sum = 0;
+  for (i = 0; i <= 23; i = i + 1)
+  {
+    sum = sum + values[i];
+  }
+  printf ("sum %d, counter %d\n", sum, i);
+
+  sum = 0;
+  odd = 0;
+  for (i = 2; i < 20; i = i + 3)
+  {
+    if (values[i] % 2 == 0)
+    {
+      sum = sum + values[i];
+    }
+    else
+    {
+      odd = odd + 1;
+    }
+  }
+  printf ("even sum %d, odd %d, counter %d\n", sum, odd, i);
+
+  a = 0;
+  b = 1;
+  for (i = 0; i < 30; i = i + 1)
+  {
+    t = a;
+    a = b;
+    b = (t + b) % 10007;
+  }
+  printf ("fibonacci %d %d\n", a, b);
+
+  sum = 0;
+  for (i = -5; i < 6; i = i + 1)
+  {
+    sum = sum * 3 + i;
+  }
+  printf ("eleven iterations %d, counter %d\n", sum, i);
+
+  sum = 0;
+  for (i = 0; i < 6; i = i + 1)
+  {
+    for (j = 0; j < 8; j = j + 1)
+    {
+      sum = sum + i * j;
+    }
+  }
+  printf ("nested %d, counters %d %d\n", sum, i, j);
+
+  sum = 0;
+  for (i = 10; i < 10; i = i + 1)
+  {
+    sum = sum + 1;
+  }
+  printf ("never ran %d, counter %d\n", sum, i);
+
+  t = firstOver (50);
+  printf ("first square over 50 at %d\n", t);
+  t = firstOver (1000);
+  printf ("no square over 1000 %d\n", t);
+
+  zero = 0;
+  sum = 0;
+  for (i = 0; i < 8; i = i + 1)
+  {
+    if (i == 6)
+    {
+      zero = 1;
+    }
+    sum = sum + 100 / (1 - zero);
+    printf ("iteration %d sum %d\n", i, sum);
+  }
+}
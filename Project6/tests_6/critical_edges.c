@@ -0,0 +1,63 @@
+// ***************************************************
+// * Critical edges: branches straight into blocks   *
+// * with phis, from ifs without else, && and || and *
+// * an inlined helper, each needing a block of its  *
+// * own for the copies                              *
+// ***************************************************
+
+function int clamp (int n)
+{
+  int k;
+  if (n > 5)
+  {
+    n = 5;
+  }
+  for (k = 0; k < 0; k = k + 1)
+  {
+  }
+  return n;
+}
+
+procedure main (void)
+{
+  int i;
+  int total;
+  int odd;
+  int big;
+  int steps;
+  i = 0;
+  total = 0;
+  odd = 0;
+  big = 0;
+  steps = 0;
+  big = clamp (big + 3);
+  while ((i < 12) || (total < 0))
+  {
+    total = total + clamp (i);
+    if (i % 2 == 1)
+    {
+      odd = odd + i;
+    }
+    if ((i > 3) && (i < 9))
+    {
+      big = big + 1;
+    }
+    if ((i == 2) || (i == 10))
+    {
+      steps = steps + 100;
+    }
+    i = i + 1;
+  }
+  printf ("total %d\n", total);
+  printf ("odd %d big %d steps %d\n", odd, big, steps);
+  i = 20;
+  while (i > 0)
+  {
+    if (i % 3 == 0)
+    {
+      steps = steps + 1;
+    }
+    i = i - 1;
+  }
+  printf ("steps %d i %d\n", steps, i);
+}
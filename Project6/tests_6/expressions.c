@@ -0,0 +1,62 @@
+// ***************************************************
+// * Expression precedence: && binds tighter than || *
+// * and < than ==, - and ! negate, conditions can   *
+// * be assigned, calls take any expression          *
+// ***************************************************
+function int twice (int n)
+{
+  return n * 2;
+}
+
+function bool between (int n, int low, int high)
+{
+  return low <= n && n <= high;
+}
+
+procedure main (void)
+{
+  int a;
+  int b;
+  int c;
+  int values[4];
+  bool t;
+  bool u;
+
+  a = 5;
+  b = -a;
+  c = - (a + 2) * 3;
+  printf ("%d %d\n", b, c);
+
+  c = -a ^ 2;
+  printf ("-a ^ 2 = %d\n", c);
+  c = a - -b;
+  printf ("a - -b = %d\n", c);
+  c = 20 - 5 - 3;
+  printf ("20 - 5 - 3 = %d\n", c);
+  c = 64 / 4 / 2;
+  printf ("64 / 4 / 2 = %d\n", c);
+
+  t = TRUE || FALSE && FALSE;
+  printf ("TRUE || FALSE && FALSE = %d\n", t);
+  t = FALSE && FALSE || TRUE;
+  printf ("FALSE && FALSE || TRUE = %d\n", t);
+  t = 1 == 2 < 3;
+  printf ("1 == 2 < 3 = %d\n", t);
+  t = !(a > 3) || b < 0;
+  u = !t;
+  printf ("%d %d\n", t, u);
+
+  if (a * -2 < -9 && !(b > 0))
+  {
+    printf ("negatives compare\n");
+  }
+
+  values[a - 4] = twice (a + 1) - 1;
+  values[0] = values[a - 4] * -1;
+  c = values[0];
+  printf ("%d\n", c);
+
+  t = between (twice (a) - 3, a + 1, values[a - 4]);
+  u = between (-a, 0, 10);
+  printf ("%d %d\n", t, u);
+}
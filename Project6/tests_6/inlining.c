@@ -0,0 +1,106 @@
+// ***************************************************
+// * Inlining: small leaf functions called in loops, *
+// * several returns, array arguments, side effects  *
+// * in order, and errors on the callee's line       *
+// ***************************************************
+
+int calls;
+
+function int sign (int n)
+{
+  calls = calls + 1;
+  if (n < 0)
+  {
+    return -1;
+  }
+  if (n > 0)
+  {
+    return 1;
+  }
+  return 0;
+}
+
+function int clamp (int n, int low, int high)
+{
+  if (n < low)
+  {
+    n = low;
+  }
+  if (n > high)
+  {
+    n = high;
+  }
+  return n;
+}
+
+function int steps (int n)
+{
+  return sign (n) + clamp (n, -2, 2);
+}
+
+function int at (int values[4], int i)
+{
+  return values[i] * 10;
+}
+
+procedure set (int values[4], int i, int value)
+{
+  values[i] = value;
+}
+
+procedure show (int n)
+{
+  printf ("show %d\n", n);
+}
+
+function int fact (int n)
+{
+  if (n < 2)
+  {
+    return 1;
+  }
+  return n * fact (n - 1);
+}
+
+function int scratch (int n)
+{
+  int local[2];
+  local[1] = local[1] + n;
+  return local[1];
+}
+
+function int ratio (int a, int b)
+{
+  return a / b;
+}
+
+procedure main (void)
+{
+  int values[4];
+  int i;
+  int sum;
+
+  sum = 0;
+  for (i = -5; i <= 5; i = i + 1)
+  {
+    sum = sum * 3 + steps (i);
+  }
+  printf ("sum %d calls %d\n", sum, calls);
+
+  for (i = 0; i < 4; i = i + 1)
+  {
+    set (values, i, i * i);
+  }
+  sum = 0;
+  for (i = 0; i < 4; i = i + 1)
+  {
+    sum = sum + at (values, i);
+  }
+  printf ("sum %d\n", sum);
+
+  show (1);
+  i = clamp (sign (-7), 0, 9) + fact (5) + scratch (3) + scratch (4);
+  show (i);
+  i = ratio (7, 0);
+  show (i);
+}
@@ -0,0 +1,69 @@
+// ***************************************************
+// * Arrays: int and bool arrays, elements in printf *
+// * and expressions, arrays passed to functions     *
+// ***************************************************
+
+int squares[8];
+
+procedure fill (int values[8], int count)
+{
+  int i;
+  for (i = 0; i < count; i = i + 1)
+  {
+    values[i] = i * i * 1000;
+  }
+}
+
+function int total (int values[8], int count)
+{
+  int i;
+  int sum;
+  sum = 0;
+  for (i = 0; i < count; i = i + 1)
+  {
+    sum = sum + values[i];
+  }
+  return sum;
+}
+
+function int depth (int n)
+{
+  int local[4];
+  local[0] = n;
+  if (n > 0)
+  {
+    depth (n - 1);
+  }
+  return local[0] + local[1];
+}
+
+procedure main (void)
+{
+  int copy[8];
+  bool flags[4];
+  char name[8];
+  int i;
+
+  fill (squares, 8);
+  i = total (squares, 8);
+  printf ("squares[7] = %d, total = %d\n", squares[7], i);
+
+  copy = squares;
+  copy[0] = -5;
+  printf ("copy[0] = %d, squares[0] = %d, copy[3] = %d\n", copy[0], squares[0], copy[3]);
+
+  flags[1] = 7;
+  flags[2] = squares[1];
+  printf ("flags %d %d %d\n", flags[0], flags[1], flags[2]);
+
+  name = "Ada";
+  name[0] = 'I';
+  printf ("name %s, name[1] %c\n", name, name[1]);
+
+  i = 2;
+  squares[i + 1] = squares[i] + squares[i * 2];
+  i = i + 1;
+  printf ("squares[3] = %d\n", squares[i]);
+  i = depth (5);
+  printf ("depth = %d\n", i);
+}
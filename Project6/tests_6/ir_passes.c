@@ -0,0 +1,86 @@
+// ***************************************************
+// * IR passes: constants through branches and loops,*
+// * repeated subexpressions, dead code, && and ||   *
+// * as values                                       *
+// ***************************************************
+
+function int twice (int n)
+{
+  int unused;
+  unused = n * 1000;
+  return n + n;
+}
+
+function int scale (int a, int b)
+{
+  int k;
+  int r;
+  k = 4;
+  if (a > b)
+  {
+    r = a * k;
+  }
+  else
+  {
+    r = b * k;
+  }
+  return r + (a - b) * (a - b);
+}
+
+procedure main (void)
+{
+  int i;
+  int j;
+  int c;
+  int sum;
+  int square;
+  int g;
+  bool both;
+  bool either;
+
+  c = 3;
+  if (c > 2)
+  {
+    j = c + 1;
+  }
+  else
+  {
+    j = c - 1;
+  }
+  printf ("j %d\n", j);
+
+  sum = 0;
+  square = 0;
+  for (i = 0; i < 10; i = i + 1)
+  {
+    g = i * i + c;
+    square = i * i + c;
+    sum = sum + g + square;
+  }
+  printf ("sum %d square %d i %d\n", sum, square, i);
+
+  i = 0;
+  j = 1;
+  while (i < 5)
+  {
+    c = j;
+    j = i;
+    i = c + 1;
+  }
+  printf ("i %d j %d c %d\n", i, j, c);
+
+  both = (i > 1) && (j < 100);
+  either = (i > 100) || (j == 4);
+  printf ("both %d either %d\n", both, either);
+  both = (i > 100) && (twice (i) > 0);
+  either = (i < 100) || (twice (i) > 0);
+  printf ("both %d either %d\n", both, either);
+
+  i = twice (21);
+  j = scale (5, 2);
+  c = scale (2, 5);
+  printf ("twice %d scale %d %d\n", i, j, c);
+  i = 0;
+  j = 7 / i;
+  printf ("not reached %d\n", j);
+}
@@ -0,0 +1,94 @@
+// ***************************************************
+// * Loop invariants: what only the outer loop       *
+// * changes, a loop that never runs, globals a call *
+// * changes, pure and printing calls                *
+// ***************************************************
+
+int total;
+int limit;
+
+function int mix (int a, int b)
+{
+  int h;
+  h = (a * 31 + b) % 1000;
+  if (h < 0)
+  {
+    h = 0 - h;
+  }
+  h = (h * 17 + a) % 1000;
+  h = (h * 13 + b) % 1000;
+  h = (h * 11 + a) % 1000;
+  h = (h * 7 + b) % 1000;
+  h = (h * 5 + a) % 1000;
+  h = (h * 3 + b) % 1000;
+  return h;
+}
+
+function int tick (int n)
+{
+  printf ("tick %d\n", n);
+  return n;
+}
+
+procedure raise (void)
+{
+  limit = limit + 1;
+}
+
+procedure main (void)
+{
+  int i;
+  int j;
+  int k;
+  int zero;
+  int sum;
+
+  sum = 0;
+  k = 7;
+  for (i = 0; i < 4; i = i + 1)
+  {
+    for (j = 0; j < 5; j = j + 1)
+    {
+      sum = sum + i * k + j + mix (i, k) + mix (3, 4);
+    }
+  }
+  printf ("sum %d\n", sum);
+
+  zero = 0;
+  for (i = 0; i < zero; i = i + 1)
+  {
+    sum = sum + 100 / zero;
+  }
+  printf ("after the empty loop %d\n", sum);
+
+  limit = 3;
+  i = 0;
+  while (i < limit)
+  {
+    if (i < 10)
+    {
+      raise ();
+    }
+    i = i + 1;
+    if (i > 12)
+    {
+      limit = 0;
+    }
+  }
+  printf ("i %d limit %d\n", i, limit);
+
+  total = 0;
+  for (i = 0; i < 3; i = i + 1)
+  {
+    total = total + tick (k);
+  }
+  printf ("total %d\n", total);
+
+  j = 1;
+  for (i = 0; i < 3; i = i + 1)
+  {
+    sum = sum + k / j;
+    j = 0;
+  }
+  printf ("not reached %d\n", sum);
+}
@@ -0,0 +1,146 @@
+// ***************************************************
+// * Memoization: pure recursive and mutually        *
+// * recursive functions, a pure function assigning  *
+// * its parameters, and impure functions that read  *
+// * a global, print or take an array, which must    *
+// * run on every call                               *
+// ***************************************************
+
+int counter;
+
+function int fib (int n)
+{
+  if (n < 2)
+  {
+    return n;
+  }
+  return fib (n - 1) + fib (n - 2);
+}
+
+function int hexdigit2int (char hex_digit)
+{
+  int i;
+  int digit;
+  char digits[17];
+
+  digits = "0123456789ABCDEF";
+  digit = -1;
+  for (i = 0; i < 16; i = i + 1)
+  {
+    if (digits[i] == hex_digit)
+    {
+      digit = i;
+    }
+  }
+  return digit;
+}
+
+function int collatz (int n)
+{
+  int steps;
+  steps = 0;
+  while (n != 1)
+  {
+    if (n % 2 == 0)
+    {
+      n = n / 2;
+    }
+    else
+    {
+      n = 3 * n + 1;
+    }
+    steps = steps + 1;
+  }
+  return steps;
+}
+
+function bool isEven (int n)
+{
+  if (n == 0)
+  {
+    return TRUE;
+  }
+  return isOdd (n - 1);
+}
+
+function bool isOdd (int n)
+{
+  if (n == 0)
+  {
+    return FALSE;
+  }
+  return isEven (n - 1);
+}
+
+function int tick (int n)
+{
+  counter = counter + 1;
+  return n + counter;
+}
+
+function int loud (int n)
+{
+  printf ("loud %d\n", n);
+  return n * 2;
+}
+
+function int first (int values[4])
+{
+  return values[0];
+}
+
+function int viaTick (int n)
+{
+  return tick (n) + 1;
+}
+
+procedure main (void)
+{
+  int i;
+  int a;
+  int b;
+  int c;
+  int sum;
+  int values[4];
+
+  a = fib (27);
+  b = fib (20) + fib (27);
+  printf ("fib %d %d\n", a, b);
+
+  a = hexdigit2int ('F') * 16 + hexdigit2int ('F');
+  b = hexdigit2int ('7') * 16 + hexdigit2int ('x');
+  printf ("hex %d %d\n", a, b);
+
+  sum = 0;
+  for (i = 1; i <= 3000; i = i + 1)
+  {
+    sum = sum + collatz (i % 300 + 1);
+  }
+  printf ("collatz sum = %d\n", sum);
+
+  if (isEven (10))
+  {
+    printf ("10 is even\n");
+  }
+  if (isOdd (7))
+  {
+    printf ("7 is odd\n");
+  }
+
+  counter = 0;
+  a = tick (1);
+  b = tick (1);
+  c = tick (1);
+  printf ("tick %d %d %d\n", a, b, c);
+  a = viaTick (5);
+  b = viaTick (5);
+  printf ("via tick %d %d\n", a, b);
+  a = loud (3) + loud (3);
+  printf ("loud sum %d\n", a);
+
+  values[0] = 7;
+  a = first (values);
+  values[0] = 8;
+  b = first (values);
+  printf ("first %d %d\n", a, b);
+}
@@ -0,0 +1,51 @@
+// ***************************************************
+// * Nested blocks: false branches skip whole blocks *
+// ***************************************************
+
+procedure classify (int n)
+{
+  if (n > 10)
+  {
+    if (n > 100)
+    {
+      printf ("huge ");
+    }
+    else
+    {
+      printf ("big ");
+    }
+  }
+  else
+  {
+    while (n > 3)
+    {
+      n = n - 3;
+    }
+    if (n == 1)
+    {
+      printf ("one ");
+    }
+    else
+    {
+      printf ("%d ", n);
+    }
+  }
+}
+
+procedure main (void)
+{
+  int i;
+
+  for (i = 0; i < 12; i = i + 1)
+  {
+    if (i == 5)
+    {
+      for (i = i; i < 5; i = i + 1)
+      {
+        printf ("never ");
+      }
+    }
+    classify (i * i);
+  }
+  printf ("\n");
+}
@@ -0,0 +1,61 @@
+// **************************************************
+// * Integer power and arithmetic by powers of two: *
+// * ^ binds tighter than * and groups to the right *
+// * and / and % by 2^k round toward zero           *
+// **************************************************
+procedure main (void)
+{
+  int n;
+  int m;
+  int i;
+  int a;
+  int b;
+  int c;
+
+  a = 2 ^ 3 ^ 2;
+  b = 3 * 2 ^ 4 - 1;
+  printf ("%d %d\n", a, b);
+
+  n = 0 - 7;
+  a = n / 4;
+  b = n % 4;
+  c = n * 8;
+  printf ("%d %d %d\n", a, b, c);
+  n = 7;
+  a = n / 4;
+  b = n % 4;
+  c = n * 8;
+  printf ("%d %d %d\n", a, b, c);
+  n = 0 - 1024;
+  a = n / 1024;
+  b = n % 1024;
+  c = n / 2048;
+  printf ("%d %d %d\n", a, b, c);
+
+  n = 0 - 3;
+  a = n ^ 2;
+  b = n ^ 3;
+  c = n ^ 0;
+  printf ("%d %d %d\n", a, b, c);
+  m = 0 - 1;
+  a = 2 ^ m;
+  b = m ^ m;
+  c = 2 ^ 31;
+  printf ("%d %d %d\n", a, b, c);
+  m = 0 - 2;
+  a = 3 ^ 21;
+  b = m ^ 3 ^ 1;
+  printf ("%d %d\n", a, b);
+
+  m = 0;
+  for (i = 0 - 20; i <= 27; i = i + 1)
+  {
+    m = m + (i * i ^ 2) % 16 + i / 8 + i % 32;
+  }
+  printf ("m = %d\n", m);
+
+  n = 0;
+  m = 0 - 1;
+  a = n ^ m;
+  printf ("not reached %d\n", a);
+}
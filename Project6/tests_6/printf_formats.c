@@ -0,0 +1,21 @@
+// ***************************************************
+// * printf: %d %x %c %s, and a newline only at \n   *
+// ***************************************************
+
+procedure main (void)
+{
+  int n;
+  int m;
+  char letter;
+  char name[8];
+  n = 255;
+  m = 0 - n;
+  letter = 'q';
+  name = "Ada";
+  printf ("dec %d hex %x\n", n, n);
+  printf ("neg %d hex %x\n", m, m);
+  printf ("char %c and %c\n", letter, 65);
+  printf ("name %s, literal %s\n", name, "text");
+  printf ("no newline, ");
+  printf ("then one\n");
+}
@@ -0,0 +1,44 @@
+// ***************************************************
+// * Recursive calls: each call gets its own frame   *
+// ***************************************************
+
+function int fib (int n)
+{
+  if (n < 2)
+  {
+    return n;
+  }
+  return fib (n - 1) + fib (n - 2);
+}
+
+function int gcd (int a, int b)
+{
+  if (b == 0)
+  {
+    return a;
+  }
+  return gcd (b, a % b);
+}
+
+procedure countdown (int n)
+{
+  if (n > 0)
+  {
+    countdown (n - 1);
+    printf ("%d ", n);
+  }
+}
+
+procedure main (void)
+{
+  int n;
+  int result;
+
+  n = 30;
+  result = fib (n);
+  printf ("fib(%d) = %d\n", n, result);
+  result = gcd (1071, 462);
+  printf ("gcd(1071, 462) = %d\n", result);
+  countdown (10);
+  printf ("\n");
+}
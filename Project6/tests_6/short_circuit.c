@@ -0,0 +1,48 @@
+// ***************************************************
+// * Short circuit: && and || skip their right side  *
+// * when the left side decides, calls there too     *
+// ***************************************************
+
+function bool noisy (int n)
+{
+  printf ("noisy %d\n", n);
+  return n > 0;
+}
+
+procedure main (void)
+{
+  int i;
+  int digit;
+  i = 0;
+  digit = 5;
+  while ((i < 4) && (digit > -1))
+  {
+    i = i + 1;
+    digit = digit - 2;
+  }
+  printf ("i %d digit %d\n", i, digit);
+  if ((i > 100) && noisy (1))
+  {
+    printf ("wrong\n");
+  }
+  if ((i < 100) || noisy (2))
+  {
+    printf ("or\n");
+  }
+  if (((i > 100) && noisy (3)) || ((i < 100) && noisy (4)))
+  {
+    printf ("mixed\n");
+  }
+  if (!((i > 100) || noisy (0)))
+  {
+    printf ("not\n");
+  }
+  if (noisy (5) && noisy (6) && noisy (0) && noisy (7))
+  {
+    printf ("wrong\n");
+  }
+  else
+  {
+    printf ("chain\n");
+  }
+}
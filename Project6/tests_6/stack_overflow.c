@@ -0,0 +1,18 @@
+// ***************************************************
+// * Stack overflow: recursion that is not a tail    *
+// * call and never ends fails with an error instead *
+// * of crashing, after what was printed before it   *
+// ***************************************************
+
+function int depth (int n)
+{
+  return depth (n + 1) % 1000 + n;
+}
+
+procedure main (void)
+{
+  int d;
+  printf ("going down\n");
+  d = depth (0);
+  printf ("never printed %d\n", d);
+}
@@ -0,0 +1,98 @@
+// ***************************************************
+// * Tail calls: functions and procedures recursing  *
+// * ten million deep in a frame of their own, tail  *
+// * calls in both branches of an if, locals zeroed  *
+// * on every call, and calls that are not in tail   *
+// * position                                        *
+// ***************************************************
+
+int steps;
+
+function int sumTo (int n, int acc)
+{
+  if (n == 0)
+  {
+    return acc;
+  }
+  return sumTo (n - 1, (acc + n) % 1000003);
+}
+
+function int collatzSteps (int n, int count)
+{
+  if (n == 1)
+  {
+    return count;
+  }
+  if (n % 2 == 0)
+  {
+    return collatzSteps (n / 2, count + 1);
+  }
+  else
+  {
+    return collatzSteps (3 * n + 1, count + 1);
+  }
+}
+
+function int fresh (int n)
+{
+  int unset;
+  if (n == 0)
+  {
+    return unset;
+  }
+  unset = unset + 7;
+  return fresh (n - 1);
+}
+
+procedure walk (int n)
+{
+  if (n > 0)
+  {
+    steps = steps + 1;
+    walk (n - 1);
+  }
+}
+
+function int depth (int n)
+{
+  if (n == 0)
+  {
+    return 0;
+  }
+  return 1 + depth (n - 1);
+}
+
+function int withArray (int n, int acc)
+{
+  int digits[4];
+  digits[n % 4] = n;
+  if (n == 0)
+  {
+    return acc;
+  }
+  return withArray (n - 1, acc + digits[n % 4]);
+}
+
+procedure main (void)
+{
+  int result;
+
+  result = sumTo (10000000, 0);
+  printf ("sumTo = %d\n", result);
+
+  result = collatzSteps (27, 0);
+  printf ("collatz 27 takes %d steps\n", result);
+
+  result = fresh (1000);
+  printf ("fresh = %d\n", result);
+
+  steps = 0;
+  walk (10000000);
+  printf ("walked %d steps\n", steps);
+
+  result = depth (1000);
+  printf ("depth = %d\n", result);
+
+  result = withArray (100, 0);
+  printf ("withArray = %d\n", result);
+}
@@ -0,0 +1,257 @@
+#include "type_checker.hpp"
+
+#include <vector>
+
+bool isScalar(ValueType type) {
+    return type == ValueType::Int || type == ValueType::Char || type == ValueType::Bool;
+}
+
+// type of a scalar declared with datatype, or of an element of an array
+static ValueType scalarTypeOf(TokenType datatype) {
+    switch (datatype) {
+        case TokenType::INT:
+            return ValueType::Int;
+        case TokenType::CHAR:
+            return ValueType::Char;
+        case TokenType::BOOL:
+            return ValueType::Bool;
+        default:
+            return ValueType::Unknown;
+    }
+}
+
+// declared type of a variable or of a function's result
+static ValueType datatypeOf(SymbolTableListNode* symbol) {
+    if (symbol->isArray) {
+        return ValueType::String;
+    }
+    return scalarTypeOf(symbol->datatype);
+}
+
+TypeChecker::TypeChecker(Interpreter& interpreter) : interpreter(interpreter) {}
+
+void TypeChecker::check() {
+    size_t mixed;
+    do {
+        mixed = _mixed.size();
+        _function = nullptr;
+        for (size_t i = 0; i < interpreter.getAddressCount(); i++) {
+            checkRow(interpreter.getAddressAtInd(i));
+        }
+    } while (_mixed.size() != mixed);
+}
+
+void TypeChecker::checkRow(ASTListNode* row) {
+    ASTListNode* node = row->sibling;
+
+    switch (row->type) {
+        case ASTNodeType::DECLARATION:
+            if (row->symbol && (row->symbol->identifierType == TokenType::FUNCTION ||
+                                row->symbol->identifierType == TokenType::PROCEDURE)) {
+                _function = row->symbol;
+            }
+            break;
+        case ASTNodeType::ASSIGNMENT:
+            checkAssignment(row);
+            break;
+        case ASTNodeType::FOR1:
+        case ASTNodeType::FOR3:
+            if (node) {
+                checkAssignment(row);
+            }
+            break;
+        case ASTNodeType::IF:
+        case ASTNodeType::WHILE:
+        case ASTNodeType::FOR2:
+            if (node) {
+                checkExpression(node);
+            }
+            break;
+        case ASTNodeType::RETURN:
+            if (node && _function) {
+                assign(_function, checkExpression(node));
+            }
+            break;
+        case ASTNodeType::CALL:
+            row->valueType = checkCall(row);
+            break;
+        default:
+            break;
+    }
+}
+
+// target = expression, like Executor::executeAssignment
+void TypeChecker::checkAssignment(ASTListNode* row) {
+    ASTListNode* target = row->sibling;
+    ASTListNode* node = target->sibling;
+    if (!node) {
+        return;
+    }
+
+    // element store: target [ index ] value =
+    if (node->token->type == TokenType::L_BRACKET) {
+        node = node->sibling;
+        checkExpression(node);
+        if (node->sibling) {
+            node = node->sibling;
+            checkExpression(node);
+        }
+        return;
+    }
+
+    ValueType type = checkExpression(node);
+    if (target->symbol && target->symbol->slot >= 0) {
+        assign(target->symbol, type);
+    }
+}
+
+// Walks the expression starting at node the way Executor::evaluateExpression
+// does, leaving node where evaluation stops
+ValueType TypeChecker::checkExpression(ASTListNode*& node) {
+    ASTListNode* start = node;
+    std::vector<ValueType> types;
+    std::vector<ASTListNode*> operands;  // first node of each value in types
+    bool scalar = true;
+
+    while (node) {
+        TokenType type = node->token->type;
+
+        if (type == TokenType::R_BRACKET || type == TokenType::R_PAREN || type == TokenType::COMMA) {
+            break;
+        }
+
+        if (type == TokenType::IDENTIFIER) {
+            ASTListNode* next = node->sibling;
+            operands.push_back(node);
+
+            if (next && next->token->type == TokenType::L_PAREN) {
+                ASTListNode* callNode = node;
+                callNode->valueType = checkCall(node);
+                types.push_back(callNode->valueType);
+            } else if (next && next->token->type == TokenType::L_BRACKET) {
+                // an element has the datatype of its array, indexing
+                // anything else fails at run time on either path
+                ASTListNode* array = node;
+                node = next->sibling;
+                checkExpression(node);
+                ValueType element = array->symbol ? scalarTypeOf(array->symbol->datatype) : ValueType::Unknown;
+                array->valueType = isScalar(element) ? element : ValueType::Unknown;
+                types.push_back(array->valueType);
+            } else {
+                node->valueType = variableType(node);
+                types.push_back(node->valueType);
+            }
+        } else if (type == TokenType::BOOLEAN_NOT) {
+            if (types.empty()) {
+                scalar = false;
+                break;
+            }
+            types.back() = isScalar(types.back()) ? ValueType::Bool : ValueType::Unknown;
+            node->valueType = types.back();
+        } else if (isOperator(type) && type != TokenType::ASSIGNMENT_OPERATOR) {
+            if (types.size() < 2) {
+                scalar = false;
+                break;
+            }
+            ValueType rhs = types.back();
+            types.pop_back();
+            ValueType lhs = types.back();
+
+            ASTListNode* right = operands.back();
+            operands.pop_back();
+            if (type == TokenType::BOOLEAN_AND || type == TokenType::BOOLEAN_OR) {
+                right->shortCircuit = node;
+            }
+
+            // char - char and bool + bool are ints, every comparison is a bool
+            ValueType result = ValueType::Unknown;
+            if (isScalar(lhs) && isScalar(rhs)) {
+                bool arithmetic = type == TokenType::PLUS || type == TokenType::MINUS ||
+                                  type == TokenType::ASTERISK || type == TokenType::DIVIDE ||
+                                  type == TokenType::MODULO || type == TokenType::CARET;
+                result = arithmetic ? ValueType::Int : ValueType::Bool;
+            }
+            types.back() = result;
+            node->valueType = result;
+        } else if (type == TokenType::INTEGER) {
+            node->valueType = ValueType::Int;
+            operands.push_back(node);
+            types.push_back(ValueType::Int);
+        } else if (type == TokenType::CHAR_LITERAL) {
+            node->valueType = ValueType::Char;
+            operands.push_back(node);
+            types.push_back(ValueType::Char);
+        } else if (type == TokenType::TRUE || type == TokenType::FALSE) {
+            node->valueType = ValueType::Bool;
+            operands.push_back(node);
+            types.push_back(ValueType::Bool);
+        } else if (type == TokenType::STRING) {
+            node->valueType = ValueType::String;
+            operands.push_back(node);
+            types.push_back(ValueType::String);
+        } else if (type != TokenType::ASSIGNMENT_OPERATOR && type != TokenType::SINGLE_QUOTE &&
+                   type != TokenType::DOUBLE_QUOTE) {
+            // anything the executor skips over leaves the walk to the generic path
+            scalar = false;
+        }
+
+        if (!types.empty() && !isScalar(types.back())) {
+            scalar = false;
+        }
+
+        if (node->sibling == nullptr) {
+            break;
+        }
+        node = node->sibling;
+    }
+
+    // an empty expression evaluates to 0
+    ValueType result = types.empty() ? ValueType::Int : types.back();
+    start->scalarExpression = scalar && isScalar(result);
+    return result;
+}
+
+// From a call site, name ( arg , ... ), leaving node on the closing paren.
+// Returns the type of the call's result.
+ValueType TypeChecker::checkCall(ASTListNode*& node) {
+    ASTListNode* callNode = node;
+    SymbolTableListNode* param = callNode->callee ? callNode->callee->symbol->parameterList : nullptr;
+
+    node = node->sibling;
+    while (node && node->token->type != TokenType::R_PAREN) {
+        node = node->sibling;
+        if (!node || node->token->type == TokenType::R_PAREN) {
+            break;
+        }
+        ValueType type = checkExpression(node);
+        if (param) {
+            assign(param, type);
+            param = param->next();
+        }
+    }
+
+    if (!callNode->callee || callNode->callee->symbol->identifierType != TokenType::FUNCTION) {
+        return ValueType::Unknown;
+    }
+    return variableType(callNode);
+}
+
+ValueType TypeChecker::variableType(ASTListNode* node) {
+    SymbolTableListNode* symbol = node->symbol;
+    if (!symbol || _mixed.count(symbol)) {
+        return ValueType::Unknown;
+    }
+    // functions have no slot of their own but a declared result type
+    if (symbol->slot < 0 && symbol->identifierType != TokenType::FUNCTION) {
+        return ValueType::Unknown;
+    }
+    return datatypeOf(symbol);
+}
+
+// symbol receives a value of type, which it can only hold as an int when it
+// is a scalar
+void TypeChecker::assign(SymbolTableListNode* symbol, ValueType type) {
+    if (!symbol->isArray && !isScalar(type)) {
+        _mixed.insert(symbol);
+    }
+}
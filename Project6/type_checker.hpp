@@ -0,0 +1,43 @@
+#ifndef TYPE_CHECKER_HPP
+#define TYPE_CHECKER_HPP
+
+#include <unordered_set>
+
+#include "ast_list_node.hpp"
+#include "interpreter.hpp"
+#include "symbol_table_list_node.hpp"
+
+// Gives every node of every expression its static type and marks the
+// expressions that only ever produce ints (scalarExpression), which the
+// Executor evaluates without converting Values. Also links the right
+// operands of && and || to their operator (shortCircuit).
+//
+// A scalar variable is only trusted to hold an int while nothing assigns it,
+// passes it or returns into it a value that could be a string. Those
+// variables and functions are found by repeating the walk until nothing
+// changes, since a call can come before the function it calls.
+class TypeChecker {
+   public:
+    explicit TypeChecker(Interpreter& interpreter);
+    void check();
+
+   private:
+    Interpreter& interpreter;
+
+    // scalar variables that may hold a string, functions that may return one
+    std::unordered_set<SymbolTableListNode*> _mixed;
+    SymbolTableListNode* _function{nullptr};  // function of the row being checked
+
+   private:
+    void checkRow(ASTListNode* row);
+    void checkAssignment(ASTListNode* row);
+    ValueType checkExpression(ASTListNode*& node);
+    ValueType checkCall(ASTListNode*& node);
+
+    ValueType variableType(ASTListNode* node);
+    void assign(SymbolTableListNode* symbol, ValueType type);
+};
+
+bool isScalar(ValueType type);
+
+#endif  // TYPE_CHECKER_HPP
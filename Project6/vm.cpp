@@ -0,0 +1,784 @@
+#include "vm.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "arithmetic.hpp"
+
+#if CS460_JIT
+#include <sys/resource.h>
+#endif
+
+// operand stack slots, allocated once and only touched as far as it is used
+static constexpr size_t stackSize = size_t(1) << 24;
+
+// C++ stack native code may use at most
+static constexpr size_t nativeStackBudget = size_t(4) << 20;
+
+VirtualMachine::VirtualMachine(const Program& program, OutputBuffer& output)
+    : program(program), output(output), stack(new int[stackSize]), stackEnd(stack.get() + stackSize) {}
+
+void VirtualMachine::enableJit(int threshold, bool trace) {
+    if (!Jit::available()) {
+        return;
+    }
+    jit = std::make_unique<Jit>(program, JitRuntime{jitCall, jitSlowPath, jitDivByZero});
+    _jitThreshold = threshold;
+    _traceTiering = trace;
+    _calls.assign(program.functions.size(), 0);
+    _backEdges.assign(program.code.size(), 0);
+
+    // a function runs up to the next function's entry, like in Jit::compile,
+    // top-level code before the first function belongs to none
+    std::vector<std::pair<size_t, int>> entries;
+    for (size_t function = 0; function < program.functions.size(); function++) {
+        if (program.functions[function].entry != 0) {  // 0 when not reachable from main
+            entries.emplace_back(program.functions[function].entry, function);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    _functionAt.assign(program.code.size(), -1);
+    for (size_t i = 0; i < entries.size(); i++) {
+        size_t last = i + 1 < entries.size() ? entries[i + 1].first : program.code.size();
+        std::fill(_functionAt.begin() + entries[i].first, _functionAt.begin() + last, entries[i].second);
+    }
+}
+
+void VirtualMachine::run(Dispatch dispatch, bool counting) {
+    globals.assign(program.globalCount, 0);
+    frames.clear();
+    arrays.clear();
+    for (const std::string& text : program.strings) {
+        arrays.emplace_back(text);
+    }
+    _executed = 0;
+    _pendingError = nullptr;
+    _memo.clear();
+    _memo.resize(program.functions.size());
+    _memoKeys.clear();
+    _jitActive = jit && !counting;
+    if (_jitActive) {
+        setNativeStackLimit();
+    }
+    if (counting) {
+        _pairs.assign((opcodeCount + 1) * opcodeCount, 0);
+    }
+
+    if (dispatch == Dispatch::Threaded && threadedAvailable()) {
+        loop = counting ? &VirtualMachine::execute<true, true> : &VirtualMachine::execute<true, false>;
+    } else {
+        loop = counting ? &VirtualMachine::execute<false, true> : &VirtualMachine::execute<false, false>;
+    }
+    (this->*loop)(program.code.data(), stack.get(), stack.get(), SIZE_MAX);
+}
+
+uint64_t VirtualMachine::executed() const {
+    return _executed;
+}
+
+uint64_t VirtualMachine::pairCount(OpCode first, OpCode second) const {
+    return _pairs[static_cast<size_t>(first) * opcodeCount + static_cast<size_t>(second)];
+}
+
+bool VirtualMachine::threadedAvailable() {
+    return CS460_THREADED_DISPATCH;
+}
+
+const MemoTable* VirtualMachine::memoTable(size_t function) const {
+    return function < _memo.size() ? _memo[function].get() : nullptr;
+}
+
+// Pushes the frame of the call at ip, whose arguments are the top values of
+// the operand stack. Returns the frame's first slot.
+inline int* VirtualMachine::enterFrame(const Instruction* ip, int* sp, int* locals) {
+    const FunctionInfo& function = program.functions[ip->a];
+    int* base = sp - ip->b;
+    if (base + function.frameSize + function.maxStack > stackEnd) {
+        runtimeError(ip, "stack overflow.");
+    }
+
+    // the arguments already sit in the first slots of the new frame
+    std::fill(base + ip->b, base + function.frameSize, 0);
+    frames.push_back({ip + 1, static_cast<size_t>(locals - stack.get()), arrays.size()});
+    return base;
+}
+
+// Pops the running frame, whose slots start at locals, dropping its arrays
+// and leaving result in place of its arguments. Returns the caller's stack
+// pointer.
+inline int* VirtualMachine::leaveFrame(int* locals, int result) {
+    *locals = result;
+    if (frames.back().memoized >= 0) {
+        remember(frames.back().memoized, result);
+    }
+    arrays.resize(frames.back().arrayBase);
+    frames.pop_back();
+    return locals + 1;
+}
+
+// The result of the CALL_MEMOIZED at ip, whose arguments are the top values
+// of the operand stack, when an earlier call had the same arguments. Else
+// keeps the arguments, the callee may assign its parameters, until the
+// result is remembered, and returns nullptr.
+const int* VirtualMachine::memoized(const Instruction* ip, const int* sp) {
+    std::unique_ptr<MemoTable>& table = _memo[ip->a];
+    if (!table) {
+        table = std::make_unique<MemoTable>(ip->b);
+    }
+    const int* args = sp - ip->b;
+    if (const int* result = table->find(args)) {
+        return result;
+    }
+    _memoKeys.insert(_memoKeys.end(), args, args + ip->b);
+    return nullptr;
+}
+
+// Remembers the result of the innermost memoized call, which is returning
+void VirtualMachine::remember(int function, int result) {
+    MemoTable& table = *_memo[function];
+    const int* args = _memoKeys.data() + _memoKeys.size() - table.arity();
+    table.remember(args, result);
+    _memoKeys.resize(_memoKeys.size() - table.arity());
+}
+
+// Handlers are shared by both dispatch styles. Each one is a case of the
+// switch and, when threaded dispatch is built in, a label the previous
+// handler jumps to directly through the handler address recorded for every
+// instruction.
+#if CS460_THREADED_DISPATCH
+#define TARGET(name) \
+    case OpCode::name: \
+    op_##name:
+#else
+#define TARGET(name) \
+    case OpCode::name:
+#endif
+
+#define COUNT()                                                         \
+    do {                                                                \
+        if constexpr (Counting) {                                       \
+            executed++;                                                 \
+            size_t op = static_cast<size_t>(ip->op);                    \
+            _pairs[previous * opcodeCount + op]++;                      \
+            previous = op;                                              \
+        }                                                               \
+    } while (0)
+
+#if CS460_THREADED_DISPATCH
+#define DISPATCH()                          \
+    do {                                    \
+        COUNT();                            \
+        if constexpr (Threaded) {           \
+            goto* handlers[ip - code];      \
+        } else {                            \
+            goto dispatch;                  \
+        }                                   \
+    } while (0)
+#else
+#define DISPATCH()                          \
+    do {                                    \
+        COUNT();                            \
+        goto dispatch;                      \
+    } while (0)
+#endif
+
+#define BINARY(name, expression) \
+    TARGET(name) {               \
+        int rhs = *--sp;         \
+        int lhs = sp[-1];        \
+        sp[-1] = (expression);   \
+        ip++;                    \
+        DISPATCH();              \
+    }
+
+// Pops the running frame, leaving result on the caller's operand stack. Stops
+// when the call a native function made through jitCall is done.
+#define RETURN_FROM_FRAME(result)                         \
+    do {                                                  \
+        int value = (result);                             \
+        const CallFrame& frame = frames.back();           \
+        ip = frame.returnIp;                              \
+        int* callerLocals = stack.get() + frame.fp;       \
+        sp = leaveFrame(locals, value);                   \
+        locals = callerLocals;                            \
+        if (frames.size() == stopDepth) {                 \
+            _executed += executed;                        \
+            return sp;                                    \
+        }                                                 \
+        DISPATCH();                                       \
+    } while (0)
+
+#define COMPARE_BRANCH(name, compare)                                \
+    TARGET(name) {                                                  \
+        ip = locals[ip->a] compare ip->b ? ip + 1 : code + ip->c;  \
+        DISPATCH();                                                 \
+    }
+
+// the step and test of a counted loop, going around again is a back-edge
+#define LOOP_BRANCH(name, compare)                     \
+    TARGET(name) {                                     \
+        locals[ip->a] = wrappingAdd(locals[ip->a], 1); \
+        if (locals[ip->a] compare ip->b) {             \
+            if (_jitActive) {                          \
+                goto loopBackEdge;                     \
+            }                                          \
+            ip = code + ip->c;                         \
+        } else {                                       \
+            ip++;                                      \
+        }                                              \
+        DISPATCH();                                    \
+    }
+
+template <bool Threaded, bool Counting>
+int* VirtualMachine::execute(const Instruction* ip, int* sp, int* locals, size_t stopDepth) {
+    const Instruction* const code = program.code.data();
+    uint64_t executed = 0;
+    size_t previous = opcodeCount;  // row of the first instruction, it follows nothing
+
+#if CS460_THREADED_DISPATCH
+    static const void* const labels[] = {
+#define CS460_OPCODE_LABEL(name) &&op_##name,
+        CS460_OPCODES(CS460_OPCODE_LABEL)
+#undef CS460_OPCODE_LABEL
+    };
+
+    // direct threading, the handler of every instruction is looked up once
+    std::vector<const void*>& table = _handlers[Counting];
+    if constexpr (Threaded) {
+        if (table.empty()) {
+            table.resize(program.code.size());
+            for (size_t pc = 0; pc < program.code.size(); pc++) {
+                table[pc] = labels[static_cast<int>(code[pc].op)];
+            }
+        }
+    }
+    const void* const* handlers = table.data();
+#endif
+
+    DISPATCH();
+
+// only switch dispatch comes back here, threaded handlers jump to each other
+[[maybe_unused]] dispatch:
+    switch (ip->op) {
+        TARGET(PUSH) {
+            *sp++ = ip->a;
+            ip++;
+            DISPATCH();
+        }
+        TARGET(PUSH_STRING) {
+            *sp++ = ip->a;
+            ip++;
+            DISPATCH();
+        }
+        TARGET(LOAD_LOCAL) {
+            *sp++ = locals[ip->a];
+            ip++;
+            DISPATCH();
+        }
+        TARGET(STORE_LOCAL) {
+            locals[ip->a] = *--sp;
+            ip++;
+            DISPATCH();
+        }
+        TARGET(LOAD_GLOBAL) {
+            *sp++ = globals[ip->a];
+            ip++;
+            DISPATCH();
+        }
+        TARGET(STORE_GLOBAL) {
+            globals[ip->a] = *--sp;
+            ip++;
+            DISPATCH();
+        }
+        TARGET(NEW_ARRAY_LOCAL) {
+            newArray(locals[ip->a], ip->c, ip->b);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(NEW_ARRAY_GLOBAL) {
+            newArray(globals[ip->a], ip->c, ip->b);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(COPY_ARRAY_LOCAL) {
+            copyArray(*--sp, locals[ip->a], ip);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(COPY_ARRAY_GLOBAL) {
+            copyArray(*--sp, globals[ip->a], ip);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(LOAD_ELEMENT) {
+            int index = *--sp;
+            sp[-1] = arrayWithIndex(sp[-1], index, ip).get(index);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(STORE_ELEMENT) {
+            sp -= 3;
+            arrayWithIndex(sp[0], sp[1], ip).set(sp[1], sp[2]);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(LOAD_ELEMENT_UNCHECKED) {
+            int index = *--sp;
+            sp[-1] = arrays[sp[-1]].get(index);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(STORE_ELEMENT_UNCHECKED) {
+            sp -= 3;
+            arrays[sp[0]].set(sp[1], sp[2]);
+            ip++;
+            DISPATCH();
+        }
+        BINARY(ADD, wrappingAdd(lhs, rhs))
+        BINARY(SUB, wrappingSubtract(lhs, rhs))
+        BINARY(MUL, wrappingMultiply(lhs, rhs))
+        TARGET(DIV) {
+            int rhs = *--sp;
+            if (rhs == 0) {
+                runtimeError(ip, "division by zero.");
+            }
+            sp[-1] = wrappingDivide(sp[-1], rhs);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(MOD) {
+            int rhs = *--sp;
+            if (rhs == 0) {
+                runtimeError(ip, "division by zero.");
+            }
+            sp[-1] = wrappingModulo(sp[-1], rhs);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(POW) {
+            int rhs = *--sp;
+            if (powerDividesByZero(sp[-1], rhs)) {
+                runtimeError(ip, "division by zero.");
+            }
+            sp[-1] = integerPower(sp[-1], rhs);
+            ip++;
+            DISPATCH();
+        }
+        BINARY(LT, lhs < rhs)
+        BINARY(LE, lhs <= rhs)
+        BINARY(GT, lhs > rhs)
+        BINARY(GE, lhs >= rhs)
+        BINARY(EQ, lhs == rhs)
+        BINARY(NE, lhs != rhs)
+        TARGET(NOT) {
+            sp[-1] = !sp[-1];
+            ip++;
+            DISPATCH();
+        }
+        TARGET(JUMP) {
+            // a backward jump closes a loop, a hot loop continues in native
+            // code right at its header
+            if (_jitActive && ip->a < ip - code) {
+                if (const void* native = hotLoop(ip, ip->a)) {
+                    RETURN_FROM_FRAME(runNative(_functionAt[ip - code], native, sp, locals));
+                }
+            }
+            ip = code + ip->a;
+            DISPATCH();
+        }
+        TARGET(JUMP_IF_FALSE) {
+            ip = *--sp ? ip + 1 : code + ip->a;
+            DISPATCH();
+        }
+        TARGET(JUMP_IF_TRUE) {
+            ip = *--sp ? code + ip->a : ip + 1;
+            DISPATCH();
+        }
+        TARGET(JUMP_IF_FALSE_OR_POP) {
+            if (sp[-1]) {
+                sp--;
+                ip++;
+            } else {
+                ip = code + ip->a;
+            }
+            DISPATCH();
+        }
+        TARGET(JUMP_IF_TRUE_OR_POP) {
+            if (sp[-1]) {
+                sp[-1] = 1;
+                ip = code + ip->a;
+            } else {
+                sp--;
+                ip++;
+            }
+            DISPATCH();
+        }
+        TARGET(CALL) {
+            locals = enterFrame(ip, sp, locals);
+        enteredFrame:
+            sp = locals + program.functions[ip->a].frameSize;
+
+            if (_jitActive) {
+                if (const void* native = hotFunction(ip->a)) {
+                    RETURN_FROM_FRAME(runNative(ip->a, native, sp, locals));
+                }
+            }
+            ip = code + program.functions[ip->a].entry;
+            DISPATCH();
+        }
+        TARGET(TAIL_CALL) {
+            // the arguments sit above the frame, which gets them as its
+            // first slots and starts over
+            const FunctionInfo& function = program.functions[ip->a];
+            sp -= ip->b;
+            std::copy(sp, sp + ip->b, locals);
+            std::fill(locals + ip->b, locals + function.frameSize, 0);
+            sp = locals + function.frameSize;
+            if (_jitActive) {
+                goto tailCallBackEdge;
+            }
+            ip = code + function.entry;
+            DISPATCH();
+        }
+        TARGET(CALL_MEMOIZED) {
+            if (const int* result = memoized(ip, sp)) {
+                sp -= ip->b;
+                *sp++ = *result;
+                ip++;
+                DISPATCH();
+            }
+            locals = enterFrame(ip, sp, locals);
+            frames.back().memoized = ip->a;
+            goto enteredFrame;
+        }
+        TARGET(RETURN) {
+            RETURN_FROM_FRAME(sp[-1]);
+        }
+        TARGET(POP) {
+            sp--;
+            ip++;
+            DISPATCH();
+        }
+        TARGET(DUP) {
+            *sp = sp[-1];
+            sp++;
+            ip++;
+            DISPATCH();
+        }
+        TARGET(PRINTF) {
+            sp -= ip->b;
+            print(ip, sp);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(HALT) {
+            _executed += executed;
+            return sp;
+        }
+        TARGET(INC_LOCAL) {
+            locals[ip->a] = wrappingAdd(locals[ip->a], ip->b);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(INC_GLOBAL) {
+            globals[ip->a] = wrappingAdd(globals[ip->a], ip->b);
+            ip++;
+            DISPATCH();
+        }
+        COMPARE_BRANCH(JUMP_UNLESS_LOCAL_LT, <)
+        COMPARE_BRANCH(JUMP_UNLESS_LOCAL_LE, <=)
+        COMPARE_BRANCH(JUMP_UNLESS_LOCAL_GT, >)
+        COMPARE_BRANCH(JUMP_UNLESS_LOCAL_GE, >=)
+        COMPARE_BRANCH(JUMP_UNLESS_LOCAL_EQ, ==)
+        COMPARE_BRANCH(JUMP_UNLESS_LOCAL_NE, !=)
+        LOOP_BRANCH(LOOP_LT_LOCAL, <)
+        LOOP_BRANCH(LOOP_LE_LOCAL, <=)
+        TARGET(MUL_ADD_LOCAL) {
+            locals[ip->a] = wrappingAdd(wrappingMultiply(locals[ip->a], ip->b), *--sp);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(MUL_POW2) {
+            sp[-1] = multiplyByPowerOfTwo(sp[-1], ip->a);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(DIV_POW2) {
+            sp[-1] = divideByPowerOfTwo(sp[-1], ip->a);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(MOD_POW2) {
+            sp[-1] = moduloPowerOfTwo(sp[-1], ip->a);
+            ip++;
+            DISPATCH();
+        }
+    }
+
+    // the back-edge of LOOP_LT_LOCAL and LOOP_LE_LOCAL with the JIT on,
+    // shared and out of the way of their handlers
+loopBackEdge:
+    if (const void* native = hotLoop(ip, ip->c)) {
+        RETURN_FROM_FRAME(runNative(_functionAt[ip - code], native, sp, locals));
+    }
+    ip = code + ip->c;
+    DISPATCH();
+
+    // TAIL_CALL with the JIT on, a back-edge to the function's entry
+tailCallBackEdge:
+    if (const void* native = hotLoop(ip, program.functions[ip->a].entry)) {
+        RETURN_FROM_FRAME(runNative(ip->a, native, sp, locals));
+    }
+    ip = code + program.functions[ip->a].entry;
+    DISPATCH();
+}
+
+#undef LOOP_BRANCH
+#undef COMPARE_BRANCH
+#undef RETURN_FROM_FRAME
+#undef BINARY
+#undef DISPATCH
+#undef COUNT
+#undef TARGET
+
+// Past the native stack limit even compiled functions stay in the
+// interpreter, which does not grow the C++ stack
+bool VirtualMachine::nativeStackLeft() const {
+    char marker;
+    return reinterpret_cast<uintptr_t>(&marker) >= _nativeStackLimit;
+}
+
+// Counts a call of function, compiling it once it is hot. Returns the native
+// entry of the function when it has been compiled.
+const void* VirtualMachine::hotFunction(int function) {
+    if (!nativeStackLeft()) {
+        return nullptr;
+    }
+    if (!jit->compiled(function)) {
+        if (++_calls[function] < _jitThreshold) {
+            return nullptr;
+        }
+        if (!tierUp(function, std::to_string(_calls[function]) + " calls")) {
+            return nullptr;
+        }
+    }
+    return jit->address(function, program.functions[function].entry);
+}
+
+// Counts the back-edge at ip to header, compiling its function once the loop
+// is hot. Returns the native address of the loop header when the function has
+// been compiled, execution moves there on the spot.
+const void* VirtualMachine::hotLoop(const Instruction* ip, size_t header) {
+    size_t pc = ip - program.code.data();
+    int function = _functionAt[pc];
+    if (function < 0 || !nativeStackLeft()) {
+        return nullptr;
+    }
+    if (!jit->compiled(function)) {
+        if (++_backEdges[pc] < _jitThreshold) {
+            return nullptr;
+        }
+        std::string reason = std::to_string(_backEdges[pc]) + " iterations of the loop on line " +
+                             std::to_string(program.lines[header]);
+        if (!tierUp(function, reason)) {
+            return nullptr;
+        }
+    }
+    if (_traceTiering) {
+        std::cerr << "[tiering] " << program.functions[function].name
+                  << ": entering native code at the loop on line " << program.lines[header] << "\n";
+    }
+    return jit->address(function, header);
+}
+
+// Compiles function to native code, turning the JIT off when that fails
+bool VirtualMachine::tierUp(int function, const std::string& reason) {
+    if (!jit->compile(function)) {
+        _jitActive = false;
+        return false;
+    }
+    if (_traceTiering) {
+        std::cerr << "[tiering] " << program.functions[function].name << ": compiled to native code after "
+                  << reason << " (" << jit->codeSize(function) << " bytes)\n";
+    }
+    return true;
+}
+
+// Native functions and the interpreter loops they re-enter recurse on the C++
+// stack, which is much smaller than the VM's. They get half of what is left
+// of it, up to nativeStackBudget.
+void VirtualMachine::setNativeStackLimit() {
+    size_t budget = nativeStackBudget;
+#if CS460_JIT
+    rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        budget = std::min<size_t>(budget, limit.rlim_cur / 2);
+    }
+#endif
+    char marker;
+    _nativeStackLimit = reinterpret_cast<uintptr_t>(&marker) - budget;
+}
+
+// Runs native code of function from entry on the frame at locals until the
+// function returns, rethrowing any error raised inside it
+int VirtualMachine::runNative(int function, const void* entry, int* sp, int* locals) {
+    JitContext context{sp, locals, globals.data(), entry, this, stackEnd,
+                       reinterpret_cast<const void*>(_nativeStackLimit)};
+    int result = jit->invoke(function, context);
+    if (_pendingError) {
+        std::exception_ptr error = _pendingError;
+        _pendingError = nullptr;
+        std::rethrow_exception(error);
+    }
+    return result;
+}
+
+// Exceptions cannot unwind through native code, the runtime functions below
+// park them in _pendingError and return nullptr instead
+
+// CALL and CALL_MEMOIZED from native code, the callee runs natively when it
+// is hot and in the interpreter otherwise
+int* VirtualMachine::jitCall(JitContext* context, const Instruction* ip, int* sp) {
+    VirtualMachine* vm = static_cast<VirtualMachine*>(context->vm);
+    try {
+        bool memoize = ip->op == OpCode::CALL_MEMOIZED;
+        if (memoize) {
+            if (const int* result = vm->memoized(ip, sp)) {
+                sp -= ip->b;
+                *sp = *result;
+                return sp + 1;
+            }
+        }
+        int* locals = vm->enterFrame(ip, sp, context->locals);
+        if (memoize) {
+            vm->frames.back().memoized = ip->a;
+        }
+        const FunctionInfo& function = vm->program.functions[ip->a];
+        int* calleeSp = locals + function.frameSize;
+
+        if (const void* native = vm->hotFunction(ip->a)) {
+            int result = vm->runNative(ip->a, native, calleeSp, locals);
+            return vm->leaveFrame(locals, result);
+        }
+        return (vm->*vm->loop)(vm->program.code.data() + function.entry, calleeSp, locals, vm->frames.size() - 1);
+    } catch (...) {
+        vm->_pendingError = std::current_exception();
+        return nullptr;
+    }
+}
+
+// instructions native code leaves to C++
+int* VirtualMachine::jitSlowPath(JitContext* context, const Instruction* ip, int* sp) {
+    VirtualMachine* vm = static_cast<VirtualMachine*>(context->vm);
+    int* locals = context->locals;
+    try {
+        switch (ip->op) {
+            case OpCode::NEW_ARRAY_LOCAL:
+                vm->newArray(locals[ip->a], ip->c, ip->b);
+                break;
+            case OpCode::NEW_ARRAY_GLOBAL:
+                vm->newArray(vm->globals[ip->a], ip->c, ip->b);
+                break;
+            case OpCode::COPY_ARRAY_LOCAL:
+                sp--;
+                vm->copyArray(*sp, locals[ip->a], ip);
+                break;
+            case OpCode::COPY_ARRAY_GLOBAL:
+                sp--;
+                vm->copyArray(*sp, vm->globals[ip->a], ip);
+                break;
+            case OpCode::LOAD_ELEMENT: {
+                int index = *--sp;
+                sp[-1] = vm->arrayWithIndex(sp[-1], index, ip).get(index);
+                break;
+            }
+            case OpCode::STORE_ELEMENT:
+                sp -= 3;
+                vm->arrayWithIndex(sp[0], sp[1], ip).set(sp[1], sp[2]);
+                break;
+            case OpCode::LOAD_ELEMENT_UNCHECKED: {
+                int index = *--sp;
+                sp[-1] = vm->arrays[sp[-1]].get(index);
+                break;
+            }
+            case OpCode::STORE_ELEMENT_UNCHECKED:
+                sp -= 3;
+                vm->arrays[sp[0]].set(sp[1], sp[2]);
+                break;
+            case OpCode::PRINTF:
+                sp -= ip->b;
+                vm->print(ip, sp);
+                break;
+            case OpCode::POW: {
+                int rhs = *--sp;
+                if (powerDividesByZero(sp[-1], rhs)) {
+                    vm->runtimeError(ip, "division by zero.");
+                }
+                sp[-1] = integerPower(sp[-1], rhs);
+                break;
+            }
+            default:
+                vm->runtimeError(ip, std::string("no native code for ") + opcodeName(ip->op) + ".");
+        }
+        return sp;
+    } catch (...) {
+        vm->_pendingError = std::current_exception();
+        return nullptr;
+    }
+}
+
+int* VirtualMachine::jitDivByZero(JitContext* context, const Instruction* ip, int*) {
+    VirtualMachine* vm = static_cast<VirtualMachine*>(context->vm);
+    try {
+        vm->runtimeError(ip, "division by zero.");
+    } catch (...) {
+        vm->_pendingError = std::current_exception();
+    }
+    return nullptr;
+}
+
+void VirtualMachine::newArray(int& slot, int type, int size) {
+    slot = arrays.size();
+    arrays.emplace_back(static_cast<ElementType>(type), size);
+}
+
+void VirtualMachine::copyArray(int source, int target, const Instruction* ip) {
+    std::string error = arrayAt(target, ip).assign(arrayAt(source, ip));
+    if (!error.empty()) {
+        runtimeError(ip, error);
+    }
+}
+
+Array& VirtualMachine::arrayAt(int handle, const Instruction* ip) {
+    if (handle < 0 || static_cast<size_t>(handle) >= arrays.size()) {
+        runtimeError(ip, "value is not an array.");
+    }
+    return arrays[handle];
+}
+
+// the array at handle, which has an element index
+Array& VirtualMachine::arrayWithIndex(int handle, int index, const Instruction* ip) {
+    Array& array = arrayAt(handle, ip);
+    if (!array.contains(index)) {
+        runtimeError(ip, outOfRange(index, array.size()));
+    }
+    return array;
+}
+
+// Same output as Executor::executePrintf, args holds the values of the
+// instruction's b arguments
+void VirtualMachine::print(const Instruction* ip, const int* args) {
+    writeFormatted(
+        program.formats[ip->a], output, [&](int i) { return args[i]; },
+        [&](int i) { return arrayAt(args[i], ip).chars(); });
+}
+
+void VirtualMachine::runtimeError(const Instruction* ip, const std::string& message) {
+    throw std::runtime_error("Error on line " + std::to_string(program.lines[ip - program.code.data()]) + ": " +
+                             message);
+}
@@ -0,0 +1,126 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "array.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "memo_table.hpp"
+#include "options.hpp"
+#include "output_buffer.hpp"
+
+// Threaded dispatch needs the GCC/Clang labels-as-values extension, define
+// CS460_SWITCH_DISPATCH to build the portable switch loop only
+#if defined(__GNUC__) && !defined(CS460_SWITCH_DISPATCH)
+#define CS460_THREADED_DISPATCH 1
+#else
+#define CS460_THREADED_DISPATCH 0
+#endif
+
+// Stack machine running a compiled Program. Every value is an int, arrays are
+// handles into a heap whose first entries are the program's string constants.
+class VirtualMachine {
+   public:
+    // printf goes to output
+    VirtualMachine(const Program& program, OutputBuffer& output);
+
+    // Tiering: a function is compiled to native code once it has been called
+    // threshold times, and so is the function of a loop that has run
+    // threshold times, which then continues natively from its header. trace
+    // logs every tier-up to stderr. Nothing happens when the JIT is not
+    // built in.
+    void enableJit(int threshold, bool trace = false);
+
+    // Runs the program from its first instruction. Falls back to the switch
+    // when threaded dispatch was not built in. Counting runs never use the JIT.
+    void run(Dispatch dispatch, bool counting = false);
+
+    // instructions executed by the last counting run
+    uint64_t executed() const;
+
+    // times second ran right after first in the last counting run
+    uint64_t pairCount(OpCode first, OpCode second) const;
+
+    static bool threadedAvailable();
+
+    // results the last run remembered for CALL_MEMOIZED of function, nullptr
+    // when it was never called that way
+    const MemoTable* memoTable(size_t function) const;
+
+   private:
+    // Activation record of a single call, its slots start at stack[fp]
+    struct CallFrame {
+        const Instruction* returnIp;
+        size_t fp;         // caller's frame
+        size_t arrayBase;  // heap size at the call, local arrays are above it
+        int memoized{-1};  // function whose MemoTable gets the result, if any
+    };
+
+    // one of the execute instantiations, picked by run
+    using Loop = int* (VirtualMachine::*)(const Instruction* ip, int* sp, int* locals, size_t stopDepth);
+
+    // Interprets from ip until HALT, or until the call that leaves stopDepth
+    // frames on the call stack returns. Returns the stack pointer then.
+    template <bool Threaded, bool Counting>
+    int* execute(const Instruction* ip, int* sp, int* locals, size_t stopDepth);
+
+    int* enterFrame(const Instruction* ip, int* sp, int* locals);
+    int* leaveFrame(int* locals, int result);
+    const int* memoized(const Instruction* ip, const int* sp);
+    void remember(int function, int result);
+
+    // JIT tiering
+    bool nativeStackLeft() const;
+    const void* hotFunction(int function);
+    const void* hotLoop(const Instruction* ip, size_t header);
+    bool tierUp(int function, const std::string& reason);
+    void setNativeStackLimit();
+    int runNative(int function, const void* entry, int* sp, int* locals);
+    static int* jitCall(JitContext* context, const Instruction* ip, int* sp);
+    static int* jitSlowPath(JitContext* context, const Instruction* ip, int* sp);
+    static int* jitDivByZero(JitContext* context, const Instruction* ip, int* sp);
+
+    void newArray(int& slot, int type, int size);
+    void copyArray(int source, int target, const Instruction* ip);
+    Array& arrayAt(int handle, const Instruction* ip);
+    Array& arrayWithIndex(int handle, int index, const Instruction* ip);
+    void print(const Instruction* ip, const int* args);
+    [[noreturn]] void runtimeError(const Instruction* ip, const std::string& message);
+
+   private:
+    const Program& program;
+    OutputBuffer& output;
+
+    // fixed size, native code keeps pointers into it
+    std::unique_ptr<int[]> stack;
+    int* stackEnd{nullptr};
+    std::vector<int> globals;
+    std::vector<CallFrame> frames;
+    std::vector<Array> arrays;
+
+    Loop loop{nullptr};
+    std::vector<const void*> _handlers[2];  // threaded handler of every instruction, without/with counting
+
+    std::unique_ptr<Jit> jit;
+    int _jitThreshold{0};
+    bool _jitActive{false};  // JIT enabled and not counting
+    bool _traceTiering{false};
+    uintptr_t _nativeStackLimit{0};  // native code only runs while the C++ stack is above this
+    std::vector<int> _calls;       // of each function
+    std::vector<int> _backEdges;   // times each backward jump was taken
+    std::vector<int> _functionAt;  // function each instruction belongs to
+    std::exception_ptr _pendingError;
+
+    std::vector<std::unique_ptr<MemoTable>> _memo;  // of each function, made on its first memoized call
+    std::vector<int> _memoKeys;  // arguments of the memoized calls still running, innermost last
+
+    uint64_t _executed{0};
+    std::vector<uint64_t> _pairs;  // opcodeCount x opcodeCount, plus a row for the start
+};
+
+#endif  // VM_HPP